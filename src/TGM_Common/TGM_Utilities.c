@@ -152,6 +152,52 @@ unsigned int FindMedianUint(unsigned int array[], unsigned int size)
     return median;
 }
 
+TGM_SortKey* TGM_RadixSortKeys(TGM_SortKey* pKeys, TGM_SortKey* pTemp, uint64_t size)
+{
+    // histograms of all the digits in one pass
+    uint64_t count[8][256];
+    memset(count, 0, sizeof(count));
+
+    for (uint64_t i = 0; i != size; ++i)
+    {
+        uint64_t key = pKeys[i].key;
+        for (unsigned int d = 0; d != 8; ++d)
+            ++(count[d][(key >> (d * 8)) & 0xff]);
+    }
+
+    TGM_SortKey* pSrc = pKeys;
+    TGM_SortKey* pDst = pTemp;
+
+    for (unsigned int d = 0; d != 8; ++d)
+    {
+        uint64_t offset = 0;
+        TGM_Bool isSkipped = FALSE;
+
+        for (unsigned int b = 0; b != 256; ++b)
+        {
+            if (count[d][b] == size)
+            {
+                isSkipped = TRUE;
+                break;
+            }
+
+            uint64_t bucketSize = count[d][b];
+            count[d][b] = offset;
+            offset += bucketSize;
+        }
+
+        if (isSkipped)
+            continue;
+
+        for (uint64_t i = 0; i != size; ++i)
+            pDst[count[d][(pSrc[i].key >> (d * 8)) & 0xff]++] = pSrc[i];
+
+        TGM_SWAP(pSrc, pDst, TGM_SortKey*);
+    }
+
+    return pSrc;
+}
+
 char* TGM_CreateFileName(const char* workingDir, const char* fileName)
 {
     unsigned int dirLen = strlen(workingDir);
@@ -161,6 +161,36 @@
 
 #define TGM_ARRAY_IS_FULL(pArray) ((pArray)->size == (pArray)->capacity)
 
+
+//=======================
+// Sorting utilities
+//=======================
+
+// an unsigned integer key and the index of the element it belongs to
+typedef struct TGM_SortKey
+{
+    uint64_t key;
+
+    uint64_t index;
+
+}TGM_SortKey;
+
+//=================================================================
+// function:
+//      stable LSD radix sort of the keys with 8-bit digits. digits
+//      that are the same in all the keys are skipped
+//
+// args:
+//      1. pKeys: the keys to be sorted
+//      2. pTemp: a buffer that holds at least the same number of
+//                keys
+//      3. size: number of keys
+//
+// return:
+//      a pointer to the sorted keys (either pKeys or pTemp)
+//=================================================================
+TGM_SortKey* TGM_RadixSortKeys(TGM_SortKey* pKeys, TGM_SortKey* pTemp, uint64_t size);
+
 int FindKthSmallestInt(int array[], int size, int k);
 
 int FindMedianInt(int array[], int size);
@@ -16,16 +16,139 @@
  * =====================================================================================
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-#include "khash.h"
 #include "TGM_Error.h"
 #include "TGM_Cluster.h"
 #include "TGM_Utilities.h"
 
 #define DEFAULT_CLUSTER_SIZE 20
 
-KHASH_MAP_INIT_INT(clusterMap, int);
+// minimum number of read pairs for each thread of the parallel cluster kernel
+#define TGM_CLUSTER_PAR_MIN (1 << 15)
+
+// build with -DTGM_CLUSTER_CHECK to redo every parallel run of the cluster kernel with the
+// serial one and quit on the first difference. it doubles the clustering time
+
+// a slice of the attribute array processed by one thread. the neighbourhood windows
+// of the read pairs at the ends of the slice overlap with the neighbouring slices
+typedef struct TGM_ClusterSlice
+{
+    TGM_Cluster* pCluster;              // the cluster object
+
+    unsigned int begin;                 // first read pair of the slice
+
+    unsigned int end;                   // end of the slice
+
+    unsigned int lowCarry;              // window start of the read pair right before the slice
+
+}TGM_ClusterSlice;
+
+// count the read pairs in [begin, end) whose second attribute is within the boundary
+static inline int TGM_ClusterCountNeighbours(const int32_t* pSecond, unsigned int begin, unsigned int end, int32_t second, int32_t secondBound)
+{
+    int count = 0;
+    unsigned int j = begin;
+
+#ifdef __SSE2__
+    __m128i vSecond = _mm_set1_epi32(second);
+    __m128i vLow = _mm_set1_epi32(-secondBound - 1);
+    __m128i vHigh = _mm_set1_epi32(secondBound + 1);
+    __m128i vCount = _mm_setzero_si128();
+
+    for (; j + 4 <= end; j += 4)
+    {
+        __m128i vDiff = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (pSecond + j)), vSecond);
+        __m128i vIn = _mm_and_si128(_mm_cmpgt_epi32(vDiff, vLow), _mm_cmplt_epi32(vDiff, vHigh));
+
+        // the mask is -1 for a neighbour
+        vCount = _mm_sub_epi32(vCount, vIn);
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i*) lanes, vCount);
+    count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; j != end; ++j)
+    {
+        if (abs(pSecond[j] - second) <= secondBound)
+            ++count;
+    }
+
+    return count;
+}
+
+// find the first read pair in [begin, end) with the largest neighbour count among those whose second
+// attribute is within the boundary
+static inline unsigned int TGM_ClusterFindCenter(const int32_t* pSecond, const int* pCount, unsigned int begin, unsigned int end,
+                                                 int32_t second, int32_t secondBound)
+{
+    int maxCount = 0;
+    unsigned int centerIndex = 0;
+    unsigned int j = begin;
+
+#ifdef __SSE2__
+    if (j + 4 <= end)
+    {
+        __m128i vSecond = _mm_set1_epi32(second);
+        __m128i vLow = _mm_set1_epi32(-secondBound - 1);
+        __m128i vHigh = _mm_set1_epi32(secondBound + 1);
+        __m128i vMax = _mm_setzero_si128();
+        __m128i vCenter = _mm_setzero_si128();
+        __m128i vIndex = _mm_setr_epi32(j, j + 1, j + 2, j + 3);
+        __m128i vStep = _mm_set1_epi32(4);
+
+        // each lane keeps its first maximum
+        for (; j + 4 <= end; j += 4)
+        {
+            __m128i vDiff = _mm_sub_epi32(_mm_loadu_si128((const __m128i*) (pSecond + j)), vSecond);
+            __m128i vIn = _mm_and_si128(_mm_cmpgt_epi32(vDiff, vLow), _mm_cmplt_epi32(vDiff, vHigh));
+            __m128i vCount = _mm_and_si128(_mm_loadu_si128((const __m128i*) (pCount + j)), vIn);
+
+            __m128i vGreater = _mm_cmpgt_epi32(vCount, vMax);
+            vMax = _mm_or_si128(_mm_and_si128(vGreater, vCount), _mm_andnot_si128(vGreater, vMax));
+            vCenter = _mm_or_si128(_mm_and_si128(vGreater, vIndex), _mm_andnot_si128(vGreater, vCenter));
+
+            vIndex = _mm_add_epi32(vIndex, vStep);
+        }
+
+        int32_t maxLanes[4];
+        int32_t centerLanes[4];
+        _mm_storeu_si128((__m128i*) maxLanes, vMax);
+        _mm_storeu_si128((__m128i*) centerLanes, vCenter);
+
+        // ties between the lanes go to the smallest index
+        for (unsigned int k = 0; k != 4; ++k)
+        {
+            if (maxLanes[k] > maxCount || (maxLanes[k] == maxCount && maxCount > 0 && (unsigned int) centerLanes[k] < centerIndex))
+            {
+                maxCount = maxLanes[k];
+                centerIndex = centerLanes[k];
+            }
+        }
+    }
+#endif
+
+    for (; j != end; ++j)
+    {
+        if (abs(pSecond[j] - second) <= secondBound && pCount[j] > maxCount)
+        {
+            centerIndex = j;
+            maxCount = pCount[j];
+        }
+    }
+
+    return centerIndex;
+}
 
 
 static void TGM_ClusterUpdateElmnt(TGM_Cluster* pCluster, int clusterID, int attrbtID)
@@ -33,19 +156,26 @@ static void TGM_ClusterUpdateElmnt(TGM_Cluster* pCluster, int clusterID, int att
     TGM_ClusterElmnt* pElmnt = TGM_ARRAY_GET_PT(pCluster->pElmntArray, clusterID);
     TGM_ReadPairAttrbt* pAttrbt = TGM_ARRAY_GET_PT(pCluster->pAttrbtArray, attrbtID);
 
+    // the cluster elements are kept in bases
+    double firstAttribute = TGM_ATTRBT_TO_BASE(pAttrbt->firstAttribute);
+    double secondAttribute = TGM_ATTRBT_TO_BASE(pAttrbt->secondAttribute);
+
     ++pElmnt->numReadPair;
 
-    pElmnt->mean[0] += pAttrbt->firstAttribute;
-    pElmnt->mean[1] += pAttrbt->secondAttribute;
+    // Welford's update. the sum of squared deviations is kept in std until the element is finalized
+    double delta[2] = {firstAttribute - pElmnt->mean[0], secondAttribute - pElmnt->mean[1]};
 
-    pElmnt->std[0] += pAttrbt->firstAttribute * pAttrbt->firstAttribute;
-    pElmnt->std[1] += pAttrbt->secondAttribute * pAttrbt->secondAttribute;
+    pElmnt->mean[0] += delta[0] / pElmnt->numReadPair;
+    pElmnt->mean[1] += delta[1] / pElmnt->numReadPair;
 
-    pElmnt->min[0] = (pAttrbt->firstAttribute < pElmnt->min[0] ? pAttrbt->firstAttribute : pElmnt->min[0]);
-    pElmnt->min[1] = (pAttrbt->secondAttribute < pElmnt->min[1] ? pAttrbt->secondAttribute : pElmnt->min[1]);
+    pElmnt->std[0] += delta[0] * (firstAttribute - pElmnt->mean[0]);
+    pElmnt->std[1] += delta[1] * (secondAttribute - pElmnt->mean[1]);
 
-    pElmnt->max[0] = (pAttrbt->firstAttribute > pElmnt->max[0] ? pAttrbt->firstAttribute : pElmnt->max[0]);
-    pElmnt->max[1] = (pAttrbt->secondAttribute > pElmnt->max[1] ? pAttrbt->secondAttribute : pElmnt->max[1]);
+    pElmnt->min[0] = (firstAttribute < pElmnt->min[0] ? firstAttribute : pElmnt->min[0]);
+    pElmnt->min[1] = (secondAttribute < pElmnt->min[1] ? secondAttribute : pElmnt->min[1]);
+
+    pElmnt->max[0] = (firstAttribute > pElmnt->max[0] ? firstAttribute : pElmnt->max[0]);
+    pElmnt->max[1] = (secondAttribute > pElmnt->max[1] ? secondAttribute : pElmnt->max[1]);
 }
 
 static int TGM_ClusterAddElmnt(TGM_Cluster* pCluster, int attrbtID)
@@ -62,20 +192,23 @@ static int TGM_ClusterAddElmnt(TGM_Cluster* pCluster, int attrbtID)
     TGM_ClusterElmnt* pElmnt = TGM_ARRAY_GET_PT(pCluster->pElmntArray, clusterID);
     TGM_ReadPairAttrbt* pAttrbt = TGM_ARRAY_GET_PT(pCluster->pAttrbtArray, attrbtID);
 
+    double firstAttribute = TGM_ATTRBT_TO_BASE(pAttrbt->firstAttribute);
+    double secondAttribute = TGM_ATTRBT_TO_BASE(pAttrbt->secondAttribute);
+
     pElmnt->numReadPair = 1;
     pElmnt->startIndex = attrbtID;
 
-    pElmnt->mean[0] = pAttrbt->firstAttribute;
-    pElmnt->mean[1] = pAttrbt->secondAttribute;
+    pElmnt->mean[0] = firstAttribute;
+    pElmnt->mean[1] = secondAttribute;
 
-    pElmnt->std[0] = pAttrbt->firstAttribute * pAttrbt->firstAttribute;
-    pElmnt->std[1] = pAttrbt->secondAttribute * pAttrbt->secondAttribute;
+    pElmnt->std[0] = 0.0;
+    pElmnt->std[1] = 0.0;
 
-    pElmnt->min[0] = pAttrbt->firstAttribute;
-    pElmnt->min[1] = pAttrbt->secondAttribute;
+    pElmnt->min[0] = firstAttribute;
+    pElmnt->min[1] = secondAttribute;
 
-    pElmnt->max[0] = pAttrbt->firstAttribute;
-    pElmnt->max[1] = pAttrbt->secondAttribute;
+    pElmnt->max[0] = firstAttribute;
+    pElmnt->max[1] = secondAttribute;
 
     return clusterID;
 }
@@ -90,9 +223,22 @@ TGM_Cluster* TGM_ClusterAlloc(int minReadPairNum)
 
     pCluster->pAttrbtArray = NULL;
     pCluster->pCount = NULL;
+    pCluster->pElmntID = NULL;
     pCluster->pMap = NULL;
     pCluster->pNext = NULL;
 
+    pCluster->pFirst = NULL;
+    pCluster->pSecond = NULL;
+    pCluster->pFirstBound = NULL;
+    pCluster->pSecondBound = NULL;
+    pCluster->pLow = NULL;
+    pCluster->pHigh = NULL;
+
+    pCluster->pMembers = NULL;
+    pCluster->pMemberOffsets = NULL;
+    pCluster->memberOffsetsCap = 0;
+    pCluster->numCompacted = 0;
+
     pCluster->size = 0;
     pCluster->capacity = 0;
 
@@ -100,6 +246,8 @@ TGM_Cluster* TGM_ClusterAlloc(int minReadPairNum)
     pCluster->minStd[0] = -1;
     pCluster->minStd[1] = -1;
 
+    pCluster->numThreads = 1;
+
     return pCluster;
 }
 
@@ -110,6 +258,17 @@ void TGM_ClusterFree(TGM_Cluster* pCluster)
         free(pCluster->pNext);
         free(pCluster->pMap);
         free(pCluster->pCount);
+        free(pCluster->pElmntID);
+
+        free(pCluster->pFirst);
+        free(pCluster->pSecond);
+        free(pCluster->pFirstBound);
+        free(pCluster->pSecondBound);
+        free(pCluster->pLow);
+        free(pCluster->pHigh);
+
+        free(pCluster->pMembers);
+        free(pCluster->pMemberOffsets);
 
         TGM_ARRAY_FREE(pCluster->pElmntArray, TRUE);
 
@@ -123,6 +282,11 @@ void TGM_ClusterSetMinStd(TGM_Cluster* pCluster, double minStd[2])
     pCluster->minStd[1] = minStd[1];
 }
 
+void TGM_ClusterSetNumThreads(TGM_Cluster* pCluster, unsigned int numThreads)
+{
+    pCluster->numThreads = (numThreads == 0 ? 1 : numThreads);
+}
+
 void TGM_ClusterInit(TGM_Cluster* pCluster, const TGM_ReadPairAttrbtArray* pAttrbtArray)
 {
     TGM_ARRAY_RESET(pCluster->pElmntArray);
@@ -135,6 +299,15 @@ void TGM_ClusterInit(TGM_Cluster* pCluster, const TGM_ReadPairAttrbtArray* pAttr
         free(pCluster->pNext);
         free(pCluster->pMap);
         free(pCluster->pCount);
+        free(pCluster->pElmntID);
+
+        free(pCluster->pFirst);
+        free(pCluster->pSecond);
+        free(pCluster->pFirstBound);
+        free(pCluster->pSecondBound);
+        free(pCluster->pLow);
+        free(pCluster->pHigh);
+        free(pCluster->pMembers);
 
         pCluster->capacity = pAttrbtArray->size * 2;
 
@@ -149,13 +322,41 @@ void TGM_ClusterInit(TGM_Cluster* pCluster, const TGM_ReadPairAttrbtArray* pAttr
         pCluster->pCount = (int*) malloc(pCluster->capacity * sizeof(int));
         if (pCluster->pCount == NULL)
             TGM_ErrQuit("ERROR: Not enough memory for the storage of the neighbour count in a cluster object.\n");
+
+        pCluster->pElmntID = (int*) malloc(pCluster->capacity * sizeof(int));
+        if (pCluster->pElmntID == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the storage of the cluster element IDs in a cluster object.\n");
+
+        pCluster->pFirst = (int32_t*) malloc(pCluster->capacity * sizeof(int32_t));
+        pCluster->pSecond = (int32_t*) malloc(pCluster->capacity * sizeof(int32_t));
+        pCluster->pFirstBound = (int32_t*) malloc(pCluster->capacity * sizeof(int32_t));
+        pCluster->pSecondBound = (int32_t*) malloc(pCluster->capacity * sizeof(int32_t));
+        if (pCluster->pFirst == NULL || pCluster->pSecond == NULL || pCluster->pFirstBound == NULL || pCluster->pSecondBound == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the storage of the attributes in a cluster object.\n");
+
+        pCluster->pLow = (unsigned int*) malloc(pCluster->capacity * sizeof(unsigned int));
+        pCluster->pHigh = (unsigned int*) malloc(pCluster->capacity * sizeof(unsigned int));
+        if (pCluster->pLow == NULL || pCluster->pHigh == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the storage of the neighbourhood windows in a cluster object.\n");
+
+        pCluster->pMembers = (unsigned int*) malloc(pCluster->capacity * sizeof(unsigned int));
+        if (pCluster->pMembers == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the storage of the cluster members in a cluster object.\n");
     }
 
+    pCluster->numCompacted = 0;
+
     for (unsigned int i = 0; i != pCluster->size; ++i)
     {
         pCluster->pNext[i] = i;
         pCluster->pMap[i] = i;
         pCluster->pCount[i] = 0;
+        pCluster->pElmntID[i] = -1;
+
+        pCluster->pFirst[i] = pAttrbtArray->data[i].firstAttribute;
+        pCluster->pSecond[i] = pAttrbtArray->data[i].secondAttribute;
+        pCluster->pFirstBound[i] = TGM_ReadPairAttrbtArrayGetFirstBound(pAttrbtArray, i);
+        pCluster->pSecondBound[i] = TGM_ReadPairAttrbtArrayGetSecondBound(pAttrbtArray, i);
     }
 }
 
@@ -166,17 +367,17 @@ void TGM_ClusterMake(TGM_Cluster* pCluster)
     {
         unsigned int j = lastLowIndex;
 
-        double firstBound = TGM_ReadPairAttrbtArrayGetFirstBound(pCluster->pAttrbtArray, i);
-        double secondBound = TGM_ReadPairAttrbtArrayGetSecondBound(pCluster->pAttrbtArray, i);
+        int32_t firstBound = TGM_ReadPairAttrbtArrayGetFirstBound(pCluster->pAttrbtArray, i);
+        int32_t secondBound = TGM_ReadPairAttrbtArrayGetSecondBound(pCluster->pAttrbtArray, i);
 
         while ((j < pCluster->size) && (pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) > firstBound)
             ++j;
 
         lastLowIndex = j;
 
-        while (fabs(pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) <= firstBound)
+        while (abs(pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) <= firstBound)
         {
-            if (fabs(pCluster->pAttrbtArray->data[i].secondAttribute - pCluster->pAttrbtArray->data[j].secondAttribute) <= secondBound)
+            if (abs(pCluster->pAttrbtArray->data[i].secondAttribute - pCluster->pAttrbtArray->data[j].secondAttribute) <= secondBound)
                 ++(pCluster->pCount[i]);
 
             ++j;
@@ -194,8 +395,8 @@ void TGM_ClusterBuild(TGM_Cluster* pCluster)
     {
         unsigned int j = lastLowIndex;
 
-        double firstBound = TGM_ReadPairAttrbtArrayGetFirstBound(pCluster->pAttrbtArray, i);
-        double secondBound = TGM_ReadPairAttrbtArrayGetSecondBound(pCluster->pAttrbtArray, i);
+        int32_t firstBound = TGM_ReadPairAttrbtArrayGetFirstBound(pCluster->pAttrbtArray, i);
+        int32_t secondBound = TGM_ReadPairAttrbtArrayGetSecondBound(pCluster->pAttrbtArray, i);
 
         while ((j < pCluster->size) && (pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) > firstBound)
             ++j;
@@ -204,9 +405,9 @@ void TGM_ClusterBuild(TGM_Cluster* pCluster)
 
         unsigned int maxCount = 0;
         unsigned int centerIndex = 0;
-        while (fabs(pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) <= firstBound)
+        while (abs(pCluster->pAttrbtArray->data[i].firstAttribute - pCluster->pAttrbtArray->data[j].firstAttribute) <= firstBound)
         {
-            if (fabs(pCluster->pAttrbtArray->data[i].secondAttribute - pCluster->pAttrbtArray->data[j].secondAttribute) <= secondBound)
+            if (abs(pCluster->pAttrbtArray->data[i].secondAttribute - pCluster->pAttrbtArray->data[j].secondAttribute) <= secondBound)
             {
                 if (pCluster->pCount[j] > maxCount)
                 {
@@ -225,6 +426,263 @@ void TGM_ClusterBuild(TGM_Cluster* pCluster)
     }
 }
 
+// window of each read pair of the slice. the window start is only the running maximum
+// inside the slice here, the part carried from the earlier slices is applied later
+static void* TGM_ClusterSliceWindows(void* pArg)
+{
+    TGM_ClusterSlice* pSlice = pArg;
+    TGM_Cluster* pCluster = pSlice->pCluster;
+    const int32_t* pFirst = pCluster->pFirst;
+
+    // binary search for the window start of the first read pair
+    unsigned int lowIndex = 0;
+    unsigned int highIndex = pSlice->begin;
+    while (lowIndex < highIndex)
+    {
+        unsigned int middle = lowIndex + (highIndex - lowIndex) / 2;
+        if (pFirst[pSlice->begin] - pFirst[middle] > pCluster->pFirstBound[pSlice->begin])
+            lowIndex = middle + 1;
+        else
+            highIndex = middle;
+    }
+
+    for (unsigned int i = pSlice->begin; i != pSlice->end; ++i)
+    {
+        int32_t firstBound = pCluster->pFirstBound[i];
+
+        while (pFirst[i] - pFirst[lowIndex] > firstBound)
+            ++lowIndex;
+
+        highIndex = i + 1;
+        while (highIndex != pCluster->size && pFirst[highIndex] - pFirst[i] <= firstBound)
+            ++highIndex;
+
+        pCluster->pLow[i] = lowIndex;
+        pCluster->pHigh[i] = highIndex;
+    }
+
+    return NULL;
+}
+
+static void* TGM_ClusterSliceCount(void* pArg)
+{
+    TGM_ClusterSlice* pSlice = pArg;
+    TGM_Cluster* pCluster = pSlice->pCluster;
+
+    for (unsigned int i = pSlice->begin; i != pSlice->end; ++i)
+    {
+        if (pCluster->pLow[i] < pSlice->lowCarry)
+            pCluster->pLow[i] = pSlice->lowCarry;
+
+        pCluster->pCount[i] = TGM_ClusterCountNeighbours(pCluster->pSecond, pCluster->pLow[i], pCluster->pHigh[i],
+                                                         pCluster->pSecond[i], pCluster->pSecondBound[i]);
+    }
+
+    return NULL;
+}
+
+// the center of each read pair is its parent in the union-find forest
+static void* TGM_ClusterSliceCenter(void* pArg)
+{
+    TGM_ClusterSlice* pSlice = pArg;
+    TGM_Cluster* pCluster = pSlice->pCluster;
+
+    for (unsigned int i = pSlice->begin; i != pSlice->end; ++i)
+    {
+        pCluster->pMap[i] = TGM_ClusterFindCenter(pCluster->pSecond, pCluster->pCount, pCluster->pLow[i], pCluster->pHigh[i],
+                                                  pCluster->pSecond[i], pCluster->pSecondBound[i]);
+    }
+
+    return NULL;
+}
+
+// find the root of each read pair with path halving. other threads may be halving the same
+// paths, but every write replaces a parent with one of its ancestors, so any value read is valid
+static void* TGM_ClusterSliceRoot(void* pArg)
+{
+    TGM_ClusterSlice* pSlice = pArg;
+    int* pParent = pSlice->pCluster->pMap;
+
+    for (unsigned int i = pSlice->begin; i != pSlice->end; ++i)
+    {
+        int x = i;
+        int parent = __atomic_load_n(pParent + x, __ATOMIC_RELAXED);
+
+        while (parent != x)
+        {
+            int grandParent = __atomic_load_n(pParent + parent, __ATOMIC_RELAXED);
+            __atomic_store_n(pParent + x, grandParent, __ATOMIC_RELAXED);
+
+            x = grandParent;
+            parent = __atomic_load_n(pParent + x, __ATOMIC_RELAXED);
+        }
+
+        __atomic_store_n(pParent + i, x, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+// run one phase on all the slices. the calling thread takes the first slice
+static void TGM_ClusterSliceRun(void* (*phase)(void*), TGM_ClusterSlice* pSlices, unsigned int numThreads)
+{
+    pthread_t threads[numThreads];
+
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        if (pthread_create(threads + t, NULL, phase, pSlices + t) != 0)
+            TGM_ErrQuit("ERROR: Cannot create a clustering thread.\n");
+    }
+
+    phase(pSlices);
+
+    for (unsigned int t = 1; t < numThreads; ++t)
+        pthread_join(threads[t], NULL);
+}
+
+// parallel version of the fused kernel.
+// a read pair never has a center with a smaller neighbour count, and ties go to the smaller index,
+// so the centers form a forest whose roots are their own centers. TGM_ClusterConnect always keeps
+// the ID of the center side, so the serial cluster ID of a read pair is the root of its tree.
+// we can therefore link all the read pairs to their centers at once and resolve the roots concurrently
+static void TGM_ClusterMakeAndBuildParallel(TGM_Cluster* pCluster, unsigned int numThreads)
+{
+    TGM_ClusterSlice slices[numThreads];
+    for (unsigned int t = 0; t != numThreads; ++t)
+    {
+        slices[t].pCluster = pCluster;
+        slices[t].begin = (uint64_t) pCluster->size * t / numThreads;
+        slices[t].end = (uint64_t) pCluster->size * (t + 1) / numThreads;
+    }
+
+    TGM_ClusterSliceRun(TGM_ClusterSliceWindows, slices, numThreads);
+
+    // the window start of a read pair is the running maximum of the true window starts
+    slices[0].lowCarry = 0;
+    for (unsigned int t = 1; t != numThreads; ++t)
+    {
+        unsigned int lastLow = pCluster->pLow[slices[t - 1].end - 1];
+        slices[t].lowCarry = (lastLow > slices[t - 1].lowCarry ? lastLow : slices[t - 1].lowCarry);
+    }
+
+    TGM_ClusterSliceRun(TGM_ClusterSliceCount, slices, numThreads);
+    TGM_ClusterSliceRun(TGM_ClusterSliceCenter, slices, numThreads);
+    TGM_ClusterSliceRun(TGM_ClusterSliceRoot, slices, numThreads);
+
+    // chain the members of each cluster into a circular list for later connections.
+    // the windows are not needed any more, so they hold the first and last member of each root
+    unsigned int* pFirstMember = pCluster->pHigh;
+    unsigned int* pLastMember = pCluster->pLow;
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+        pLastMember[i] = UINT_MAX;
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        int root = pCluster->pMap[i];
+
+        if (pLastMember[root] == UINT_MAX)
+            pFirstMember[root] = i;
+        else
+            pCluster->pNext[pLastMember[root]] = i;
+
+        pLastMember[root] = i;
+    }
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        if (pLastMember[i] != UINT_MAX)
+            pCluster->pNext[pLastMember[i]] = pFirstMember[i];
+    }
+}
+
+static void TGM_ClusterMakeAndBuildSerial(TGM_Cluster* pCluster)
+{
+    const int32_t* pFirst = pCluster->pFirst;
+    const int32_t* pSecond = pCluster->pSecond;
+
+    unsigned int lastLowIndex = 0;
+    unsigned int buildIndex = 0;
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        int32_t firstBound = pCluster->pFirstBound[i];
+
+        // the window starts where the previous one did at the earliest (same as TGM_ClusterMake)
+        while (pFirst[i] - pFirst[lastLowIndex] > firstBound)
+            ++lastLowIndex;
+
+        unsigned int highIndex = i + 1;
+        while (highIndex != pCluster->size && pFirst[highIndex] - pFirst[i] <= firstBound)
+            ++highIndex;
+
+        pCluster->pLow[i] = lastLowIndex;
+        pCluster->pHigh[i] = highIndex;
+        pCluster->pCount[i] = TGM_ClusterCountNeighbours(pSecond, lastLowIndex, highIndex, pSecond[i], pCluster->pSecondBound[i]);
+
+        // the counts up to i are final. connect the read pairs whose windows end there
+        while (buildIndex <= i && pCluster->pHigh[buildIndex] <= i + 1)
+        {
+            unsigned int centerIndex = TGM_ClusterFindCenter(pSecond, pCluster->pCount, pCluster->pLow[buildIndex], pCluster->pHigh[buildIndex],
+                                                             pSecond[buildIndex], pCluster->pSecondBound[buildIndex]);
+
+            TGM_ClusterConnect(pCluster, centerIndex, buildIndex);
+            ++buildIndex;
+        }
+    }
+}
+
+#ifdef TGM_CLUSTER_CHECK
+// redo a parallel run with the serial kernel on the same attributes. the neighbour counts and
+// the cluster IDs must be the same (the member lists may be chained in another order)
+static void TGM_ClusterCheckParallel(TGM_Cluster* pCluster, unsigned int numThreads)
+{
+    int* pParCount = (int*) malloc(2 * pCluster->size * sizeof(int));
+    if (pParCount == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the check of the parallel cluster kernel.\n");
+
+    int* pParMap = pParCount + pCluster->size;
+    memcpy(pParCount, pCluster->pCount, pCluster->size * sizeof(int));
+    memcpy(pParMap, pCluster->pMap, pCluster->size * sizeof(int));
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        pCluster->pNext[i] = i;
+        pCluster->pMap[i] = i;
+        pCluster->pCount[i] = 0;
+    }
+
+    TGM_ClusterMakeAndBuildSerial(pCluster);
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        if (pCluster->pCount[i] != pParCount[i] || pCluster->pMap[i] != pParMap[i])
+            TGM_ErrQuit("ERROR: The cluster kernel on %u threads differs from the serial one at read pair %u of %u.\n", numThreads, i, pCluster->size);
+    }
+
+    free(pParCount);
+}
+#endif
+
+void TGM_ClusterMakeAndBuild(TGM_Cluster* pCluster)
+{
+    unsigned int numThreads = pCluster->numThreads;
+    if (numThreads > pCluster->size / TGM_CLUSTER_PAR_MIN)
+        numThreads = pCluster->size / TGM_CLUSTER_PAR_MIN;
+
+    if (numThreads > 1)
+    {
+        TGM_ClusterMakeAndBuildParallel(pCluster, numThreads);
+
+#ifdef TGM_CLUSTER_CHECK
+        TGM_ClusterCheckParallel(pCluster, numThreads);
+#endif
+        return;
+    }
+
+    TGM_ClusterMakeAndBuildSerial(pCluster);
+}
+
 void TGM_ClusterConnect(TGM_Cluster* pCluster, unsigned int centerIndex, unsigned int memberIndex)
 {
     if (centerIndex == memberIndex)
@@ -248,48 +706,167 @@ void TGM_ClusterConnect(TGM_Cluster* pCluster, unsigned int centerIndex, unsigne
 
 void TGM_ClusterFinalize(TGM_Cluster* pCluster)
 {
-    // create a hash to transfer the cluster center ID to cluster element ID
-    khash_t(clusterMap)* clusterHash = kh_init(clusterMap);
-    kh_resize(clusterMap, clusterHash, DEFAULT_CLUSTER_SIZE);
-
-    int khRet = 0;
-    khiter_t khIter = 0;
-    int clusterIndex = 0;
-
+    // the cluster IDs are the attribute indices of the cluster centers, so the element of each
+    // center is looked up directly. the elements are created in the order of their first read pair
     for (unsigned int i = 0; i != pCluster->size; ++i)
     {
+        int centerIndex = pCluster->pMap[i];
+
         // skip those very small clusters
-        unsigned int clusterSize = pCluster->pCount[pCluster->pMap[i]];
+        unsigned int clusterSize = pCluster->pCount[centerIndex];
         if (clusterSize < pCluster->minReadPairNum)
+        {
+            pCluster->pMap[i] = -1;
             continue;
+        }
 
-        khIter = kh_put(clusterMap, clusterHash, pCluster->pMap[i], &khRet);
-        if (khRet == 0)
-        {
-            clusterIndex = kh_value(clusterHash, khIter);
+        int clusterIndex = pCluster->pElmntID[centerIndex];
+        if (clusterIndex >= 0)
             TGM_ClusterUpdateElmnt(pCluster, clusterIndex, i);
-        }
         else
         {
             clusterIndex = TGM_ClusterAddElmnt(pCluster, i);
-            kh_value(clusterHash, khIter) = clusterIndex;
+            pCluster->pElmntID[centerIndex] = clusterIndex;
         }
 
         pCluster->pMap[i] = clusterIndex;
     }
 
-    kh_destroy(clusterMap, clusterHash);
-
     for (unsigned int i = 0; i != pCluster->pElmntArray->size; ++i)
     {
         TGM_ClusterElmnt* pElmnt = TGM_ARRAY_GET_PT(pCluster->pElmntArray, i);
 
-        for (unsigned int j = 0; j != 2; ++j)
+        pElmnt->std[0] = sqrt(pElmnt->std[0] / pElmnt->numReadPair);
+        pElmnt->std[1] = sqrt(pElmnt->std[1] / pElmnt->numReadPair);
+    }
+}
+
+void TGM_ClusterCompact(TGM_Cluster* pCluster)
+{
+    unsigned int numElmnts = pCluster->pElmntArray->size;
+
+    if (numElmnts + 1 > pCluster->memberOffsetsCap)
+    {
+        free(pCluster->pMemberOffsets);
+
+        pCluster->memberOffsetsCap = (numElmnts + 1) * 2;
+        pCluster->pMemberOffsets = (unsigned int*) malloc(pCluster->memberOffsetsCap * sizeof(unsigned int));
+        if (pCluster->pMemberOffsets == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the storage of the member offsets in a cluster object.\n");
+    }
+
+    // counting sort of the read pairs by their cluster element. the read pairs dropped
+    // by TGM_ClusterFinalize are marked with -1
+    unsigned int* pOffsets = pCluster->pMemberOffsets;
+    memset(pOffsets, 0, (numElmnts + 1) * sizeof(unsigned int));
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        if (pCluster->pMap[i] >= 0)
+            ++(pOffsets[pCluster->pMap[i] + 1]);
+    }
+
+    for (unsigned int i = 0; i != numElmnts; ++i)
+        pOffsets[i + 1] += pOffsets[i];
+
+    for (unsigned int i = 0; i != pCluster->size; ++i)
+    {
+        if (pCluster->pMap[i] >= 0)
+            pCluster->pMembers[pOffsets[pCluster->pMap[i]]++] = i;
+    }
+
+    // each offset now points to the end of its element
+    for (unsigned int i = numElmnts; i != 0; --i)
+        pOffsets[i] = pOffsets[i - 1];
+
+    pOffsets[0] = 0;
+    pCluster->numCompacted = numElmnts;
+}
+
+void TGM_ClusterGather(void* pDst, const TGM_Cluster* pCluster, const void* pRecords, size_t recordSize)
+{
+    char* pOutput = pDst;
+    const char* pInput = pRecords;
+    unsigned int numMembers = TGM_ClusterNumMembers(pCluster);
+
+    for (unsigned int i = 0; i != numMembers; ++i)
+    {
+        uint64_t origIndex = pCluster->pAttrbtArray->data[pCluster->pMembers[i]].origIndex;
+        memcpy(pOutput + i * recordSize, pInput + origIndex * recordSize, recordSize);
+    }
+}
+
+void TGM_ClusterCountSamples(uint32_t support[2], TGM_SupportArray* pSupportArray, const TGM_Cluster* pCluster, unsigned int index, const int32_t* pSampleMap)
+{
+    support[0] = pSupportArray->size;
+
+    for (unsigned int m = TGM_ClusterMemberBegin(pCluster, index); m != TGM_ClusterMemberEnd(pCluster, index); ++m)
+    {
+        int32_t readGrpID = pCluster->pAttrbtArray->data[pCluster->pMembers[m]].readGrpID;
+        TGM_SupportArrayAdd(pSupportArray, support[0], pSampleMap[readGrpID], 1);
+    }
+
+    support[1] = pSupportArray->size;
+}
+
+void TGM_SupportArrayAdd(TGM_SupportArray* pSupportArray, uint32_t begin, int32_t sampleID, uint32_t count)
+{
+    // an event is supported by a few samples, so a sorted insertion is cheaper than a dense vector
+    unsigned int i = pSupportArray->size;
+    while (i > begin && pSupportArray->data[i - 1].sampleID > sampleID)
+        --i;
+
+    if (i > begin && pSupportArray->data[i - 1].sampleID == sampleID)
+    {
+        pSupportArray->data[i - 1].count += count;
+        return;
+    }
+
+    if (TGM_ARRAY_IS_FULL(pSupportArray))
+        TGM_ARRAY_RESIZE(pSupportArray, pSupportArray->capacity * 2, TGM_SampleCount);
+
+    memmove(pSupportArray->data + i + 1, pSupportArray->data + i, (pSupportArray->size - i) * sizeof(TGM_SampleCount));
+
+    pSupportArray->data[i].sampleID = sampleID;
+    pSupportArray->data[i].count = count;
+    ++(pSupportArray->size);
+}
+
+void TGM_SupportArraySum(uint32_t support[2], TGM_SupportArray* pSupportArray, const uint32_t support1[2], const uint32_t support2[2])
+{
+    // the ranges may be the output array so they are read by index as it grows
+    uint32_t i = support1[0];
+    uint32_t end1 = support1[1];
+    uint32_t j = support2[0];
+    uint32_t end2 = support2[1];
+
+    uint32_t begin = pSupportArray->size;
+    while (i != end1 || j != end2)
+    {
+        TGM_SampleCount sampleCount;
+        if (j == end2 || (i != end1 && pSupportArray->data[i].sampleID < pSupportArray->data[j].sampleID))
+        {
+            sampleCount = pSupportArray->data[i];
+            ++i;
+        }
+        else if (i == end1 || pSupportArray->data[j].sampleID < pSupportArray->data[i].sampleID)
         {
-            pElmnt->mean[j] /= pElmnt->numReadPair;
-            pElmnt->std[j] = sqrt(pElmnt->std[j] / pElmnt->numReadPair - (pElmnt->mean[j] * pElmnt->mean[j]));
+            sampleCount = pSupportArray->data[j];
+            ++j;
         }
+        else
+        {
+            sampleCount = pSupportArray->data[i];
+            sampleCount.count += pSupportArray->data[j].count;
+            ++i;
+            ++j;
+        }
+
+        TGM_ARRAY_PUSH(pSupportArray, &sampleCount, TGM_SampleCount);
     }
+
+    support[0] = begin;
+    support[1] = pSupportArray->size;
 }
 
 int TGM_ClusterClean(TGM_Cluster* pCluster)
@@ -323,7 +900,7 @@ void TGM_ClusterPrint(const TGM_Cluster* pCluster, int32_t refID, const char* sp
     unsigned int count = 0;
     while (count != pArray->size)
     {
-        int firstAttribute = pCluster->pAttrbtArray->data[pArray->data[i].startIndex].firstAttribute;
+        int firstAttribute = pCluster->pAttrbtArray->data[pArray->data[i].startIndex].firstAttribute / TGM_ATTRBT_SCALE;
         printf("chr%d\t%d\t%d\t%d\t%f\n", refID + 1, firstAttribute, firstAttribute + 1, pArray->data[i].numReadPair, pArray->data[i].std[0]);
 
         if (pArray->data[i].numReadPair != 0)
@@ -347,8 +924,9 @@ int TGM_ClusterMerge(TGM_Cluster* pCluster, int dstIndex, int srcIndex)
         pDstElmnt->min[i] = (pDstElmnt->min[i] < pSrcElmnt->min[i] ? pDstElmnt->min[i] : pSrcElmnt->min[i]);
         pDstElmnt->max[i] = (pDstElmnt->max[i] > pSrcElmnt->max[i] ? pDstElmnt->max[i] : pSrcElmnt->max[i]);
 
-        pDstElmnt->std[i] = (pDstElmnt->std[i] * pDstElmnt->std[i] + pDstElmnt->mean[i] + pDstElmnt->mean[i]) * pDstElmnt->numReadPair;
-        pSrcElmnt->std[i] = (pSrcElmnt->std[i] * pSrcElmnt->std[i] + pSrcElmnt->mean[i] + pSrcElmnt->mean[i]) * pSrcElmnt->numReadPair;
+        // sum of squares of each element
+        pDstElmnt->std[i] = (pDstElmnt->std[i] * pDstElmnt->std[i] + pDstElmnt->mean[i] * pDstElmnt->mean[i]) * pDstElmnt->numReadPair;
+        pSrcElmnt->std[i] = (pSrcElmnt->std[i] * pSrcElmnt->std[i] + pSrcElmnt->mean[i] * pSrcElmnt->mean[i]) * pSrcElmnt->numReadPair;
 
         pDstElmnt->std[i] += pSrcElmnt->std[i];
 
@@ -357,7 +935,7 @@ int TGM_ClusterMerge(TGM_Cluster* pCluster, int dstIndex, int srcIndex)
 
     pDstElmnt->numReadPair += pSrcElmnt->numReadPair;
     pSrcElmnt->numReadPair = 0;
-    --(pCluster->size);
+    --(pCluster->pElmntArray->size);
 
     pDstElmnt->std[0] = sqrt(pDstElmnt->std[0] / pDstElmnt->numReadPair - pDstElmnt->mean[0] * pDstElmnt->mean[0]);
     pDstElmnt->std[1] = sqrt(pDstElmnt->std[1] / pDstElmnt->numReadPair - pDstElmnt->mean[1] * pDstElmnt->mean[1]);
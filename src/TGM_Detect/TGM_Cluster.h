@@ -51,6 +51,35 @@ typedef struct TGM_ClusterElmntArray
 
 }TGM_ClusterElmntArray;
 
+// number of read pairs of one sample supporting a cluster element or an event
+typedef struct TGM_SampleCount
+{
+    int32_t sampleID;
+
+    uint32_t count;
+
+}TGM_SampleCount;
+
+// sample counts of the events found by one detection job. each event owns a range of counts
+// sorted by sample ID, so a sample without any supporting read pair takes no space
+typedef struct TGM_SupportArray
+{
+    TGM_SampleCount* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_SupportArray;
+
+// first and end (exclusive) position in pMembers of the read pairs of a cluster element
+#define TGM_ClusterMemberBegin(pCluster, index) ((pCluster)->pMemberOffsets[(index)])
+
+#define TGM_ClusterMemberEnd(pCluster, index) ((pCluster)->pMemberOffsets[(index) + 1])
+
+// total number of read pairs in the compacted cluster elements
+#define TGM_ClusterNumMembers(pCluster) ((pCluster)->pMemberOffsets[(pCluster)->numCompacted])
+
 typedef struct TGM_Cluster
 {
     const TGM_ReadPairAttrbtArray* pAttrbtArray;
@@ -63,6 +92,32 @@ typedef struct TGM_Cluster
     
     int* pCount;
 
+    // cluster element of each cluster center (filled by TGM_ClusterFinalize)
+    int* pElmntID;
+
+    // attributes and boundaries gathered by TGM_ClusterInit for the fused kernel
+    int32_t* pFirst;
+
+    int32_t* pSecond;
+
+    int32_t* pFirstBound;
+
+    int32_t* pSecondBound;
+
+    // neighbourhood window [low, high) of each read pair
+    unsigned int* pLow;
+
+    unsigned int* pHigh;
+
+    // read pairs of each cluster element stored contiguously (filled by TGM_ClusterCompact)
+    unsigned int* pMembers;
+
+    unsigned int* pMemberOffsets;
+
+    unsigned int memberOffsetsCap;
+
+    unsigned int numCompacted;
+
     unsigned int size;
 
     unsigned int capacity;
@@ -71,6 +126,8 @@ typedef struct TGM_Cluster
 
     double minStd[2];
 
+    unsigned int numThreads;
+
 }TGM_Cluster;
 
 TGM_Cluster* TGM_ClusterAlloc(int minReadPairNum);
@@ -79,16 +136,40 @@ void TGM_ClusterFree(TGM_Cluster* pCluster);
 
 void TGM_ClusterSetMinStd(TGM_Cluster* pCluster, double minStd[2]);
 
+// number of threads used by TGM_ClusterMakeAndBuild on large attribute arrays (default 1)
+void TGM_ClusterSetNumThreads(TGM_Cluster* pCluster, unsigned int numThreads);
+
 void TGM_ClusterInit(TGM_Cluster* pCluster, const TGM_ReadPairAttrbtArray* pAttrbtArray);
 
 void TGM_ClusterMake(TGM_Cluster* pCluster);
 
 void TGM_ClusterBuild(TGM_Cluster* pCluster);
 
+// same clusters as TGM_ClusterMake followed by TGM_ClusterBuild in one pass over the attributes
+void TGM_ClusterMakeAndBuild(TGM_Cluster* pCluster);
+
 void TGM_ClusterConnect(TGM_Cluster* pCluster, unsigned int centerIndex, unsigned int memberIndex);
 
 void TGM_ClusterFinalize(TGM_Cluster* pCluster);
 
+// store the read pairs of each cluster element contiguously in attribute order. must be called
+// right after TGM_ClusterFinalize. later connections and merges are not reflected in the members
+void TGM_ClusterCompact(TGM_Cluster* pCluster);
+
+// copy the records of the compacted read pairs in member order. pRecords is the original array
+// of the read pairs and pDst must hold TGM_ClusterNumMembers(pCluster) records
+void TGM_ClusterGather(void* pDst, const TGM_Cluster* pCluster, const void* pRecords, size_t recordSize);
+
+// count the read pairs of each sample among the members of a compacted cluster element. the counts are
+// appended to pSupportArray and their range is returned in support. pSampleMap maps read groups to samples
+void TGM_ClusterCountSamples(uint32_t support[2], TGM_SupportArray* pSupportArray, const TGM_Cluster* pCluster, unsigned int index, const int32_t* pSampleMap);
+
+// add read pairs of a sample to the last range of sample counts, which starts at begin
+void TGM_SupportArrayAdd(TGM_SupportArray* pSupportArray, uint32_t begin, int32_t sampleID, uint32_t count);
+
+// append the sum of two ranges of sample counts and return its range in support
+void TGM_SupportArraySum(uint32_t support[2], TGM_SupportArray* pSupportArray, const uint32_t support1[2], const uint32_t support2[2]);
+
 int TGM_ClusterClean(TGM_Cluster* pCluster);
 
 void TGM_ClusterPrint(const TGM_Cluster* pCluster, int32_t refID, const char* specialID);
@@ -0,0 +1,392 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_DetectCache.c
+ *
+ *    Description:  cache of the detected events of each reference for incremental detection
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "md5.h"
+#include "TGM_Error.h"
+#include "TGM_Utilities.h"
+#include "TGM_DetectCache.h"
+
+static const char TGM_DETECT_CACHE_MAGIC[4] = {'T', 'G', 'M', 'E'};
+
+static void TGM_DetectCacheWrite(const void* pData, size_t size, FILE* output)
+{
+    if (size > 0 && fwrite(pData, size, 1, output) != 1)
+        TGM_ErrQuit("ERROR: Cannot write the detect cache.\n");
+}
+
+// a cache file that cannot be read is detected again instead of stopping the run
+static TGM_Bool TGM_DetectCacheRead(void* pData, size_t size, FILE* input)
+{
+    return (size == 0 || fread(pData, size, 1, input) == 1);
+}
+
+static void TGM_DetectCacheDigestUpdate(struct MD5Context* pContext, const void* pData, size_t size)
+{
+    if (size > 0)
+        MD5Update(pContext, (unsigned char*) pData, size);
+}
+
+// strings are digested with their terminators so that the neighbors cannot trade characters
+static void TGM_DetectCacheDigestString(struct MD5Context* pContext, const char* str)
+{
+    TGM_DetectCacheDigestUpdate(pContext, str, strlen(str) + 1);
+}
+
+// write the key of the events at the beginning of a cache file
+static void TGM_DetectCacheKeyWrite(const TGM_DetectCacheKey* pKey, FILE* output)
+{
+    uint32_t version = TGM_DETECT_CACHE_VERSION;
+
+    TGM_DetectCacheWrite(TGM_DETECT_CACHE_MAGIC, sizeof(TGM_DETECT_CACHE_MAGIC), output);
+    TGM_DetectCacheWrite(&version, sizeof(uint32_t), output);
+    TGM_DetectCacheWrite(&(pKey->refID), sizeof(int32_t), output);
+    TGM_DetectCacheWrite(pKey->parsDigest, sizeof(pKey->parsDigest), output);
+    TGM_DetectCacheWrite(&(pKey->numChunks), sizeof(uint32_t), output);
+
+    for (unsigned int i = 0; i != pKey->numChunks; ++i)
+    {
+        const TGM_DetectCacheChunk* pChunk = pKey->pChunks + i;
+
+        TGM_DetectCacheWrite(&(pChunk->chunkType), sizeof(int16_t), output);
+        TGM_DetectCacheWrite(&(pChunk->codec), sizeof(int16_t), output);
+        TGM_DetectCacheWrite(&(pChunk->numPairs), sizeof(uint64_t), output);
+        TGM_DetectCacheWrite(&(pChunk->size), sizeof(uint64_t), output);
+        TGM_DetectCacheWrite(pChunk->digest, sizeof(pChunk->digest), output);
+    }
+}
+
+// check the key at the beginning of a cache file against the current one
+static TGM_Bool TGM_DetectCacheKeyMatch(const TGM_DetectCacheKey* pKey, FILE* input)
+{
+    char magic[4];
+    uint32_t version = 0;
+    int32_t refID = 0;
+    unsigned char parsDigest[16];
+    uint32_t numChunks = 0;
+
+    if (!TGM_DetectCacheRead(magic, sizeof(magic), input)
+        || !TGM_DetectCacheRead(&version, sizeof(uint32_t), input)
+        || !TGM_DetectCacheRead(&refID, sizeof(int32_t), input)
+        || !TGM_DetectCacheRead(parsDigest, sizeof(parsDigest), input)
+        || !TGM_DetectCacheRead(&numChunks, sizeof(uint32_t), input))
+    {
+        return FALSE;
+    }
+
+    if (memcmp(magic, TGM_DETECT_CACHE_MAGIC, sizeof(magic)) != 0 || version != TGM_DETECT_CACHE_VERSION || refID != pKey->refID
+        || memcmp(parsDigest, pKey->parsDigest, sizeof(parsDigest)) != 0 || numChunks != pKey->numChunks)
+    {
+        return FALSE;
+    }
+
+    for (unsigned int i = 0; i != numChunks; ++i)
+    {
+        const TGM_DetectCacheChunk* pChunk = pKey->pChunks + i;
+        TGM_DetectCacheChunk chunk;
+
+        if (!TGM_DetectCacheRead(&(chunk.chunkType), sizeof(int16_t), input)
+            || !TGM_DetectCacheRead(&(chunk.codec), sizeof(int16_t), input)
+            || !TGM_DetectCacheRead(&(chunk.numPairs), sizeof(uint64_t), input)
+            || !TGM_DetectCacheRead(&(chunk.size), sizeof(uint64_t), input)
+            || !TGM_DetectCacheRead(chunk.digest, sizeof(chunk.digest), input))
+        {
+            return FALSE;
+        }
+
+        if (chunk.chunkType != pChunk->chunkType || chunk.codec != pChunk->codec || chunk.numPairs != pChunk->numPairs
+            || chunk.size != pChunk->size || memcmp(chunk.digest, pChunk->digest, sizeof(chunk.digest)) != 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static TGM_EventBuff* TGM_DetectCacheReadBuff(FILE* input)
+{
+    uint32_t size = 0;
+    uint64_t textSize = 0;
+
+    if (!TGM_DetectCacheRead(&size, sizeof(uint32_t), input) || !TGM_DetectCacheRead(&textSize, sizeof(uint64_t), input))
+        return NULL;
+
+    TGM_EventBuff* pEventBuff = TGM_EventBuffAlloc();
+    TGM_ARRAY_RESIZE_NO_COPY(pEventBuff, size, TGM_EventRecord);
+
+    if (textSize > pEventBuff->textCapacity)
+    {
+        free(pEventBuff->pText);
+        pEventBuff->textCapacity = textSize;
+        pEventBuff->pText = (char*) malloc(textSize);
+        if (pEventBuff->pText == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the text of the events.\n");
+    }
+
+    pEventBuff->size = size;
+    pEventBuff->textSize = textSize;
+
+    if (!TGM_DetectCacheRead(pEventBuff->data, size * sizeof(TGM_EventRecord), input) || !TGM_DetectCacheRead(pEventBuff->pText, textSize, input))
+    {
+        TGM_EventBuffFree(pEventBuff);
+        return NULL;
+    }
+
+    // a record pointing out of the text is a broken file
+    for (unsigned int i = 0; i != size; ++i)
+    {
+        if (pEventBuff->data[i].offset + pEventBuff->data[i].length > textSize)
+        {
+            TGM_EventBuffFree(pEventBuff);
+            return NULL;
+        }
+    }
+
+    return pEventBuff;
+}
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_DetectCacheKey* TGM_DetectCacheKeyAlloc(const char* workingDir, const char* engineName, int32_t refID, const unsigned char parsDigest[16],
+                                            const TGM_ReadPairInFile* pInFile, uint32_t chunkSet)
+{
+    TGM_DetectCacheKey* pKey = (TGM_DetectCacheKey*) calloc(1, sizeof(TGM_DetectCacheKey));
+    if (pKey == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a detect cache key.\n");
+
+    char fileName[strlen(engineName) + 40];
+
+    sprintf(fileName, "detect_%s_%d.dat", engineName, refID);
+    pKey->cacheName = TGM_CreateFileName(workingDir, fileName);
+
+    strcat(fileName, ".tmp");
+    pKey->tempName = TGM_CreateFileName(workingDir, fileName);
+
+    pKey->refID = refID;
+    memcpy(pKey->parsDigest, parsDigest, sizeof(pKey->parsDigest));
+
+    uint64_t ranges[TGM_NUM_RP_CHUNK_TYPES][2];
+    for (unsigned int j = 0; j != TGM_NUM_RP_CHUNK_TYPES; ++j)
+    {
+        ranges[j][0] = 0;
+        ranges[j][1] = 0;
+
+        if ((chunkSet & (1 << j)) != 0)
+        {
+            TGM_ReadPairInFileFind(ranges[j], ranges[j] + 1, pInFile, refID, j);
+            pKey->numChunks += ranges[j][1] - ranges[j][0];
+        }
+    }
+
+    pKey->pChunks = (TGM_DetectCacheChunk*) calloc(pKey->numChunks + 1, sizeof(TGM_DetectCacheChunk));
+    if (pKey->pChunks == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a detect cache key.\n");
+
+    // a rebuilt container may move the chunks around but the same bytes give the same events.
+    // the digests were taken when the chunks were written, so the read pairs are not read here
+    unsigned int numChunks = 0;
+    for (unsigned int j = 0; j != TGM_NUM_RP_CHUNK_TYPES; ++j)
+    {
+        for (uint64_t i = ranges[j][0]; i != ranges[j][1]; ++i)
+        {
+            const TGM_ReadPairChunk* pChunk = pInFile->pChunkArray->data + i;
+            TGM_DetectCacheChunk* pCacheChunk = pKey->pChunks + numChunks;
+
+            pCacheChunk->chunkType = pChunk->chunkType;
+            pCacheChunk->codec = pChunk->codec;
+            pCacheChunk->numPairs = pChunk->numPairs;
+            pCacheChunk->size = pChunk->size;
+            memcpy(pCacheChunk->digest, pChunk->digest, sizeof(pCacheChunk->digest));
+
+            ++numChunks;
+        }
+    }
+
+    return pKey;
+}
+
+void TGM_DetectCacheKeyFree(TGM_DetectCacheKey* pKey)
+{
+    if (pKey != NULL)
+    {
+        free(pKey->cacheName);
+        free(pKey->tempName);
+        free(pKey->pChunks);
+
+        free(pKey);
+    }
+}
+
+
+//======================
+// Interface functions
+//======================
+
+void TGM_DetectCacheDigestPars(unsigned char parsDigest[16], const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, uint32_t sampleFields,
+                               const void* pEngineData, size_t engineDataSize, TGM_Bool useBams)
+{
+    struct MD5Context context;
+    MD5Init(&context);
+
+    uint32_t version = TGM_DETECT_CACHE_VERSION;
+    int32_t outputFormat = pDetectPars->outputFormat;
+
+    // tiled and streamed runs may cut a cluster at a different place
+    int32_t tileSize = pDetectPars->tileSize;
+    int32_t streamSpecial = pDetectPars->streamSpecial;
+
+    TGM_DetectCacheDigestUpdate(&context, &version, sizeof(uint32_t));
+    TGM_DetectCacheDigestUpdate(&context, &(pDetectPars->minNumClustered), sizeof(int));
+    TGM_DetectCacheDigestUpdate(&context, &(pDetectPars->minEventLength), sizeof(int));
+    TGM_DetectCacheDigestUpdate(&context, &outputFormat, sizeof(int32_t));
+    TGM_DetectCacheDigestUpdate(&context, &tileSize, sizeof(int32_t));
+    TGM_DetectCacheDigestUpdate(&context, &streamSpecial, sizeof(int32_t));
+    TGM_DetectCacheDigestUpdate(&context, &sampleFields, sizeof(uint32_t));
+    TGM_DetectCacheDigestUpdate(&context, pEngineData, engineDataSize);
+
+    // the library table the events were detected with
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->size), sizeof(uint32_t));
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->fragLenMax), sizeof(uint32_t));
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->cutoff), sizeof(double));
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->trimRate), sizeof(double));
+    TGM_DetectCacheDigestUpdate(&context, pLibTable->pLibInfo, pLibTable->size * sizeof(TGM_LibInfo));
+    TGM_DetectCacheDigestUpdate(&context, pLibTable->pSampleMap, pLibTable->size * sizeof(int32_t));
+
+    for (unsigned int i = 0; i != pLibTable->size; ++i)
+        TGM_DetectCacheDigestString(&context, pLibTable->pReadGrps[i]);
+
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->pSampleInfo->size), sizeof(uint32_t));
+    for (unsigned int i = 0; i != pLibTable->pSampleInfo->size; ++i)
+        TGM_DetectCacheDigestString(&context, pLibTable->pSampleInfo->pSamples[i]);
+
+    // the events are written with the names of the references
+    TGM_DetectCacheDigestUpdate(&context, &(pLibTable->pAnchorInfo->size), sizeof(uint32_t));
+    for (unsigned int i = 0; i != pLibTable->pAnchorInfo->size; ++i)
+        TGM_DetectCacheDigestString(&context, pLibTable->pAnchorInfo->pAnchors[i]);
+
+    // a BAM file is taken as changed when its size or its modification time is
+    if (useBams)
+    {
+        TGM_DetectCacheDigestUpdate(&context, &(pDetectPars->numBamFiles), sizeof(unsigned int));
+        for (unsigned int i = 0; i != pDetectPars->numBamFiles; ++i)
+        {
+            struct stat bamStat;
+            if (stat(pDetectPars->bamFileNames[i], &bamStat) != 0)
+                TGM_ErrQuit("ERROR: Cannot get the status of the bam file: %s\n", pDetectPars->bamFileNames[i]);
+
+            uint64_t size = bamStat.st_size;
+            int64_t mtime = bamStat.st_mtime;
+
+            TGM_DetectCacheDigestString(&context, pDetectPars->bamFileNames[i]);
+            TGM_DetectCacheDigestUpdate(&context, &size, sizeof(uint64_t));
+            TGM_DetectCacheDigestUpdate(&context, &mtime, sizeof(int64_t));
+        }
+    }
+
+    MD5Final(parsDigest, &context);
+}
+
+TGM_Status TGM_DetectCacheLoad(TGM_EventBuff*** pppEventBuffs, unsigned int* pNumBuffs, const TGM_DetectCacheKey* pKey)
+{
+    *pppEventBuffs = NULL;
+    *pNumBuffs = 0;
+
+    FILE* input = fopen(pKey->cacheName, "rb");
+    if (input == NULL)
+        return TGM_EOF;
+
+    uint32_t numBuffs = 0;
+    if (!TGM_DetectCacheKeyMatch(pKey, input) || !TGM_DetectCacheRead(&numBuffs, sizeof(uint32_t), input))
+    {
+        fclose(input);
+        return TGM_ERR;
+    }
+
+    TGM_EventBuff** ppEventBuffs = (TGM_EventBuff**) calloc(numBuffs + 1, sizeof(TGM_EventBuff*));
+    if (ppEventBuffs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the cached events.\n");
+
+    for (unsigned int i = 0; i != numBuffs; ++i)
+    {
+        ppEventBuffs[i] = TGM_DetectCacheReadBuff(input);
+        if (ppEventBuffs[i] == NULL)
+        {
+            for (unsigned int j = 0; j != i; ++j)
+                TGM_EventBuffFree(ppEventBuffs[j]);
+
+            free(ppEventBuffs);
+            fclose(input);
+
+            return TGM_ERR;
+        }
+    }
+
+    fclose(input);
+
+    *pppEventBuffs = ppEventBuffs;
+    *pNumBuffs = numBuffs;
+
+    return TGM_OK;
+}
+
+void TGM_DetectCacheSave(const TGM_DetectCacheKey* pKey, TGM_EventBuff* const* ppEventBuffs, unsigned int numBuffs)
+{
+    FILE* output = fopen(pKey->tempName, "wb");
+    if (output == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the detect cache file: %s\n", pKey->tempName);
+
+    TGM_DetectCacheKeyWrite(pKey, output);
+
+    // the empty buffers are left out. this does not change the order the other events are merged in
+    uint32_t numSaved = 0;
+    for (unsigned int i = 0; i != numBuffs; ++i)
+    {
+        if (ppEventBuffs[i] != NULL && ppEventBuffs[i]->size != 0)
+            ++numSaved;
+    }
+
+    TGM_DetectCacheWrite(&numSaved, sizeof(uint32_t), output);
+
+    for (unsigned int i = 0; i != numBuffs; ++i)
+    {
+        const TGM_EventBuff* pEventBuff = ppEventBuffs[i];
+        if (pEventBuff == NULL || pEventBuff->size == 0)
+            continue;
+
+        uint32_t size = pEventBuff->size;
+
+        TGM_DetectCacheWrite(&size, sizeof(uint32_t), output);
+        TGM_DetectCacheWrite(&(pEventBuff->textSize), sizeof(uint64_t), output);
+        TGM_DetectCacheWrite(pEventBuff->data, size * sizeof(TGM_EventRecord), output);
+        TGM_DetectCacheWrite(pEventBuff->pText, pEventBuff->textSize, output);
+    }
+
+    if (fclose(output) != 0)
+        TGM_ErrQuit("ERROR: Cannot write the detect cache file: %s\n", pKey->tempName);
+
+    // the old cache file stays in place until the new one is complete
+    if (rename(pKey->tempName, pKey->cacheName) != 0)
+        TGM_ErrQuit("ERROR: Cannot replace the detect cache file: %s\n", pKey->cacheName);
+}
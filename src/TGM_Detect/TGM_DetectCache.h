@@ -0,0 +1,152 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_DetectCache.h
+ *
+ *    Description:  cache of the detected events of each reference for incremental detection
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_DETECTCACHE_H
+#define  TGM_DETECTCACHE_H
+
+#include <stdint.h>
+
+#include "TGM_Types.h"
+#include "TGM_LibInfo.h"
+#include "TGM_ReadPairFile.h"
+#include "TGM_ReadPairDetect.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// version of the detect cache format
+#define TGM_DETECT_CACHE_VERSION 1
+
+// a read pair chunk the events of a reference are detected from
+typedef struct TGM_DetectCacheChunk
+{
+    int16_t chunkType;                  // read pair type of the chunk
+
+    int16_t codec;                      // encoding of the read pairs in the chunk
+
+    uint64_t numPairs;                  // number of read pairs in the chunk
+
+    uint64_t size;                      // number of bytes of the chunk
+
+    unsigned char digest[16];           // md5 digest of the bytes of the chunk
+
+}TGM_DetectCacheChunk;
+
+// what the events of one engine on one reference depend on. the cached events
+// are only used if the key saved with them is the same as the current one
+typedef struct TGM_DetectCacheKey
+{
+    char* cacheName;                    // name of the cache file
+
+    char* tempName;                     // name of the cache file being written
+
+    int32_t refID;                      // reference ID
+
+    unsigned char parsDigest[16];       // digest of the parameters, the library table and the BAM files
+
+    TGM_DetectCacheChunk* pChunks;      // read pair chunks of the reference in index order
+
+    unsigned int numChunks;             // number of read pair chunks
+
+}TGM_DetectCacheKey;
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+//================================================================
+// function:
+//      make the cache key of the events of an engine on a
+//      reference from the index entries of its chunks
+//
+// args:
+//      1. workingDir: working directory of the cache files
+//      2. engineName: name of the detection engine
+//      3. refID: reference ID
+//      4. parsDigest: digest of the parameters of the engine
+//      5. pInFile: a pointer to the read pair container
+//      6. chunkSet: read pair chunk types read by the engine
+//
+// return:
+//      a pointer to the cache key
+//================================================================
+TGM_DetectCacheKey* TGM_DetectCacheKeyAlloc(const char* workingDir, const char* engineName, int32_t refID, const unsigned char parsDigest[16],
+                                            const TGM_ReadPairInFile* pInFile, uint32_t chunkSet);
+
+void TGM_DetectCacheKeyFree(TGM_DetectCacheKey* pKey);
+
+
+//======================
+// Interface functions
+//======================
+
+//================================================================
+// function:
+//      digest the parameters, the library table and the BAM files
+//      the events of an engine depend on. the tile size and the
+//      streaming of the special pairs are included since they can
+//      change where a cluster is cut. the number of threads is
+//      left out
+//
+// args:
+//      1. parsDigest: output digest
+//      2. pDetectPars: detection parameters
+//      3. pLibTable: library information table
+//      4. sampleFields: per-sample fields of the events
+//      5. pEngineData: settings of the engine (SV types or special
+//                      reference names)
+//      6. engineDataSize: number of bytes of the engine settings
+//      7. useBams: do the events of the engine read the BAM files
+//================================================================
+void TGM_DetectCacheDigestPars(unsigned char parsDigest[16], const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, uint32_t sampleFields,
+                               const void* pEngineData, size_t engineDataSize, TGM_Bool useBams);
+
+//================================================================
+// function:
+//      load the cached events of a reference
+//
+// args:
+//      1. pppEventBuffs: output event buffers in the order they
+//                        were saved
+//      2. pNumBuffs: output number of event buffers
+//      3. pKey: current cache key of the reference
+//
+// return:
+//      TGM_OK if the events are loaded, TGM_EOF if there is no
+//      cache file and TGM_ERR if the cache file is stale or
+//      broken (the events must be detected again)
+//================================================================
+TGM_Status TGM_DetectCacheLoad(TGM_EventBuff*** pppEventBuffs, unsigned int* pNumBuffs, const TGM_DetectCacheKey* pKey);
+
+//================================================================
+// function:
+//      save the events of a reference with their cache key. the
+//      cache file is replaced atomically so that an interrupted
+//      run never leaves a partial one behind
+//
+// args:
+//      1. pKey: cache key of the reference
+//      2. ppEventBuffs: event buffers of the reference (NULLs
+//                       skipped)
+//      3. numBuffs: number of event buffers
+//================================================================
+void TGM_DetectCacheSave(const TGM_DetectCacheKey* pKey, TGM_EventBuff* const* ppEventBuffs, unsigned int numBuffs);
+
+#endif  /*TGM_DETECTCACHE_H*/
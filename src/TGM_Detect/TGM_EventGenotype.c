@@ -0,0 +1,340 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_EventGenotype.c
+ *
+ *    Description:  count the read pairs supporting each allele of the events in the BAM files
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TGM_Error.h"
+#include "TGM_Utilities.h"
+#include "TGM_BamPairAux.h"
+#include "TGM_EventGenotype.h"
+
+#define DEFAULT_GENOTYPE_CAPACITY 100
+
+// support of a read pair for a site
+typedef enum
+{
+    TGM_GENOTYPE_NONE = -1,               // the pair is not informative
+
+    TGM_GENOTYPE_ALT  = 0,                // the pair supports the event
+
+    TGM_GENOTYPE_REF  = 1                 // the pair supports the reference
+
+}TGM_GenotypeAllele;
+
+static int CompareWindows(const void* a, const void* b)
+{
+    const TGM_GenotypeWindow* first = a;
+    const TGM_GenotypeWindow* second = b;
+
+    if (first->refID != second->refID)
+        return (first->refID < second->refID ? -1 : 1);
+    else if (first->begin != second->begin)
+        return (first->begin < second->begin ? -1 : 1);
+    else
+        return (first->siteIndex < second->siteIndex ? -1 : (first->siteIndex > second->siteIndex ? 1 : 0));
+}
+
+// the up mate of an informative pair starts within one maximum fragment length of a breakpoint.
+// the two windows of a site are joined if they overlap so that a pair is looked at once for a site
+static void TGM_GenotyperMakeWindows(TGM_Genotyper* pGenotyper)
+{
+    int32_t fragLenMax = pGenotyper->pLibTable->fragLenMax;
+    TGM_GenotypeWindowArray* pWindows = pGenotyper->pWindows;
+
+    TGM_ARRAY_RESET(pWindows);
+    TGM_ARRAY_RESIZE(pWindows, 2 * pGenotyper->pSites->size, TGM_GenotypeWindow);
+
+    for (unsigned int i = 0; i != pGenotyper->pSites->size; ++i)
+    {
+        const TGM_GenotypeSite* pSite = pGenotyper->pSites->data + i;
+
+        TGM_GenotypeWindow* pWindow = pWindows->data + pWindows->size;
+        pWindow->refID = pSite->refID;
+        pWindow->begin = (pSite->pos > fragLenMax ? pSite->pos - fragLenMax : 0);
+        pWindow->end = pSite->pos + fragLenMax;
+        pWindow->siteIndex = i;
+        ++(pWindows->size);
+
+        int32_t endBegin = (pSite->end > fragLenMax ? pSite->end - fragLenMax : 0);
+        if (endBegin <= pWindow->end)
+        {
+            if (pSite->end > pWindow->end)
+                pWindow->end = pSite->end;
+        }
+        else
+        {
+            ++pWindow;
+            pWindow->refID = pSite->refID;
+            pWindow->begin = endBegin;
+            pWindow->end = pSite->end;
+            pWindow->siteIndex = i;
+            ++(pWindows->size);
+        }
+    }
+
+    qsort(pWindows->data, pWindows->size, sizeof(TGM_GenotypeWindow), CompareWindows);
+}
+
+// classify the pair of an up mate for a site
+static TGM_GenotypeAllele TGM_GenotypeClassify(const TGM_GenotypeSite* pSite, const bam1_t* pUpAlgn, int32_t upEnd, int fragLen, SV_ReadPairType readPairType,
+                                               const TGM_LibInfo* pLibInfo)
+{
+    int32_t upPos = pUpAlgn->core.pos;
+    int32_t downPos = pUpAlgn->core.mpos;
+    int32_t fragEnd = upPos + fragLen;
+
+    // a breakpoint is known within the spread of the fragment length of the library
+    int32_t slack = pLibInfo->fragLenHigh - pLibInfo->fragLenMedian;
+    int32_t fragLenHigh = pLibInfo->fragLenHigh;
+
+    switch (pSite->eventType)
+    {
+        case SV_DELETION:
+            if (readPairType == PT_LONG && upPos >= pSite->pos - fragLenHigh && upEnd <= pSite->pos + slack
+                && downPos >= pSite->end - slack && fragEnd <= pSite->end + fragLenHigh)
+            {
+                return TGM_GENOTYPE_ALT;
+            }
+            break;
+        case SV_TANDEM_DUP:
+            if (readPairType == PT_REVERSED && upPos >= pSite->pos - slack && upPos < pSite->pos + fragLenHigh
+                && fragEnd <= pSite->end + slack && downPos >= pSite->end - fragLenHigh)
+            {
+                return TGM_GENOTYPE_ALT;
+            }
+            else if (readPairType == PT_SHORT && upEnd <= pSite->pos + slack && downPos >= pSite->pos - slack)
+            {
+                // a duplication found by the short pairs is a small insertion at its start
+                return TGM_GENOTYPE_ALT;
+            }
+            break;
+        case SV_INVERSION:
+            if ((readPairType == PT_INVERTED3 || readPairType == PT_INVERTED5) && abs(upPos - pSite->pos) < fragLenHigh
+                && abs(downPos - pSite->end) < fragLenHigh)
+            {
+                return TGM_GENOTYPE_ALT;
+            }
+            break;
+        default:
+            break;
+    }
+
+    // a normal pair spanning a breakpoint comes from the reference allele
+    if (readPairType == PT_NORMAL && ((upEnd <= pSite->pos && downPos >= pSite->pos) || (upEnd <= pSite->end && downPos >= pSite->end)))
+        return TGM_GENOTYPE_REF;
+
+    return TGM_GENOTYPE_NONE;
+}
+
+// type of a pair from the orientation and the fragment length of its up mate
+static SV_ReadPairType TGM_GenotypePairType(const TGM_PairStats* pPairStats, const TGM_LibInfo* pLibInfo)
+{
+    SV_ReadPairType type1 = SV_ReadPairTypeMap[0][pPairStats->pairMode];
+    SV_ReadPairType type2 = SV_ReadPairTypeMap[1][pPairStats->pairMode];
+
+    if (type1 == PT_NORMAL || type2 == PT_NORMAL)
+    {
+        if (pPairStats->fragLen > pLibInfo->fragLenHigh)
+            return PT_LONG;
+        else if (pPairStats->fragLen < pLibInfo->fragLenLow)
+            return PT_SHORT;
+        else
+            return PT_NORMAL;
+    }
+    else if ((type1 == PT_UNKNOWN && type2 == PT_UNKNOWN) || (type1 != PT_UNKNOWN && type2 != PT_UNKNOWN))
+    {
+        return PT_UNKNOWN;
+    }
+
+    return (type1 == PT_UNKNOWN ? type2 : type1);
+}
+
+// count the pairs whose up mates start in a region covered by the windows [first, last)
+static void TGM_GenotyperCountRegion(TGM_Genotyper* pGenotyper, unsigned int bamIndex, unsigned int first, unsigned int last, int32_t begin, int32_t end)
+{
+    const TGM_LibInfoTable* pLibTable = pGenotyper->pLibTable;
+    const TGM_GenotypeWindow* pWindows = pGenotyper->pWindows->data;
+    unsigned int numSamples = pLibTable->pSampleInfo->size;
+    bam1_t* pAlignment = pGenotyper->pAlignment;
+
+    // a window is at most three maximum fragment lengths long
+    int32_t maxWindowLen = 3 * pLibTable->fragLenMax;
+
+    bam_iter_t pBamIter = bam_iter_query(pGenotyper->ppIndices[bamIndex], pWindows[first].refID, begin, end);
+
+    unsigned int active = first;
+    while (bam_iter_read(pGenotyper->pBamInputs[bamIndex], pBamIter, pAlignment) >= 0)
+    {
+        const bam1_core_t* pCore = &(pAlignment->core);
+
+        // the alignments starting before the region belong to the previous one
+        if (pCore->pos < begin)
+            continue;
+
+        if ((pCore->flag & BAM_FPAIRED) == 0 || (pCore->flag & TGM_READ_PAIR_FMASK) != 0 || pCore->tid != pCore->mtid)
+            continue;
+
+        // only the up mate is counted
+        if (pCore->pos > pCore->mpos || (pCore->pos == pCore->mpos && (pCore->flag & BAM_FREAD1) == 0))
+            continue;
+
+        while (active != last && pWindows[active].begin + maxWindowLen <= pCore->pos)
+            ++active;
+
+        if (active == last || pWindows[active].begin > pCore->pos)
+            continue;
+
+        TGM_PairStats pairStats;
+        if (TGM_LoadPairStats(&pairStats, pAlignment, pLibTable) != TGM_OK)
+            continue;
+
+        const TGM_LibInfo* pLibInfo = pLibTable->pLibInfo + pairStats.readGrpID;
+        SV_ReadPairType readPairType = TGM_GenotypePairType(&pairStats, pLibInfo);
+        if (readPairType == PT_UNKNOWN)
+            continue;
+
+        int32_t sampleID = pLibTable->pSampleMap[pairStats.readGrpID];
+        int32_t upEnd = bam_calend(pCore, bam1_cigar(pAlignment));
+
+        for (unsigned int j = active; j != last && pWindows[j].begin <= pCore->pos; ++j)
+        {
+            if (pCore->pos >= pWindows[j].end)
+                continue;
+
+            uint32_t siteIndex = pWindows[j].siteIndex;
+            TGM_GenotypeAllele allele = TGM_GenotypeClassify(pGenotyper->pSites->data + siteIndex, pAlignment, upEnd, pairStats.fragLen, readPairType, pLibInfo);
+            if (allele != TGM_GENOTYPE_NONE)
+                ++(pGenotyper->pCounts[2 * ((uint64_t) siteIndex * numSamples + sampleID) + allele]);
+        }
+    }
+
+    bam_iter_destroy(pBamIter);
+}
+
+TGM_Genotyper* TGM_GenotyperAlloc(char* const* bamFileNames, bam_index_t* const* ppIndices, unsigned int numBamFiles, unsigned int cacheBlocks,
+                                  const TGM_LibInfoTable* pLibTable)
+{
+    TGM_Genotyper* pGenotyper = (TGM_Genotyper*) malloc(sizeof(TGM_Genotyper));
+    if (pGenotyper == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the genotyper.\n");
+
+    pGenotyper->pBamInputs = (bamFile*) malloc(numBamFiles * sizeof(bamFile));
+    if (pGenotyper->pBamInputs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the BAM inputs of the genotyper.\n");
+
+    if (cacheBlocks == 0)
+        cacheBlocks = TGM_GENOTYPE_CACHE_BLOCKS;
+
+    // the nearby regions of a batch do not inflate the same blocks again
+    for (unsigned int i = 0; i != numBamFiles; ++i)
+    {
+        pGenotyper->pBamInputs[i] = bam_open(bamFileNames[i], "r");
+        if (pGenotyper->pBamInputs[i] == NULL)
+            TGM_ErrQuit("ERROR: Cannot open bam file: %s.\n", bamFileNames[i]);
+
+        bgzf_set_cache_size(pGenotyper->pBamInputs[i], cacheBlocks * TGM_BGZF_BLOCK_SIZE);
+    }
+
+    pGenotyper->ppIndices = ppIndices;
+    pGenotyper->numBamFiles = numBamFiles;
+    pGenotyper->pLibTable = pLibTable;
+    pGenotyper->pAlignment = bam_init1();
+
+    pGenotyper->pSites = NULL;
+    TGM_ARRAY_ALLOC(pGenotyper->pSites, DEFAULT_GENOTYPE_CAPACITY, TGM_GenotypeSiteArray, TGM_GenotypeSite);
+
+    pGenotyper->pWindows = NULL;
+    TGM_ARRAY_ALLOC(pGenotyper->pWindows, 2 * DEFAULT_GENOTYPE_CAPACITY, TGM_GenotypeWindowArray, TGM_GenotypeWindow);
+
+    pGenotyper->pCounts = NULL;
+    pGenotyper->countCapacity = 0;
+
+    return pGenotyper;
+}
+
+void TGM_GenotyperFree(TGM_Genotyper* pGenotyper)
+{
+    if (pGenotyper != NULL)
+    {
+        for (unsigned int i = 0; i != pGenotyper->numBamFiles; ++i)
+            bam_close(pGenotyper->pBamInputs[i]);
+
+        free(pGenotyper->pBamInputs);
+        bam_destroy1(pGenotyper->pAlignment);
+
+        TGM_ARRAY_FREE(pGenotyper->pSites, TRUE);
+        TGM_ARRAY_FREE(pGenotyper->pWindows, TRUE);
+        free(pGenotyper->pCounts);
+
+        free(pGenotyper);
+    }
+}
+
+void TGM_GenotyperReset(TGM_Genotyper* pGenotyper)
+{
+    TGM_ARRAY_RESET(pGenotyper->pSites);
+}
+
+void TGM_GenotyperAddSite(TGM_Genotyper* pGenotyper, int32_t refID, int32_t pos, int32_t end, SV_EventType eventType)
+{
+    TGM_GenotypeSite site = {refID, pos, end, eventType};
+    TGM_ARRAY_PUSH(pGenotyper->pSites, &site, TGM_GenotypeSite);
+}
+
+void TGM_GenotyperRun(TGM_Genotyper* pGenotyper)
+{
+    uint64_t numCounts = 2 * (uint64_t) pGenotyper->pSites->size * pGenotyper->pLibTable->pSampleInfo->size;
+    if (numCounts > pGenotyper->countCapacity)
+    {
+        free(pGenotyper->pCounts);
+        pGenotyper->countCapacity = numCounts;
+        pGenotyper->pCounts = (uint32_t*) malloc(numCounts * sizeof(uint32_t));
+        if (pGenotyper->pCounts == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the genotype counts.\n");
+    }
+
+    if (numCounts == 0)
+        return;
+
+    memset(pGenotyper->pCounts, 0, numCounts * sizeof(uint32_t));
+
+    TGM_GenotyperMakeWindows(pGenotyper);
+    const TGM_GenotypeWindow* pWindows = pGenotyper->pWindows->data;
+    unsigned int numWindows = pGenotyper->pWindows->size;
+
+    // the overlapping windows are fetched as one region
+    unsigned int first = 0;
+    while (first != numWindows)
+    {
+        int32_t end = pWindows[first].end;
+        unsigned int last = first + 1;
+        while (last != numWindows && pWindows[last].refID == pWindows[first].refID && pWindows[last].begin <= end)
+        {
+            if (pWindows[last].end > end)
+                end = pWindows[last].end;
+
+            ++last;
+        }
+
+        for (unsigned int i = 0; i != pGenotyper->numBamFiles; ++i)
+            TGM_GenotyperCountRegion(pGenotyper, i, first, last, pWindows[first].begin, end);
+
+        first = last;
+    }
+}
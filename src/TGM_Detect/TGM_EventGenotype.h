@@ -0,0 +1,161 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_EventGenotype.h
+ *
+ *    Description:  count the read pairs supporting each allele of the events in the BAM files
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_EVENTGENOTYPE_H
+#define  TGM_EVENTGENOTYPE_H
+
+#include <stdint.h>
+
+#include "bam.h"
+#include "TGM_LibInfo.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// default number of decoded BGZF blocks cached for each BAM file
+#define TGM_GENOTYPE_CACHE_BLOCKS 32
+
+// size of a decoded BGZF block
+#define TGM_BGZF_BLOCK_SIZE 0x10000
+
+// an event to be genotyped
+typedef struct TGM_GenotypeSite
+{
+    int32_t refID;                        // reference ID of the event
+
+    int32_t pos;                          // 5' breakpoint of the event
+
+    int32_t end;                          // 3' breakpoint of the event
+
+    SV_EventType eventType;               // deletion, tandem duplication or inversion
+
+}TGM_GenotypeSite;
+
+typedef struct TGM_GenotypeSiteArray
+{
+    TGM_GenotypeSite* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_GenotypeSiteArray;
+
+// a window around a breakpoint holding the up mates of the informative read pairs of a site
+typedef struct TGM_GenotypeWindow
+{
+    int32_t refID;                        // reference ID of the window
+
+    int32_t begin;                        // start of the window
+
+    int32_t end;                          // end of the window (exclusive)
+
+    uint32_t siteIndex;                   // site of the window
+
+}TGM_GenotypeWindow;
+
+typedef struct TGM_GenotypeWindowArray
+{
+    TGM_GenotypeWindow* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_GenotypeWindowArray;
+
+// genotyper of a detection thread. the sites of a batch are sorted into breakpoint windows and the
+// overlapping windows are read from each BAM file once, so the nearby events share their reads
+typedef struct TGM_Genotyper
+{
+    bamFile* pBamInputs;                  // input of each BAM file (the BGZF block cache is per input)
+
+    bam_index_t* const* ppIndices;        // index of each BAM file (shared, not owned)
+
+    unsigned int numBamFiles;             // number of BAM files
+
+    const TGM_LibInfoTable* pLibTable;    // library information table
+
+    bam1_t* pAlignment;                   // alignment being read
+
+    TGM_GenotypeSiteArray* pSites;        // sites of the current batch
+
+    TGM_GenotypeWindowArray* pWindows;    // breakpoint windows of the sites
+
+    uint32_t* pCounts;                    // alternative and reference counts of each sample at each site
+
+    uint64_t countCapacity;               // capacity of the count buffer
+
+}TGM_Genotyper;
+
+// alternative and reference counts of the samples at a site: count[2 * sampleID] and count[2 * sampleID + 1]
+#define TGM_GenotyperCounts(pGenotyper, siteIndex) ((pGenotyper)->pCounts + 2 * (uint64_t) (siteIndex) * (pGenotyper)->pLibTable->pSampleInfo->size)
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+//================================================================
+// function:
+//      allocate a genotyper reading the given BAM files
+//
+// args:
+//      1. bamFileNames: names of the BAM files
+//      2. ppIndices: index of each BAM file (shared, not owned)
+//      3. numBamFiles: number of BAM files
+//      4. cacheBlocks: number of decoded BGZF blocks cached for
+//                      each BAM file (0 for the default)
+//      5. pLibTable: library information table
+//
+// return:
+//      a pointer to the genotyper
+//================================================================
+TGM_Genotyper* TGM_GenotyperAlloc(char* const* bamFileNames, bam_index_t* const* ppIndices, unsigned int numBamFiles, unsigned int cacheBlocks,
+                                  const TGM_LibInfoTable* pLibTable);
+
+void TGM_GenotyperFree(TGM_Genotyper* pGenotyper);
+
+
+//======================
+// Interface functions
+//======================
+
+// start a new batch of sites
+void TGM_GenotyperReset(TGM_Genotyper* pGenotyper);
+
+// add a site to the current batch. the counts of the site are found with the index of its addition
+void TGM_GenotyperAddSite(TGM_Genotyper* pGenotyper, int32_t refID, int32_t pos, int32_t end, SV_EventType eventType);
+
+//================================================================
+// function:
+//      count the read pairs supporting the alternative and the
+//      reference allele of each site in the current batch.
+//      a read pair supports the alternative allele if its
+//      orientation and fragment length agree with the event
+//      and its reads are close to the breakpoints. a normal
+//      pair supports the reference allele if it spans one of
+//      the breakpoints
+//
+// args:
+//      1. pGenotyper: a pointer to the genotyper
+//================================================================
+void TGM_GenotyperRun(TGM_Genotyper* pGenotyper);
+
+#endif  /*TGM_EVENTGENOTYPE_H*/
@@ -0,0 +1,829 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_EventWriter.c
+ *
+ *    Description:  buffered, ordered output of the SV events
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "khash.h"
+#include "bgzf.h"
+#include "TGM_Error.h"
+#include "TGM_Utilities.h"
+#include "TGM_EventWriter.h"
+
+#define DEFAULT_EVENT_CAPACITY 64
+
+#define DEFAULT_EVENT_TEXT_CAPACITY 4096
+
+// a tabix linear index window covers 16kb
+#define TGM_TABIX_LIDX_SHIFT 14
+
+// tabix preset of the VCF format
+#define TGM_TABIX_FORMAT_VCF 2
+
+// characters of a contig line of the VCF header besides the reference name
+#define TGM_VCF_CONTIG_LINE_SIZE 40
+
+static const char* TGM_TabixIndexSuffix = ".tbi";
+
+KHASH_MAP_INIT_INT(tbiBin, uint32_t);
+
+// the event buffers of one reference waiting to be written
+typedef struct TGM_EventBatch
+{
+    TGM_EventBuff** ppEventBuffs;         // event buffers of the reference
+
+    unsigned int numBuffs;                // number of event buffers
+
+    struct TGM_EventBatch* pNext;         // next batch in the queue
+
+}TGM_EventBatch;
+
+// a range of virtual file offsets in the compressed output
+typedef struct TGM_TabixChunk
+{
+    uint64_t beg;                         // virtual offset of the first event in the chunk
+
+    uint64_t end;                         // virtual offset right after the last event in the chunk
+
+}TGM_TabixChunk;
+
+typedef struct TGM_TabixBin
+{
+    TGM_TabixChunk* data;                 // chunks of the events in the bin
+
+    unsigned int size;                    // number of chunks
+
+    unsigned int capacity;                // capacity of the chunk array
+
+    uint32_t bin;                         // bin number
+
+}TGM_TabixBin;
+
+// index of one reference
+typedef struct TGM_TabixRef
+{
+    int32_t refID;                        // reference ID
+
+    TGM_TabixBin* pBins;                  // bins with events, in the order they are first used
+
+    unsigned int numBins;                 // number of bins
+
+    unsigned int binCapacity;             // capacity of the bin array
+
+    khash_t(tbiBin)* pBinHash;            // bin number to its index in the bin array
+
+    uint64_t* pOffsets;                   // linear index: the smallest virtual offset of the events overlapping each window
+
+    unsigned int numOffsets;              // number of linear index windows
+
+    unsigned int offsetCapacity;          // capacity of the linear index
+
+}TGM_TabixRef;
+
+typedef struct TGM_TabixIndex
+{
+    TGM_TabixRef* data;                   // indexed references in the order they are written
+
+    unsigned int size;                    // number of indexed references
+
+    unsigned int capacity;                // capacity of the reference array
+
+}TGM_TabixIndex;
+
+// meta lines of the VCF header. the contig lines and the column line are added when the output is opened
+static const char* TGM_VcfMeta =
+    "##fileformat=VCFv4.1\n"
+    "##source=Tangram\n"
+    "##INFO=<ID=SVTYPE,Number=1,Type=String,Description=\"Type of structural variant\">\n"
+    "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End position of the variant described in this record\">\n"
+    "##INFO=<ID=SVLEN,Number=1,Type=Integer,Description=\"Difference in length between REF and ALT alleles\">\n"
+    "##INFO=<ID=CIPOS,Number=2,Type=Integer,Description=\"Confidence interval around POS\">\n"
+    "##INFO=<ID=CIEND,Number=2,Type=Integer,Description=\"Confidence interval around END\">\n"
+    "##INFO=<ID=CILEN,Number=2,Type=Integer,Description=\"Confidence interval around SVLEN\">\n"
+    "##INFO=<ID=CHR2,Number=1,Type=String,Description=\"Chromosome of the other breakpoint of a translocation\">\n"
+    "##INFO=<ID=POS2,Number=1,Type=Integer,Description=\"Position of the other breakpoint of a translocation\">\n"
+    "##INFO=<ID=STRANDS,Number=1,Type=String,Description=\"Strands of the up and down mates of a translocation\">\n"
+    "##INFO=<ID=NFRAG,Number=.,Type=Integer,Description=\"Number of supporting fragments\">\n"
+    "##ALT=<ID=DEL,Description=\"Deletion\">\n"
+    "##ALT=<ID=DUP:TANDEM,Description=\"Tandem duplication\">\n"
+    "##ALT=<ID=INV,Description=\"Inversion\">\n"
+    "##ALT=<ID=TRA,Description=\"Inter-chromosome translocation\">\n"
+    "##ALT=<ID=INS:ME,Description=\"Insertion of a mobile element\">\n";
+
+static const char* TGM_VcfSupportMeta = "##FORMAT=<ID=SU,Number=1,Type=Integer,Description=\"Number of read pairs supporting the event\">\n";
+
+static const char* TGM_VcfGenotypeMeta = "##FORMAT=<ID=AS,Number=1,Type=Integer,Description=\"Number of read pairs supporting the alternative allele in the BAM files\">\n"
+                                         "##FORMAT=<ID=RS,Number=1,Type=Integer,Description=\"Number of read pairs supporting the reference allele in the BAM files\">\n";
+
+static const char* TGM_VcfColumns = "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO";
+
+static int CompareEventRecords(const void* a, const void* b)
+{
+    const TGM_EventRecord* pFirst = a;
+    const TGM_EventRecord* pSecond = b;
+
+    if (pFirst->refID != pSecond->refID)
+        return (pFirst->refID < pSecond->refID ? -1 : 1);
+
+    if (pFirst->pos != pSecond->pos)
+        return (pFirst->pos < pSecond->pos ? -1 : 1);
+
+    // the text offset keeps the events at the same position in the order they were added
+    if (pFirst->offset != pSecond->offset)
+        return (pFirst->offset < pSecond->offset ? -1 : 1);
+
+    return 0;
+}
+
+// the smallest bin containing [beg, end)
+static inline uint32_t TGM_TabixReg2Bin(int32_t beg, int32_t end)
+{
+    --end;
+
+    if (beg >> 14 == end >> 14)
+        return ((1 << 15) - 1) / 7 + (beg >> 14);
+
+    if (beg >> 17 == end >> 17)
+        return ((1 << 12) - 1) / 7 + (beg >> 17);
+
+    if (beg >> 20 == end >> 20)
+        return ((1 << 9) - 1) / 7 + (beg >> 20);
+
+    if (beg >> 23 == end >> 23)
+        return ((1 << 6) - 1) / 7 + (beg >> 23);
+
+    if (beg >> 26 == end >> 26)
+        return ((1 << 3) - 1) / 7 + (beg >> 26);
+
+    return 0;
+}
+
+static TGM_TabixIndex* TGM_TabixIndexAlloc(void)
+{
+    TGM_TabixIndex* pIndex = NULL;
+    TGM_ARRAY_ALLOC(pIndex, 32, TGM_TabixIndex, TGM_TabixRef);
+
+    return pIndex;
+}
+
+static void TGM_TabixIndexFree(TGM_TabixIndex* pIndex)
+{
+    if (pIndex != NULL)
+    {
+        for (unsigned int i = 0; i != pIndex->size; ++i)
+        {
+            TGM_TabixRef* pRef = pIndex->data + i;
+
+            for (unsigned int j = 0; j != pRef->numBins; ++j)
+                free(pRef->pBins[j].data);
+
+            free(pRef->pBins);
+            free(pRef->pOffsets);
+            kh_destroy(tbiBin, pRef->pBinHash);
+        }
+
+        TGM_ARRAY_FREE(pIndex, TRUE);
+    }
+}
+
+static TGM_TabixRef* TGM_TabixIndexGetRef(TGM_TabixIndex* pIndex, int32_t refID)
+{
+    if (pIndex->size > 0 && pIndex->data[pIndex->size - 1].refID == refID)
+        return pIndex->data + (pIndex->size - 1);
+
+    // the events of a reference are written together
+    for (unsigned int i = 0; i != pIndex->size; ++i)
+    {
+        if (pIndex->data[i].refID == refID)
+            TGM_ErrQuit("ERROR: The events of reference %d are not written together.\n", refID);
+    }
+
+    TGM_TabixRef newRef;
+    memset(&newRef, 0, sizeof(TGM_TabixRef));
+
+    newRef.refID = refID;
+    newRef.pBinHash = kh_init(tbiBin);
+
+    TGM_ARRAY_PUSH(pIndex, &newRef, TGM_TabixRef);
+
+    return pIndex->data + (pIndex->size - 1);
+}
+
+// add an event written at [vbeg, vend) of the compressed output into the index
+static void TGM_TabixIndexAdd(TGM_TabixIndex* pIndex, int32_t refID, int32_t beg, int32_t end, uint64_t vbeg, uint64_t vend)
+{
+    if (beg < 0)
+        beg = 0;
+
+    if (end <= beg)
+        end = beg + 1;
+
+    TGM_TabixRef* pRef = TGM_TabixIndexGetRef(pIndex, refID);
+
+    int ret = 0;
+    uint32_t bin = TGM_TabixReg2Bin(beg, end);
+    khiter_t khIter = kh_put(tbiBin, pRef->pBinHash, bin, &ret);
+
+    if (ret != 0)
+    {
+        if (pRef->numBins == pRef->binCapacity)
+        {
+            pRef->binCapacity = (pRef->binCapacity == 0 ? 16 : pRef->binCapacity * 2);
+            pRef->pBins = (TGM_TabixBin*) realloc(pRef->pBins, pRef->binCapacity * sizeof(TGM_TabixBin));
+            if (pRef->pBins == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the bins of the tabix index.\n");
+        }
+
+        TGM_TabixBin* pNewBin = pRef->pBins + pRef->numBins;
+        TGM_ARRAY_INIT(pNewBin, 4, TGM_TabixChunk);
+        pNewBin->bin = bin;
+
+        kh_value(pRef->pBinHash, khIter) = pRef->numBins;
+        ++(pRef->numBins);
+    }
+
+    // the events are written in order so that a bin only grows at its last chunk
+    TGM_TabixBin* pBin = pRef->pBins + kh_value(pRef->pBinHash, khIter);
+    if (pBin->size > 0 && pBin->data[pBin->size - 1].end == vbeg)
+        pBin->data[pBin->size - 1].end = vend;
+    else
+    {
+        TGM_TabixChunk newChunk = {vbeg, vend};
+        TGM_ARRAY_PUSH(pBin, &newChunk, TGM_TabixChunk);
+    }
+
+    unsigned int first = beg >> TGM_TABIX_LIDX_SHIFT;
+    unsigned int last = (end - 1) >> TGM_TABIX_LIDX_SHIFT;
+
+    if (last >= pRef->offsetCapacity)
+    {
+        unsigned int newCapacity = (pRef->offsetCapacity == 0 ? 64 : pRef->offsetCapacity);
+        while (newCapacity <= last)
+            newCapacity *= 2;
+
+        pRef->pOffsets = (uint64_t*) realloc(pRef->pOffsets, newCapacity * sizeof(uint64_t));
+        if (pRef->pOffsets == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the linear index of the tabix index.\n");
+
+        memset(pRef->pOffsets + pRef->offsetCapacity, 0, (newCapacity - pRef->offsetCapacity) * sizeof(uint64_t));
+        pRef->offsetCapacity = newCapacity;
+    }
+
+    for (unsigned int w = first; w <= last; ++w)
+    {
+        if (pRef->pOffsets[w] == 0)
+            pRef->pOffsets[w] = vbeg;
+    }
+
+    if (last + 1 > pRef->numOffsets)
+        pRef->numOffsets = last + 1;
+}
+
+static int CompareTabixBins(const void* a, const void* b)
+{
+    const TGM_TabixBin* pFirst = a;
+    const TGM_TabixBin* pSecond = b;
+
+    if (pFirst->bin != pSecond->bin)
+        return (pFirst->bin < pSecond->bin ? -1 : 1);
+
+    return 0;
+}
+
+static void TGM_TabixWrite(BGZF* pIndexOutput, const void* pData, int size)
+{
+    if (bgzf_write(pIndexOutput, pData, size) != size)
+        TGM_ErrQuit("ERROR: Cannot write the tabix index.\n");
+}
+
+static void TGM_TabixWriteInt32(BGZF* pIndexOutput, int32_t value)
+{
+    TGM_TabixWrite(pIndexOutput, &value, sizeof(int32_t));
+}
+
+// write the index in the tabix (.tbi) format. the integers are little-endian like the rest of our binary files
+static void TGM_TabixIndexWrite(TGM_TabixIndex* pIndex, const char* indexName, const TGM_AnchorInfo* pAnchorInfo)
+{
+    BGZF* pIndexOutput = bgzf_open(indexName, "w");
+    if (pIndexOutput == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the tabix index file: %s\n", indexName);
+
+    TGM_TabixWrite(pIndexOutput, "TBI\1", 4);
+    TGM_TabixWriteInt32(pIndexOutput, pIndex->size);
+
+    // format, sequence column, begin column, end column, meta character and number of skipped lines
+    TGM_TabixWriteInt32(pIndexOutput, TGM_TABIX_FORMAT_VCF);
+    TGM_TabixWriteInt32(pIndexOutput, 1);
+    TGM_TabixWriteInt32(pIndexOutput, 2);
+    TGM_TabixWriteInt32(pIndexOutput, 0);
+    TGM_TabixWriteInt32(pIndexOutput, '#');
+    TGM_TabixWriteInt32(pIndexOutput, 0);
+
+    // the sequence names are the ones in the CHROM column
+    int32_t namesLen = 0;
+    for (unsigned int i = 0; i != pIndex->size; ++i)
+        namesLen += strlen(pAnchorInfo->pAnchors[pIndex->data[i].refID]) + 1;
+
+    TGM_TabixWriteInt32(pIndexOutput, namesLen);
+    for (unsigned int i = 0; i != pIndex->size; ++i)
+    {
+        const char* refName = pAnchorInfo->pAnchors[pIndex->data[i].refID];
+        TGM_TabixWrite(pIndexOutput, refName, strlen(refName) + 1);
+    }
+
+    for (unsigned int i = 0; i != pIndex->size; ++i)
+    {
+        TGM_TabixRef* pRef = pIndex->data + i;
+
+        qsort(pRef->pBins, pRef->numBins, sizeof(TGM_TabixBin), CompareTabixBins);
+
+        TGM_TabixWriteInt32(pIndexOutput, pRef->numBins);
+        for (unsigned int j = 0; j != pRef->numBins; ++j)
+        {
+            TGM_TabixBin* pBin = pRef->pBins + j;
+
+            TGM_TabixWrite(pIndexOutput, &(pBin->bin), sizeof(uint32_t));
+            TGM_TabixWriteInt32(pIndexOutput, pBin->size);
+            TGM_TabixWrite(pIndexOutput, pBin->data, pBin->size * sizeof(TGM_TabixChunk));
+        }
+
+        // the empty windows point to the closest event before them
+        for (unsigned int w = 1; w < pRef->numOffsets; ++w)
+        {
+            if (pRef->pOffsets[w] == 0)
+                pRef->pOffsets[w] = pRef->pOffsets[w - 1];
+        }
+
+        TGM_TabixWriteInt32(pIndexOutput, pRef->numOffsets);
+        TGM_TabixWrite(pIndexOutput, pRef->pOffsets, pRef->numOffsets * sizeof(uint64_t));
+    }
+
+    if (bgzf_close(pIndexOutput) != 0)
+        TGM_ErrQuit("ERROR: Cannot close the tabix index file: %s\n", indexName);
+}
+
+static void TGM_EventWriterPut(TGM_EventWriter* pWriter, const TGM_EventRecord* pRecord, const char* pText)
+{
+    if (pWriter->pBgzf == NULL)
+    {
+        if (fwrite(pText, sizeof(char), pRecord->length, pWriter->output) != pRecord->length)
+            TGM_ErrQuit("ERROR: Cannot write the events.\n");
+
+        return;
+    }
+
+    BGZF* pBgzf = pWriter->pBgzf;
+
+    uint64_t vbeg = bgzf_tell(pBgzf);
+    if (bgzf_write(pBgzf, pText, pRecord->length) != (int) pRecord->length)
+        TGM_ErrQuit("ERROR: Cannot write the compressed events.\n");
+
+    uint64_t vend = bgzf_tell(pBgzf);
+
+    if (pWriter->pIndex != NULL)
+        TGM_TabixIndexAdd(pWriter->pIndex, pRecord->refID, pRecord->pos, pRecord->end, vbeg, vend);
+}
+
+// restore the heap property below node i of the stream heap. the streams are ordered by their
+// current events and then by their positions in the batch so that the output does not depend on timing
+static void TGM_EventHeapDown(unsigned int* pHeap, unsigned int heapSize, unsigned int i, TGM_EventBuff** ppEventBuffs, const unsigned int* pCursors)
+{
+    while (TRUE)
+    {
+        unsigned int smallest = i;
+
+        for (unsigned int child = 2 * i + 1; child <= 2 * i + 2 && child < heapSize; ++child)
+        {
+            const TGM_EventRecord* pChild = ppEventBuffs[pHeap[child]]->data + pCursors[pHeap[child]];
+            const TGM_EventRecord* pSmallest = ppEventBuffs[pHeap[smallest]]->data + pCursors[pHeap[smallest]];
+
+            int cmp = 0;
+            if (pChild->refID != pSmallest->refID)
+                cmp = (pChild->refID < pSmallest->refID ? -1 : 1);
+            else if (pChild->pos != pSmallest->pos)
+                cmp = (pChild->pos < pSmallest->pos ? -1 : 1);
+            else
+                cmp = (pHeap[child] < pHeap[smallest] ? -1 : 1);
+
+            if (cmp < 0)
+                smallest = child;
+        }
+
+        if (smallest == i)
+            break;
+
+        unsigned int temp = pHeap[i];
+        pHeap[i] = pHeap[smallest];
+        pHeap[smallest] = temp;
+
+        i = smallest;
+    }
+}
+
+// merge the event buffers of a batch by position and write them
+static void TGM_EventWriterWriteBatch(TGM_EventWriter* pWriter, TGM_EventBatch* pBatch)
+{
+    TGM_EventBuff** ppEventBuffs = pBatch->ppEventBuffs;
+    unsigned int numBuffs = pBatch->numBuffs;
+
+    unsigned int* pHeap = (unsigned int*) malloc(2 * (numBuffs + 1) * sizeof(unsigned int));
+    if (pHeap == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for merging the events.\n");
+
+    unsigned int* pCursors = pHeap + (numBuffs + 1);
+    unsigned int heapSize = 0;
+
+    for (unsigned int i = 0; i != numBuffs; ++i)
+    {
+        TGM_EventBuff* pEventBuff = ppEventBuffs[i];
+        pCursors[i] = 0;
+
+        if (pEventBuff == NULL || pEventBuff->size == 0)
+            continue;
+
+        // most jobs find their events in position order
+        for (unsigned int j = 1; j < pEventBuff->size; ++j)
+        {
+            if (CompareEventRecords(pEventBuff->data + j - 1, pEventBuff->data + j) > 0)
+            {
+                qsort(pEventBuff->data, pEventBuff->size, sizeof(TGM_EventRecord), CompareEventRecords);
+                break;
+            }
+        }
+
+        pHeap[heapSize++] = i;
+    }
+
+    for (unsigned int i = heapSize / 2; i-- > 0; )
+        TGM_EventHeapDown(pHeap, heapSize, i, ppEventBuffs, pCursors);
+
+    while (heapSize > 0)
+    {
+        unsigned int top = pHeap[0];
+        TGM_EventBuff* pEventBuff = ppEventBuffs[top];
+        const TGM_EventRecord* pRecord = pEventBuff->data + pCursors[top];
+
+        TGM_EventWriterPut(pWriter, pRecord, pEventBuff->pText + pRecord->offset);
+
+        ++(pCursors[top]);
+        if (pCursors[top] == pEventBuff->size)
+            pHeap[0] = pHeap[--heapSize];
+
+        TGM_EventHeapDown(pHeap, heapSize, 0, ppEventBuffs, pCursors);
+    }
+
+    free(pHeap);
+
+    for (unsigned int i = 0; i != numBuffs; ++i)
+        TGM_EventBuffFree(ppEventBuffs[i]);
+
+    free(ppEventBuffs);
+    free(pBatch);
+}
+
+// write the submitted batches in order until the output is closed
+static void* TGM_EventWriterThread(void* pArg)
+{
+    TGM_EventWriter* pWriter = pArg;
+
+    pthread_mutex_lock(&(pWriter->mutex));
+
+    while (TRUE)
+    {
+        while (pWriter->pHead == NULL && !pWriter->isClosing)
+            pthread_cond_wait(&(pWriter->cond), &(pWriter->mutex));
+
+        if (pWriter->pHead == NULL)
+            break;
+
+        TGM_EventBatch* pBatch = pWriter->pHead;
+        pWriter->pHead = pBatch->pNext;
+        if (pWriter->pHead == NULL)
+            pWriter->pTail = NULL;
+
+        pthread_mutex_unlock(&(pWriter->mutex));
+
+        TGM_EventWriterWriteBatch(pWriter, pBatch);
+
+        pthread_mutex_lock(&(pWriter->mutex));
+    }
+
+    pthread_mutex_unlock(&(pWriter->mutex));
+
+    return NULL;
+}
+
+// format text at the end of the text buffer without counting it in. returns the length of the text
+static int TGM_EventBuffFormat(TGM_EventBuff* pEventBuff, const char* format, va_list ap)
+{
+    va_list apCopy;
+    uint64_t available = pEventBuff->textCapacity - pEventBuff->textSize;
+
+    va_copy(apCopy, ap);
+    int length = vsnprintf(pEventBuff->pText + pEventBuff->textSize, available, format, apCopy);
+    va_end(apCopy);
+
+    if (length < 0)
+        TGM_ErrQuit("ERROR: Cannot format an event.\n");
+
+    // the text did not fit. grow the buffer and format it again
+    if ((uint64_t) length >= available)
+    {
+        while (pEventBuff->textCapacity - pEventBuff->textSize <= (uint64_t) length)
+            pEventBuff->textCapacity *= 2;
+
+        pEventBuff->pText = (char*) realloc(pEventBuff->pText, pEventBuff->textCapacity);
+        if (pEventBuff->pText == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the text of the events.\n");
+
+        vsnprintf(pEventBuff->pText + pEventBuff->textSize, pEventBuff->textCapacity - pEventBuff->textSize, format, ap);
+    }
+
+    return length;
+}
+
+// the VCF header gets a contig line for each reference and a sample column for each sample when the per-sample fields are written
+static char* TGM_VcfHeaderMake(const char* const* pSampleNames, unsigned int numSamples, uint32_t sampleFields, const TGM_AnchorInfo* pAnchorInfo)
+{
+    if (sampleFields == 0)
+        numSamples = 0;
+
+    size_t headerLen = strlen(TGM_VcfMeta) + strlen(TGM_VcfSupportMeta) + strlen(TGM_VcfGenotypeMeta) + strlen(TGM_VcfColumns) + strlen("\tFORMAT\n");
+    for (unsigned int i = 0; i != numSamples; ++i)
+        headerLen += strlen(pSampleNames[i]) + 1;
+
+    for (unsigned int i = 0; i != pAnchorInfo->size; ++i)
+        headerLen += strlen(pAnchorInfo->pAnchors[i]) + TGM_VCF_CONTIG_LINE_SIZE;
+
+    char* pHeader = (char*) malloc(headerLen + 1);
+    if (pHeader == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the VCF header.\n");
+
+    strcpy(pHeader, TGM_VcfMeta);
+    if ((sampleFields & TGM_SAMPLE_SUPPORT) != 0)
+        strcat(pHeader, TGM_VcfSupportMeta);
+
+    if ((sampleFields & TGM_SAMPLE_GENOTYPE) != 0)
+        strcat(pHeader, TGM_VcfGenotypeMeta);
+
+    // the length of a reference left out of the library table is unknown
+    char* pEnd = pHeader + strlen(pHeader);
+    for (unsigned int i = 0; i != pAnchorInfo->size; ++i)
+    {
+        if (pAnchorInfo->pLength[i] > 0)
+            pEnd += sprintf(pEnd, "##contig=<ID=%s,length=%d>\n", pAnchorInfo->pAnchors[i], pAnchorInfo->pLength[i]);
+        else
+            pEnd += sprintf(pEnd, "##contig=<ID=%s>\n", pAnchorInfo->pAnchors[i]);
+    }
+
+    strcat(pHeader, TGM_VcfColumns);
+    if (numSamples > 0)
+    {
+        strcat(pHeader, "\tFORMAT");
+        for (unsigned int i = 0; i != numSamples; ++i)
+        {
+            strcat(pHeader, "\t");
+            strcat(pHeader, pSampleNames[i]);
+        }
+    }
+
+    strcat(pHeader, "\n");
+
+    return pHeader;
+}
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_EventBuff* TGM_EventBuffAlloc(void)
+{
+    TGM_EventBuff* pEventBuff = NULL;
+    TGM_ARRAY_ALLOC(pEventBuff, DEFAULT_EVENT_CAPACITY, TGM_EventBuff, TGM_EventRecord);
+
+    pEventBuff->textSize = 0;
+    pEventBuff->textCapacity = DEFAULT_EVENT_TEXT_CAPACITY;
+    pEventBuff->pText = (char*) malloc(pEventBuff->textCapacity);
+    if (pEventBuff->pText == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the text of the events.\n");
+
+    return pEventBuff;
+}
+
+void TGM_EventBuffFree(TGM_EventBuff* pEventBuff)
+{
+    if (pEventBuff != NULL)
+    {
+        free(pEventBuff->pText);
+        TGM_ARRAY_FREE(pEventBuff, TRUE);
+    }
+}
+
+TGM_EventWriter* TGM_EventWriterOpen(const char* outputName, TGM_EventFormat format, TGM_Bool compress, const char* const* pSampleNames, unsigned int numSamples,
+                                     uint32_t sampleFields, const TGM_AnchorInfo* pAnchorInfo)
+{
+    TGM_EventWriter* pWriter = (TGM_EventWriter*) calloc(1, sizeof(TGM_EventWriter));
+    if (pWriter == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the event writer.\n");
+
+    pWriter->format = format;
+    pWriter->pAnchorInfo = pAnchorInfo;
+
+    if (compress)
+    {
+        if (outputName != NULL)
+            pWriter->pBgzf = bgzf_open(outputName, "w");
+        else
+            pWriter->pBgzf = bgzf_fdopen(fileno(stdout), "w");
+
+        if (pWriter->pBgzf == NULL)
+            TGM_ErrQuit("ERROR: Cannot open the event output file: %s\n", (outputName != NULL ? outputName : "stdout"));
+
+        // the index needs a file to sit next to
+        if (format == TGM_EVENT_VCF && outputName != NULL)
+        {
+            pWriter->indexName = (char*) malloc(strlen(outputName) + strlen(TGM_TabixIndexSuffix) + 1);
+            if (pWriter->indexName == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the name of the tabix index.\n");
+
+            strcpy(pWriter->indexName, outputName);
+            strcat(pWriter->indexName, TGM_TabixIndexSuffix);
+
+            pWriter->pIndex = TGM_TabixIndexAlloc();
+        }
+    }
+    else if (outputName != NULL)
+    {
+        pWriter->output = fopen(outputName, "w");
+        if (pWriter->output == NULL)
+            TGM_ErrQuit("ERROR: Cannot open the event output file: %s\n", outputName);
+
+        // the events leave in large writes instead of one line at a time
+        pWriter->pStreamBuff = (char*) malloc(TGM_EVENT_WRITE_BUFF_SIZE);
+        if (pWriter->pStreamBuff == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the stream buffer of the event output.\n");
+
+        if (setvbuf(pWriter->output, pWriter->pStreamBuff, _IOFBF, TGM_EVENT_WRITE_BUFF_SIZE) != 0)
+            TGM_ErrQuit("ERROR: Cannot set the stream buffer of the event output.\n");
+    }
+    else
+        pWriter->output = stdout;
+
+    if (format == TGM_EVENT_VCF)
+    {
+        char* pHeader = TGM_VcfHeaderMake(pSampleNames, numSamples, sampleFields, pAnchorInfo);
+        int headerLen = strlen(pHeader);
+
+        if (pWriter->pBgzf != NULL)
+        {
+            // the records start in a new block so that the index never points into the header
+            if (bgzf_write(pWriter->pBgzf, pHeader, headerLen) != headerLen || bgzf_flush(pWriter->pBgzf) != 0)
+                TGM_ErrQuit("ERROR: Cannot write the compressed events.\n");
+        }
+        else if (fwrite(pHeader, sizeof(char), headerLen, pWriter->output) != (size_t) headerLen)
+            TGM_ErrQuit("ERROR: Cannot write the events.\n");
+
+        free(pHeader);
+    }
+
+    pWriter->pHead = NULL;
+    pWriter->pTail = NULL;
+    pWriter->isClosing = FALSE;
+
+    pthread_mutex_init(&(pWriter->mutex), NULL);
+    pthread_cond_init(&(pWriter->cond), NULL);
+
+    if (pthread_create(&(pWriter->writer), NULL, TGM_EventWriterThread, pWriter) != 0)
+        TGM_ErrQuit("ERROR: Cannot create the writer thread of the event output.\n");
+
+    return pWriter;
+}
+
+void TGM_EventWriterClose(TGM_EventWriter* pWriter)
+{
+    if (pWriter != NULL)
+    {
+        pthread_mutex_lock(&(pWriter->mutex));
+        pWriter->isClosing = TRUE;
+        pthread_cond_broadcast(&(pWriter->cond));
+        pthread_mutex_unlock(&(pWriter->mutex));
+
+        // the writer thread empties the queue before it quits
+        pthread_join(pWriter->writer, NULL);
+        pthread_mutex_destroy(&(pWriter->mutex));
+        pthread_cond_destroy(&(pWriter->cond));
+
+        if (pWriter->pBgzf != NULL)
+        {
+            if (bgzf_close(pWriter->pBgzf) != 0)
+                TGM_ErrQuit("ERROR: Cannot close the compressed event output.\n");
+        }
+        else if (pWriter->output != stdout)
+        {
+            if (fclose(pWriter->output) != 0)
+                TGM_ErrQuit("ERROR: Cannot close the event output.\n");
+        }
+        else
+            fflush(stdout);
+
+        // the index is written after the output is complete so that it never points past its end
+        if (pWriter->pIndex != NULL)
+        {
+            TGM_TabixIndexWrite(pWriter->pIndex, pWriter->indexName, pWriter->pAnchorInfo);
+            TGM_TabixIndexFree(pWriter->pIndex);
+        }
+
+        free(pWriter->indexName);
+        free(pWriter->pStreamBuff);
+        free(pWriter);
+    }
+}
+
+
+//======================
+// Interface functions
+//======================
+
+void TGM_EventBuffAdd(TGM_EventBuff* pEventBuff, int32_t refID, int32_t pos, int32_t end, const char* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    int length = TGM_EventBuffFormat(pEventBuff, format, ap);
+    va_end(ap);
+
+    TGM_EventRecord newRecord;
+
+    newRecord.refID = refID;
+    newRecord.pos = pos;
+    newRecord.end = end;
+    newRecord.length = length;
+    newRecord.offset = pEventBuff->textSize;
+
+    TGM_ARRAY_PUSH(pEventBuff, &newRecord, TGM_EventRecord);
+
+    pEventBuff->textSize += length;
+}
+
+void TGM_EventBuffAppend(TGM_EventBuff* pEventBuff, const char* format, ...)
+{
+    va_list ap;
+
+    // the new text goes before the line end of the last event
+    --(pEventBuff->textSize);
+
+    va_start(ap, format);
+    int length = TGM_EventBuffFormat(pEventBuff, format, ap);
+    va_end(ap);
+
+    // the terminating null of the formatted text left room for the line end
+    pEventBuff->textSize += length;
+    pEventBuff->pText[pEventBuff->textSize] = '\n';
+    ++(pEventBuff->textSize);
+
+    pEventBuff->data[pEventBuff->size - 1].length += length;
+}
+
+void TGM_EventWriterSubmit(TGM_EventWriter* pWriter, TGM_EventBuff** ppEventBuffs, unsigned int numBuffs)
+{
+    TGM_EventBatch* pBatch = (TGM_EventBatch*) malloc(sizeof(TGM_EventBatch));
+    if (pBatch == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a batch of events.\n");
+
+    pBatch->ppEventBuffs = (TGM_EventBuff**) malloc((numBuffs + 1) * sizeof(TGM_EventBuff*));
+    if (pBatch->ppEventBuffs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a batch of events.\n");
+
+    memcpy(pBatch->ppEventBuffs, ppEventBuffs, numBuffs * sizeof(TGM_EventBuff*));
+    pBatch->numBuffs = numBuffs;
+    pBatch->pNext = NULL;
+
+    pthread_mutex_lock(&(pWriter->mutex));
+
+    if (pWriter->pTail != NULL)
+        pWriter->pTail->pNext = pBatch;
+    else
+        pWriter->pHead = pBatch;
+
+    pWriter->pTail = pBatch;
+
+    pthread_cond_broadcast(&(pWriter->cond));
+    pthread_mutex_unlock(&(pWriter->mutex));
+}
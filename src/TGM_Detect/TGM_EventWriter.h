@@ -0,0 +1,186 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_EventWriter.h
+ *
+ *    Description:  buffered, ordered output of the SV events
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_EVENTWRITER_H
+#define  TGM_EVENTWRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "TGM_Types.h"
+#include "TGM_LibInfo.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// size of the stream buffer of an uncompressed event output
+#define TGM_EVENT_WRITE_BUFF_SIZE (1 << 20)
+
+// format of the event output
+typedef enum
+{
+    TGM_EVENT_TEXT = 0,                   // one tab-delimited line for each event
+
+    TGM_EVENT_VCF = 1                     // VCF records with symbolic alleles
+
+}TGM_EventFormat;
+
+// per-sample fields of the events
+#define TGM_SAMPLE_SUPPORT  0x1           // SU: read pairs clustered into the event
+
+#define TGM_SAMPLE_GENOTYPE 0x2           // AS and RS: read pairs supporting the event and the reference in the BAM files
+
+// a formatted event in an event buffer
+typedef struct TGM_EventRecord
+{
+    int32_t refID;                        // reference ID of the event
+
+    int32_t pos;                          // start of the event (0-based, the sort key)
+
+    int32_t end;                          // end of the event (0-based, exclusive. used by the index)
+
+    uint32_t length;                      // number of characters of the formatted event
+
+    uint64_t offset;                      // offset of the formatted event in the text buffer
+
+}TGM_EventRecord;
+
+// events formatted by one detection job. the records are merged by position when the buffer is written
+typedef struct TGM_EventBuff
+{
+    TGM_EventRecord* data;                // formatted events
+
+    unsigned int size;                    // number of formatted events
+
+    unsigned int capacity;                // capacity of the record array
+
+    char* pText;                          // text of the formatted events
+
+    uint64_t textSize;                    // number of characters in the text buffer
+
+    uint64_t textCapacity;                // capacity of the text buffer
+
+}TGM_EventBuff;
+
+struct TGM_EventBatch;
+
+// event output. the events of each reference are submitted as one batch of event buffers
+// and are merged and written by the writer thread in the order of submission
+typedef struct TGM_EventWriter
+{
+    FILE* output;                         // output stream of the uncompressed events
+
+    char* pStreamBuff;                    // stream buffer of the uncompressed output
+
+    void* pBgzf;                          // BGZF stream of the compressed events
+
+    char* indexName;                      // name of the tabix index (NULL if no index is built)
+
+    void* pIndex;                         // tabix index built while the events are written
+
+    TGM_EventFormat format;               // format of the events
+
+    const TGM_AnchorInfo* pAnchorInfo;    // names and lengths of the references
+
+    pthread_t writer;                     // writer thread
+
+    pthread_mutex_t mutex;                // mutex protecting the batch queue
+
+    pthread_cond_t cond;                  // signaled when a batch is submitted or the output is closing
+
+    struct TGM_EventBatch* pHead;         // next batch to be written
+
+    struct TGM_EventBatch* pTail;         // last batch submitted
+
+    TGM_Bool isClosing;                   // the writer thread should quit when the queue is empty
+
+}TGM_EventWriter;
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_EventBuff* TGM_EventBuffAlloc(void);
+
+void TGM_EventBuffFree(TGM_EventBuff* pEventBuff);
+
+//================================================================
+// function:
+//      open the event output and start its writer thread
+//
+// args:
+//      1. outputName: name of the output file (NULL for stdout)
+//      2. format: format of the events
+//      3. compress: write a BGZF-compressed output. a VCF output
+//                   also gets a tabix index (outputName.tbi)
+//      4. pSampleNames: names of the samples. a VCF output gets a
+//                       sample column for each of them
+//      5. numSamples: number of samples
+//      6. sampleFields: per-sample fields of the events (0 if the
+//                       events carry no per-sample fields)
+//      7. pAnchorInfo: references of the events. a VCF output gets
+//                      a contig line for each of them and they
+//                      name the sequences of the index
+//
+// return:
+//      a pointer to the event writer
+//================================================================
+TGM_EventWriter* TGM_EventWriterOpen(const char* outputName, TGM_EventFormat format, TGM_Bool compress, const char* const* pSampleNames, unsigned int numSamples,
+                                     uint32_t sampleFields, const TGM_AnchorInfo* pAnchorInfo);
+
+//================================================================
+// function:
+//      write all the submitted events, the index, and close the
+//      event output
+//
+// args:
+//      1. pWriter: a pointer to the event writer
+//================================================================
+void TGM_EventWriterClose(TGM_EventWriter* pWriter);
+
+
+//======================
+// Interface functions
+//======================
+
+// append a formatted event to an event buffer (printf-like)
+void TGM_EventBuffAdd(TGM_EventBuff* pEventBuff, int32_t refID, int32_t pos, int32_t end, const char* format, ...);
+
+// extend the last event of an event buffer before its line end (printf-like)
+void TGM_EventBuffAppend(TGM_EventBuff* pEventBuff, const char* format, ...);
+
+//================================================================
+// function:
+//      hand the event buffers of a reference over to the writer
+//      thread. the batches must be submitted in the order of
+//      the references and the events of one reference are
+//      written ordered by position. ties keep the order of the
+//      buffers and of the events in a buffer
+//
+// args:
+//      1. pWriter: a pointer to the event writer
+//      2. ppEventBuffs: event buffers of the reference (owned
+//                       and freed by the writer, NULLs skipped)
+//      3. numBuffs: number of event buffers
+//================================================================
+void TGM_EventWriterSubmit(TGM_EventWriter* pWriter, TGM_EventBuff** ppEventBuffs, unsigned int numBuffs);
+
+#endif  /*TGM_EVENTWRITER_H*/
@@ -16,41 +16,95 @@
  * =====================================================================================
  */
 
+#include <math.h>
+#include <pthread.h>
+
 #include "TGM_Error.h"
 #include "TGM_Utilities.h"
 #include "TGM_ReadPairAttrbt.h"
 
 #define DEFAULT_RP_ATTRB_CAPACITY 50
 
-static int CompareAttrbt(const void* a, const void* b)
+// number of bytes in the sorting key of an attribute: read group ID, second and first attribute
+#define TGM_ATTRBT_KEY_BYTES 12
+
+// minimum number of attributes for each thread of a parallel sort
+#define TGM_ATTRBT_PAR_SORT_MIN (1 << 16)
+
+// one slice of the attributes in a pass of the radix sort
+typedef struct TGM_AttrbtSortJob
 {
-    const TGM_ReadPairAttrbt* first = a;
-    const TGM_ReadPairAttrbt* second = b;
+    const TGM_ReadPairAttrbt* pSrc;     // attributes to be scattered
 
-    if (first->firstAttribute < second->firstAttribute)
-    {
-        return -1;
-    }
-    else if (first->firstAttribute > second->firstAttribute)
-    {
-        return 1;
-    }
-    else
+    TGM_ReadPairAttrbt* pDst;           // output of the scatter
+
+    uint64_t begin;                     // first attribute of the slice
+
+    uint64_t end;                       // end of the slice
+
+    unsigned int byteIndex;             // digit of this pass (0 is the least significant byte)
+
+    uint64_t count[256];                // digit counts of the slice, then the output offsets
+
+}TGM_AttrbtSortJob;
+
+// the attributes are ordered by the first attribute, then the second one, then the read group ID
+static inline unsigned int TGM_ReadPairAttrbtDigit(const TGM_ReadPairAttrbt* pAttrbt, unsigned int byteIndex)
+{
+    int32_t value = pAttrbt->readGrpID;
+    if (byteIndex >= 8)
+        value = pAttrbt->firstAttribute;
+    else if (byteIndex >= 4)
+        value = pAttrbt->secondAttribute;
+
+    // flip the sign bit so that the negative values come first
+    return ((((uint32_t) value) ^ 0x80000000u) >> ((byteIndex & 3) * 8)) & 0xff;
+}
+
+// convert a boundary in bases to fixed point. attribute differences are whole fixed point
+// units, so rounding the boundary down keeps the same neighbours
+static inline int32_t TGM_ReadPairAttrbtBound(double bound)
+{
+    return (int32_t) floor(bound * TGM_ATTRBT_SCALE);
+}
+
+static void* TGM_AttrbtSortCount(void* pArg)
+{
+    TGM_AttrbtSortJob* pJob = pArg;
+
+    memset(pJob->count, 0, sizeof(pJob->count));
+    for (uint64_t i = pJob->begin; i != pJob->end; ++i)
+        ++(pJob->count[TGM_ReadPairAttrbtDigit(pJob->pSrc + i, pJob->byteIndex)]);
+
+    return NULL;
+}
+
+static void* TGM_AttrbtSortScatter(void* pArg)
+{
+    TGM_AttrbtSortJob* pJob = pArg;
+
+    for (uint64_t i = pJob->begin; i != pJob->end; ++i)
+        pJob->pDst[pJob->count[TGM_ReadPairAttrbtDigit(pJob->pSrc + i, pJob->byteIndex)]++] = pJob->pSrc[i];
+
+    return NULL;
+}
+
+// run one phase of a pass on all the slices. the calling thread takes the first slice
+static void TGM_AttrbtSortRun(void* (*phase)(void*), TGM_AttrbtSortJob* pJobs, unsigned int numThreads)
+{
+    pthread_t threads[numThreads];
+
+    for (unsigned int t = 1; t < numThreads; ++t)
     {
-        if (first->secondAttribute < second->secondAttribute)
-            return -1;
-        else if (first->secondAttribute > second->secondAttribute)
-            return 1;
-        else
-        {
-            if (first->readGrpID <= second->readGrpID)
-                return -1;
-            else
-                return 1;
-        }
+        if (pthread_create(threads + t, NULL, phase, pJobs + t) != 0)
+            TGM_ErrQuit("ERROR: Cannot create a sorting thread.\n");
     }
-}
 
+    phase(pJobs);
+
+    for (unsigned int t = 1; t < numThreads; ++t)
+        pthread_join(threads[t], NULL);
+}
 
 TGM_ReadPairAttrbtArray* TGM_ReadPairAttrbtArrayAlloc(uint32_t numReadGrp)
 {
@@ -62,7 +116,7 @@ TGM_ReadPairAttrbtArray* TGM_ReadPairAttrbtArrayAlloc(uint32_t numReadGrp)
     if (pAttrbtArray->data == NULL)
         TGM_ErrQuit("ERROR: Not enough memory for the storage of the read pair attributes in the read pair attribute array object.\n");
 
-    pAttrbtArray->pBoundaries = (double (*)[2]) malloc(sizeof(double) * 2 * numReadGrp);
+    pAttrbtArray->pBoundaries = (int32_t (*)[2]) malloc(sizeof(int32_t) * 2 * numReadGrp);
     if (pAttrbtArray->pBoundaries == NULL)
         TGM_ErrQuit("ERROR: Not enough memory for the storage of the boundaries in the read pair attribute array object.\n");
 
@@ -70,6 +124,10 @@ TGM_ReadPairAttrbtArray* TGM_ReadPairAttrbtArrayAlloc(uint32_t numReadGrp)
     pAttrbtArray->size = 0;
     pAttrbtArray->capacity = DEFAULT_RP_ATTRB_CAPACITY;
 
+    pAttrbtArray->pSortBuff = NULL;
+    pAttrbtArray->sortBuffCap = 0;
+    pAttrbtArray->numSortThreads = 1;
+
     return pAttrbtArray;
 }
 
@@ -79,6 +137,7 @@ void TGM_ReadPairAttrbtArrayFree(TGM_ReadPairAttrbtArray* pAttrbtArray)
     {
         free(pAttrbtArray->data);
         free(pAttrbtArray->pBoundaries);
+        free(pAttrbtArray->pSortBuff);
         free(pAttrbtArray);
     }
 }
@@ -99,6 +158,87 @@ void TGM_ReadPairAttrbtArrayReInit(TGM_ReadPairAttrbtArray* pAttrbtArray, uint64
     }
 }
 
+void TGM_ReadPairAttrbtArraySort(TGM_ReadPairAttrbtArray* pAttrbtArray, unsigned int numThreads)
+{
+    uint64_t size = pAttrbtArray->size;
+    if (size < 2)
+        return;
+
+    if (size > pAttrbtArray->sortBuffCap)
+    {
+        free(pAttrbtArray->pSortBuff);
+        pAttrbtArray->pSortBuff = (TGM_ReadPairAttrbt*) malloc(size * sizeof(TGM_ReadPairAttrbt));
+        if (pAttrbtArray->pSortBuff == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the sorting buffer of the read pair attribute array object.\n");
+
+        pAttrbtArray->sortBuffCap = size;
+    }
+
+    if (numThreads > size / TGM_ATTRBT_PAR_SORT_MIN)
+        numThreads = size / TGM_ATTRBT_PAR_SORT_MIN;
+
+    if (numThreads == 0)
+        numThreads = 1;
+
+    TGM_AttrbtSortJob jobs[numThreads];
+    for (unsigned int t = 0; t != numThreads; ++t)
+    {
+        jobs[t].begin = size * t / numThreads;
+        jobs[t].end = size * (t + 1) / numThreads;
+    }
+
+    TGM_ReadPairAttrbt* pSrc = pAttrbtArray->data;
+    TGM_ReadPairAttrbt* pDst = pAttrbtArray->pSortBuff;
+
+    for (unsigned int byteIndex = 0; byteIndex != TGM_ATTRBT_KEY_BYTES; ++byteIndex)
+    {
+        for (unsigned int t = 0; t != numThreads; ++t)
+        {
+            jobs[t].pSrc = pSrc;
+            jobs[t].pDst = pDst;
+            jobs[t].byteIndex = byteIndex;
+        }
+
+        TGM_AttrbtSortRun(TGM_AttrbtSortCount, jobs, numThreads);
+
+        // skip the digit if all the attributes share it
+        TGM_Bool isSkipped = FALSE;
+        for (unsigned int d = 0; d != 256 && !isSkipped; ++d)
+        {
+            uint64_t total = 0;
+            for (unsigned int t = 0; t != numThreads; ++t)
+                total += jobs[t].count[d];
+
+            isSkipped = (total == size);
+        }
+
+        if (isSkipped)
+            continue;
+
+        // output offsets are ordered by digit first and slice second to keep the sort stable
+        uint64_t offset = 0;
+        for (unsigned int d = 0; d != 256; ++d)
+        {
+            for (unsigned int t = 0; t != numThreads; ++t)
+            {
+                uint64_t count = jobs[t].count[d];
+                jobs[t].count[d] = offset;
+                offset += count;
+            }
+        }
+
+        TGM_AttrbtSortRun(TGM_AttrbtSortScatter, jobs, numThreads);
+        TGM_SWAP(pSrc, pDst, TGM_ReadPairAttrbt*);
+    }
+
+    // the sorted attributes may end up in the sorting buffer
+    if (pSrc != pAttrbtArray->data)
+    {
+        TGM_SWAP(pAttrbtArray->data, pAttrbtArray->pSortBuff, TGM_ReadPairAttrbt*);
+        TGM_SWAP(pAttrbtArray->capacity, pAttrbtArray->sortBuffCap, uint64_t);
+    }
+}
+
 void TGM_ReadPairMakeLocal(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LocalPairArray* pLocalPairArray, const TGM_LibInfoTable* pLibTable, SV_ReadPairType readPairType)
 {
     TGM_ReadPairAttrbtArrayReInit(pAttrbtArray, pLocalPairArray->size);
@@ -111,58 +251,66 @@ void TGM_ReadPairMakeLocal(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_Loca
         pAttrbtArray->data[i].origIndex = i;
         pAttrbtArray->data[i].readGrpID = pLocalPairArray->data[i].readGrpID;
 
-        double median = pLibTable->pLibInfo[pAttrbtArray->data[i].readGrpID].fragLenMedian;
+        int32_t median = pLibTable->pLibInfo[pAttrbtArray->data[i].readGrpID].fragLenMedian;
 
-        pAttrbtArray->data[i].firstAttribute =  pLocalPairArray->data[i].upPos + (double) pLocalPairArray->data[i].fragLen / 2;
-        pAttrbtArray->data[i].secondAttribute = pLocalPairArray->data[i].fragLen - median;
+        // the center of the fragment is half way between two bases for odd fragment lengths
+        pAttrbtArray->data[i].firstAttribute =  pLocalPairArray->data[i].upPos * TGM_ATTRBT_SCALE + pLocalPairArray->data[i].fragLen * TGM_ATTRBT_SCALE / 2;
+        pAttrbtArray->data[i].secondAttribute = (pLocalPairArray->data[i].fragLen - median) * TGM_ATTRBT_SCALE;
     }
 
-    qsort(pAttrbtArray->data, pAttrbtArray->size, sizeof(pAttrbtArray->data[0]), CompareAttrbt);
+    TGM_ReadPairAttrbtArraySort(pAttrbtArray, pAttrbtArray->numSortThreads);
 
     // neighbourhood scale factor (borrowed from Spanner)
     double boundScale[2] = {1.25, 0.5};
     for (unsigned int i = 0; i != pAttrbtArray->numReadGrp; ++i)
     {
-        pAttrbtArray->pBoundaries[i][0] = (double) pLibTable->pLibInfo[i].fragLenMedian * boundScale[0];
-        pAttrbtArray->pBoundaries[i][1] = (double) (pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale[1];
+        pAttrbtArray->pBoundaries[i][0] = TGM_ReadPairAttrbtBound(pLibTable->pLibInfo[i].fragLenMedian * boundScale[0]);
+        pAttrbtArray->pBoundaries[i][1] = TGM_ReadPairAttrbtBound((pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale[1]);
     }
-
-    qsort(pAttrbtArray->data, pAttrbtArray->size, sizeof(pAttrbtArray->data[0]), CompareAttrbt);
 }
 
-void TGM_ReadPairMakeCross(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LibInfoTable* pLibTable, const TGM_CrossPairArray* pCrossPairArray)
+void TGM_ReadPairMakeCross(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LibInfoTable* pLibTable, const TGM_CrossPairArray* pCrossPairArray, int32_t downRefID)
 {
     TGM_ReadPairAttrbtArrayReInit(pAttrbtArray, pCrossPairArray->size);
     pAttrbtArray->readPairType = PT_CROSS;
-    pAttrbtArray->size = pCrossPairArray->size;
     pAttrbtArray->numReadGrp = pLibTable->size;
 
+    // the cross pairs are already bucketed by the reference of the up mate. positions on
+    // different references are never neighbours, so we take one down mate reference at a time
     for (unsigned int i = 0; i != pCrossPairArray->size; ++i)
     {
-        pAttrbtArray->data[i].origIndex = i;
-        pAttrbtArray->data[i].readGrpID = pCrossPairArray->data[i].readGrpID;
+        if (pCrossPairArray->data[i].downRefID != downRefID)
+            continue;
+
+        TGM_ReadPairAttrbt* pAttrbt = pAttrbtArray->data + pAttrbtArray->size;
+        ++(pAttrbtArray->size);
 
-        pAttrbtArray->data[i].firstAttribute = pCrossPairArray->data[i].upRefID * 1e10 + pCrossPairArray->data[i].upPos;
-        pAttrbtArray->data[i].secondAttribute = pCrossPairArray->data[i].downRefID * 1e10 + pCrossPairArray->data[i].downPos;
+        pAttrbt->origIndex = i;
+        pAttrbt->readGrpID = pCrossPairArray->data[i].readGrpID;
+
+        pAttrbt->firstAttribute = pCrossPairArray->data[i].upPos * TGM_ATTRBT_SCALE;
+        pAttrbt->secondAttribute = pCrossPairArray->data[i].downPos * TGM_ATTRBT_SCALE;
     }
 
-    qsort(pAttrbtArray->data, pAttrbtArray->size, sizeof(pAttrbtArray->data[0]), CompareAttrbt);
+    TGM_ReadPairAttrbtArraySort(pAttrbtArray, pAttrbtArray->numSortThreads);
 
     double boundScale = 1.25;
     for (unsigned int i = 0; i != pAttrbtArray->numReadGrp; ++i)
     {
-        pAttrbtArray->pBoundaries[i][0] = (double) (pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale;
-        pAttrbtArray->pBoundaries[i][1] = (double) (pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale;
+        pAttrbtArray->pBoundaries[i][0] = TGM_ReadPairAttrbtBound((pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale);
+        pAttrbtArray->pBoundaries[i][1] = pAttrbtArray->pBoundaries[i][0];
     }
 }
 
 void TGM_ReadPairMakeInverted(TGM_ReadPairAttrbtArray* pAttrbtArrays[2], const TGM_LibInfoTable* pLibTable, const TGM_LocalPairArray* pInvertedPairArray)
 {
-    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[0], pInvertedPairArray->size / 2);
-    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[1], pInvertedPairArray->size / 2);
+    // count the inverted3 and inverted5 pairs first so that each array is allocated only once
+    uint64_t numPairs[2] = {0, 0};
+    for (unsigned int i = 0; i != pInvertedPairArray->size; ++i)
+        ++numPairs[pInvertedPairArray->data[i].readPairType - PT_INVERTED3];
 
-    pAttrbtArrays[0]->size = 0;
-    pAttrbtArrays[1]->size = 0;
+    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[0], numPairs[0]);
+    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[1], numPairs[1]);
 
     pAttrbtArrays[0]->readPairType = PT_INVERTED3;
     pAttrbtArrays[1]->readPairType = PT_INVERTED5;
@@ -175,35 +323,30 @@ void TGM_ReadPairMakeInverted(TGM_ReadPairAttrbtArray* pAttrbtArrays[2], const T
         const TGM_LocalPair* pInvertedPair = pInvertedPairArray->data + i;
         int arrayIndex = pInvertedPair->readPairType - PT_INVERTED3;
 
-        if (pAttrbtArrays[arrayIndex]->size == pAttrbtArrays[arrayIndex]->capacity)
-            TGM_ARRAY_RESIZE(pAttrbtArrays[arrayIndex], pAttrbtArrays[arrayIndex]->capacity * 2, TGM_ReadPairAttrbt);
-
         TGM_ReadPairAttrbt* pAttrbt = pAttrbtArrays[arrayIndex]->data + pAttrbtArrays[arrayIndex]->size;
         ++(pAttrbtArrays[arrayIndex]->size);
 
         pAttrbt->origIndex = i;
         pAttrbt->readGrpID = pInvertedPair->readGrpID;
 
-        double median = pLibTable->pLibInfo[pInvertedPair->readGrpID].fragLenMedian;
-
-        pAttrbt->firstAttribute =  pInvertedPair->upPos + (double) pInvertedPair->fragLen / 2;
-        pAttrbt->secondAttribute = pInvertedPair->fragLen - median;
+        int32_t median = pLibTable->pLibInfo[pInvertedPair->readGrpID].fragLenMedian;
 
-        ++(pAttrbtArrays[arrayIndex]->size);
+        pAttrbt->firstAttribute =  pInvertedPair->upPos * TGM_ATTRBT_SCALE + pInvertedPair->fragLen * TGM_ATTRBT_SCALE / 2;
+        pAttrbt->secondAttribute = (pInvertedPair->fragLen - median) * TGM_ATTRBT_SCALE;
     }
 
-    qsort(pAttrbtArrays[0]->data, pAttrbtArrays[0]->size, sizeof(pAttrbtArrays[0]->data[0]), CompareAttrbt);
-    qsort(pAttrbtArrays[1]->data, pAttrbtArrays[1]->size, sizeof(pAttrbtArrays[1]->data[0]), CompareAttrbt);
+    TGM_ReadPairAttrbtArraySort(pAttrbtArrays[0], pAttrbtArrays[0]->numSortThreads);
+    TGM_ReadPairAttrbtArraySort(pAttrbtArrays[1], pAttrbtArrays[1]->numSortThreads);
 
     // neighbourhood scale factor (borrowed from Spanner)
     double boundScale[2] = {1.25, 0.5};
     for (unsigned int i = 0; i != pAttrbtArrays[0]->numReadGrp; ++i)
     {
-        pAttrbtArrays[0]->pBoundaries[i][0] = (double) pLibTable->pLibInfo[i].fragLenMedian * boundScale[0] * 2.0;
-        pAttrbtArrays[0]->pBoundaries[i][1] = (double) (pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale[1];
+        pAttrbtArrays[0]->pBoundaries[i][0] = TGM_ReadPairAttrbtBound(pLibTable->pLibInfo[i].fragLenMedian * boundScale[0] * 2.0);
+        pAttrbtArrays[0]->pBoundaries[i][1] = TGM_ReadPairAttrbtBound((pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale[1]);
     }
 
-    memcpy(pAttrbtArrays[1]->pBoundaries, pAttrbtArrays[0]->pBoundaries, sizeof(double) * 2 * pAttrbtArrays[0]->numReadGrp);
+    memcpy(pAttrbtArrays[1]->pBoundaries, pAttrbtArrays[0]->pBoundaries, sizeof(int32_t) * 2 * pAttrbtArrays[0]->numReadGrp);
 }
 
 void TGM_ReadPairMakeSpecial(TGM_ReadPairAttrbtArray* pAttrbtArrays[], int numArray, const TGM_SpecialPairArray* pSpecialPairArray, const TGM_LibInfoTable* pLibTable)
@@ -233,9 +376,9 @@ void TGM_ReadPairMakeSpecial(TGM_ReadPairAttrbtArray* pAttrbtArrays[], int numAr
         pAttrbt->origIndex = i;
         pAttrbt->readGrpID = pSpecialPair->readGrpID;
 
-        double halfMedian = pLibTable->pLibInfo[pSpecialPair->readGrpID].fragLenMedian / 2.0;
-        double halfMedians[2] = {halfMedian, -halfMedian};
-        uint32_t pos[2] = {pSpecialPair->pos[0], pSpecialPair->end[0]};
+        int32_t halfMedian = pLibTable->pLibInfo[pSpecialPair->readGrpID].fragLenMedian * TGM_ATTRBT_SCALE / 2;
+        int32_t halfMedians[2] = {halfMedian, -halfMedian};
+        int32_t pos[2] = {pSpecialPair->pos[0] * TGM_ATTRBT_SCALE, pSpecialPair->end[0] * TGM_ATTRBT_SCALE};
 
         int posIndex = pSpecialPair->readPairType - PT_SPECIAL3;
 
@@ -246,19 +389,66 @@ void TGM_ReadPairMakeSpecial(TGM_ReadPairAttrbtArray* pAttrbtArrays[], int numAr
     // sort the attribute arrays according to the first attribute
     for (unsigned int i = 0; i != numArray; i += 2)
     {
-        qsort(pAttrbtArrays[i]->data, pAttrbtArrays[i]->size, sizeof(pAttrbtArrays[i]->data[0]), CompareAttrbt);
-        qsort(pAttrbtArrays[i + 1]->data, pAttrbtArrays[i + 1]->size, sizeof(pAttrbtArrays[i + 1]->data[0]), CompareAttrbt);
+        TGM_ReadPairAttrbtArraySort(pAttrbtArrays[i], pAttrbtArrays[i]->numSortThreads);
+        TGM_ReadPairAttrbtArraySort(pAttrbtArrays[i + 1], pAttrbtArrays[i + 1]->numSortThreads);
     }
 
     // set the boundary
     double boundScale = 1.25;
     for (unsigned int i = 0; i != pAttrbtArrays[0]->numReadGrp; ++i)
     {
-        pAttrbtArrays[0]->pBoundaries[i][0] = (double) (pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale;
-        pAttrbtArrays[0]->pBoundaries[i][1] = 1e-3;
+        pAttrbtArrays[0]->pBoundaries[i][0] = TGM_ReadPairAttrbtBound((pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale);
+        pAttrbtArrays[0]->pBoundaries[i][1] = 0;
     }
 
     for (unsigned int i = 1; i != numArray; ++i)
-        memcpy(pAttrbtArrays[i]->pBoundaries, pAttrbtArrays[0]->pBoundaries, sizeof(double) * 2 * pAttrbtArrays[0]->numReadGrp);
+        memcpy(pAttrbtArrays[i]->pBoundaries, pAttrbtArrays[0]->pBoundaries, sizeof(int32_t) * 2 * pAttrbtArrays[0]->numReadGrp);
 }
 
+void TGM_ReadPairMakeSpecialRange(TGM_ReadPairAttrbtArray* pAttrbtArrays[2], const TGM_SpecialPairArray* pSpecialPairArray, const uint32_t* pOrder,
+                                  unsigned int begin, unsigned int end, const TGM_LibInfoTable* pLibTable)
+{
+    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[0], DEFAULT_RP_ATTRB_CAPACITY);
+    TGM_ReadPairAttrbtArrayReInit(pAttrbtArrays[1], DEFAULT_RP_ATTRB_CAPACITY);
+
+    pAttrbtArrays[0]->readPairType = PT_SPECIAL3;
+    pAttrbtArrays[1]->readPairType = PT_SPECIAL5;
+
+    // the original index still points into the whole special pair array
+    for (unsigned int k = begin; k != end; ++k)
+    {
+        unsigned int i = pOrder[k];
+        const TGM_SpecialPair* pSpecialPair = pSpecialPairArray->data + i;
+        int posIndex = pSpecialPair->readPairType - PT_SPECIAL3;
+        TGM_ReadPairAttrbtArray* pAttrbtArray = pAttrbtArrays[posIndex];
+
+        if (pAttrbtArray->size == pAttrbtArray->capacity)
+            TGM_ARRAY_RESIZE(pAttrbtArray, pAttrbtArray->capacity * 2, TGM_ReadPairAttrbt);
+
+        TGM_ReadPairAttrbt* pAttrbt = pAttrbtArray->data + pAttrbtArray->size;
+        ++(pAttrbtArray->size);
+
+        pAttrbt->origIndex = i;
+        pAttrbt->readGrpID = pSpecialPair->readGrpID;
+
+        int32_t halfMedian = pLibTable->pLibInfo[pSpecialPair->readGrpID].fragLenMedian * TGM_ATTRBT_SCALE / 2;
+        int32_t halfMedians[2] = {halfMedian, -halfMedian};
+        int32_t pos[2] = {pSpecialPair->pos[0] * TGM_ATTRBT_SCALE, pSpecialPair->end[0] * TGM_ATTRBT_SCALE};
+
+        pAttrbt->firstAttribute = pos[posIndex] + halfMedians[posIndex];
+        pAttrbt->secondAttribute = 0;
+    }
+
+    TGM_ReadPairAttrbtArraySort(pAttrbtArrays[0], pAttrbtArrays[0]->numSortThreads);
+    TGM_ReadPairAttrbtArraySort(pAttrbtArrays[1], pAttrbtArrays[1]->numSortThreads);
+
+    // set the boundary
+    double boundScale = 1.25;
+    for (unsigned int i = 0; i != pAttrbtArrays[0]->numReadGrp; ++i)
+    {
+        pAttrbtArrays[0]->pBoundaries[i][0] = TGM_ReadPairAttrbtBound((pLibTable->pLibInfo[i].fragLenHigh - pLibTable->pLibInfo[i].fragLenLow) * boundScale);
+        pAttrbtArrays[0]->pBoundaries[i][1] = 0;
+    }
+
+    memcpy(pAttrbtArrays[1]->pBoundaries, pAttrbtArrays[0]->pBoundaries, sizeof(int32_t) * 2 * pAttrbtArrays[0]->numReadGrp);
+}
@@ -24,15 +24,22 @@
 #include "TGM_LibInfo.h"
 #include "TGM_ReadPairBuild.h"
 
+// the attributes are stored in fixed point with this many units per base.
+// all the positions and fragment lengths are integers, so half a base is the finest step we need
+#define TGM_ATTRBT_SCALE 2
+
+// convert a fixed point attribute (or boundary) back to bases
+#define TGM_ATTRBT_TO_BASE(value) ((double) (value) / TGM_ATTRBT_SCALE)
+
 typedef struct TGM_ReadPairAttrbt
 {
-    double firstAttribute;
+    int32_t firstAttribute;             // first attribute in fixed point
 
-    double secondAttribute;
+    int32_t secondAttribute;            // second attribute in fixed point
 
-    uint64_t origIndex;
+    uint32_t origIndex;                 // index of the read pair in its original array
 
-    int32_t readGrpID;
+    int32_t readGrpID;                  // read group ID (index of the boundaries)
 
 }TGM_ReadPairAttrbt;
 
@@ -40,7 +47,7 @@ typedef struct TGM_ReadPairAttrbtArray
 {
     TGM_ReadPairAttrbt* data;
 
-    double (*pBoundaries)[2];
+    int32_t (*pBoundaries)[2];
 
     uint64_t size;
 
@@ -50,6 +57,12 @@ typedef struct TGM_ReadPairAttrbtArray
 
     SV_ReadPairType readPairType;
 
+    TGM_ReadPairAttrbt* pSortBuff;
+
+    uint64_t sortBuffCap;
+
+    unsigned int numSortThreads;
+
 }TGM_ReadPairAttrbtArray;
 
 TGM_ReadPairAttrbtArray* TGM_ReadPairAttrbtArrayAlloc(uint32_t numReadGrp);
@@ -62,13 +75,18 @@ void TGM_ReadPairAttrbtArrayFree(TGM_ReadPairAttrbtArray* pAttrbtArray);
 
 void TGM_ReadPairAttrbtArrayReInit(TGM_ReadPairAttrbtArray* pAttrbtArray, uint64_t newCapacity);
 
+void TGM_ReadPairAttrbtArraySort(TGM_ReadPairAttrbtArray* pAttrbtArray, unsigned int numThreads);
+
 void TGM_ReadPairMakeLocal(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LocalPairArray* pLocalPairArray, const TGM_LibInfoTable* pLibTable, SV_ReadPairType readpairType);
 
-void TGM_ReadPairMakeCross(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LibInfoTable* pLibTable, const TGM_CrossPairArray* pCrossPairArray);
+void TGM_ReadPairMakeCross(TGM_ReadPairAttrbtArray* pAttrbtArray, const TGM_LibInfoTable* pLibTable, const TGM_CrossPairArray* pCrossPairArray, int32_t downRefID);
 
 void TGM_ReadPairMakeInverted(TGM_ReadPairAttrbtArray* pAttrbtArrays[2], const TGM_LibInfoTable* pLibTable, const TGM_LocalPairArray* pInvertedPairArray);
 
 void TGM_ReadPairMakeSpecial(TGM_ReadPairAttrbtArray* pAttrbtArrays[], int numArray, const TGM_SpecialPairArray* pSpecialArray, const TGM_LibInfoTable* pLibTable);
 
+void TGM_ReadPairMakeSpecialRange(TGM_ReadPairAttrbtArray* pAttrbtArrays[2], const TGM_SpecialPairArray* pSpecialPairArray, const uint32_t* pOrder,
+                                  unsigned int begin, unsigned int end, const TGM_LibInfoTable* pLibTable);
+
 
 #endif  /*TGM_READPAIRDATA_H*/
@@ -19,6 +19,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "khash.h"
 #include "TGM_Error.h"
@@ -26,64 +27,52 @@
 #include "TGM_BamPairAux.h"
 #include "TGM_BamInStream.h"
 #include "TGM_ReadPairBuild.h"
+#include "TGM_ReadPairCheckpoint.h"
 
 #define DEFAULT_RP_INFO_CAPACITY 50
 
-#define TGM_NUM_RP_FILE 6
-
 #define DEFAULT_RP_TABLE_CAPACITY 10
 
 #define MAX_MQ_FOR_MULTIPLE 10
 
 #define MIN_MQ_FOR_UNIQUE 20
 
+#define DEFAULT_SPLIT_BAM_CAPACITY 20
+
 static const char* TGM_LibTableFileName = "lib_table.dat";
 
 static const char* TGM_HistFileName = "hist.dat";
 
-static const char* TGM_READ_PAIR_FILE_NAME_TEMPLATE[] = 
-{
-    "refXXX_long_pairs.dat",
-
-    "refXXX_short_pairs.dat",
-
-    "refXXX_reversed_pairs.dat",
-
-    "refXXX_inverted_pairs.dat",
-
-    "refXXX_special_pairs.dat",
-
-    "refXXX_cross_pairs.dat",
-};
+KHASH_MAP_INIT_STR(name, uint32_t);
 
-enum
+// shared state of the split bam workers
+typedef struct TGM_SplitBuildJob
 {
-    TGM_LONG_PAIR_FILE = 0,
+    const TGM_ReadPairBuildPars* pBuildPars;   // parameters of the read pair build
 
-    TGM_SHORT_PAIR_FILE = 1,
+    const TGM_LibInfoTable* pLibTable;         // library information table (read only in the workers)
 
-    TGM_REVERSED_PAIR_FILE = 2,
+    char** pBamNames;                          // split bam files to be processed
 
-    TGM_INVERTED_PAIR_FILE = 3,
+    uint32_t numBams;                          // number of split bam files
 
-    TGM_SPEICAL_PAIR_FILE = 4,
+    uint32_t nextBam;                          // index of the next bam file to be processed
 
-    TGM_CROSS_PAIR_FILE = 5
-};
+    uint32_t nextHandOver;                     // index of the next bam file to be handed over to the writer thread
 
-typedef struct TGM_ReadPairOutStream
-{
-    FILE* output;
+    uint32_t numChr;                           // number of normal references
 
-    int64_t numPairs;
+    pthread_mutex_t mutex;                     // mutex protecting the bam indices
 
-    int64_t splitInfoPos;
+    pthread_cond_t cond;                       // signaled when a bam file is handed over
 
-}TGM_ReadPairOutStream;
+    TGM_ReadPairOutFile* pOutFile;             // read pair container
 
-KHASH_MAP_INIT_STR(name, uint32_t);
+    TGM_ReadPairCheckpoint* pCheckpoint;       // checkpoint of the build
+
+    const char* pSpecialID;                    // special reference names from the primary bam files
 
-KHASH_MAP_INIT_INT(file, TGM_ReadPairOutStream);
+}TGM_SplitBuildJob;
 
 // check the read pair type
 static SV_ReadPairType TGM_CheckReadPairType(const TGM_ZAtag* pZAtag, const TGM_PairStats* pPairStats, const bam1_t* pDownAlgn, 
@@ -498,6 +487,35 @@ static char* TGM_SpecialPairTableGetID(const TGM_SpecialPairTable* pSpecialPairT
     return pSpecialID;
 }
 
+// restore the special reference names saved by TGM_SpecialPairTableGetID
+static void TGM_SpecialPairTableSetID(TGM_SpecialPairTable* pSpecialPairTable, const char* pSpecialID)
+{
+    unsigned int numSpecial = strlen(pSpecialID) / 2;
+
+    if (numSpecial > pSpecialPairTable->capacity)
+    {
+        pSpecialPairTable->capacity = numSpecial * 2;
+        pSpecialPairTable->names = (char (*)[3]) realloc(pSpecialPairTable->names, sizeof(char) * 3 * pSpecialPairTable->capacity);
+        if (pSpecialPairTable->names == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special reference names.\n");
+    }
+
+    kh_clear(name, pSpecialPairTable->nameHash);
+
+    for (unsigned int i = 0; i != numSpecial; ++i)
+    {
+        pSpecialPairTable->names[i][0] = pSpecialID[i * 2];
+        pSpecialPairTable->names[i][1] = pSpecialID[i * 2 + 1];
+        pSpecialPairTable->names[i][2] = '\0';
+
+        int ret = 0;
+        khiter_t khIter = kh_put(name, pSpecialPairTable->nameHash, pSpecialPairTable->names[i], &ret);
+        kh_value((khash_t(name)*) pSpecialPairTable->nameHash, khIter) = i;
+    }
+
+    pSpecialPairTable->size = numSpecial;
+}
+
 static void TGM_SplitPairArrayUpdate(TGM_SplitPairArray* pSplitPairArray, const bam1_t* pFirstPartial, const bam1_t* pSecondPartial, int32_t readGrpID, const TGM_ZAtag* pZAtag)
 {
     if (pSplitPairArray->size == pSplitPairArray->capacity)
@@ -531,6 +549,155 @@ static void TGM_SplitPairArrayUpdate(TGM_SplitPairArray* pSplitPairArray, const
     ++(pSplitPairArray->size);
 }
 
+static int CompareSpecialAnchor(const void* a, const void* b)
+{
+    const TGM_SpecialPair* first = a;
+    const TGM_SpecialPair* second = b;
+
+    if (first->refID[0] < second->refID[0])
+        return -1;
+    else if (first->refID[0] > second->refID[0])
+        return 1;
+
+    return 0;
+}
+
+// write a read pair array grouped by reference into the read pair container
+static void TGM_ReadPairArrayWrite(TGM_ReadPairOutFile* pOutFile, TGM_ReadPairChunkType chunkType, const void* pData,
+                                  size_t recordSize, const uint64_t* pChrCount, unsigned int numChr)
+{
+    const char* pCurr = (const char*) pData;
+
+    for (unsigned int i = 0; i != numChr; ++i)
+    {
+        if (pChrCount[i] > 0)
+        {
+            TGM_ReadPairOutFileWrite(pOutFile, i, chunkType, pCurr, recordSize, pChrCount[i]);
+            pCurr += recordSize * pChrCount[i];
+        }
+    }
+}
+
+// write job of the writer thread: write the read pair table and clear it for the next bam file
+static void TGM_ReadPairTableAsyncWrite(void* pTable, TGM_ReadPairOutFile* pOutFile)
+{
+    TGM_ReadPairTableWrite(pTable, pOutFile);
+    TGM_ReadPairTableClear(pTable);
+}
+
+// write job of the writer thread: write the split pair table and clear it for the next bam file
+static void TGM_SplitPairTableAsyncWrite(void* pTable, TGM_ReadPairOutFile* pOutFile)
+{
+    TGM_SplitPairTableWrite(pTable, pOutFile);
+    TGM_SplitPairTableClear(pTable);
+}
+
+// hand the split pairs of a bam file over to the writer thread in the order of the bam list
+static void TGM_SplitBuildHandOver(TGM_SplitBuildJob* pJob, uint32_t bamIndex, TGM_SplitPairTable* pSplitPairTable, TGM_SplitPairTable* pSplitWriteTable)
+{
+    pthread_mutex_lock(&(pJob->mutex));
+    while (pJob->nextHandOver != bamIndex)
+        pthread_cond_wait(&(pJob->cond), &(pJob->mutex));
+
+    pthread_mutex_unlock(&(pJob->mutex));
+
+    // the previous bam file (maybe from another worker) is written after the sync so that we can commit it.
+    // this also guarantees that our write table is cleared
+    TGM_ReadPairOutFileSync(pJob->pOutFile);
+    TGM_ReadPairCheckpointCommit(pJob->pCheckpoint, pJob->pOutFile);
+    TGM_SplitPairTableSwap(pSplitPairTable, pSplitWriteTable);
+    TGM_ReadPairOutFileSubmit(pJob->pOutFile, TGM_SplitPairTableAsyncWrite, pSplitWriteTable);
+    TGM_ReadPairCheckpointStage(pJob->pCheckpoint, pJob->pBamNames[bamIndex], TGM_SPLIT_BAM, pJob->pLibTable, pJob->pSpecialID, NULL);
+
+    pthread_mutex_lock(&(pJob->mutex));
+    ++(pJob->nextHandOver);
+    pthread_cond_broadcast(&(pJob->cond));
+    pthread_mutex_unlock(&(pJob->mutex));
+}
+
+// a split bam worker: take the next split bam file and load its split pairs into the private split pair table
+static void* TGM_SplitBuildWorker(void* pArg)
+{
+    TGM_SplitBuildJob* pJob = pArg;
+    const TGM_ReadPairBuildPars* pBuildPars = pJob->pBuildPars;
+
+    TGM_BamInStreamLite* pBamInStreamLite = TGM_BamInStreamLiteAlloc();
+    TGM_SplitPairTable* pSplitPairTable = TGM_SplitPairTableAlloc(pJob->numChr, pBuildPars->detectSet);
+    TGM_SplitPairTable* pSplitWriteTable = TGM_SplitPairTableAlloc(pJob->numChr, pBuildPars->detectSet);
+
+    while (TRUE)
+    {
+        pthread_mutex_lock(&(pJob->mutex));
+        uint32_t bamIndex = pJob->nextBam;
+        if (bamIndex < pJob->numBams)
+            ++(pJob->nextBam);
+
+        pthread_mutex_unlock(&(pJob->mutex));
+
+        if (bamIndex == pJob->numBams)
+            break;
+
+        // open the bam file and skip its header (already loaded by the main thread)
+        TGM_BamInStreamLiteOpen(pBamInStreamLite, pJob->pBamNames[bamIndex]);
+        TGM_BamHeader* pBamHeader = TGM_BamInStreamLiteLoadHeader(pBamInStreamLite);
+
+        // we have to change the fitler function here for split pairs
+        TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_SplitFilter);
+        
+        // split filter does not need any parameters
+        TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, NULL);
+
+        // set the sorting order
+        TGM_BamInStreamLiteSetSortMode(pBamInStreamLite, TGM_SORTED_SPLIT);
+
+        int retNum = 0;
+        const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
+        TGM_Status bamStatus = TGM_OK;
+
+        do
+        {
+            int64_t index = -1;
+            bamStatus = TGM_BamInStreamLiteRead(pAlgns, &retNum, &index, pBamInStreamLite);
+
+            if (retNum == 2)
+            {
+                // without the ZA tag the read pair type stays unknown
+                TGM_ZAtag zaTag;
+                memset(&zaTag, 0, sizeof(TGM_ZAtag));
+
+                const bam1_t* pFirstPartial = pAlgns[0];
+                const bam1_t* pSecondPartial = pAlgns[1];
+
+                // FIXME: ZA tag is not available in current split bam
+                // change this block back when the ZA tag is available
+                /*  
+                TGM_Status ZAstatus = TGM_LoadZAtag(&zaTag, pFirstPartial);
+
+                if (ZAstatus == TGM_OK)
+                    TGM_SplitPairTableUpdate(pSplitPairTable, pJob->pLibTable, pFirstPartial, pSecondPartial, &zaTag, pBuildPars->minMQ);
+                */
+                TGM_SplitPairTableUpdate(pSplitPairTable, pJob->pLibTable, pFirstPartial, pSecondPartial, &zaTag, pBuildPars->minMQ);
+            }
+
+        }while(bamStatus == TGM_OK);
+
+        // close the current split bam file and free the bam header
+        TGM_BamInStreamLiteClose(pBamInStreamLite);
+        TGM_BamHeaderFree(pBamHeader);
+
+        TGM_SplitBuildHandOver(pJob, bamIndex, pSplitPairTable, pSplitWriteTable);
+    }
+
+    // the write table may still be in the writer thread
+    TGM_ReadPairOutFileSync(pJob->pOutFile);
+
+    TGM_SplitPairTableFree(pSplitPairTable);
+    TGM_SplitPairTableFree(pSplitWriteTable);
+    TGM_BamInStreamLiteFree(pBamInStreamLite);
+
+    return NULL;
+}
+
 //===============================
 // Constructors and Destructors
 //===============================
@@ -766,6 +933,22 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
     TGM_LibInfoTableSetCutoff(pLibTable, pBuildPars->cutoff);
     TGM_LibInfoTableSetTrimRate(pLibTable, pBuildPars->trimRate);
 
+    // the checkpoint manifest records every bam file whose read pairs are safely in the read pair container
+    TGM_ReadPairCheckpoint* pCheckpoint = TGM_ReadPairCheckpointAlloc(pBuildPars->workingDir, pBuildPars->resume);
+
+    TGM_Bool isResumed = FALSE;
+    if (pBuildPars->resume && TGM_ReadPairCheckpointLoad(pCheckpoint) == TGM_OK)
+    {
+        TGM_LibInfoTableFree(pLibTable);
+        pLibTable = pCheckpoint->pLibTable;
+        pCheckpoint->pLibTable = NULL;
+
+        TGM_LibInfoTableSetCutoff(pLibTable, pBuildPars->cutoff);
+        TGM_LibInfoTableSetTrimRate(pLibTable, pBuildPars->trimRate);
+
+        isResumed = TRUE;
+    }
+
     // get the library table output file name
     char* libTableOutputFile = TGM_CreateFileName(pBuildPars->workingDir, TGM_LibTableFileName);
 
@@ -783,8 +966,14 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
     // write the fragment length info into the library information file
     TGM_Bool writeLibInfo = FALSE;
 
-    // read pair file hash
-    khash_t(file)* pFileHash = NULL;
+    // read pair container
+    TGM_ReadPairOutFile* pOutFile = NULL;
+
+    if (isResumed && pCheckpoint->containerOffset > 0)
+    {
+        pOutFile = TGM_ReadPairOutFileResume(pBuildPars->workingDir, pBuildPars->compressLevel, pCheckpoint->containerOffset, 
+                                             pCheckpoint->pChunkArray->data, pCheckpoint->pChunkArray->size);
+    }
 
 
     char* pSpecialID = NULL;
@@ -801,16 +990,44 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
         TGM_Bool hasReadPairTable = FALSE;
         TGM_ReadPairTable* pReadPairTable = NULL;
 
+        // the table being written out by the writer thread while we classify the next bam file
+        TGM_ReadPairTable* pWriteTable = NULL;
+
         // open the fragment length histogram output file
         char* histOutputFile = TGM_CreateFileName(pBuildPars->workingDir, TGM_HistFileName);
-        FILE* histOutput = fopen(histOutputFile, "w");
+        FILE* histOutput = fopen(histOutputFile, (isResumed ? "r+b" : "wb"));
         if (histOutput == NULL)
             TGM_ErrQuit("ERROR: Cannot open fragment length histogram file: %s\n", histOutputFile);
 
         free(histOutputFile);
 
+        if (isResumed)
+        {
+            // drop the histograms of the bam file that was interrupted
+            if (ftruncate(fileno(histOutput), pCheckpoint->histOffset) != 0 || fseeko(histOutput, pCheckpoint->histOffset, SEEK_SET) != 0)
+                TGM_ErrQuit("ERROR: Cannot truncate the fragment length histogram file.\n");
+
+            if (TGM_ReadPairCheckpointCount(pCheckpoint, TGM_PRIMARY_BAM) > 0)
+            {
+                pReadPairTable = TGM_ReadPairTableAlloc(pLibTable->pAnchorInfo->size, pBuildPars->detectSet); 
+                pWriteTable = TGM_ReadPairTableAlloc(pLibTable->pAnchorInfo->size, pBuildPars->detectSet); 
+
+                if (pReadPairTable->pSpecialPairTable != NULL && pCheckpoint->pSpecialID != NULL)
+                    TGM_SpecialPairTableSetID(pReadPairTable->pSpecialPairTable, pCheckpoint->pSpecialID);
+
+                if (pOutFile == NULL)
+                    pOutFile = TGM_ReadPairOutFileOpen(pBuildPars->workingDir, pBuildPars->compressLevel);
+
+                hasReadPairTable = TRUE;
+            }
+        }
+
         while (TGM_GetNextLine(bamFileName, TGM_MAX_LINE, pBuildPars->fileListInput) == TGM_OK)
         {
+            // skip the bam files finished by an earlier run
+            if (isResumed && TGM_ReadPairCheckpointIsDone(pCheckpoint, bamFileName, TGM_PRIMARY_BAM))
+                continue;
+
             // open the bam file
             TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
 
@@ -844,7 +1061,15 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
                 if (status == TGM_OK)
                     sortMode = TGM_SORTED_COORDINATE_ZA;
                 else if (status == TGM_ERR)
+                {
+                    // record the skipped bam file so that the manifest follows the order of the bam list
+                    if (pOutFile != NULL)
+                        TGM_ReadPairOutFileSync(pOutFile);
+
+                    TGM_ReadPairCheckpointCommit(pCheckpoint, pOutFile);
+                    TGM_ReadPairCheckpointStage(pCheckpoint, bamFileName, TGM_PRIMARY_BAM, pLibTable, NULL, histOutput);
                     continue;
+                }
 
                 TGM_BamInStreamLiteSetSortMode(pBamInStreamLite, sortMode);
             }
@@ -908,12 +1133,16 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
             if (!hasReadPairTable)
             {
                 pReadPairTable = TGM_ReadPairTableAlloc(pLibTable->pAnchorInfo->size, pBuildPars->detectSet); 
-                pFileHash = TGM_ReadPairFilesOpen(pLibTable, pBuildPars->detectSet, pBuildPars->workingDir);
+                pWriteTable = TGM_ReadPairTableAlloc(pLibTable->pAnchorInfo->size, pBuildPars->detectSet); 
+
+                if (pOutFile == NULL)
+                    pOutFile = TGM_ReadPairOutFileOpen(pBuildPars->workingDir, pBuildPars->compressLevel);
+
                 hasReadPairTable =TRUE;
             }
 
             // we need to load the cross pair if we want to detect inter-chromosome translocation
-            if ((pBuildPars->detectSet & SV_INTER_CHR_TRNSLCTN) != 0)
+            if ((pBuildPars->detectSet & (1 << SV_INTER_CHR_TRNSLCTN)) != 0)
                 loadCross = TRUE;
             else
                 loadCross = FALSE;
@@ -986,21 +1215,23 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
 
             }while(bamStatus == TGM_OK);
 
-            // write out the read pair table for the current bam file
-            TGM_ReadPairTableWrite(pReadPairTable, pFileHash);
+            // wait until the table of the previous bam file is written and cleared, commit the previous bam file
+            // then hand the table of the current bam file over to the writer thread
+            TGM_ReadPairOutFileSync(pOutFile);
+            TGM_ReadPairCheckpointCommit(pCheckpoint, pOutFile);
+            TGM_ReadPairTableSwap(pReadPairTable, pWriteTable);
+            TGM_ReadPairOutFileSubmit(pOutFile, TGM_ReadPairTableAsyncWrite, pWriteTable);
 
-            // clear the read pair table for the next bam file
-            TGM_ReadPairTableClear(pReadPairTable);
+            char* pCurrSpecialID = (pReadPairTable->pSpecialPairTable != NULL ? TGM_SpecialPairTableGetID(pReadPairTable->pSpecialPairTable) : NULL);
+            TGM_ReadPairCheckpointStage(pCheckpoint, bamFileName, TGM_PRIMARY_BAM, pLibTable, pCurrSpecialID, histOutput);
+            free(pCurrSpecialID);
 
             // close the bam file
             TGM_BamInStreamLiteClose(pBamInStreamLite);
             TGM_BamHeaderFree(pBamHeader);
         }
 
-        // write the number of pairs into each read pair file
-        TGM_ReadPairFilesWriteNum(pFileHash);
-
-        if (pLibTable->size > 0)
+        if (pLibTable->size > 0 && pReadPairTable != NULL)
         {
             // this function will check the empty condition or null pointer condition
             pSpecialID = TGM_SpecialPairTableGetID(pReadPairTable->pSpecialPairTable);
@@ -1008,101 +1239,106 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
         }
 
         // clean up
+        if (pOutFile != NULL)
+            TGM_ReadPairOutFileSync(pOutFile);
+
+        TGM_ReadPairCheckpointCommit(pCheckpoint, pOutFile);
+
         fclose(histOutput);
         TGM_FragLenHistArrayFree(pHistArray);
         TGM_ReadPairTableFree(pReadPairTable);
+        TGM_ReadPairTableFree(pWriteTable);
     }
 
     // if we are going to use the split alignments
     if (pBuildPars->splitFileInput != NULL) 
     {
-        TGM_Bool hasSplitTable = FALSE;
-        TGM_SplitPairTable* pSplitPairTable = NULL;
+        TGM_SplitBuildJob splitJob;
+        memset(&splitJob, 0, sizeof(TGM_SplitBuildJob));
+
+        uint32_t capBams = DEFAULT_SPLIT_BAM_CAPACITY;
+        splitJob.pBamNames = (char**) malloc(capBams * sizeof(char*));
+        if (splitJob.pBamNames == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the split bam file names.\n");
 
+        // the headers are loaded in the order of the bam list so that
+        // the library information table does not depend on the thread scheduling
         while (TGM_GetNextLine(bamFileName, TGM_MAX_LINE, pBuildPars->splitFileInput) == TGM_OK)
         {
-            // open the bam file
-            TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+            // skip the split bam files finished by an earlier run
+            if (isResumed && TGM_ReadPairCheckpointIsDone(pCheckpoint, bamFileName, TGM_SPLIT_BAM))
+                continue;
 
-            // load the bam header
+            TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
             TGM_BamHeader* pBamHeader = TGM_BamInStreamLiteLoadHeader(pBamInStreamLite);
 
-            // load the bam header before read any alignments
             if (TGM_LibInfoTableSetRGSplit(pLibTable, pBamHeader, pBuildPars->specialPrefix, pBuildPars->prefixLen) != TGM_OK)
                 TGM_ErrQuit("ERROR: Found an error when loading the split bam file.\n");
 
-            // we have to change the fitler function here for split pairs
-            TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_SplitFilter);
-            
-            // split filter does not need any parameters
-            TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, NULL);
-
-            // set the sorting order
-            TGM_SortMode sortMode = TGM_SORTED_SPLIT;
-            TGM_BamInStreamLiteSetSortMode(pBamInStreamLite, sortMode);
-
-            int retNum = 0;
-            const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
-            TGM_Status bamStatus = TGM_OK;
+            TGM_BamInStreamLiteClose(pBamInStreamLite);
+            TGM_BamHeaderFree(pBamHeader);
 
-            // create a split table object if we haven't yet
-            if (!hasSplitTable)
+            if (splitJob.numBams == capBams)
             {
-                uint32_t numChr = TGM_LibInfoTableCountNormalChr(pLibTable);
-                pSplitPairTable = TGM_SplitPairTableAlloc(numChr, pBuildPars->detectSet);
+                capBams *= 2;
+                splitJob.pBamNames = (char**) realloc(splitJob.pBamNames, capBams * sizeof(char*));
+                if (splitJob.pBamNames == NULL)
+                    TGM_ErrQuit("ERROR: Not enough memory for the split bam file names.\n");
+            }
 
-                // open the read pair files 
-                if (pFileHash == NULL)
-                {
-                    pFileHash = TGM_ReadPairFilesOpen(pLibTable, pBuildPars->detectSet, pBuildPars->workingDir);
-                    TGM_ReadPairFilesWriteNum(pFileHash);
-                }
+            splitJob.pBamNames[splitJob.numBams] = strdup(bamFileName);
+            if (splitJob.pBamNames[splitJob.numBams] == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the split bam file names.\n");
 
-                // initialize the number of split pairs
-                TGM_ReadPairFilesWriteSplitNum(pFileHash);
+            ++(splitJob.numBams);
+        }
 
-                hasSplitTable = TRUE;
-            }
+        if (splitJob.numBams > 0)
+        {
+            // open the read pair container
+            if (pOutFile == NULL)
+                pOutFile = TGM_ReadPairOutFileOpen(pBuildPars->workingDir, pBuildPars->compressLevel);
 
-            do
-            {
-                int64_t index = -1;
-                bamStatus = TGM_BamInStreamLiteRead(pAlgns, &retNum, &index, pBamInStreamLite);
+            splitJob.pBuildPars = pBuildPars;
+            splitJob.pLibTable = pLibTable;
+            splitJob.numChr = TGM_LibInfoTableCountNormalChr(pLibTable);
+            splitJob.pOutFile = pOutFile;
+            splitJob.pCheckpoint = pCheckpoint;
+            splitJob.pSpecialID = pSpecialID;
 
-                if (retNum == 2)
-                {
-                    TGM_ZAtag zaTag;
+            pthread_mutex_init(&(splitJob.mutex), NULL);
+            pthread_cond_init(&(splitJob.cond), NULL);
 
-                    const bam1_t* pFirstPartial = pAlgns[0];
-                    const bam1_t* pSecondPartial = pAlgns[1];
+            unsigned int numThreads = (pBuildPars->numThreads > 0 ? pBuildPars->numThreads : 1);
+            if (numThreads > splitJob.numBams)
+                numThreads = splitJob.numBams;
 
-                    // FIXME: ZA tag is not available in current split bam
-                    // change this block back when the ZA tag is available
-                    /*  
-                    TGM_Status ZAstatus = TGM_LoadZAtag(&zaTag, pFirstPartial);
+            pthread_t threads[numThreads];
 
-                    if (ZAstatus == TGM_OK)
-                        TGM_SplitPairTableUpdate(pSplitPairTable, pLibTable, pFirstPartial, pSecondPartial, &zaTag, pBuildPars->minMQ);
-                    */
-                    TGM_SplitPairTableUpdate(pSplitPairTable, pLibTable, pFirstPartial, pSecondPartial, &zaTag, pBuildPars->minMQ);
-                }
+            // the calling thread works as the first worker
+            for (unsigned int t = 1; t < numThreads; ++t)
+            {
+                if (pthread_create(threads + t, NULL, TGM_SplitBuildWorker, &splitJob) != 0)
+                    TGM_ErrQuit("ERROR: Cannot create a split bam worker thread.\n");
+            }
 
-            }while(bamStatus == TGM_OK);
+            TGM_SplitBuildWorker(&splitJob);
 
-            // write the split pair inforamtion into the read pair files
-            TGM_SplitPairTableWrite(pSplitPairTable, pFileHash);
-            TGM_SplitPairTableClear(pSplitPairTable);
+            for (unsigned int t = 1; t < numThreads; ++t)
+                pthread_join(threads[t], NULL);
 
-            // close the current split bam file and free the bam header
-            TGM_BamInStreamLiteClose(pBamInStreamLite);
-            TGM_BamHeaderFree(pBamHeader);
+            pthread_mutex_destroy(&(splitJob.mutex));
+            pthread_cond_destroy(&(splitJob.cond));
+
+            // commit the last split bam file
+            TGM_ReadPairOutFileSync(pOutFile);
+            TGM_ReadPairCheckpointCommit(pCheckpoint, pOutFile);
         }
 
-        // write the number of split pairs of each type into the read pair file
-        TGM_ReadPairFilesWriteSplitNum(pFileHash);
+        for (uint32_t i = 0; i != splitJob.numBams; ++i)
+            free(splitJob.pBamNames[i]);
 
-        // free the split pair table
-        TGM_SplitPairTableFree(pSplitPairTable);
+        free(splitJob.pBamNames);
     }
 
     // write the library information into file
@@ -1124,7 +1360,8 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
 
     // clean up
     fclose(libTableOutput);
-    TGM_ReadPairFilesClose(pFileHash);
+    TGM_ReadPairOutFileClose(pOutFile);
+    TGM_ReadPairCheckpointFree(pCheckpoint);
     TGM_LibInfoTableFree(pLibTable);
     TGM_BamInStreamLiteFree(pBamInStreamLite);
 }
@@ -1272,7 +1509,7 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars)
         }
 
         // we need to load the cross pair if we want to detect inter-chromosome translocation
-        if ((pBuildPars->detectSet & SV_INTER_CHR_TRNSLCTN) != 0)
+        if ((pBuildPars->detectSet & (1 << SV_INTER_CHR_TRNSLCTN)) != 0)
             TGM_FilterDataRPTurnOnCross(pFilterData);
 
         while ((bamStatus = TGM_BamInStreamLoadPair(&pUpNode, &pDownNode, pBamInStream)) != TGM_EOF && bamStatus != TGM_ERR)
@@ -1397,6 +1634,24 @@ void TGM_ReadPairTableClear(TGM_ReadPairTable* pReadPairTable)
         TGM_SpecialPairTableClear(pReadPairTable->pSpecialPairTable, pReadPairTable->numChr);
 }
 
+// swap the read pairs of two read pair tables
+void TGM_ReadPairTableSwap(TGM_ReadPairTable* pFirstTable, TGM_ReadPairTable* pSecondTable)
+{
+    TGM_SWAP(pFirstTable->pLongPairArray, pSecondTable->pLongPairArray, TGM_LocalPairArray*);
+    TGM_SWAP(pFirstTable->pShortPairArray, pSecondTable->pShortPairArray, TGM_LocalPairArray*);
+    TGM_SWAP(pFirstTable->pReversedPairArray, pSecondTable->pReversedPairArray, TGM_LocalPairArray*);
+    TGM_SWAP(pFirstTable->pInvertedPairArray, pSecondTable->pInvertedPairArray, TGM_LocalPairArray*);
+    TGM_SWAP(pFirstTable->pCrossPairArray, pSecondTable->pCrossPairArray, TGM_CrossPairArray*);
+    TGM_SWAP(pFirstTable->numPairs, pSecondTable->numPairs, uint64_t);
+
+    // the special reference names stay with their tables so that the special IDs are consistent across the bam files
+    if (pFirstTable->pSpecialPairTable != NULL)
+    {
+        TGM_SWAP(pFirstTable->pSpecialPairTable->array, pSecondTable->pSpecialPairTable->array, TGM_SpecialPairArray);
+        TGM_SWAP(pFirstTable->pSpecialPairTable->crossArray, pSecondTable->pSpecialPairTable->crossArray, TGM_SpecialPairArray);
+    }
+}
+
 // update the read pair table with the incoming read pairs
 void TGM_ReadPairTableUpdate(TGM_ReadPairTable* pReadPairTable, const bam1_t* pUpAlgn, const bam1_t* pDownAlgn, const TGM_ZAtag* pZAtag, const TGM_PairStats* pPairStats, 
                             const TGM_MateInfo* pMateInfo, const TGM_LibInfoTable* pLibTable, const TGM_FragLenHistArray* pHistArray, const TGM_ReadPairBuildPars* pBuildPars)
@@ -1467,264 +1722,59 @@ void TGM_ReadPairTableUpdate(TGM_ReadPairTable* pReadPairTable, const bam1_t* pU
     }
 }
 
-// open a seriers read pair files for output. A read pair
-// file will be open for each read pair type on each chromosome
-void* TGM_ReadPairFilesOpen(const TGM_LibInfoTable* pLibTable, uint32_t detectSet, const char* workingDir)
+// write the read pair table into the read pair container
+void TGM_ReadPairTableWrite(const TGM_ReadPairTable* pReadPairTable, TGM_ReadPairOutFile* pOutFile)
 {
-    khash_t(file)* pFileHash = kh_init(file);
-
-    // buffer to hold the reference ID
-    char refBuff[4];
-
-    // length of the working directory
-    int dirLen = strlen(workingDir);
-
-    // buffer to hold the full read pair file name
-    char nameBuff[dirLen + 50];
-
-    // copy the working directory name into the name buffer
-    strncpy(nameBuff, workingDir, dirLen);
-    char* namePos = nameBuff + dirLen;
-    char* replacePos = namePos + 3;
-
-    // the reference ID should not be larger than 1000 (arbitrary, but reasonable)
-    const TGM_AnchorInfo* pAnchorInfo = pLibTable->pAnchorInfo;
-    if (pAnchorInfo->size > 1000)
-        TGM_ErrQuit("ERROR: reference ID overflow (0-999).\n");
-
-    // this is the place holder put at the beginning of each read pair file
-    // different SV types may have different file headers
-    const uint64_t placeHolder = 0;
-    TGM_ReadPairOutStream stream = {NULL, 0, 0};
+    unsigned int numChr = pReadPairTable->numChr;
 
-    for (unsigned int i = 0; i != pAnchorInfo->size; ++i)
+    if (pReadPairTable->pLongPairArray != NULL)
     {
-        if (pAnchorInfo->pLength[i] <= 0
-            || strncmp(pAnchorInfo->pAnchors[i], pAnchorInfo->pSpecialPrefix, pAnchorInfo->specialPrefixLen) == 0)
-        {
-            continue;
-        }
-
-        // copy the reference ID into the name buffer
-        unsigned int offset = 2 - (unsigned int) log10(i);
-        sprintf(refBuff, "000");
-        sprintf(refBuff + offset, "%d", i);
-
-        int fileID = 0;
-        int ret = 0;
-        khiter_t khIter = 0;
-        unsigned int fileIndex = TGM_LONG_PAIR_FILE;
-
-        for (unsigned int j = SV_DELETION; j <= SV_INTER_CHR_TRNSLCTN; ++j)
-        {
-            if ((detectSet & (1 << j)) != 0)
-            {
-                strcpy(namePos, TGM_READ_PAIR_FILE_NAME_TEMPLATE[fileIndex]);
-                strncpy(replacePos, refBuff, 3);
-
-                stream.output = fopen(nameBuff, "wb");
-                if (stream.output == NULL)
-                    TGM_ErrQuit("ERROR: Cannot open file: %d\n", nameBuff);
-
-                fileID = i * TGM_NUM_RP_FILE + fileIndex; 
-                khIter = kh_put(file, pFileHash, fileID, &ret);
-                kh_value(pFileHash, khIter) = stream;
-                // leave a place for the total number of read pairs
-                fwrite(&placeHolder, sizeof(uint64_t), 1, stream.output);
-
-                // for tandem duplication we have two read types to take care
-                if (j == SV_TANDEM_DUP)
-                {
-                    ++fileIndex;
-
-                    strcpy(namePos, TGM_READ_PAIR_FILE_NAME_TEMPLATE[fileIndex]);
-                    strncpy(replacePos, refBuff, 3);
-
-                    stream.output = fopen(nameBuff, "wb");
-                    if (stream.output == NULL)
-                        TGM_ErrQuit("ERROR: Cannot open file: %d\n", nameBuff);
-
-                    fileID = i * TGM_NUM_RP_FILE + fileIndex; 
-                    khIter = kh_put(file, pFileHash, fileID, &ret);
-                    kh_value(pFileHash, khIter) = stream;
-
-                    // leave a place for the total number of read pairs
-                    fwrite(&placeHolder, sizeof(uint64_t), 1, stream.output);
-                }
-            }
-
-            ++fileIndex;
-        }
+        TGM_ReadPairArrayWrite(pOutFile, TGM_LONG_PAIR_CHUNK, pReadPairTable->pLongPairArray->data, sizeof(TGM_LocalPair), 
+                              pReadPairTable->pLongPairArray->chrCount, numChr);
     }
 
-    return ((void*) pFileHash);
-}
-
-// write the number of read pairs for each chromosome and SV types into the beginning of each read pair file
-void TGM_ReadPairFilesWriteNum(void* pFileHash)
-{
-    khash_t(file)* pHash = (khash_t(file)*) pFileHash;
-
-    for (khiter_t khIter = kh_begin(pHash); khIter != kh_end(pHash); ++khIter)
+    if (pReadPairTable->pShortPairArray != NULL)
     {
-        if (kh_exist(pHash, khIter))
-        {
-            kh_value(pHash, khIter).splitInfoPos = ftello(kh_value(pHash, khIter).output);
-
-            fseeko(kh_value(pHash, khIter).output, 0, SEEK_SET);
-            fwrite(&(kh_value(pHash, khIter).numPairs), sizeof(uint64_t), 1, kh_value(pHash, khIter).output);
-
-            kh_value(pHash, khIter).numPairs = 0;
-        }
+        TGM_ReadPairArrayWrite(pOutFile, TGM_SHORT_PAIR_CHUNK, pReadPairTable->pShortPairArray->data, sizeof(TGM_LocalPair), 
+                              pReadPairTable->pShortPairArray->chrCount, numChr);
     }
-}
-
-// close all the read pair files
-void TGM_ReadPairFilesWriteSplitNum(void* pFileHash)
-{
-    khash_t(file)* pHash = (khash_t(file)*) pFileHash;
 
-    for (khiter_t khIter = kh_begin(pHash); khIter != kh_end(pHash); ++khIter)
+    if (pReadPairTable->pReversedPairArray != NULL)
     {
-        if (kh_exist(pHash, khIter))
-        {
-            fseeko(kh_value(pHash, khIter).output, kh_value(pHash, khIter).splitInfoPos, SEEK_SET);
-            fwrite(&(kh_value(pHash, khIter).numPairs), sizeof(uint64_t), 1, kh_value(pHash, khIter).output);
-        }
+        TGM_ReadPairArrayWrite(pOutFile, TGM_REVERSED_PAIR_CHUNK, pReadPairTable->pReversedPairArray->data, sizeof(TGM_LocalPair), 
+                              pReadPairTable->pReversedPairArray->chrCount, numChr);
     }
-}
 
-// close all the read pair files
-void TGM_ReadPairFilesClose(void* pFileHash)
-{
-    khash_t(file)* pHash = (khash_t(file)*) pFileHash;
-
-    for (khiter_t khIter = kh_begin(pHash); khIter != kh_end(pHash); ++khIter)
+    if (pReadPairTable->pInvertedPairArray != NULL)
     {
-        if (kh_exist(pHash, khIter))
-            fclose(kh_value(pHash, khIter).output);
+        TGM_ReadPairArrayWrite(pOutFile, TGM_INVERTED_PAIR_CHUNK, pReadPairTable->pInvertedPairArray->data, sizeof(TGM_LocalPair), 
+                              pReadPairTable->pInvertedPairArray->chrCount, numChr);
     }
 
-    kh_destroy(file, pHash);
-}
-
-// write the read pair table into the read pair files
-void TGM_ReadPairTableWrite(const TGM_ReadPairTable* pReadPairTable, void* pHash)
-{
-    khash_t(file)* pFileHash = (khash_t(file)*) pHash;
-    unsigned int numChr = pReadPairTable->numChr;
-
-    int fileID = 0;
-    khiter_t khIter = 0;
-
-    int currPos[] = {0, 0, 0, 0, 0, 0};
-
-    for (unsigned int i = 0; i != numChr; ++i)
+    if (pReadPairTable->pCrossPairArray != NULL)
     {
-        int numPairs = pReadPairTable->pLongPairArray == NULL ? 0 : pReadPairTable->pLongPairArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_LONG_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pLongPairArray->data + currPos[TGM_LONG_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_LONG_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pReadPairTable->pShortPairArray == NULL ? 0 : pReadPairTable->pShortPairArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_SHORT_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pShortPairArray->data + currPos[TGM_SHORT_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_SHORT_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pReadPairTable->pReversedPairArray == NULL ? 0 : pReadPairTable->pReversedPairArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_REVERSED_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pReversedPairArray->data + currPos[TGM_REVERSED_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_REVERSED_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pReadPairTable->pInvertedPairArray == NULL ? 0 : pReadPairTable->pInvertedPairArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_INVERTED_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pInvertedPairArray->data + currPos[TGM_INVERTED_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_INVERTED_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pReadPairTable->pSpecialPairTable == NULL ? 0 : pReadPairTable->pSpecialPairTable->array.chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_SPEICAL_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pSpecialPairTable->array.data + currPos[TGM_SPEICAL_PAIR_FILE], sizeof(TGM_SpecialPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_SPEICAL_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pReadPairTable->pCrossPairArray == NULL ? 0 : pReadPairTable->pCrossPairArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_CROSS_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pReadPairTable->pCrossPairArray->data + currPos[TGM_CROSS_PAIR_FILE], sizeof(TGM_CrossPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_CROSS_PAIR_FILE] += numPairs;
-        }
+        TGM_ReadPairArrayWrite(pOutFile, TGM_CROSS_PAIR_CHUNK, pReadPairTable->pCrossPairArray->data, sizeof(TGM_CrossPair), 
+                              pReadPairTable->pCrossPairArray->chrCount, numChr);
     }
 
-    // take care of those special pairs whose anchor refID is not the same as its mate's refID.
     if (pReadPairTable->pSpecialPairTable != NULL)
     {
-        const TGM_SpecialPairArray* pSpecialPairArray = &(pReadPairTable->pSpecialPairTable->crossArray);
-        for (unsigned int i = 0; i != pSpecialPairArray->size; ++i)
-        {
-            fileID = pSpecialPairArray->data[i].refID[0] * TGM_NUM_RP_FILE + TGM_SPEICAL_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
+        TGM_ReadPairArrayWrite(pOutFile, TGM_SPECIAL_PAIR_CHUNK, pReadPairTable->pSpecialPairTable->array.data, sizeof(TGM_SpecialPair), 
+                              pReadPairTable->pSpecialPairTable->array.chrCount, numChr);
+
+        // take care of those special pairs whose anchor refID is not the same as its mate's refID.
+        // group them by the anchor refID so that each reference gets a single chunk
+        TGM_SpecialPairArray* pCrossArray = &(pReadPairTable->pSpecialPairTable->crossArray);
+        qsort(pCrossArray->data, pCrossArray->size, sizeof(TGM_SpecialPair), CompareSpecialAnchor);
 
-            if (khIter != kh_end(pFileHash))
+        uint64_t start = 0;
+        for (uint64_t i = 1; i <= pCrossArray->size; ++i)
+        {
+            if (i == pCrossArray->size || pCrossArray->data[i].refID[0] != pCrossArray->data[start].refID[0])
             {
-                kh_value(pFileHash, khIter).numPairs += 1;
-                fwrite(pSpecialPairArray->data + i, sizeof(TGM_SpecialPair), 1, kh_value(pFileHash, khIter).output);
+                TGM_ReadPairOutFileWrite(pOutFile, pCrossArray->data[start].refID[0], TGM_SPECIAL_PAIR_CHUNK, 
+                                        pCrossArray->data + start, sizeof(TGM_SpecialPair), i - start);
+                start = i;
             }
         }
     }
@@ -1763,92 +1813,36 @@ void TGM_SplitPairTableClear(TGM_SplitPairTable* pSplitPairTable)
     }
 }
 
-// write the read pair table into the read pair files
-void TGM_SplitPairTableWrite(const TGM_SplitPairTable* pSplitPairTable, void* pHash)
+// swap the split pairs of two split pair tables
+void TGM_SplitPairTableSwap(TGM_SplitPairTable* pFirstTable, TGM_SplitPairTable* pSecondTable)
 {
-    khash_t(file)* pFileHash = (khash_t(file)*) pHash;
-    unsigned int numChr = pSplitPairTable->numChr;
-
-    int fileID = 0;
-    khiter_t khIter = 0;
+    TGM_SWAP(pFirstTable->pSplitLongArray, pSecondTable->pSplitLongArray, TGM_SplitPairArray*);
+    TGM_SWAP(pFirstTable->pSplitShortArray, pSecondTable->pSplitShortArray, TGM_SplitPairArray*);
+    TGM_SWAP(pFirstTable->pSplitReversedArray, pSecondTable->pSplitReversedArray, TGM_SplitPairArray*);
+    TGM_SWAP(pFirstTable->pSplitInvertedArray, pSecondTable->pSplitInvertedArray, TGM_SplitPairArray*);
+    TGM_SWAP(pFirstTable->pSplitSpecialArray, pSecondTable->pSplitSpecialArray, TGM_SplitPairArray*);
+}
 
-    int currPos[] = {0, 0, 0, 0, 0};
+// write the split pair table into the read pair container
+void TGM_SplitPairTableWrite(const TGM_SplitPairTable* pSplitPairTable, TGM_ReadPairOutFile* pOutFile)
+{
+    unsigned int numChr = pSplitPairTable->numChr;
 
-    for (unsigned int i = 0; i != numChr; ++i)
+    const TGM_SplitPairArray* pSplitArrays[] = 
     {
-        int numPairs = pSplitPairTable->pSplitLongArray == NULL ? 0 : pSplitPairTable->pSplitLongArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_LONG_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pSplitPairTable->pSplitLongArray->data + currPos[TGM_LONG_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_LONG_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pSplitPairTable->pSplitShortArray == NULL ? 0 : pSplitPairTable->pSplitShortArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_SHORT_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pSplitPairTable->pSplitShortArray->data + currPos[TGM_SHORT_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_SHORT_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pSplitPairTable->pSplitReversedArray == NULL ? 0 : pSplitPairTable->pSplitReversedArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_REVERSED_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pSplitPairTable->pSplitReversedArray->data + currPos[TGM_REVERSED_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_REVERSED_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pSplitPairTable->pSplitInvertedArray == NULL ? 0 : pSplitPairTable->pSplitInvertedArray->chrCount[i];
-        if (numPairs > 0)
-        {
-            fileID = i * TGM_NUM_RP_FILE + TGM_INVERTED_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pSplitPairTable->pSplitInvertedArray->data + currPos[TGM_INVERTED_PAIR_FILE], sizeof(TGM_LocalPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_INVERTED_PAIR_FILE] += numPairs;
-        }
-
-        numPairs = pSplitPairTable->pSplitSpecialArray == NULL ? 0 : pSplitPairTable->pSplitSpecialArray->chrCount[i];
-        if (numPairs > 0)
+        pSplitPairTable->pSplitLongArray,
+        pSplitPairTable->pSplitShortArray,
+        pSplitPairTable->pSplitReversedArray,
+        pSplitPairTable->pSplitInvertedArray,
+        pSplitPairTable->pSplitSpecialArray
+    };
+
+    for (unsigned int i = 0; i != sizeof(pSplitArrays) / sizeof(pSplitArrays[0]); ++i)
+    {
+        if (pSplitArrays[i] != NULL)
         {
-            fileID = i * TGM_NUM_RP_FILE + TGM_SPEICAL_PAIR_FILE;
-            khIter = kh_get(file, pFileHash, fileID);
-
-            if (khIter != kh_end(pFileHash))
-            {
-                kh_value(pFileHash, khIter).numPairs += numPairs;
-                fwrite(pSplitPairTable->pSplitSpecialArray->data + currPos[TGM_SPEICAL_PAIR_FILE], sizeof(TGM_SpecialPair), numPairs, kh_value(pFileHash, khIter).output);
-            }
-
-            currPos[TGM_SPEICAL_PAIR_FILE] += numPairs;
+            TGM_ReadPairArrayWrite(pOutFile, TGM_SPLIT_LONG_CHUNK + i, pSplitArrays[i]->data, sizeof(TGM_SplitPair), 
+                                  pSplitArrays[i]->chrCount, numChr);
         }
     }
 }
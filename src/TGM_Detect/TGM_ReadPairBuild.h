@@ -20,6 +20,7 @@
 #define  TGM_READPAIRBUILD_H
 
 #include "TGM_LibInfo.h"
+#include "TGM_ReadPairFile.h"
 
 
 //===============================
@@ -51,6 +52,12 @@ typedef struct
 
     uint32_t prefixLen;            // length of the prefix of the special reference
 
+    int compressLevel;             // zlib compression level of the read pair file (0 means raw records)
+
+    TGM_Bool resume;               // skip the bam files committed in the checkpoint manifest of the working directory
+
+    unsigned int numThreads;       // number of threads used to process the split bam files
+
 }TGM_ReadPairBuildPars;
 
 // local pair structure(for deletion, tademn duplication and inversion)
@@ -58,7 +65,9 @@ typedef struct TGM_LocalPairInfo
 {
     int32_t readGrpID;                                        // read group ID
 
-    int32_t refID:16, upMapQ:8, downMapQ:8;                   // reference ID, up mate mapping quality, down mate mapping quality
+    int32_t refID;                                            // reference ID
+
+    int32_t upMapQ:16, downMapQ:16;                           // up mate mapping quality, down mate mapping quality
 
     int32_t upPos;                                            // alignment position of the up mate
 
@@ -79,7 +88,9 @@ typedef struct TGM_CrossPair
 {
     int32_t readGrpID;                                            // read group ID
                                                                                                                                           
-    int32_t upRefID:16, downRefID:16;                             // up reference ID, down reference ID
+    int32_t upRefID;                                              // up reference ID
+
+    int32_t downRefID;                                            // down reference ID
                                                                                                                                           
     int32_t upMapQ:16, downMapQ:16;                               // up mapping quality, down mapping quality
                                                                   
@@ -102,7 +113,7 @@ typedef struct TGM_SpecialPair
 {
     int32_t readGrpID;                                           // read group ID
                                                                                                                                          
-    int16_t refID[2];                                            // up reference ID, down reference ID
+    int32_t refID[2];                                            // up reference ID, down reference ID
                                                                                                                                          
     int32_t pos[2];                                              // alignment position of the up and down mate
                                                                  
@@ -201,7 +212,7 @@ typedef struct TGM_SplitPair
 {
     int32_t readGrpID;             // read group ID
                                                                                                            
-    int16_t refID[2];              // up reference ID, down reference ID
+    int32_t refID[2];              // up reference ID, down reference ID
                                                                                                            
     int32_t pos[2];                // alignment position of the up and down mate
                                    
@@ -291,6 +302,19 @@ void TGM_ReadPairBuild(const TGM_ReadPairBuildPars* pBuildPars);
 //=============================================================== 
 void TGM_ReadPairTableClear(TGM_ReadPairTable* pReadPairTable);
 
+//===============================================================
+// function:
+//      swap the read pairs of two read pair tables. the special
+//      reference names are not swapped
+//
+// args:
+//      1. pFirstTable: a pointer to a read pair table
+//      2. pSecondTable: a pointer to another read pair table
+//                       with the same detect set
+// 
+//=============================================================== 
+void TGM_ReadPairTableSwap(TGM_ReadPairTable* pFirstTable, TGM_ReadPairTable* pSecondTable);
+
 //======================================================================
 // function:
 //      update the read pair table with the incoming read pairs
@@ -309,51 +333,15 @@ void TGM_ReadPairTableClear(TGM_ReadPairTable* pReadPairTable);
 void TGM_ReadPairTableUpdate(TGM_ReadPairTable* pReadPairTable, const bam1_t* pUpAlgn, const bam1_t* pDownAlgn, const TGM_ZAtag* pZAtag, const TGM_PairStats* pPairStats, 
                             const TGM_MateInfo* pMateInfo, const TGM_LibInfoTable* pLibTable, const TGM_FragLenHistArray* pHistArray, const TGM_ReadPairBuildPars* pBuildPars);
 
-//================================================================
-// function:
-//      open a seriers read pair files for output. A read pair
-//      file will be open for each read pair type on each 
-//      chromosome
-//
-// args:
-//      1. pLibTable: a pointer to the library information table
-//      2. detectSet: a bit set indicating which SV event shoud
-//                    be detected
-//      3. workingDir: the working directory for the detector
-//
-// return:
-//      a pointer ot a hash table of read pair files
-//================================================================
-void* TGM_ReadPairFilesOpen(const TGM_LibInfoTable* pLibTable, uint32_t detectSet, const char* workingDir);
-
-//==================================================================
-// function:
-//      close all the read pair files
-//
-// args:
-//      1. pFileHash: a pointer to a hash table of read pair files
-//==================================================================
-void TGM_ReadPairFilesClose(void* pFileHash);
-
 //=================================================================
 // function:
-//      write the read pair table into the read pair files
+//      write the read pair table into the read pair container
 //
 // args:
 //      1. pReadPairTable: a pointer to a read pair table
-//      2. pFileHash: a pointer to a hash table of read pair files
-//=================================================================
-void TGM_ReadPairTableWrite(const TGM_ReadPairTable* pReadPairTable, void* pFileHash);
-
-//=================================================================
-// function:
-//      write the number of read pairs for each chromosome and 
-//      SV types into the beginning of each read pair file
-//
-// args:
-//      1. pFileHash: a pointer to a hash table of read pair files
+//      2. pOutFile: a pointer to the read pair container
 //=================================================================
-void TGM_ReadPairFilesWriteNum(void* pFileHash);
+void TGM_ReadPairTableWrite(const TGM_ReadPairTable* pReadPairTable, TGM_ReadPairOutFile* pOutFile);
 
 //=================================================================
 // function:
@@ -394,17 +382,26 @@ void TGM_SplitPairTableUpdate(TGM_SplitPairTable* pSplitPairTable, const TGM_Lib
 
 //=================================================================
 // function:
-//      write the split pair table into the read pair files
+//      write the split pair table into the read pair container
 //
 // args:
 //      1. pSplitPairTable: a pointer to a read pair table
-//      2. pFileHash: a pointer to a hash table of read pair files
+//      2. pOutFile: a pointer to the read pair container
 //=================================================================
-void TGM_SplitPairTableWrite(const TGM_SplitPairTable* pSplitPairTable, void* pFileHash);
+void TGM_SplitPairTableWrite(const TGM_SplitPairTable* pSplitPairTable, TGM_ReadPairOutFile* pOutFile);
 
 void TGM_SplitPairTableClear(TGM_SplitPairTable* pSplitPairTable);
 
-void TGM_ReadPairFilesWriteSplitNum(void* pFileHash);
+//=================================================================
+// function:
+//      swap the split pairs of two split pair tables
+//
+// args:
+//      1. pFirstTable: a pointer to a split pair table
+//      2. pSecondTable: a pointer to another split pair table
+//                       with the same detect set
+//=================================================================
+void TGM_SplitPairTableSwap(TGM_SplitPairTable* pFirstTable, TGM_SplitPairTable* pSecondTable);
 
 
 #endif  /*TGM_READPAIRBUILD_H*/
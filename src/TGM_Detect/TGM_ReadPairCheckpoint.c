@@ -0,0 +1,350 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairCheckpoint.c
+ *
+ *    Description:  checkpoint and resume of the read pair build
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "TGM_Error.h"
+#include "TGM_Utilities.h"
+#include "TGM_ReadPairCheckpoint.h"
+
+#define DEFAULT_CHECKPOINT_BAM_CAPACITY 50
+
+static const char* TGM_CheckpointFileName = "build_manifest.dat";
+
+static const char* TGM_CheckpointTempName = "build_manifest.dat.tmp";
+
+static const char TGM_CHECKPOINT_MAGIC[4] = {'T', 'G', 'M', 'C'};
+
+static void TGM_CheckpointWrite(const void* pData, size_t size, FILE* output)
+{
+    if (size > 0 && fwrite(pData, size, 1, output) != 1)
+        TGM_ErrQuit("ERROR: Cannot write the checkpoint manifest.\n");
+}
+
+static void TGM_CheckpointRead(void* pData, size_t size, FILE* input)
+{
+    if (size > 0 && fread(pData, size, 1, input) != 1)
+        TGM_ErrQuit("ERROR: The checkpoint manifest is truncated.\n");
+}
+
+// get the size and the modification time of a bam file
+static void TGM_CheckpointBamStat(TGM_CheckpointBam* pBam, const char* bamFileName)
+{
+    struct stat bamStat;
+    if (stat(bamFileName, &bamStat) != 0)
+        TGM_ErrQuit("ERROR: Cannot get the status of the bam file: %s\n", bamFileName);
+
+    pBam->size = bamStat.st_size;
+    pBam->mtime = bamStat.st_mtime;
+}
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_ReadPairCheckpoint* TGM_ReadPairCheckpointAlloc(const char* workingDir, TGM_Bool resume)
+{
+    TGM_ReadPairCheckpoint* pCheckpoint = (TGM_ReadPairCheckpoint*) calloc(1, sizeof(TGM_ReadPairCheckpoint));
+    if (pCheckpoint == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a checkpoint object.\n");
+
+    pCheckpoint->manifestName = TGM_CreateFileName(workingDir, TGM_CheckpointFileName);
+    pCheckpoint->tempName = TGM_CreateFileName(workingDir, TGM_CheckpointTempName);
+
+    TGM_ARRAY_ALLOC(pCheckpoint->pBamArray, DEFAULT_CHECKPOINT_BAM_CAPACITY, TGM_CheckpointBamArray, TGM_CheckpointBam);
+
+    // a fresh build must never pick up the manifest of an old one
+    if (!resume)
+        unlink(pCheckpoint->manifestName);
+
+    return pCheckpoint;
+}
+
+void TGM_ReadPairCheckpointFree(TGM_ReadPairCheckpoint* pCheckpoint)
+{
+    if (pCheckpoint != NULL)
+    {
+        for (uint64_t i = 0; i != pCheckpoint->pBamArray->size; ++i)
+            free(pCheckpoint->pBamArray->data[i].path);
+
+        TGM_ARRAY_FREE(pCheckpoint->pBamArray, TRUE);
+        TGM_ARRAY_FREE(pCheckpoint->pChunkArray, TRUE);
+
+        free(pCheckpoint->staged.path);
+        free(pCheckpoint->pSnapshot);
+        free(pCheckpoint->pSpecialID);
+        TGM_LibInfoTableFree(pCheckpoint->pLibTable);
+
+        free(pCheckpoint->manifestName);
+        free(pCheckpoint->tempName);
+
+        free(pCheckpoint);
+    }
+}
+
+
+//======================
+// Interface functions
+//======================
+
+TGM_Status TGM_ReadPairCheckpointLoad(TGM_ReadPairCheckpoint* pCheckpoint)
+{
+    FILE* input = fopen(pCheckpoint->manifestName, "rb");
+    if (input == NULL)
+        return TGM_EOF;
+
+    char magic[4];
+    uint32_t version = 0;
+
+    TGM_CheckpointRead(magic, sizeof(magic), input);
+    TGM_CheckpointRead(&version, sizeof(uint32_t), input);
+
+    if (memcmp(magic, TGM_CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != TGM_CHECKPOINT_VERSION)
+        TGM_ErrQuit("ERROR: \"%s\" is not a valid checkpoint manifest.\n", pCheckpoint->manifestName);
+
+    // processed bam files
+    uint64_t numBams = 0;
+    TGM_CheckpointRead(&numBams, sizeof(uint64_t), input);
+
+    for (uint64_t i = 0; i != numBams; ++i)
+    {
+        TGM_CheckpointBam bam;
+        uint32_t pathLen = 0;
+
+        TGM_CheckpointRead(&(bam.bamType), sizeof(int32_t), input);
+        TGM_CheckpointRead(&pathLen, sizeof(uint32_t), input);
+
+        bam.path = (char*) malloc(pathLen + 1);
+        if (bam.path == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the bam file name.\n");
+
+        TGM_CheckpointRead(bam.path, pathLen, input);
+        bam.path[pathLen] = '\0';
+
+        TGM_CheckpointRead(&(bam.size), sizeof(uint64_t), input);
+        TGM_CheckpointRead(&(bam.mtime), sizeof(int64_t), input);
+
+        TGM_ARRAY_PUSH(pCheckpoint->pBamArray, &bam, TGM_CheckpointBam);
+    }
+
+    // committed state of the read pair container
+    uint64_t numChunks = 0;
+    TGM_CheckpointRead(&(pCheckpoint->containerOffset), sizeof(uint64_t), input);
+    TGM_CheckpointRead(&numChunks, sizeof(uint64_t), input);
+
+    TGM_ARRAY_ALLOC(pCheckpoint->pChunkArray, (numChunks > 0 ? numChunks : 1), TGM_ReadPairChunkArray, TGM_ReadPairChunk);
+    TGM_CheckpointRead(pCheckpoint->pChunkArray->data, numChunks * sizeof(TGM_ReadPairChunk), input);
+    pCheckpoint->pChunkArray->size = numChunks;
+
+    // build state at the end of the last committed bam file
+    TGM_CheckpointRead(&(pCheckpoint->snapshotSize), sizeof(uint64_t), input);
+
+    pCheckpoint->pSnapshot = (char*) malloc(pCheckpoint->snapshotSize);
+    if (pCheckpoint->pSnapshot == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the checkpoint snapshot.\n");
+
+    TGM_CheckpointRead(pCheckpoint->pSnapshot, pCheckpoint->snapshotSize, input);
+    fclose(input);
+
+    FILE* snapshot = fmemopen(pCheckpoint->pSnapshot, pCheckpoint->snapshotSize, "rb");
+    if (snapshot == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the checkpoint snapshot.\n");
+
+    TGM_CheckpointRead(&(pCheckpoint->histOffset), sizeof(uint64_t), snapshot);
+
+    uint32_t numSpecial = 0;
+    TGM_CheckpointRead(&numSpecial, sizeof(uint32_t), snapshot);
+    if (numSpecial > 0)
+    {
+        pCheckpoint->pSpecialID = (char*) malloc(numSpecial * 2 + 1);
+        if (pCheckpoint->pSpecialID == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special reference ID.\n");
+
+        TGM_CheckpointRead(pCheckpoint->pSpecialID, numSpecial * 2, snapshot);
+        pCheckpoint->pSpecialID[numSpecial * 2] = '\0';
+    }
+
+    pCheckpoint->pLibTable = TGM_LibInfoTableRead(snapshot);
+
+    // the sequencing technology is not part of the library information file
+    TGM_CheckpointRead(pCheckpoint->pLibTable->pSeqTech, pCheckpoint->pLibTable->size * sizeof(int8_t), snapshot);
+
+    fclose(snapshot);
+
+    return TGM_OK;
+}
+
+TGM_Bool TGM_ReadPairCheckpointIsDone(TGM_ReadPairCheckpoint* pCheckpoint, const char* bamFileName, TGM_CheckpointBamType bamType)
+{
+    uint64_t order = pCheckpoint->numChecked[bamType]++;
+
+    const TGM_CheckpointBam* pBam = NULL;
+    for (uint64_t i = 0; i != pCheckpoint->pBamArray->size; ++i)
+    {
+        if (pCheckpoint->pBamArray->data[i].bamType == bamType)
+        {
+            if (order == 0)
+            {
+                pBam = pCheckpoint->pBamArray->data + i;
+                break;
+            }
+
+            --order;
+        }
+    }
+
+    if (pBam == NULL)
+        return FALSE;
+
+    TGM_CheckpointBam currBam;
+    TGM_CheckpointBamStat(&currBam, bamFileName);
+
+    if (strcmp(pBam->path, bamFileName) != 0 || pBam->size != currBam.size || pBam->mtime != currBam.mtime)
+    {
+        TGM_ErrQuit("ERROR: The bam file \"%s\" does not match the checkpoint (\"%s\"). Remove \"%s\" to start the build over.\n",
+                    bamFileName, pBam->path, pCheckpoint->manifestName);
+    }
+
+    return TRUE;
+}
+
+void TGM_ReadPairCheckpointStage(TGM_ReadPairCheckpoint* pCheckpoint, const char* bamFileName, TGM_CheckpointBamType bamType,
+                                 const TGM_LibInfoTable* pLibTable, const char* pSpecialID, FILE* histOutput)
+{
+    if (pCheckpoint->hasStaged)
+        TGM_ErrQuit("ERROR: The previous bam file has not been committed to the checkpoint.\n");
+
+    free(pCheckpoint->staged.path);
+    pCheckpoint->staged.path = strdup(bamFileName);
+    if (pCheckpoint->staged.path == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the bam file name.\n");
+
+    pCheckpoint->staged.bamType = bamType;
+    TGM_CheckpointBamStat(&(pCheckpoint->staged), bamFileName);
+
+    // the histograms are written by the main thread before the bam file is staged
+    if (histOutput != NULL)
+    {
+        if (fflush(histOutput) != 0 || fsync(fileno(histOutput)) != 0)
+            TGM_ErrQuit("ERROR: Cannot flush the fragment length histogram file.\n");
+
+        pCheckpoint->histOffset = ftello(histOutput);
+    }
+
+    free(pCheckpoint->pSnapshot);
+    pCheckpoint->pSnapshot = NULL;
+    pCheckpoint->snapshotSize = 0;
+
+    FILE* snapshot = open_memstream(&(pCheckpoint->pSnapshot), &(pCheckpoint->snapshotSize));
+    if (snapshot == NULL)
+        TGM_ErrQuit("ERROR: Cannot create the checkpoint snapshot.\n");
+
+    TGM_CheckpointWrite(&(pCheckpoint->histOffset), sizeof(uint64_t), snapshot);
+
+    uint32_t numSpecial = (pSpecialID != NULL ? strlen(pSpecialID) / 2 : 0);
+    TGM_CheckpointWrite(&numSpecial, sizeof(uint32_t), snapshot);
+    TGM_CheckpointWrite(pSpecialID, numSpecial * 2, snapshot);
+
+    // the library information table can only be read back with its fragment length info if it has any
+    TGM_LibInfoTableWrite(pLibTable, pLibTable->fragLenMax > 0, snapshot);
+    TGM_CheckpointWrite(pLibTable->pSeqTech, pLibTable->size * sizeof(int8_t), snapshot);
+
+    fclose(snapshot);
+
+    pCheckpoint->hasStaged = TRUE;
+}
+
+void TGM_ReadPairCheckpointCommit(TGM_ReadPairCheckpoint* pCheckpoint, TGM_ReadPairOutFile* pOutFile)
+{
+    if (!pCheckpoint->hasStaged)
+        return;
+
+    uint64_t containerOffset = 0;
+    uint64_t numChunks = 0;
+    const TGM_ReadPairChunk* pChunks = NULL;
+
+    // the read pairs must hit the disk before the manifest says they are there
+    if (pOutFile != NULL)
+    {
+        TGM_ReadPairOutFileFlush(pOutFile);
+
+        containerOffset = pOutFile->currOffset;
+        numChunks = pOutFile->pChunkArray->size;
+        pChunks = pOutFile->pChunkArray->data;
+    }
+
+    FILE* output = fopen(pCheckpoint->tempName, "wb");
+    if (output == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the checkpoint manifest: %s\n", pCheckpoint->tempName);
+
+    uint32_t version = TGM_CHECKPOINT_VERSION;
+    uint64_t numBams = pCheckpoint->pBamArray->size + 1;
+
+    TGM_CheckpointWrite(TGM_CHECKPOINT_MAGIC, sizeof(TGM_CHECKPOINT_MAGIC), output);
+    TGM_CheckpointWrite(&version, sizeof(uint32_t), output);
+    TGM_CheckpointWrite(&numBams, sizeof(uint64_t), output);
+
+    for (uint64_t i = 0; i != numBams; ++i)
+    {
+        const TGM_CheckpointBam* pBam = (i < pCheckpoint->pBamArray->size ? pCheckpoint->pBamArray->data + i : &(pCheckpoint->staged));
+        uint32_t pathLen = strlen(pBam->path);
+
+        TGM_CheckpointWrite(&(pBam->bamType), sizeof(int32_t), output);
+        TGM_CheckpointWrite(&pathLen, sizeof(uint32_t), output);
+        TGM_CheckpointWrite(pBam->path, pathLen, output);
+        TGM_CheckpointWrite(&(pBam->size), sizeof(uint64_t), output);
+        TGM_CheckpointWrite(&(pBam->mtime), sizeof(int64_t), output);
+    }
+
+    uint64_t snapshotSize = pCheckpoint->snapshotSize;
+
+    TGM_CheckpointWrite(&containerOffset, sizeof(uint64_t), output);
+    TGM_CheckpointWrite(&numChunks, sizeof(uint64_t), output);
+    TGM_CheckpointWrite(pChunks, numChunks * sizeof(TGM_ReadPairChunk), output);
+    TGM_CheckpointWrite(&snapshotSize, sizeof(uint64_t), output);
+    TGM_CheckpointWrite(pCheckpoint->pSnapshot, snapshotSize, output);
+
+    if (fflush(output) != 0 || fsync(fileno(output)) != 0)
+        TGM_ErrQuit("ERROR: Cannot flush the checkpoint manifest.\n");
+
+    fclose(output);
+
+    // rename is atomic so the manifest is either the old one or the new one
+    if (rename(pCheckpoint->tempName, pCheckpoint->manifestName) != 0)
+        TGM_ErrQuit("ERROR: Cannot update the checkpoint manifest: %s\n", pCheckpoint->manifestName);
+
+    TGM_ARRAY_PUSH(pCheckpoint->pBamArray, &(pCheckpoint->staged), TGM_CheckpointBam);
+
+    pCheckpoint->staged.path = NULL;
+    pCheckpoint->hasStaged = FALSE;
+}
+
+uint64_t TGM_ReadPairCheckpointCount(const TGM_ReadPairCheckpoint* pCheckpoint, TGM_CheckpointBamType bamType)
+{
+    uint64_t count = 0;
+    for (uint64_t i = 0; i != pCheckpoint->pBamArray->size; ++i)
+    {
+        if (pCheckpoint->pBamArray->data[i].bamType == bamType)
+            ++count;
+    }
+
+    return count;
+}
@@ -0,0 +1,202 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairCheckpoint.h
+ *
+ *    Description:  checkpoint and resume of the read pair build
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_READPAIRCHECKPOINT_H
+#define  TGM_READPAIRCHECKPOINT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "TGM_Types.h"
+#include "TGM_LibInfo.h"
+#include "TGM_ReadPairFile.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// version of the checkpoint manifest format
+#define TGM_CHECKPOINT_VERSION 1
+
+// type of the bam files
+typedef enum
+{
+    TGM_PRIMARY_BAM = 0,
+
+    TGM_SPLIT_BAM = 1
+
+}TGM_CheckpointBamType;
+
+// a bam file that has been processed
+typedef struct TGM_CheckpointBam
+{
+    char* path;                         // path of the bam file
+
+    uint64_t size;                      // size of the bam file
+
+    int64_t mtime;                      // modification time of the bam file
+
+    int32_t bamType;                    // primary or split bam
+
+}TGM_CheckpointBam;
+
+typedef struct TGM_CheckpointBamArray
+{
+    TGM_CheckpointBam* data;            // processed bam files
+
+    uint64_t size;                      // number of processed bam files
+
+    uint64_t capacity;                  // capacity of the array
+
+}TGM_CheckpointBamArray;
+
+// checkpoint of the read pair build
+typedef struct TGM_ReadPairCheckpoint
+{
+    char* manifestName;                 // name of the manifest file
+
+    char* tempName;                     // name of the temporary manifest file
+
+    TGM_CheckpointBamArray* pBamArray;  // bam files committed in the manifest
+
+    uint64_t numChecked[2];             // number of primary and split bam files checked against the manifest
+
+    TGM_CheckpointBam staged;           // the bam file waiting for its read pairs to be written
+
+    TGM_Bool hasStaged;                 // do we have a staged bam file
+
+    char* pSnapshot;                    // serialized build state at the end of the staged bam file
+
+    size_t snapshotSize;                // size of the serialized build state
+
+    uint64_t histOffset;                // size of the fragment length histogram file
+
+    uint64_t containerOffset;           // committed size of the read pair container (loaded from the manifest)
+
+    TGM_ReadPairChunkArray* pChunkArray;  // committed chunk index of the read pair container (loaded from the manifest)
+
+    char* pSpecialID;                   // special reference names (loaded from the manifest)
+
+    TGM_LibInfoTable* pLibTable;        // library information table (loaded from the manifest)
+
+}TGM_ReadPairCheckpoint;
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+//================================================================
+// function:
+//      create a checkpoint object for the working directory. if
+//      we are not resuming, the old manifest is removed
+//
+// args:
+//      1. workingDir: the working directory for the detector
+//      2. resume: resume from the manifest or not
+//
+// return:
+//      a pointer to the checkpoint object
+//================================================================
+TGM_ReadPairCheckpoint* TGM_ReadPairCheckpointAlloc(const char* workingDir, TGM_Bool resume);
+
+void TGM_ReadPairCheckpointFree(TGM_ReadPairCheckpoint* pCheckpoint);
+
+
+//======================
+// Interface functions
+//======================
+
+//================================================================
+// function:
+//      load the manifest from the working directory
+//
+// args:
+//      1. pCheckpoint: a pointer to the checkpoint object
+//
+// return:
+//      TGM_OK if a manifest is loaded; TGM_EOF if there is no
+//      manifest
+//================================================================
+TGM_Status TGM_ReadPairCheckpointLoad(TGM_ReadPairCheckpoint* pCheckpoint);
+
+//================================================================
+// function:
+//      check if a bam file was committed in the manifest. the
+//      bam files must be checked in the order of the bam list.
+//      a bam file that does not match the manifest record at
+//      the same position (path, size or modification time)
+//      is a fatal error
+//
+// args:
+//      1. pCheckpoint: a pointer to the checkpoint object
+//      2. bamFileName: the name of the bam file
+//      3. bamType: primary or split bam
+//
+// return:
+//      TRUE if the bam file can be skipped
+//================================================================
+TGM_Bool TGM_ReadPairCheckpointIsDone(TGM_ReadPairCheckpoint* pCheckpoint, const char* bamFileName, TGM_CheckpointBamType bamType);
+
+//================================================================
+// function:
+//      record the build state at the end of a bam file. it is
+//      committed with the next call of
+//      TGM_ReadPairCheckpointCommit once its read pairs are in
+//      the read pair container
+//
+// args:
+//      1. pCheckpoint: a pointer to the checkpoint object
+//      2. bamFileName: the name of the bam file
+//      3. bamType: primary or split bam
+//      4. pLibTable: a pointer to the library information table
+//      5. pSpecialID: special reference names (can be NULL)
+//      6. histOutput: the fragment length histogram file (NULL
+//                     for split bam files)
+//================================================================
+void TGM_ReadPairCheckpointStage(TGM_ReadPairCheckpoint* pCheckpoint, const char* bamFileName, TGM_CheckpointBamType bamType,
+                                 const TGM_LibInfoTable* pLibTable, const char* pSpecialID, FILE* histOutput);
+
+//================================================================
+// function:
+//      flush the read pair container and atomically replace the
+//      manifest so that it includes the staged bam file. the
+//      writer thread must not hold any read pairs of a later
+//      bam file
+//
+// args:
+//      1. pCheckpoint: a pointer to the checkpoint object
+//      2. pOutFile: a pointer to the read pair container (can
+//                   be NULL)
+//================================================================
+void TGM_ReadPairCheckpointCommit(TGM_ReadPairCheckpoint* pCheckpoint, TGM_ReadPairOutFile* pOutFile);
+
+//================================================================
+// function:
+//      get the number of committed bam files of a given type
+//
+// args:
+//      1. pCheckpoint: a pointer to the checkpoint object
+//      2. bamType: primary or split bam
+//
+// return:
+//      number of committed bam files
+//================================================================
+uint64_t TGM_ReadPairCheckpointCount(const TGM_ReadPairCheckpoint* pCheckpoint, TGM_CheckpointBamType bamType);
+
+#endif  /*TGM_READPAIRCHECKPOINT_H*/
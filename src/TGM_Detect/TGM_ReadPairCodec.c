@@ -0,0 +1,479 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairCodec.c
+ *
+ *    Description:  compressed encoding of the read pair records
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "TGM_Error.h"
+#include "TGM_ReadPairBuild.h"
+#include "TGM_ReadPairCodec.h"
+
+// every field is packed into a zigzag varint of at most 5 bytes
+// and no record has more than 16 fields
+#define TGM_RP_MAX_PACKED_RECORD 80
+
+// size of the uncompressed length stored in front of a block
+#define TGM_RP_BLOCK_HEADER_SIZE sizeof(uint32_t)
+
+// read cursor in a packed block
+typedef struct TGM_PackedReader
+{
+    const uint8_t* pCurr;
+
+    const uint8_t* pEnd;
+
+}TGM_PackedReader;
+
+static inline uint8_t* TGM_PutSigned(uint8_t* pCurr, int64_t value)
+{
+    uint64_t zigzag = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+
+    while (zigzag >= 0x80)
+    {
+        *pCurr++ = (uint8_t) (zigzag | 0x80);
+        zigzag >>= 7;
+    }
+
+    *pCurr++ = (uint8_t) zigzag;
+
+    return pCurr;
+}
+
+static inline int64_t TGM_GetSigned(TGM_PackedReader* pReader)
+{
+    uint64_t zigzag = 0;
+    unsigned int shift = 0;
+
+    while (TRUE)
+    {
+        if (pReader->pCurr == pReader->pEnd || shift > 63)
+            TGM_ErrQuit("ERROR: Corrupted compressed block in the read pair file.\n");
+
+        uint8_t byte = *pReader->pCurr++;
+        zigzag |= (uint64_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            break;
+
+        shift += 7;
+    }
+
+    return (int64_t) (zigzag >> 1) ^ -((int64_t) (zigzag & 1));
+}
+
+static uint8_t* TGM_LocalPairPack(uint8_t* pCurr, const TGM_LocalPair* pLocalPair, int32_t refID, int32_t* pLastPos)
+{
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pLocalPair->upPos - *pLastPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pLocalPair->upEnd - pLocalPair->upPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pLocalPair->downPos - pLocalPair->upPos);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->fragLen);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pLocalPair->refID - refID);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->readGrpID);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->upMapQ);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->downMapQ);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->upNumMM);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->downNumMM);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->fragLenQual);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->readPairType);
+    pCurr = TGM_PutSigned(pCurr, pLocalPair->pairMode);
+
+    *pLastPos = pLocalPair->upPos;
+
+    return pCurr;
+}
+
+static void TGM_LocalPairUnpack(TGM_LocalPair* pLocalPair, TGM_PackedReader* pReader, int32_t refID, int32_t* pLastPos)
+{
+    pLocalPair->upPos = *pLastPos + TGM_GetSigned(pReader);
+    pLocalPair->upEnd = pLocalPair->upPos + TGM_GetSigned(pReader);
+    pLocalPair->downPos = pLocalPair->upPos + TGM_GetSigned(pReader);
+    pLocalPair->fragLen = TGM_GetSigned(pReader);
+    pLocalPair->refID = refID + TGM_GetSigned(pReader);
+    pLocalPair->readGrpID = TGM_GetSigned(pReader);
+    pLocalPair->upMapQ = TGM_GetSigned(pReader);
+    pLocalPair->downMapQ = TGM_GetSigned(pReader);
+    pLocalPair->upNumMM = TGM_GetSigned(pReader);
+    pLocalPair->downNumMM = TGM_GetSigned(pReader);
+    pLocalPair->fragLenQual = TGM_GetSigned(pReader);
+    pLocalPair->readPairType = TGM_GetSigned(pReader);
+    pLocalPair->pairMode = TGM_GetSigned(pReader);
+
+    *pLastPos = pLocalPair->upPos;
+}
+
+static uint8_t* TGM_CrossPairPack(uint8_t* pCurr, const TGM_CrossPair* pCrossPair, int32_t refID, int32_t* pLastPos)
+{
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pCrossPair->upPos - *pLastPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pCrossPair->upEnd - pCrossPair->upPos);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->downPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pCrossPair->downEnd - pCrossPair->downPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pCrossPair->upRefID - refID);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->downRefID);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->readGrpID);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->upMapQ);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->downMapQ);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->upNumMM);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->downNumMM);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->fragLenQual);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->readPairType);
+    pCurr = TGM_PutSigned(pCurr, pCrossPair->pairMode);
+
+    *pLastPos = pCrossPair->upPos;
+
+    return pCurr;
+}
+
+static void TGM_CrossPairUnpack(TGM_CrossPair* pCrossPair, TGM_PackedReader* pReader, int32_t refID, int32_t* pLastPos)
+{
+    pCrossPair->upPos = *pLastPos + TGM_GetSigned(pReader);
+    pCrossPair->upEnd = pCrossPair->upPos + TGM_GetSigned(pReader);
+    pCrossPair->downPos = TGM_GetSigned(pReader);
+    pCrossPair->downEnd = pCrossPair->downPos + TGM_GetSigned(pReader);
+    pCrossPair->upRefID = refID + TGM_GetSigned(pReader);
+    pCrossPair->downRefID = TGM_GetSigned(pReader);
+    pCrossPair->readGrpID = TGM_GetSigned(pReader);
+    pCrossPair->upMapQ = TGM_GetSigned(pReader);
+    pCrossPair->downMapQ = TGM_GetSigned(pReader);
+    pCrossPair->upNumMM = TGM_GetSigned(pReader);
+    pCrossPair->downNumMM = TGM_GetSigned(pReader);
+    pCrossPair->fragLenQual = TGM_GetSigned(pReader);
+    pCrossPair->readPairType = TGM_GetSigned(pReader);
+    pCrossPair->pairMode = TGM_GetSigned(pReader);
+
+    *pLastPos = pCrossPair->upPos;
+}
+
+static uint8_t* TGM_SpecialPairPack(uint8_t* pCurr, const TGM_SpecialPair* pSpecialPair, int32_t refID, int32_t* pLastPos)
+{
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->pos[0] - *pLastPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->end[0] - pSpecialPair->pos[0]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->pos[1] - pSpecialPair->pos[0]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->end[1] - pSpecialPair->pos[1]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->refID[0] - refID);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSpecialPair->refID[1] - refID);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->readGrpID);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->numMM[0]);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->numMM[1]);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->bestMQ[0]);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->bestMQ[1]);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->numSpeicalHits);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->specialID);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->readPairType);
+    pCurr = TGM_PutSigned(pCurr, pSpecialPair->pairMode);
+
+    *pLastPos = pSpecialPair->pos[0];
+
+    return pCurr;
+}
+
+static void TGM_SpecialPairUnpack(TGM_SpecialPair* pSpecialPair, TGM_PackedReader* pReader, int32_t refID, int32_t* pLastPos)
+{
+    pSpecialPair->pos[0] = *pLastPos + TGM_GetSigned(pReader);
+    pSpecialPair->end[0] = pSpecialPair->pos[0] + TGM_GetSigned(pReader);
+    pSpecialPair->pos[1] = pSpecialPair->pos[0] + TGM_GetSigned(pReader);
+    pSpecialPair->end[1] = pSpecialPair->pos[1] + TGM_GetSigned(pReader);
+    pSpecialPair->refID[0] = refID + TGM_GetSigned(pReader);
+    pSpecialPair->refID[1] = refID + TGM_GetSigned(pReader);
+    pSpecialPair->readGrpID = TGM_GetSigned(pReader);
+    pSpecialPair->numMM[0] = TGM_GetSigned(pReader);
+    pSpecialPair->numMM[1] = TGM_GetSigned(pReader);
+    pSpecialPair->bestMQ[0] = TGM_GetSigned(pReader);
+    pSpecialPair->bestMQ[1] = TGM_GetSigned(pReader);
+    pSpecialPair->numSpeicalHits = TGM_GetSigned(pReader);
+    pSpecialPair->specialID = TGM_GetSigned(pReader);
+    pSpecialPair->readPairType = TGM_GetSigned(pReader);
+    pSpecialPair->pairMode = TGM_GetSigned(pReader);
+
+    *pLastPos = pSpecialPair->pos[0];
+}
+
+static uint8_t* TGM_SplitPairPack(uint8_t* pCurr, const TGM_SplitPair* pSplitPair, int32_t refID, int32_t* pLastPos)
+{
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->pos[0] - *pLastPos);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->end[0] - pSplitPair->pos[0]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->pos[1] - pSplitPair->pos[0]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->end[1] - pSplitPair->pos[1]);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->refID[0] - refID);
+    pCurr = TGM_PutSigned(pCurr, (int64_t) pSplitPair->refID[1] - refID);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->readGrpID);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->numMM[0]);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->numMM[1]);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->bestMQ[0]);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->bestMQ[1]);
+    pCurr = TGM_PutSigned(pCurr, pSplitPair->readPairType);
+
+    *pLastPos = pSplitPair->pos[0];
+
+    return pCurr;
+}
+
+static void TGM_SplitPairUnpack(TGM_SplitPair* pSplitPair, TGM_PackedReader* pReader, int32_t refID, int32_t* pLastPos)
+{
+    pSplitPair->pos[0] = *pLastPos + TGM_GetSigned(pReader);
+    pSplitPair->end[0] = pSplitPair->pos[0] + TGM_GetSigned(pReader);
+    pSplitPair->pos[1] = pSplitPair->pos[0] + TGM_GetSigned(pReader);
+    pSplitPair->end[1] = pSplitPair->pos[1] + TGM_GetSigned(pReader);
+    pSplitPair->refID[0] = refID + TGM_GetSigned(pReader);
+    pSplitPair->refID[1] = refID + TGM_GetSigned(pReader);
+    pSplitPair->readGrpID = TGM_GetSigned(pReader);
+    pSplitPair->numMM[0] = TGM_GetSigned(pReader);
+    pSplitPair->numMM[1] = TGM_GetSigned(pReader);
+    pSplitPair->bestMQ[0] = TGM_GetSigned(pReader);
+    pSplitPair->bestMQ[1] = TGM_GetSigned(pReader);
+    pSplitPair->readPairType = TGM_GetSigned(pReader);
+
+    *pLastPos = pSplitPair->pos[0];
+}
+
+// make sure a codec buffer can hold a given number of bytes
+static void* TGM_CodecBuffReserve(void* pBuff, uint64_t* pCapacity, uint64_t size)
+{
+    if (size > *pCapacity)
+    {
+        free(pBuff);
+        pBuff = malloc(size);
+        if (pBuff == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the read pair codec buffer.\n");
+
+        *pCapacity = size;
+    }
+
+    return pBuff;
+}
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_ReadPairCodecBuff* TGM_ReadPairCodecBuffAlloc(void)
+{
+    TGM_ReadPairCodecBuff* pCodecBuff = (TGM_ReadPairCodecBuff*) calloc(1, sizeof(TGM_ReadPairCodecBuff));
+    if (pCodecBuff == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a read pair codec buffer object.\n");
+
+    return pCodecBuff;
+}
+
+void TGM_ReadPairCodecBuffFree(TGM_ReadPairCodecBuff* pCodecBuff)
+{
+    if (pCodecBuff != NULL)
+    {
+        free(pCodecBuff->pRecords);
+        free(pCodecBuff->pKeys);
+        free(pCodecBuff->pPacked);
+        free(pCodecBuff->pZipped);
+
+        free(pCodecBuff);
+    }
+}
+
+
+//======================
+// Interface functions
+//======================
+
+size_t TGM_ReadPairRecordSize(TGM_ReadPairChunkType chunkType)
+{
+    switch (chunkType)
+    {
+        case TGM_LONG_PAIR_CHUNK:
+        case TGM_SHORT_PAIR_CHUNK:
+        case TGM_REVERSED_PAIR_CHUNK:
+        case TGM_INVERTED_PAIR_CHUNK:
+            return sizeof(TGM_LocalPair);
+        case TGM_SPECIAL_PAIR_CHUNK:
+            return sizeof(TGM_SpecialPair);
+        case TGM_CROSS_PAIR_CHUNK:
+            return sizeof(TGM_CrossPair);
+        case TGM_SPLIT_LONG_CHUNK:
+        case TGM_SPLIT_SHORT_CHUNK:
+        case TGM_SPLIT_REVERSED_CHUNK:
+        case TGM_SPLIT_INVERTED_CHUNK:
+        case TGM_SPLIT_SPECIAL_CHUNK:
+            return sizeof(TGM_SplitPair);
+        default:
+            TGM_ErrQuit("ERROR: Unknown chunk type in the read pair file: %d.\n", chunkType);
+    }
+
+    return 0;
+}
+
+int32_t TGM_ReadPairRecordPos(const void* pRecord, TGM_ReadPairChunkType chunkType)
+{
+    switch (chunkType)
+    {
+        case TGM_LONG_PAIR_CHUNK:
+        case TGM_SHORT_PAIR_CHUNK:
+        case TGM_REVERSED_PAIR_CHUNK:
+        case TGM_INVERTED_PAIR_CHUNK:
+            return ((const TGM_LocalPair*) pRecord)->upPos;
+        case TGM_CROSS_PAIR_CHUNK:
+            return ((const TGM_CrossPair*) pRecord)->upPos;
+        case TGM_SPECIAL_PAIR_CHUNK:
+            return ((const TGM_SpecialPair*) pRecord)->pos[0];
+        default:
+            return ((const TGM_SplitPair*) pRecord)->pos[0];
+    }
+}
+
+uint64_t TGM_ReadPairBlockEncode(const uint8_t** ppBlock, TGM_ReadPairCodecBuff* pCodecBuff, int32_t refID, TGM_ReadPairChunkType chunkType,
+                                 const void* pData, uint64_t numPairs, int level)
+{
+    size_t recordSize = TGM_ReadPairRecordSize(chunkType);
+
+    pCodecBuff->pRecords = TGM_CodecBuffReserve(pCodecBuff->pRecords, &(pCodecBuff->recordsCap), recordSize * numPairs);
+    pCodecBuff->pPacked = TGM_CodecBuffReserve(pCodecBuff->pPacked, &(pCodecBuff->packedCap), TGM_RP_MAX_PACKED_RECORD * numPairs);
+
+    pCodecBuff->pKeys = TGM_CodecBuffReserve(pCodecBuff->pKeys, &(pCodecBuff->keysCap), 2 * sizeof(TGM_SortKey) * numPairs);
+
+    // stable sort by position so that pairs at the same position keep
+    // the order they have in a raw chunk
+    TGM_SortKey* pKeys = pCodecBuff->pKeys;
+    for (uint64_t i = 0; i != numPairs; ++i)
+    {
+        pKeys[i].key = (uint32_t) TGM_ReadPairRecordPos((const char*) pData + recordSize * i, chunkType);
+        pKeys[i].index = i;
+    }
+
+    const TGM_SortKey* pSorted = TGM_RadixSortKeys(pKeys, pKeys + numPairs, numPairs);
+    for (uint64_t i = 0; i != numPairs; ++i)
+        memcpy((char*) pCodecBuff->pRecords + recordSize * i, (const char*) pData + recordSize * pSorted[i].index, recordSize);
+
+    uint8_t* pCurr = pCodecBuff->pPacked;
+    int32_t lastPos = 0;
+
+    switch (chunkType)
+    {
+        case TGM_LONG_PAIR_CHUNK:
+        case TGM_SHORT_PAIR_CHUNK:
+        case TGM_REVERSED_PAIR_CHUNK:
+        case TGM_INVERTED_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                pCurr = TGM_LocalPairPack(pCurr, (const TGM_LocalPair*) pCodecBuff->pRecords + i, refID, &lastPos);
+            break;
+        case TGM_CROSS_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                pCurr = TGM_CrossPairPack(pCurr, (const TGM_CrossPair*) pCodecBuff->pRecords + i, refID, &lastPos);
+            break;
+        case TGM_SPECIAL_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                pCurr = TGM_SpecialPairPack(pCurr, (const TGM_SpecialPair*) pCodecBuff->pRecords + i, refID, &lastPos);
+            break;
+        default:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                pCurr = TGM_SplitPairPack(pCurr, (const TGM_SplitPair*) pCodecBuff->pRecords + i, refID, &lastPos);
+            break;
+    }
+
+    uint32_t packedSize = pCurr - pCodecBuff->pPacked;
+    uLongf zippedSize = compressBound(packedSize);
+
+    pCodecBuff->pZipped = TGM_CodecBuffReserve(pCodecBuff->pZipped, &(pCodecBuff->zippedCap), TGM_RP_BLOCK_HEADER_SIZE + zippedSize);
+
+    if (compress2(pCodecBuff->pZipped + TGM_RP_BLOCK_HEADER_SIZE, &zippedSize, pCodecBuff->pPacked, packedSize, level) != Z_OK)
+        TGM_ErrQuit("ERROR: Cannot compress the read pairs.\n");
+
+    memcpy(pCodecBuff->pZipped, &packedSize, TGM_RP_BLOCK_HEADER_SIZE);
+
+    *ppBlock = pCodecBuff->pZipped;
+
+    return TGM_RP_BLOCK_HEADER_SIZE + zippedSize;
+}
+
+void TGM_ReadPairBlockDecode(void* pDst, TGM_ReadPairCodecBuff* pCodecBuff, const uint8_t* pBlock, uint64_t blockSize,
+                             int32_t refID, TGM_ReadPairChunkType chunkType, uint64_t numPairs)
+{
+    uint32_t packedSize = 0;
+    if (blockSize < TGM_RP_BLOCK_HEADER_SIZE)
+        TGM_ErrQuit("ERROR: Corrupted compressed block in the read pair file.\n");
+
+    memcpy(&packedSize, pBlock, TGM_RP_BLOCK_HEADER_SIZE);
+    if (packedSize > TGM_RP_MAX_PACKED_RECORD * numPairs)
+        TGM_ErrQuit("ERROR: Corrupted compressed block in the read pair file.\n");
+
+    pCodecBuff->pPacked = TGM_CodecBuffReserve(pCodecBuff->pPacked, &(pCodecBuff->packedCap), packedSize);
+
+    uLongf unzippedSize = packedSize;
+    if (uncompress(pCodecBuff->pPacked, &unzippedSize, pBlock + TGM_RP_BLOCK_HEADER_SIZE, blockSize - TGM_RP_BLOCK_HEADER_SIZE) != Z_OK
+        || unzippedSize != packedSize)
+    {
+        TGM_ErrQuit("ERROR: Cannot decompress the read pairs.\n");
+    }
+
+    TGM_PackedReader reader = {pCodecBuff->pPacked, pCodecBuff->pPacked + packedSize};
+    int32_t lastPos = 0;
+
+    // clear the padding bytes so that the decoded records are identical to the raw ones
+    memset(pDst, 0, TGM_ReadPairRecordSize(chunkType) * numPairs);
+
+    switch (chunkType)
+    {
+        case TGM_LONG_PAIR_CHUNK:
+        case TGM_SHORT_PAIR_CHUNK:
+        case TGM_REVERSED_PAIR_CHUNK:
+        case TGM_INVERTED_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                TGM_LocalPairUnpack((TGM_LocalPair*) pDst + i, &reader, refID, &lastPos);
+            break;
+        case TGM_CROSS_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                TGM_CrossPairUnpack((TGM_CrossPair*) pDst + i, &reader, refID, &lastPos);
+            break;
+        case TGM_SPECIAL_PAIR_CHUNK:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                TGM_SpecialPairUnpack((TGM_SpecialPair*) pDst + i, &reader, refID, &lastPos);
+            break;
+        default:
+            for (uint64_t i = 0; i != numPairs; ++i)
+                TGM_SplitPairUnpack((TGM_SplitPair*) pDst + i, &reader, refID, &lastPos);
+            break;
+    }
+
+    if (reader.pCurr != reader.pEnd)
+        TGM_ErrQuit("ERROR: Corrupted compressed block in the read pair file.\n");
+}
+
+int32_t TGM_ReadPairBlockStartPos(const uint8_t* pBlock, uint64_t blockSize)
+{
+    if (blockSize < TGM_RP_BLOCK_HEADER_SIZE)
+        TGM_ErrQuit("ERROR: Corrupted compressed block in the read pair file.\n");
+
+    // the first field of every record type is its position packed as the delta from zero
+    uint8_t packed[16];
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(z_stream));
+    if (inflateInit(&stream) != Z_OK)
+        TGM_ErrQuit("ERROR: Cannot decompress the read pairs.\n");
+
+    stream.next_in = (Bytef*) (pBlock + TGM_RP_BLOCK_HEADER_SIZE);
+    stream.avail_in = blockSize - TGM_RP_BLOCK_HEADER_SIZE;
+    stream.next_out = packed;
+    stream.avail_out = sizeof(packed);
+
+    int ret = inflate(&stream, Z_SYNC_FLUSH);
+    uint64_t packedSize = sizeof(packed) - stream.avail_out;
+    inflateEnd(&stream);
+
+    if ((ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) || packedSize == 0)
+        TGM_ErrQuit("ERROR: Cannot decompress the read pairs.\n");
+
+    TGM_PackedReader reader = {packed, packed + packedSize};
+
+    return TGM_GetSigned(&reader);
+}
@@ -0,0 +1,153 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairCodec.h
+ *
+ *    Description:  compressed encoding of the read pair records
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_READPAIRCODEC_H
+#define  TGM_READPAIRCODEC_H
+
+#include <stdint.h>
+
+#include "TGM_Types.h"
+#include "TGM_Utilities.h"
+#include "TGM_ReadPairFile.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// maximum number of read pairs in a compressed block
+#define TGM_RP_CODEC_BLOCK_PAIRS 16384
+
+// buffers used to encode or decode a block of read pairs
+typedef struct TGM_ReadPairCodecBuff
+{
+    void* pRecords;                 // position sorted copy of the read pairs in a block
+
+    uint64_t recordsCap;            // capacity (in bytes) of the record buffer
+
+    TGM_SortKey* pKeys;             // position keys of the read pairs in a block and the sort buffer
+
+    uint64_t keysCap;               // capacity (in bytes) of the key buffer
+
+    uint8_t* pPacked;               // varint packed read pairs
+
+    uint64_t packedCap;             // capacity (in bytes) of the packed buffer
+
+    uint8_t* pZipped;               // compressed block
+
+    uint64_t zippedCap;             // capacity (in bytes) of the compressed buffer
+
+}TGM_ReadPairCodecBuff;
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_ReadPairCodecBuff* TGM_ReadPairCodecBuffAlloc(void);
+
+void TGM_ReadPairCodecBuffFree(TGM_ReadPairCodecBuff* pCodecBuff);
+
+
+//======================
+// Interface functions
+//======================
+
+//================================================================
+// function:
+//      get the record size of a given chunk type
+//
+// args:
+//      1. chunkType: read pair type of the chunk
+//
+// return:
+//      size of a read pair record
+//================================================================
+size_t TGM_ReadPairRecordSize(TGM_ReadPairChunkType chunkType);
+
+//================================================================
+// function:
+//      get the position a read pair record is sorted by in a
+//      compressed block
+//
+// args:
+//      1. pRecord: a pointer to the read pair record
+//      2. chunkType: read pair type of the record
+//
+// return:
+//      position of the read pair
+//================================================================
+int32_t TGM_ReadPairRecordPos(const void* pRecord, TGM_ReadPairChunkType chunkType);
+
+//================================================================
+// function:
+//      encode a block of read pairs: sort them by position,
+//      delta-encode the positions, store the ends as lengths,
+//      varint-pack all the fields and compress the result
+//      with zlib
+//
+// args:
+//      1. ppBlock: output pointer to the encoded block (owned
+//                  by the codec buffer)
+//      2. pCodecBuff: a pointer to the codec buffers
+//      3. refID: reference ID of the read pairs
+//      4. chunkType: read pair type of the block
+//      5. pData: a pointer to the read pairs
+//      6. numPairs: number of read pairs (no more than
+//                   TGM_RP_CODEC_BLOCK_PAIRS)
+//      7. level: zlib compression level
+//
+// return:
+//      number of bytes of the encoded block
+//================================================================
+uint64_t TGM_ReadPairBlockEncode(const uint8_t** ppBlock, TGM_ReadPairCodecBuff* pCodecBuff, int32_t refID, TGM_ReadPairChunkType chunkType,
+                                 const void* pData, uint64_t numPairs, int level);
+
+//================================================================
+// function:
+//      decode a block of read pairs encoded by
+//      TGM_ReadPairBlockEncode
+//
+// args:
+//      1. pDst: buffer large enough to hold all the read pairs
+//               of the block
+//      2. pCodecBuff: a pointer to the codec buffers
+//      3. pBlock: a pointer to the encoded block
+//      4. blockSize: number of bytes of the encoded block
+//      5. refID: reference ID of the read pairs
+//      6. chunkType: read pair type of the block
+//      7. numPairs: number of read pairs in the block
+//================================================================
+void TGM_ReadPairBlockDecode(void* pDst, TGM_ReadPairCodecBuff* pCodecBuff, const uint8_t* pBlock, uint64_t blockSize,
+                             int32_t refID, TGM_ReadPairChunkType chunkType, uint64_t numPairs);
+
+//================================================================
+// function:
+//      get the smallest position in a block of read pairs encoded
+//      by TGM_ReadPairBlockEncode. only the first bytes of the
+//      block are decompressed
+//
+// args:
+//      1. pBlock: a pointer to the encoded block
+//      2. blockSize: number of bytes of the encoded block
+//
+// return:
+//      position of the first read pair in the block
+//================================================================
+int32_t TGM_ReadPairBlockStartPos(const uint8_t* pBlock, uint64_t blockSize);
+
+#endif  /*TGM_READPAIRCODEC_H*/
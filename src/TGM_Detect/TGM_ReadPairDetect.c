@@ -23,35 +23,270 @@
 #include "TGM_Utilities.h"
 #include "TGM_ReadPairDetect.h"
 #include "TGM_ReadPairAttrbt.h"
+#include "TGM_ReadPairCodec.h"
+#include "TGM_EventGenotype.h"
+#include "TGM_DetectCache.h"
 
 #define DEFAULT_SV_CAPACITY 50
 
-static const char* TGM_LibTableFileName = "lib_table.dat";
+#define DEFAULT_SPECIAL_ID_CAPACITY 10
 
-static const char* TGM_READ_PAIR_FILE_NAME_TEMPLATE[] = 
-{
-    "refXXX_long_pairs.dat",
+#define DEFAULT_JOB_DEQUE_CAPACITY 16
+
+// minimum number of special pairs in a job before it is split into sub-jobs
+#define MIN_SPLIT_JOB_PAIRS 4096
+
+// a job is only split at a gap of this many times the maximum fragment length
+#define SPLIT_GAP_FRAG_LEN_SCALE 4
 
-    "refXXX_short_pairs.dat",
+// a streamed window of special pairs without such a gap is cut after this many times the maximum fragment length
+#define WINDOW_FRAG_LEN_SCALE 16
 
-    "refXXX_reversed_pairs.dat",
+// the local pair chunks (long, short, reversed and inverted pairs) are the first chunk types
+#define NUM_LOCAL_PAIR_CHUNK (TGM_INVERTED_PAIR_CHUNK + 1)
 
-    "refXXX_inverted_pairs.dat",
+// the SV types handled by the local engine. they all work on the read pairs anchored on one reference
+#define LOCAL_SV_SET ((1 << SV_DELETION) | (1 << SV_TANDEM_DUP) | (1 << SV_INVERSION) | (1 << SV_INTER_CHR_TRNSLCTN))
 
-    "refXXX_special_pairs.dat",
+// number of SV types handled by the local engine
+#define NUM_LOCAL_SV_TYPE 4
 
-    "refXXX_cross_pairs.dat",
-};
+// the local SV types and the read pairs they cluster
+static const SV_EventType TGM_LocalEventTypes[NUM_LOCAL_SV_TYPE] = {SV_DELETION, SV_TANDEM_DUP, SV_INVERSION, SV_INTER_CHR_TRNSLCTN};
+
+static const uint32_t TGM_LocalEventChunks[NUM_LOCAL_SV_TYPE] = {(1 << TGM_LONG_PAIR_CHUNK), (1 << TGM_SHORT_PAIR_CHUNK) | (1 << TGM_REVERSED_PAIR_CHUNK),
+                                                                (1 << TGM_INVERTED_PAIR_CHUNK), (1 << TGM_CROSS_PAIR_CHUNK)};
+
+static const char* TGM_LibTableFileName = "lib_table.dat";
 
 KHASH_MAP_INIT_STR(name, uint32_t);
 
 KHASH_SET_INIT_INT(readGrp);
 
-static void TGM_DelEventMerge(TGM_DelArray* pDelArray, TGM_Cluster* pDelCluster)
+KHASH_MAP_INIT_INT64(crossCell, uint32_t);
+
+struct TGM_DetectEngines;
+
+// special pairs and events of a reference shared by all the detection jobs on that reference
+typedef struct TGM_SpecialRefData
+{
+    TGM_SpecialPairArray* pSpecialPairArray;   // special pairs of the reference (mapped from the container or read into memory)
+
+    uint32_t* pOrder;                          // indices of the special pairs sorted by special ID and position
+
+    TGM_EventBuff** ppEventBuffs;              // formatted events of each job waiting to be written
+
+    uint64_t* pJobKeys;                        // special ID and first position of each job of a streamed reference
+
+    TGM_DetectCacheKey* pCacheKey;             // key the events are cached with once they are detected (NULL if they are not cached)
+
+    unsigned int numJobs;                      // number of jobs on the reference
+
+    unsigned int numPending;                   // number of unfinished jobs on the reference
+
+    uint64_t numBytes;                         // memory taken by the special pairs of the reference
+
+    TGM_Bool isLoaded;                         // are the jobs of the reference created
+
+}TGM_SpecialRefData;
+
+// special pairs of a streamed reference between two position gaps that no cluster or merged event
+// can span, or a piece of at most a few maximum fragment lengths cut out of a dense region. a window
+// holds the pairs of one special reference and is freed as soon as it is clustered
+typedef struct TGM_SpecialWindow
+{
+    TGM_SpecialRefData* pRefData;              // reference the window belongs to
+
+    TGM_SpecialPairArray* pSpecialPairArray;   // special pairs of the window in position order
+
+    uint32_t* pOrder;                          // indices of the special pairs sorted by position and alignment length
+
+    int64_t ownBegin;                          // the window only keeps the events starting in [ownBegin, ownEnd)
+
+    int64_t ownEnd;
+
+    uint64_t numBytes;                         // memory taken by the window
+
+}TGM_SpecialWindow;
+
+// windows of one special reference being cut by the streaming loader. a cut window keeps taking the
+// special pairs of the halo behind its cut, which also go into the next window
+typedef struct TGM_SpecialWindowCut
+{
+    TGM_SpecialPairArray* pOpen;               // special pairs of the open window (NULL if there is none)
+
+    TGM_SpecialPairArray* pClosing;            // special pairs of the cut window waiting for its halo (NULL if there is none)
+
+    int64_t openBegin;                         // start of the core of the open window (INT64_MIN right after a gap)
+
+    int64_t closingBegin;                      // start of the core of the cut window
+
+    int64_t cutPos;                            // end of the core of the cut window
+
+}TGM_SpecialWindowCut;
+
+// state of the special insertion detection engine
+typedef struct TGM_SpecialDetectPool
+{
+    struct TGM_DetectEngines* pEngines;        // shared state of the detection engines
+
+    const TGM_SpecialID* pSpecialID;           // special reference names
+
+    TGM_SpecialRefData* pRefData;              // data of each working reference
+
+    int32_t* pLoadOrder;                       // working references in decreasing number of special pairs
+
+    uint64_t splitSize;                        // jobs larger than this are split into sub-jobs
+
+    unsigned char cacheDigest[16];             // digest of the parameters the cached events depend on (incremental detection only)
+
+}TGM_SpecialDetectPool;
+
+// local pairs and events of a reference shared by all the detection jobs on that reference
+typedef struct TGM_LocalRefData
+{
+    TGM_LocalPairArray* pLocalPairArrays[NUM_LOCAL_PAIR_CHUNK];  // local pairs of each chunk type (mapped from the container or read into memory)
+
+    uint32_t* pOrders[NUM_LOCAL_PAIR_CHUNK];   // indices of the local pairs sorted by position (tiled references only)
+
+    TGM_CrossPairArray* pCrossPairArray;       // cross pairs whose up mate is on the reference
+
+    TGM_EventBuff** ppEventBuffs;              // formatted events of each job waiting to be written
+
+    TGM_DetectCacheKey* pCacheKey;             // key the events are cached with once they are detected (NULL if they are not cached)
+
+    unsigned int numBuffs;                     // number of event buffers of the reference
+
+    unsigned int numTiles;                     // number of tiles the reference is cut into
+
+    unsigned int numPending;                   // number of unfinished jobs on the reference
+
+    uint64_t numBytes;                         // memory taken by the local and cross pairs of the reference
+
+    TGM_Bool isLoaded;                         // are the jobs of the reference created
+
+}TGM_LocalRefData;
+
+// state of the local SV (deletion, tandem duplication, inversion and translocation) detection engine
+typedef struct TGM_LocalDetectPool
+{
+    struct TGM_DetectEngines* pEngines;        // shared state of the detection engines
+
+    TGM_LocalRefData* pRefData;                // data of each working reference
+
+    int32_t* pLoadOrder;                       // working references in decreasing number of local pairs
+
+    uint32_t detectSet;                        // local SV types to detect
+
+    uint32_t chunkSet;                         // read pair chunk types needed by the SV types
+
+    uint64_t totalCount;                       // number of read pairs needed on all the working references
+
+    unsigned char cacheDigest[16];             // digest of the parameters the cached events depend on (incremental detection only)
+
+}TGM_LocalDetectPool;
+
+// detection engines sharing one job scheduler and one pool of detection threads. each engine
+// has its own loader and the events of all the engines are written in reference order
+typedef struct TGM_DetectEngines
+{
+    const TGM_ReadPairDetectPars* pDetectPars; // detection parameters
+
+    const TGM_LibInfoTable* pLibTable;         // library information table
+
+    TGM_ReadPairInFile* pInFile;               // read pair container
+
+    TGM_DetectScheduler* pScheduler;           // per-thread job queues
+
+    TGM_SpecialDetectPool* pSpecialPool;       // special insertion engine (NULL if not running)
+
+    TGM_LocalDetectPool* pLocalPool;           // local SV engine (NULL if not running)
+
+    unsigned int numThreads;                   // number of detection threads
+
+    unsigned int numRefs;                      // number of working references
+
+    unsigned int numLoaders;                   // number of loaders still pushing jobs
+
+    unsigned int nextOutput;                   // next reference to be written
+
+    TGM_EventWriter* pWriter;                  // event output
+
+    uint32_t sampleFields;                     // per-sample fields of the events
+
+    bam_index_t** ppBamIndices;                // index of each BAM file genotyped (NULL if the events are not genotyped)
+
+}TGM_DetectEngines;
+
+typedef struct TGM_DetectRefCount
+{
+    int32_t refID;                             // reference ID
+
+    uint64_t count;                            // number of read pairs on the reference
+
+}TGM_DetectRefCount;
+
+typedef struct TGM_DetectThread
+{
+    TGM_DetectEngines* pEngines;               // shared state of the detection threads
+
+    unsigned int threadID;                     // index of the job queue owned by the thread
+
+}TGM_DetectThread;
+
+// scratch space of a detection thread reused by the jobs of all the engines
+typedef struct TGM_DetectWorkspace
+{
+    TGM_ReadPairAttrbtArray* pAttrbtArrays[2]; // attributes of the read pairs being clustered
+
+    TGM_Cluster* pClusters[2];                 // cluster engines for the two attribute arrays
+
+    TGM_SpecialPairArray* pMemberPairs;        // special pairs of a compacted cluster
+
+    TGM_SpecialEventArray* pSideEvents;        // 3' and 5' special events before they are merged
+
+    SV_AssistArray* pAssistArray;              // fragment lengths and mapping qualities of a deletion cluster
+
+    TGM_CrossGrid* pCrossGrid;                 // grid hash of the cross pairs
+
+    TGM_LocalPairArray* pTilePairs[2];         // local pairs of a tile and its halo
+
+    TGM_SupportArray* pSupportArray;           // per-sample counts of the events of a job
+
+    TGM_Genotyper* pGenotyper;                 // genotyper of the local events (NULL if the events are not genotyped)
+
+}TGM_DetectWorkspace;
+
+static void TGM_DetectEnginesInit(TGM_DetectEngines* pEngines, const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile);
+
+static void TGM_DetectEnginesRun(TGM_DetectEngines* pEngines);
+
+static void TGM_SpecialDetectPoolInit(TGM_SpecialDetectPool* pPool, TGM_DetectEngines* pEngines, const TGM_SpecialID* pSpecialID);
+
+static void TGM_SpecialDetectPoolDestroy(TGM_SpecialDetectPool* pPool);
+
+static void TGM_LocalDetectPoolInit(TGM_LocalDetectPool* pPool, TGM_DetectEngines* pEngines, uint32_t detectSet);
+
+static void TGM_LocalDetectPoolDestroy(TGM_LocalDetectPool* pPool);
+
+// count the samples supporting an event made from a compacted cluster element. the range is empty if the support is not collected
+static void TGM_EventCountSamples(uint32_t support[2], TGM_SupportArray* pSupportArray, const TGM_Cluster* pCluster, unsigned int index,
+                                  const TGM_LibInfoTable* pLibTable)
+{
+    if (pSupportArray != NULL)
+        TGM_ClusterCountSamples(support, pSupportArray, pCluster, index, pLibTable->pSampleMap);
+    else
+        support[0] = support[1] = 0;
+}
+
+static void TGM_DelEventMerge(TGM_DelArray* pDelArray, TGM_SupportArray* pSupportArray, TGM_Cluster* pDelCluster)
 {
     TGM_DelEvent* pLastEvent = pDelArray->data + (pDelArray->size - 1);
     TGM_DelEvent* pNewEvent = pDelArray->data + pDelArray->size;
 
+    if (pSupportArray != NULL)
+        TGM_SupportArraySum(pLastEvent->support, pSupportArray, pLastEvent->support, pNewEvent->support);
+
     pLastEvent->pos5[0] = (pLastEvent->pos5[0] < pNewEvent->pos5[0] ? pLastEvent->pos5[0] : pNewEvent->pos5[0]);
     pLastEvent->pos5[1] = (pLastEvent->pos5[1] > pNewEvent->pos5[1] ? pLastEvent->pos5[1] : pNewEvent->pos5[1]);
     pLastEvent->pos5[2] = (pLastEvent->pos5[2] > pNewEvent->pos5[2] ? pLastEvent->pos5[2] : pNewEvent->pos5[2]);
@@ -111,107 +346,249 @@ static int CompareDelEvents(const void* pEvent1, const void* pEvent2)
     return 0;
 }
 
-static int CompareSpecialEvents(const void* pEvent1, const void* pEvent2)
+static int CompareDupEvents(const void* pEvent1, const void* pEvent2)
 {
-    const TGM_SpecialEvent* pE1 = pEvent1;
-    const TGM_SpecialEvent* pE2 = pEvent2;
+    const TGM_DupEvent* pE1 = pEvent1;
+    const TGM_DupEvent* pE2 = pEvent2;
 
-    if (pE1->refID < pE2->refID)
+    if (pE1->pos < pE2->pos)
         return -1;
-    else if (pE1->refID > pE2->refID)
+    else if (pE1->pos > pE2->pos)
         return 1;
     else
     {
-        if (pE1->pos < pE2->pos)
+        if (pE1->length < pE2->length)
             return -1;
-        else if (pE1->pos > pE2->pos)
+        else if (pE1->length > pE2->length)
             return 1;
         else
         {
-            if (pE1->length < pE2->length)
+            if (pE1->readPairType < pE2->readPairType)
                 return -1;
-            else if (pE1->length > pE2->length)
+            else if (pE1->readPairType > pE2->readPairType)
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int CompareInvEvents(const void* pEvent1, const void* pEvent2)
+{
+    const TGM_InvEvent* pE1 = pEvent1;
+    const TGM_InvEvent* pE2 = pEvent2;
+
+    if (pE1->pos < pE2->pos)
+        return -1;
+    else if (pE1->pos > pE2->pos)
+        return 1;
+    else
+    {
+        if (pE1->end < pE2->end)
+            return -1;
+        else if (pE1->end > pE2->end)
+            return 1;
+        else
+        {
+            if (pE1->numFrag[0] < pE2->numFrag[0])
+                return -1;
+            else if (pE1->numFrag[0] > pE2->numFrag[0])
                 return 1;
-            else
-                return 0;
         }
     }
 
     return 0;
 }
 
-TGM_DetectJobStack* TGM_DetectJobStackAlloc(unsigned int numThread, unsigned int loadingLimit, const TGM_LibInfoTable* pLibTable)
+static int CompareCrossGridEntries(const void* pEntry1, const void* pEntry2)
+{
+    const TGM_CrossGridEntry* pE1 = pEntry1;
+    const TGM_CrossGridEntry* pE2 = pEntry2;
+
+    if (pE1->group != pE2->group)
+        return (pE1->group < pE2->group ? -1 : 1);
+
+    if (pE1->cell[0] != pE2->cell[0])
+        return (pE1->cell[0] < pE2->cell[0] ? -1 : 1);
+
+    if (pE1->cell[1] != pE2->cell[1])
+        return (pE1->cell[1] < pE2->cell[1] ? -1 : 1);
+
+    if (pE1->index != pE2->index)
+        return (pE1->index < pE2->index ? -1 : 1);
+
+    return 0;
+}
+
+static int CompareTransEvents(const void* pEvent1, const void* pEvent2)
+{
+    const TGM_TransEvent* pE1 = pEvent1;
+    const TGM_TransEvent* pE2 = pEvent2;
+
+    if (pE1->pos[0] != pE2->pos[0])
+        return (pE1->pos[0] < pE2->pos[0] ? -1 : 1);
+
+    if (pE1->refID[1] != pE2->refID[1])
+        return (pE1->refID[1] < pE2->refID[1] ? -1 : 1);
+
+    if (pE1->pos[1] != pE2->pos[1])
+        return (pE1->pos[1] < pE2->pos[1] ? -1 : 1);
+
+    if (pE1->orient != pE2->orient)
+        return (pE1->orient < pE2->orient ? -1 : 1);
+
+    return 0;
+}
+
+TGM_DetectScheduler* TGM_DetectSchedulerAlloc(unsigned int numThread, unsigned int loadingLimit, const TGM_LibInfoTable* pLibTable)
 {
-    TGM_DetectJobStack* pJobStack = (TGM_DetectJobStack*) malloc(sizeof(TGM_DetectJobStack));
-    if (pJobStack == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for a detection job queue.\n");
+    TGM_DetectScheduler* pScheduler = (TGM_DetectScheduler*) malloc(sizeof(TGM_DetectScheduler));
+    if (pScheduler == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a detection job scheduler.\n");
 
-    pJobStack->pJobs = (TGM_DetectJob*) calloc(sizeof(TGM_DetectJob), 2 * numThread);
-    if (pJobStack->pJobs == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for a detection job queue.\n");
+    pScheduler->pDeques = (TGM_DetectJobDeque*) calloc(numThread, sizeof(TGM_DetectJobDeque));
+    if (pScheduler->pDeques == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the detection job queues.\n");
 
-    pJobStack->pLibTable = pLibTable;
+    for (unsigned int i = 0; i != numThread; ++i)
+    {
+        TGM_DetectJobDeque* pDeque = pScheduler->pDeques + i;
+
+        pDeque->pJobs = (TGM_DetectJob*) calloc(DEFAULT_JOB_DEQUE_CAPACITY, sizeof(TGM_DetectJob));
+        if (pDeque->pJobs == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the detection job queues.\n");
+
+        pDeque->head = 0;
+        pDeque->size = 0;
+        pDeque->capacity = DEFAULT_JOB_DEQUE_CAPACITY;
+
+        if (pthread_mutex_init(&(pDeque->mutex), NULL) != 0)
+            TGM_ErrQuit("ERROR: Unable to initialize the mutex.\n");
+    }
 
-    pJobStack->top = 0;
-    pJobStack->capacity = 2 * numThread;
+    pScheduler->pLibTable = pLibTable;
 
-    int status = pthread_mutex_init(&(pJobStack->mutex), NULL);
+    int status = pthread_mutex_init(&(pScheduler->mutex), NULL);
     if (status != 0)
         TGM_ErrQuit("ERROR: Unable to initialize the mutex.\n");
 
-    pJobStack->numThread = numThread;
-    pJobStack->loadingNum = 0;
-    pJobStack->loadingLimit = loadingLimit;
+    status = pthread_cond_init(&(pScheduler->cond), NULL);
+    if (status != 0)
+        TGM_ErrQuit("ERROR: Unable to initialize the condition variable.\n");
+
+    pScheduler->numThread = numThread;
+    pScheduler->loadingNum = 0;
+    pScheduler->loadingLimit = loadingLimit;
 
-    pJobStack->nextJobID = 0;
+    pScheduler->loadingMem = 0;
+    pScheduler->loadingMemLimit = 0;
 
-    return pJobStack;
+    return pScheduler;
 }
 
-void TGM_DetectJobStackFree(TGM_DetectJobStack* pJobStack)
+void TGM_DetectSchedulerFree(TGM_DetectScheduler* pScheduler)
 {
-    if (pJobStack != NULL)
+    if (pScheduler != NULL)
     {
-        free(pJobStack->pJobs);
-        pthread_mutex_destroy(&(pJobStack->mutex));
+        for (unsigned int i = 0; i != pScheduler->numThread; ++i)
+        {
+            free(pScheduler->pDeques[i].pJobs);
+            pthread_mutex_destroy(&(pScheduler->pDeques[i].mutex));
+        }
+
+        free(pScheduler->pDeques);
 
-        free(pJobStack);
+        pthread_mutex_destroy(&(pScheduler->mutex));
+        pthread_cond_destroy(&(pScheduler->cond));
+
+        free(pScheduler);
     }
 }
 
-int TGM_DetectJobStackLock(TGM_DetectJobStack* pJobStack)
+int TGM_DetectSchedulerLock(TGM_DetectScheduler* pScheduler)
+{
+    return (pthread_mutex_lock(&(pScheduler->mutex)));
+}
+
+int TGM_DetectSchedulerUnlock(TGM_DetectScheduler* pScheduler)
+{
+    return (pthread_mutex_unlock(&(pScheduler->mutex)));
+}
+
+int TGM_DetectSchedulerWait(TGM_DetectScheduler* pScheduler)
 {
-    return (pthread_mutex_lock(&(pJobStack->mutex)));
+    return (pthread_cond_wait(&(pScheduler->cond), &(pScheduler->mutex)));
 }
 
-int TGM_DetectJobStackUnlock(TGM_DetectJobStack* pJobStack)
+int TGM_DetectSchedulerBroadcast(TGM_DetectScheduler* pScheduler)
 {
-    return (pthread_mutex_unlock(&(pJobStack->mutex)));
+    return (pthread_cond_broadcast(&(pScheduler->cond)));
 }
 
-void TGM_DetectJobStackPush(TGM_DetectJobStack* pJobStack, const TGM_DetectJob* pJob)
+void TGM_DetectSchedulerPush(TGM_DetectScheduler* pScheduler, unsigned int threadID, const TGM_DetectJob* pJob)
 {
-    if (pJobStack->top == pJobStack->capacity)
+    TGM_DetectJobDeque* pDeque = pScheduler->pDeques + threadID;
+    pthread_mutex_lock(&(pDeque->mutex));
+
+    if (pDeque->size == pDeque->capacity)
     {
-        pJobStack->capacity *= 2;
-        pJobStack->pJobs = (TGM_DetectJob*) realloc(pJobStack->pJobs, sizeof(TGM_DetectJob) * pJobStack->capacity);
-        if (pJobStack->pJobs == NULL)
+        // unwrap the ring buffer into a larger one
+        TGM_DetectJob* pNewJobs = (TGM_DetectJob*) malloc(sizeof(TGM_DetectJob) * pDeque->capacity * 2);
+        if (pNewJobs == NULL)
             TGM_ErrQuit("ERROR: Not enough memory for the detection job queue.\n");
+
+        for (unsigned int i = 0; i != pDeque->size; ++i)
+            pNewJobs[i] = pDeque->pJobs[(pDeque->head + i) % pDeque->capacity];
+
+        free(pDeque->pJobs);
+        pDeque->pJobs = pNewJobs;
+        pDeque->head = 0;
+        pDeque->capacity *= 2;
     }
 
-    pJobStack->pJobs[pJobStack->top] = *pJob;
-    ++(pJobStack->top);
+    pDeque->pJobs[(pDeque->head + pDeque->size) % pDeque->capacity] = *pJob;
+    ++(pDeque->size);
+
+    pthread_mutex_unlock(&(pDeque->mutex));
 }
 
-TGM_Status TGM_DetectJobStackPop(TGM_DetectJob* pJob, TGM_DetectJobStack* pJobStack)
+TGM_Status TGM_DetectSchedulerPop(TGM_DetectJob* pJob, TGM_DetectScheduler* pScheduler, unsigned int threadID)
 {
-    if (TGM_DetectJobStackIsEmpty(pJobStack))
-        return TGM_ERR;
+    // take the newest job of our own queue
+    TGM_DetectJobDeque* pDeque = pScheduler->pDeques + threadID;
+    pthread_mutex_lock(&(pDeque->mutex));
+
+    if (pDeque->size > 0)
+    {
+        --(pDeque->size);
+        *pJob = pDeque->pJobs[(pDeque->head + pDeque->size) % pDeque->capacity];
+        pthread_mutex_unlock(&(pDeque->mutex));
+
+        return TGM_OK;
+    }
+
+    pthread_mutex_unlock(&(pDeque->mutex));
+
+    // steal the oldest job from the other threads
+    for (unsigned int i = 1; i < pScheduler->numThread; ++i)
+    {
+        pDeque = pScheduler->pDeques + (threadID + i) % pScheduler->numThread;
+        pthread_mutex_lock(&(pDeque->mutex));
+
+        if (pDeque->size > 0)
+        {
+            *pJob = pDeque->pJobs[pDeque->head];
+            pDeque->head = (pDeque->head + 1) % pDeque->capacity;
+            --(pDeque->size);
+            pthread_mutex_unlock(&(pDeque->mutex));
+
+            return TGM_OK;
+        }
 
-    *pJob = pJobStack->pJobs[pJobStack->top - 1];
-    --(pJobStack->top);
+        pthread_mutex_unlock(&(pDeque->mutex));
+    }
 
-    return TGM_OK;
+    return TGM_ERR;
 }
 
 void TGM_ReadPairDetect(const TGM_ReadPairDetectPars* pDetectPars)
@@ -231,142 +608,142 @@ void TGM_ReadPairDetect(const TGM_ReadPairDetectPars* pDetectPars)
 
     TGM_LibInfoTable* pLibTable = TGM_LibInfoTableRead(pLibInput);
 
+    // open the read pair container and load its chunk index
+    TGM_ReadPairInFile* pInFile = TGM_ReadPairInFileOpen(pDetectPars->workingDir, pDetectPars->numThreads);
 
     uint32_t detectSet = 0;
     uint32_t readSize = fread(&detectSet, sizeof(uint32_t), 1, pLibInput);
     if (readSize != 1)
         TGM_ErrQuit("ERROR: Cannot read detect set.\n");
 
-    for (unsigned int i = SV_DELETION; i != SV_INTER_CHR_TRNSLCTN; ++i)
+    TGM_DetectEngines engines;
+    TGM_DetectEnginesInit(&engines, pDetectPars, pLibTable, pInFile);
+
+    TGM_LocalDetectPool localPool;
+    TGM_SpecialDetectPool specialPool;
+    TGM_SpecialID* pSpecialID = NULL;
+
+    // deletions, tandem duplications, inversions and translocations share one load of the read pairs of each reference
+    if ((detectSet & LOCAL_SV_SET) != 0 && engines.numRefs > 0)
+    {
+        TGM_LocalDetectPoolInit(&localPool, &engines, detectSet & LOCAL_SV_SET);
+        engines.pLocalPool = &localPool;
+    }
+
+    for (unsigned int i = SV_DELETION; i <= SV_INTER_CHR_TRNSLCTN; ++i)
     {
+        if ((detectSet & (1 << i)) == 0)
+            continue;
+
         switch(i)
         {
-            case SV_DELETION:
-                if ((detectSet & (1 << i)) != 0)
-                    TGM_DetectDel(pDetectPars, pLibTable);
-                break;
-            case SV_TANDEM_DUP:
-                if ((detectSet & (1 << i)) != 0)
-                    TGM_DetectTandemDup(pDetectPars, pLibTable);
-                break;
-            case SV_INVERSION:
-                if ((detectSet & (1 << i)) != 0)
-                    TGM_DetectInversion(pDetectPars, pLibTable);
-                break;
             case SV_SPECIAL:
-                if ((detectSet & (1 << i)) != 0)
-                {
-                    TGM_SpecialID* pSpecialID = TGM_SpecialIDRead(pLibInput);
-                    if (pSpecialID != NULL)
-                        TGM_DetectSpecial(pDetectPars, pLibTable, pSpecialID);
+                pSpecialID = TGM_SpecialIDAlloc(DEFAULT_SPECIAL_ID_CAPACITY);
+                TGM_SpecialIDRead(pSpecialID, pLibInput);
 
-                    TGM_SpecialIDFree(pSpecialID);
+                if (pSpecialID->size > 0 && engines.numRefs > 0)
+                {
+                    TGM_SpecialDetectPoolInit(&specialPool, &engines, pSpecialID);
+                    engines.pSpecialPool = &specialPool;
                 }
                 break;
-            case SV_INTER_CHR_TRNSLCTN:
-                if ((detectSet & (1 << i)) != 0)
-                    TGM_DetectTranslocation(pDetectPars, pLibTable);
-                break;
             default:
                 break;
         }
     }
 
+    // the local SVs and the special insertions are detected at the same time on one pool of threads
+    TGM_DetectEnginesRun(&engines);
+
+    if (engines.pLocalPool != NULL)
+        TGM_LocalDetectPoolDestroy(&localPool);
+
+    if (engines.pSpecialPool != NULL)
+        TGM_SpecialDetectPoolDestroy(&specialPool);
+
+    TGM_SpecialIDFree(pSpecialID);
+
     fclose(pLibInput);
+    TGM_ReadPairInFileClose(pInFile);
     TGM_LibInfoTableFree(pLibTable);
 }
 
-TGM_SpecialID* TGM_SpecialIDRead(FILE* libInput)
+void TGM_LocalPairArrayRead(TGM_LocalPairArray* pLocalPairArray, TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType)
 {
-    uint32_t size = 0;
-    unsigned int readSize = fread(&size, sizeof(uint32_t), 1, libInput);
-    if (readSize != 1)
-        TGM_ErrQuit("ERROR: Cannot read the number of special references.\n");
+    uint64_t size = TGM_ReadPairInFileCount(pInFile, refID, chunkType);
 
+    TGM_ARRAY_RESIZE_NO_COPY(pLocalPairArray, size, TGM_LocalPair);
     if (size == 0)
-        return NULL;
-
-    TGM_SpecialID* pSpecialID = (TGM_SpecialID*) malloc(sizeof(TGM_SpecialID));
-    if (pSpecialID == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for a special ID object.\n");
+        return;
 
-    pSpecialID->names = (char (*)[3]) calloc(sizeof(char), 3 * size);
-    if (pSpecialID->names == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for the special IDs.\n");
+    pLocalPairArray->size = TGM_ReadPairInFileRead(pLocalPairArray->data, pInFile, refID, chunkType, sizeof(TGM_LocalPair));
+}
 
-    for (unsigned int i = 0; i != size; ++i)
-    {
-        readSize = fread(pSpecialID->names[i], sizeof(char), 2, libInput);
-        if (readSize != 2)
-            TGM_ErrQuit("ERROR: Cannot read special ID from the library information file.\n");
-    }
+void TGM_CrossPairArrayRead(TGM_CrossPairArray* pCrossPairArray, TGM_ReadPairInFile* pInFile, int32_t refID)
+{
+    uint64_t size = TGM_ReadPairInFileCount(pInFile, refID, TGM_CROSS_PAIR_CHUNK);
 
-    pSpecialID->size = size;
+    TGM_ARRAY_RESIZE_NO_COPY(pCrossPairArray, size, TGM_CrossPair);
+    if (size == 0)
+        return;
 
-    return pSpecialID;
+    pCrossPairArray->size = TGM_ReadPairInFileRead(pCrossPairArray->data, pInFile, refID, TGM_CROSS_PAIR_CHUNK, sizeof(TGM_CrossPair));
 }
 
-void TGM_SpecialIDFree(TGM_SpecialID* pSpecialID)
+TGM_Bool TGM_LocalPairArrayMap(TGM_LocalPairArray* pLocalPairArray, TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType)
 {
-    if (pSpecialID != NULL)
-    {
-        free(pSpecialID->names);
-        free(pSpecialID);
-    }
+    uint64_t numPairs = 0;
+    const void* pData = TGM_ReadPairInFileMap(pInFile, refID, chunkType, sizeof(TGM_LocalPair), &numPairs);
+    if (pData == NULL)
+        return FALSE;
+
+    // the mapping is read only and the zero capacity tells that the array does not own it
+    pLocalPairArray->data = (TGM_LocalPair*) pData;
+    pLocalPairArray->size = numPairs;
+    pLocalPairArray->capacity = 0;
+
+    return TRUE;
 }
 
-void TGM_LocalPairArrayRead(TGM_LocalPairArray* pLocalPairArray, FILE* input)
+TGM_Bool TGM_CrossPairArrayMap(TGM_CrossPairArray* pCrossPairArray, TGM_ReadPairInFile* pInFile, int32_t refID)
 {
-    int64_t size = 0;
-    unsigned int readSize = fread(&(size), sizeof(int64_t), 1, input);
-    if (readSize != 1)
-        TGM_ErrQuit("ERROR: Cannot read the size of local pair array.\n");
+    uint64_t numPairs = 0;
+    const void* pData = TGM_ReadPairInFileMap(pInFile, refID, TGM_CROSS_PAIR_CHUNK, sizeof(TGM_CrossPair), &numPairs);
+    if (pData == NULL)
+        return FALSE;
 
-    if (size > pLocalPairArray->capacity)
-        TGM_ARRAY_RESIZE_NO_COPY(pLocalPairArray, size, TGM_LocalPair);
-    else if (size <= 0)
-        return;
+    // the mapping is read only and the zero capacity tells that the array does not own it
+    pCrossPairArray->data = (TGM_CrossPair*) pData;
+    pCrossPairArray->size = numPairs;
+    pCrossPairArray->capacity = 0;
 
-    pLocalPairArray->size = size;
-    readSize = fread(pLocalPairArray->data, sizeof(TGM_LocalPair), size, input);
-    if (readSize != size)
-        TGM_ErrQuit("ERROR: Cannot read the local pair array.\n");
+    return TRUE;
 }
 
-void TGM_CrossPairArrayRead(TGM_CrossPairArray* pCrossPairArray, FILE* input)
+TGM_Bool TGM_SpecialPairArrayMap(TGM_SpecialPairArray* pSpecialPairArray, TGM_ReadPairInFile* pInFile, int32_t refID)
 {
-    int64_t size = 0;
-    unsigned int readSize = fread(&(size), sizeof(int64_t), 1, input);
-    if (readSize != 1)
-        TGM_ErrQuit("ERROR: Cannot read the size of cross pair array.\n");
+    uint64_t numPairs = 0;
+    const void* pData = TGM_ReadPairInFileMap(pInFile, refID, TGM_SPECIAL_PAIR_CHUNK, sizeof(TGM_SpecialPair), &numPairs);
+    if (pData == NULL)
+        return FALSE;
 
-    if (size > pCrossPairArray->capacity)
-        TGM_ARRAY_RESIZE_NO_COPY(pCrossPairArray, size, TGM_CrossPair);
-    else if (size <= 0)
-        return;
+    // the mapping is read only and the zero capacity tells that the array does not own it
+    pSpecialPairArray->data = (TGM_SpecialPair*) pData;
+    pSpecialPairArray->size = numPairs;
+    pSpecialPairArray->capacity = 0;
 
-    pCrossPairArray->size = size;
-    readSize = fread(pCrossPairArray->data, sizeof(TGM_CrossPair), size, input);
-    if (readSize != size)
-        TGM_ErrQuit("ERROR: Cannot read the cross pair array.\n");
+    return TRUE;
 }
 
-void TGM_SpecialPairArrayRead(TGM_SpecialPairArray* pSpecialPairArray, FILE* input)
+void TGM_SpecialPairArrayRead(TGM_SpecialPairArray* pSpecialPairArray, TGM_ReadPairInFile* pInFile, int32_t refID)
 {
-    int64_t size = 0;
-    unsigned int readSize = fread(&(size), sizeof(int64_t), 1, input);
-    if (readSize != 1)
-        TGM_ErrQuit("ERROR: Cannot read the size of special pair array.\n");
+    uint64_t size = TGM_ReadPairInFileCount(pInFile, refID, TGM_SPECIAL_PAIR_CHUNK);
 
-    if (size > pSpecialPairArray->capacity)
-        TGM_ARRAY_RESIZE_NO_COPY(pSpecialPairArray, size, TGM_SpecialPair);
-    else if (size <= 0)
+    TGM_ARRAY_RESIZE_NO_COPY(pSpecialPairArray, size, TGM_SpecialPair);
+    if (size == 0)
         return;
 
-    pSpecialPairArray->size = size;
-    readSize = fread(pSpecialPairArray->data, sizeof(TGM_SpecialPair), size, input);
-    if (readSize != size)
-        TGM_ErrQuit("ERROR: Cannot read the special pair array.\n");
+    pSpecialPairArray->size = TGM_ReadPairInFileRead(pSpecialPairArray->data, pInFile, refID, TGM_SPECIAL_PAIR_CHUNK, sizeof(TGM_SpecialPair));
 }
 
 /*  
@@ -399,182 +776,1938 @@ void TGM_SpecialPairTableReadID(TGM_SpecialPairTable* pSpeicalPairTable, FILE* l
 }
 */
 
-void SV_AssistArrayResize(SV_AssistArray* pAssistArray, unsigned int newSize)
+SV_AssistArray* SV_AssistArrayAlloc(void)
 {
-    if (newSize > pAssistArray->capacity)
+    SV_AssistArray* pAssistArray = (SV_AssistArray*) calloc(1, sizeof(SV_AssistArray));
+    if (pAssistArray == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for an assist array.\n");
+
+    return pAssistArray;
+}
+
+void SV_AssistArrayFree(SV_AssistArray* pAssistArray)
+{
+    if (pAssistArray != NULL)
     {
         free(pAssistArray->pFragLenDiff);
-        free(pAssistArray->pMapQ3);
         free(pAssistArray->pMapQ5);
+        free(pAssistArray->pMapQ3);
 
-        pAssistArray->capacity = newSize * 2;
-
-        pAssistArray->pFragLenDiff = (int*) malloc(sizeof(int) * pAssistArray->capacity);
-        pAssistArray->pMapQ3 = (int*) malloc(sizeof(int) * pAssistArray->capacity);
-        pAssistArray->pMapQ5 = (int*) malloc(sizeof(int) * pAssistArray->capacity);
+        free(pAssistArray);
     }
-
-    pAssistArray->size = newSize;
 }
 
-void TGM_DetectDel(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable)
+TGM_CrossGrid* TGM_CrossGridAlloc(void)
 {
+    TGM_CrossGrid* pCrossGrid = (TGM_CrossGrid*) calloc(1, sizeof(TGM_CrossGrid));
+    if (pCrossGrid == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a cross pair grid.\n");
 
-}
-
-void TGM_DetectTandemDup(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable)
-{
+    pCrossGrid->pCellHash = kh_init(crossCell);
 
+    return pCrossGrid;
 }
 
-void TGM_DetectInversion(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable)
+void TGM_CrossGridFree(TGM_CrossGrid* pCrossGrid)
 {
+    if (pCrossGrid != NULL)
+    {
+        free(pCrossGrid->pEntries);
+        free(pCrossGrid->pCellStart);
+        free(pCrossGrid->pParent);
+        free(pCrossGrid->pCompID);
+        free(pCrossGrid->pCompStart);
+        free(pCrossGrid->pMembers);
 
+        kh_destroy(crossCell, pCrossGrid->pCellHash);
+
+        free(pCrossGrid);
+    }
 }
 
-void TGM_DetectSpecial(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, const TGM_SpecialID* pSpecialID)
+// a group never has more non-empty cells than cross pairs, so all the arrays are sized by the number of cross pairs
+static void TGM_CrossGridReserve(TGM_CrossGrid* pCrossGrid, uint64_t numPairs)
 {
-    char specialFileName[TGM_MAX_LINE];
-    unsigned int workingDirLen = strlen(pDetectPars->workingDir);
-    strcpy(specialFileName, pDetectPars->workingDir);
-    strcpy(specialFileName + workingDirLen, TGM_READ_PAIR_FILE_NAME_TEMPLATE[4]);
-
-    char* refPos = specialFileName + workingDirLen + 3;
-    TGM_SpecialPairArray* pSpecialPairArray = NULL;
-    TGM_ARRAY_ALLOC(pSpecialPairArray, 10, TGM_SpecialPairArray, TGM_SpecialPair);
-
-    unsigned int numArray = pSpecialID->size * 2;
-    TGM_ReadPairAttrbtArray** pAttrbtArrays = (TGM_ReadPairAttrbtArray**) malloc(sizeof(TGM_ReadPairAttrbtArray*) * numArray);
-    if (pAttrbtArrays == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for the read pair attribute arrays.\n");
+    if (numPairs <= pCrossGrid->capacity)
+        return;
 
-    for (unsigned int i = 0; i != numArray; ++i)
-        pAttrbtArrays[i] = TGM_ReadPairAttrbtArrayAlloc(pLibTable->size);
+    free(pCrossGrid->pEntries);
+    free(pCrossGrid->pCellStart);
+    free(pCrossGrid->pParent);
+    free(pCrossGrid->pCompID);
+    free(pCrossGrid->pCompStart);
+    free(pCrossGrid->pMembers);
 
-    TGM_Cluster* pCluster3 = TGM_ClusterAlloc(pDetectPars->minNumClustered);
-    TGM_Cluster* pCluster5 = TGM_ClusterAlloc(pDetectPars->minNumClustered);
+    pCrossGrid->capacity = numPairs * 2;
 
-    TGM_SpecialEventArray* pSpecialEventArray = NULL;
-    TGM_ARRAY_ALLOC(pSpecialEventArray, DEFAULT_SV_CAPACITY, TGM_SpecialEventArray, TGM_SpecialEvent);
+    pCrossGrid->pEntries = (TGM_CrossGridEntry*) malloc(pCrossGrid->capacity * sizeof(TGM_CrossGridEntry));
+    pCrossGrid->pCellStart = (uint32_t*) malloc((pCrossGrid->capacity + 1) * sizeof(uint32_t));
+    pCrossGrid->pParent = (uint32_t*) malloc(pCrossGrid->capacity * sizeof(uint32_t));
+    pCrossGrid->pCompID = (uint32_t*) malloc(pCrossGrid->capacity * sizeof(uint32_t));
+    pCrossGrid->pCompStart = (uint32_t*) malloc((pCrossGrid->capacity + 1) * sizeof(uint32_t));
+    pCrossGrid->pMembers = (uint32_t*) malloc(pCrossGrid->capacity * sizeof(uint32_t));
 
-    for (unsigned int k = pDetectPars->workingRefID[0]; k <= pDetectPars->workingRefID[1]; ++k)
+    if (pCrossGrid->pEntries == NULL || pCrossGrid->pCellStart == NULL || pCrossGrid->pParent == NULL
+        || pCrossGrid->pCompID == NULL || pCrossGrid->pCompStart == NULL || pCrossGrid->pMembers == NULL)
     {
-        sprintf(refPos, "%03u", k);
-        // fix the null character introduced by sprintf
-        *(refPos + 3) = '_';
-        FILE* specialInput = fopen(specialFileName, "rb");
-        if (specialInput == NULL)
-            TGM_ErrQuit("ERROR: Cannot open special pair file.\n");
-
-        TGM_SpecialPairArrayRead(pSpecialPairArray, specialInput);
-        TGM_ReadPairMakeSpecial(pAttrbtArrays, numArray, pSpecialPairArray, pLibTable);
-
-        for (unsigned int i = 0; i != numArray; i += 2)
-        {
-            TGM_ARRAY_RESET(pSpecialEventArray);
-            TGM_ClusterInit(pCluster3, pAttrbtArrays[i]);
-            TGM_ClusterInit(pCluster5, pAttrbtArrays[i + 1]);
+        TGM_ErrQuit("ERROR: Not enough memory for a cross pair grid.\n");
+    }
+}
 
-            TGM_ClusterMake(pCluster3);
-            TGM_ClusterMake(pCluster5);
+void SV_AssistArrayResize(SV_AssistArray* pAssistArray, unsigned int newSize)
+{
+    if (newSize > pAssistArray->capacity)
+    {
+        free(pAssistArray->pFragLenDiff);
+        free(pAssistArray->pMapQ3);
+        free(pAssistArray->pMapQ5);
+
+        pAssistArray->capacity = newSize * 2;
+
+        pAssistArray->pFragLenDiff = (int*) malloc(sizeof(int) * pAssistArray->capacity);
+        pAssistArray->pMapQ3 = (int*) malloc(sizeof(int) * pAssistArray->capacity);
+        pAssistArray->pMapQ5 = (int*) malloc(sizeof(int) * pAssistArray->capacity);
+    }
+
+    pAssistArray->size = newSize;
+}
+
+// the cluster elements come out almost in position order. a stable insertion pass puts the few events that
+// are out of place back in (position, length) order and costs a single scan when the stream is already sorted
+static void TGM_SpecialEventStreamOrder(TGM_SpecialEvent* pEvents, unsigned int numEvents)
+{
+    for (unsigned int i = 1; i < numEvents; ++i)
+    {
+        if (pEvents[i - 1].pos < pEvents[i].pos || (pEvents[i - 1].pos == pEvents[i].pos && pEvents[i - 1].length <= pEvents[i].length))
+            continue;
+
+        TGM_SpecialEvent event = pEvents[i];
+        unsigned int j = i;
+        while (j > 0 && (pEvents[j - 1].pos > event.pos || (pEvents[j - 1].pos == event.pos && pEvents[j - 1].length > event.length)))
+        {
+            pEvents[j] = pEvents[j - 1];
+            --j;
+        }
+
+        pEvents[j] = event;
+    }
+}
+
+// sweep the position ordered 3' and 5' event streams of a special reference and merge all the events
+// within one maximum fragment length of the event being built. the merged events are appended to
+// pSpecialEventArray in position order. on equal positions the 3' event comes first
+static void TGM_SpecialEventSweep(TGM_SpecialEventArray* pSpecialEventArray, TGM_SupportArray* pSupportArray, const TGM_SpecialEvent* pEvents3, unsigned int numEvents3,
+                                  const TGM_SpecialEvent* pEvents5, unsigned int numEvents5, uint32_t fragLenMax,
+                                  TGM_Cluster* pCluster3, TGM_Cluster* pCluster5)
+{
+    unsigned int index3 = 0;
+    unsigned int index5 = 0;
+    TGM_SpecialEvent* pOpenEvent = NULL;
+
+    while (index3 != numEvents3 || index5 != numEvents5)
+    {
+        const TGM_SpecialEvent* pNextEvent = NULL;
+        if (index5 == numEvents5 || (index3 != numEvents3 && (pEvents3[index3].pos < pEvents5[index5].pos 
+            || (pEvents3[index3].pos == pEvents5[index5].pos && pEvents3[index3].length <= pEvents5[index5].length))))
+        {
+            pNextEvent = pEvents3 + index3;
+            ++index3;
+        }
+        else
+        {
+            pNextEvent = pEvents5 + index5;
+            ++index5;
+        }
+
+        if (pOpenEvent != NULL && abs((int) pNextEvent->pos - (int) pOpenEvent->pos) < fragLenMax)
+        {
+            TGM_SpecialEvent mergedEvent;
+            TGM_SpecialEventMerge(&mergedEvent, pSupportArray, pNextEvent, pOpenEvent, pCluster3, pCluster5);
+            *pOpenEvent = mergedEvent;
+        }
+        else
+        {
+            if (TGM_ARRAY_IS_FULL(pSpecialEventArray))
+                TGM_ARRAY_RESIZE(pSpecialEventArray, pSpecialEventArray->capacity * 2, TGM_SpecialEvent);
+
+            pOpenEvent = pSpecialEventArray->data + pSpecialEventArray->size;
+            *pOpenEvent = *pNextEvent;
+            ++(pSpecialEventArray->size);
+        }
+    }
+}
+
+// cluster a range of special pairs hitting the same special reference and merge the events from the two sides
+static void TGM_DetectSpecialOne(TGM_SpecialEventArray* pSpecialEventArray, TGM_SpecialEventArray* pSideEvents, TGM_SupportArray* pSupportArray, TGM_Cluster* pCluster3, TGM_Cluster* pCluster5,
+                                 TGM_ReadPairAttrbtArray* pAttrbtArrays[2], TGM_SpecialPairArray* pMemberPairs, const TGM_SpecialPairArray* pSpecialPairArray,
+                                 const uint32_t* pOrder, unsigned int begin, unsigned int end, const TGM_LibInfoTable* pLibTable)
+{
+    TGM_ARRAY_RESET(pSpecialEventArray);
+    TGM_ARRAY_RESET(pSideEvents);
+    TGM_ReadPairMakeSpecialRange(pAttrbtArrays, pSpecialPairArray, pOrder, begin, end, pLibTable);
+
+    TGM_ClusterInit(pCluster3, pAttrbtArrays[0]);
+    TGM_ClusterInit(pCluster5, pAttrbtArrays[1]);
+
+    TGM_ClusterMakeAndBuild(pCluster3);
+    TGM_ClusterMakeAndBuild(pCluster5);
+
+    TGM_ClusterFinalize(pCluster3);
+    TGM_ClusterFinalize(pCluster5);
+
+    TGM_ClusterCompact(pCluster3);
+    TGM_ClusterCompact(pCluster5);
+
+    TGM_ClusterClean(pCluster3);
+    TGM_ClusterClean(pCluster5);
+
+    // the special pairs of each side are gathered in cluster order so that the events are made in streaming passes.
+    // the 3' events are followed by the 5' events in the side event array
+    TGM_Cluster* pClusters[2] = {pCluster3, pCluster5};
+    unsigned int numEvents[2] = {0, 0};
+    for (unsigned int k = 0; k != 2; ++k)
+    {
+        const TGM_Cluster* pCluster = pClusters[k];
+
+        TGM_ARRAY_RESIZE_NO_COPY(pMemberPairs, TGM_ClusterNumMembers(pCluster), TGM_SpecialPair);
+        TGM_ClusterGather(pMemberPairs->data, pCluster, pSpecialPairArray->data, sizeof(TGM_SpecialPair));
+
+        unsigned int numClsElmnts = pCluster->pElmntArray->length;
+        for (unsigned int j = 0; j != numClsElmnts; ++j)
+        {
+            if (pCluster->pElmntArray->data[j].numReadPair == 0)
+                continue;
+
+            if (TGM_ARRAY_IS_FULL(pSideEvents))
+                TGM_ARRAY_RESIZE(pSideEvents, pSideEvents->capacity * 2, TGM_SpecialEvent);
+
+            TGM_SpecialEvent* pSpecialEvent = pSideEvents->data + pSideEvents->size;
+            TGM_SpecialEventMake(pSpecialEvent, pSupportArray, pCluster, j, pMemberPairs->data, pLibTable);
+            ++(pSideEvents->size);
+            ++numEvents[k];
+        }
+    }
+
+    TGM_SpecialEvent* pEvents3 = pSideEvents->data;
+    TGM_SpecialEvent* pEvents5 = pSideEvents->data + numEvents[0];
+
+    TGM_SpecialEventStreamOrder(pEvents3, numEvents[0]);
+    TGM_SpecialEventStreamOrder(pEvents5, numEvents[1]);
+
+    TGM_SpecialEventSweep(pSpecialEventArray, pSupportArray, pEvents3, numEvents[0], pEvents5, numEvents[1], pLibTable->fragLenMax, pCluster3, pCluster5);
+}
+
+// wait till a reference fits in the loading limits and count it in. the scheduler must be locked
+static void TGM_DetectSchedulerLoadWait(TGM_DetectScheduler* pScheduler, uint64_t numBytes)
+{
+    // always let one reference in so that a reference larger than the memory limit is still loaded
+    while (pScheduler->loadingNum > 0
+           && (pScheduler->loadingNum >= pScheduler->loadingLimit
+               || (pScheduler->loadingMemLimit > 0 && pScheduler->loadingMem + numBytes > pScheduler->loadingMemLimit)))
+    {
+        TGM_DetectSchedulerWait(pScheduler);
+    }
+
+    ++(pScheduler->loadingNum);
+    pScheduler->loadingMem += numBytes;
+}
+
+// count more memory of the data being loaded in. unlike a new reference this only waits for
+// the other data in flight, so a loader can always grow what it holds. the scheduler must be locked
+static void TGM_DetectSchedulerLoadGrow(TGM_DetectScheduler* pScheduler, uint64_t numBytes)
+{
+    while (pScheduler->loadingNum > 0 && pScheduler->loadingMemLimit > 0 && pScheduler->loadingMem + numBytes > pScheduler->loadingMemLimit)
+        TGM_DetectSchedulerWait(pScheduler);
+
+    pScheduler->loadingMem += numBytes;
+}
+
+// the scheduler must be locked
+static void TGM_DetectSchedulerLoadDone(TGM_DetectScheduler* pScheduler, uint64_t numBytes)
+{
+    --(pScheduler->loadingNum);
+    pScheduler->loadingMem -= numBytes;
+    TGM_DetectSchedulerBroadcast(pScheduler);
+}
+
+// move the events of a reference whose special insertion jobs are all finished into the output batch. the scheduler must be locked
+static unsigned int TGM_SpecialDetectGather(TGM_EventBuff** ppBatch, TGM_SpecialDetectPool* pPool, unsigned int refIndex)
+{
+    TGM_SpecialRefData* pRefData = pPool->pRefData + refIndex;
+    unsigned int numJobs = pRefData->numJobs;
+
+    if (pRefData->pJobKeys == NULL)
+    {
+        memcpy(ppBatch, pRefData->ppEventBuffs, numJobs * sizeof(TGM_EventBuff*));
+    }
+    else
+    {
+        // the windows of a streamed reference are made in position order across the special references.
+        // put them back in the order of the in-memory jobs so that events at the same position are written alike
+        TGM_SortKey* pKeys = (TGM_SortKey*) malloc(2 * (numJobs + 1) * sizeof(TGM_SortKey));
+        if (pKeys == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the order of the special insertion events.\n");
+
+        for (unsigned int i = 0; i != numJobs; ++i)
+        {
+            pKeys[i].key = pRefData->pJobKeys[i];
+            pKeys[i].index = i;
+        }
+
+        const TGM_SortKey* pSorted = TGM_RadixSortKeys(pKeys, pKeys + numJobs + 1, numJobs);
+        for (unsigned int i = 0; i != numJobs; ++i)
+            ppBatch[i] = pRefData->ppEventBuffs[pSorted[i].index];
+
+        free(pKeys);
+        free(pRefData->pJobKeys);
+        pRefData->pJobKeys = NULL;
+    }
+
+    free(pRefData->ppEventBuffs);
+    pRefData->ppEventBuffs = NULL;
+
+    // the events of a detected reference are kept for the next runs
+    if (pRefData->pCacheKey != NULL)
+    {
+        TGM_DetectCacheSave(pRefData->pCacheKey, ppBatch, numJobs);
+        TGM_DetectCacheKeyFree(pRefData->pCacheKey);
+        pRefData->pCacheKey = NULL;
+    }
+
+    return numJobs;
+}
+
+// the scheduler must be locked
+static void TGM_SpecialDetectRelease(TGM_SpecialDetectPool* pPool, TGM_SpecialRefData* pRefData)
+{
+    if (pRefData->pSpecialPairArray->capacity == 0)
+        free(pRefData->pSpecialPairArray);
+    else
+        TGM_ARRAY_FREE(pRefData->pSpecialPairArray, TRUE);
+
+    free(pRefData->pOrder);
+
+    pRefData->pSpecialPairArray = NULL;
+    pRefData->pOrder = NULL;
+
+    TGM_DetectSchedulerLoadDone(pPool->pEngines->pScheduler, pRefData->numBytes);
+}
+
+// sort the special pairs by special ID, position and alignment length without moving them (they may be mapped read only).
+// the radix sort is stable so the special pairs with the same key keep their original order
+static uint32_t* TGM_SpecialPairArraySortOrder(const TGM_SpecialPairArray* pSpecialPairArray)
+{
+    uint64_t size = pSpecialPairArray->size;
+
+    uint32_t* pOrder = (uint32_t*) malloc((size + 1) * sizeof(uint32_t));
+    TGM_SortKey* pKeys = (TGM_SortKey*) malloc(2 * (size + 1) * sizeof(TGM_SortKey));
+    if (pOrder == NULL || pKeys == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the order of the special pairs.\n");
+
+    // 16 bits of special ID, 32 bits of position and 16 bits of alignment length
+    for (uint64_t i = 0; i != size; ++i)
+    {
+        const TGM_SpecialPair* pSpecialPair = pSpecialPairArray->data + i;
+
+        int32_t length = pSpecialPair->end[0] - pSpecialPair->pos[0];
+        if (length < 0)
+            length = 0;
+        else if (length > 0xffff)
+            length = 0xffff;
+
+        pKeys[i].key = ((uint64_t) ((uint16_t) (pSpecialPair->specialID + 0x8000)) << 48)
+                       | ((uint64_t) ((uint32_t) pSpecialPair->pos[0]) << 16)
+                       | (uint64_t) length;
+
+        pKeys[i].index = i;
+    }
+
+    const TGM_SortKey* pSorted = TGM_RadixSortKeys(pKeys, pKeys + size + 1, size);
+    for (uint64_t i = 0; i != size; ++i)
+        pOrder[i] = pSorted[i].index;
+
+    free(pKeys);
+
+    return pOrder;
+}
+
+static int CompareJobSize(const void* pJob1, const void* pJob2)
+{
+    const TGM_DetectJob* pJ1 = pJob1;
+    const TGM_DetectJob* pJ2 = pJob2;
+
+    unsigned int size1 = pJ1->end - pJ1->begin;
+    unsigned int size2 = pJ2->end - pJ2->begin;
+
+    if (size1 != size2)
+        return (size1 > size2 ? -1 : 1);
+
+    return (pJ1->jobID < pJ2->jobID ? -1 : 1);
+}
+
+// cut the special pairs of a reference into jobs. a special reference with too many pairs is split into
+// sub-jobs at position gaps that no cluster or merged event can span, so the result does not change
+static unsigned int TGM_SpecialDetectMakeJobs(TGM_DetectJob** ppJobs, const TGM_SpecialPairArray* pSpecialPairArray, const uint32_t* pOrder, int32_t refID,
+                                              TGM_SpecialRefData* pRefData, uint64_t splitSize, int32_t minGap)
+{
+    unsigned int numJobs = 0;
+    unsigned int capacity = DEFAULT_JOB_DEQUE_CAPACITY;
+    TGM_DetectJob* pJobs = (TGM_DetectJob*) malloc(sizeof(TGM_DetectJob) * capacity);
+    if (pJobs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the detection jobs.\n");
+
+    const TGM_SpecialPair* pPairs = pSpecialPairArray->data;
+    unsigned int begin = 0;
+    unsigned int size = pSpecialPairArray->size;
+
+    while (begin != size)
+    {
+        unsigned int end = begin + 1;
+        while (end != size && pPairs[pOrder[end]].specialID == pPairs[pOrder[begin]].specialID
+               && ((end - begin) < splitSize || (pPairs[pOrder[end]].pos[0] - pPairs[pOrder[end - 1]].pos[0]) <= minGap))
+        {
+            ++end;
+        }
+
+        if (numJobs == capacity)
+        {
+            capacity *= 2;
+            pJobs = (TGM_DetectJob*) realloc(pJobs, sizeof(TGM_DetectJob) * capacity);
+            if (pJobs == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the detection jobs.\n");
+        }
+
+        TGM_DetectJob* pJob = pJobs + numJobs;
+        pJob->data = pRefData;
+        pJob->refID = refID;
+        pJob->specialID = pPairs[pOrder[begin]].specialID;
+        pJob->jobID = numJobs;
+        pJob->tileID = 0;
+        pJob->begin = begin;
+        pJob->end = end;
+        pJob->eventType = SV_SPECIAL;
+
+        ++numJobs;
+        begin = end;
+    }
+
+    *ppJobs = pJobs;
+    return numJobs;
+}
+
+// cluster the long pairs of a reference and call the deletions. a large reference is clustered on several threads
+static void TGM_DetectDelOne(TGM_DelArray* pDelArray, TGM_SupportArray* pSupportArray, TGM_DetectWorkspace* pWorkspace, const TGM_LocalPairArray* pLongPairArray,
+                             unsigned int numThreads, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pDetectPars)
+{
+    TGM_ReadPairAttrbtArray* pAttrbtArray = pWorkspace->pAttrbtArrays[0];
+    TGM_Cluster* pDelCluster = pWorkspace->pClusters[0];
+
+    pAttrbtArray->numSortThreads = numThreads;
+    TGM_ClusterSetNumThreads(pDelCluster, numThreads);
+
+    TGM_ReadPairMakeLocal(pAttrbtArray, pLongPairArray, pLibTable, PT_LONG);
+
+    TGM_ClusterInit(pDelCluster, pAttrbtArray);
+    TGM_ClusterMakeAndBuild(pDelCluster);
+    TGM_ClusterFinalize(pDelCluster);
+    TGM_ClusterCompact(pDelCluster);
+    TGM_ClusterClean(pDelCluster);
+
+    TGM_ReadPairFindDel(pDelArray, pSupportArray, pWorkspace->pAssistArray, pLongPairArray, pDelCluster, pLibTable, pDetectPars);
+
+    // the workspace is shared with the jobs of the other engines
+    pAttrbtArray->numSortThreads = 1;
+    TGM_ClusterSetNumThreads(pDelCluster, 1);
+}
+
+// cluster the short and the reversed pairs of a reference and call the tandem duplications
+static void TGM_DetectDupOne(TGM_DupArray* pDupArray, TGM_SupportArray* pSupportArray, TGM_DetectWorkspace* pWorkspace, const TGM_LocalPairArray* pShortPairArray,
+                             const TGM_LocalPairArray* pReversedPairArray, unsigned int numThreads, const TGM_LibInfoTable* pLibTable,
+                             const TGM_ReadPairDetectPars* pDetectPars)
+{
+    const TGM_LocalPairArray* pLocalPairArrays[2] = {pShortPairArray, pReversedPairArray};
+    SV_ReadPairType readPairTypes[2] = {PT_SHORT, PT_REVERSED};
+
+    TGM_ARRAY_RESET(pDupArray);
+
+    for (unsigned int k = 0; k != 2; ++k)
+    {
+        if (pLocalPairArrays[k] == NULL || pLocalPairArrays[k]->size == 0)
+            continue;
+
+        TGM_ReadPairAttrbtArray* pAttrbtArray = pWorkspace->pAttrbtArrays[k];
+        TGM_Cluster* pDupCluster = pWorkspace->pClusters[k];
+
+        pAttrbtArray->numSortThreads = numThreads;
+        TGM_ClusterSetNumThreads(pDupCluster, numThreads);
+
+        TGM_ReadPairMakeLocal(pAttrbtArray, pLocalPairArrays[k], pLibTable, readPairTypes[k]);
+
+        TGM_ClusterInit(pDupCluster, pAttrbtArray);
+        TGM_ClusterMakeAndBuild(pDupCluster);
+        TGM_ClusterFinalize(pDupCluster);
+        TGM_ClusterCompact(pDupCluster);
+        TGM_ClusterClean(pDupCluster);
+
+        TGM_ReadPairFindDup(pDupArray, pSupportArray, pWorkspace->pAssistArray, pLocalPairArrays[k], pDupCluster, pLibTable, pDetectPars);
+
+        pAttrbtArray->numSortThreads = 1;
+        TGM_ClusterSetNumThreads(pDupCluster, 1);
+    }
+
+    if (pDupArray->size > 1)
+        qsort(pDupArray->data, pDupArray->size, sizeof(TGM_DupEvent), CompareDupEvents);
+}
+
+// cluster the inverted3 and inverted5 pairs of a reference and call the inversions
+static void TGM_DetectInvOne(TGM_InvArray* pInvArray, TGM_SupportArray* pSupportArray, TGM_DetectWorkspace* pWorkspace, const TGM_LocalPairArray* pInvertedPairArray,
+                             unsigned int numThreads, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pDetectPars)
+{
+    for (unsigned int k = 0; k != 2; ++k)
+    {
+        pWorkspace->pAttrbtArrays[k]->numSortThreads = numThreads;
+        TGM_ClusterSetNumThreads(pWorkspace->pClusters[k], numThreads);
+    }
+
+    TGM_ReadPairMakeInverted(pWorkspace->pAttrbtArrays, pLibTable, pInvertedPairArray);
+
+    for (unsigned int k = 0; k != 2; ++k)
+    {
+        TGM_Cluster* pInvCluster = pWorkspace->pClusters[k];
+
+        TGM_ClusterInit(pInvCluster, pWorkspace->pAttrbtArrays[k]);
+        TGM_ClusterMakeAndBuild(pInvCluster);
+        TGM_ClusterFinalize(pInvCluster);
+        TGM_ClusterCompact(pInvCluster);
+        TGM_ClusterClean(pInvCluster);
+    }
+
+    TGM_ReadPairFindInv(pInvArray, pSupportArray, pInvertedPairArray, pWorkspace->pClusters, pLibTable, pDetectPars);
+
+    for (unsigned int k = 0; k != 2; ++k)
+    {
+        pWorkspace->pAttrbtArrays[k]->numSortThreads = 1;
+        TGM_ClusterSetNumThreads(pWorkspace->pClusters[k], 1);
+    }
+}
+
+// move the events of a reference whose local SV jobs are all finished into the output batch. the scheduler must be locked
+static unsigned int TGM_LocalDetectGather(TGM_EventBuff** ppBatch, TGM_LocalDetectPool* pPool, unsigned int refIndex)
+{
+    TGM_LocalRefData* pRefData = pPool->pRefData + refIndex;
+    unsigned int numBuffs = pRefData->numBuffs;
+
+    memcpy(ppBatch, pRefData->ppEventBuffs, numBuffs * sizeof(TGM_EventBuff*));
+
+    free(pRefData->ppEventBuffs);
+    pRefData->ppEventBuffs = NULL;
+
+    // the events of a detected reference are kept for the next runs
+    if (pRefData->pCacheKey != NULL)
+    {
+        TGM_DetectCacheSave(pRefData->pCacheKey, ppBatch, numBuffs);
+        TGM_DetectCacheKeyFree(pRefData->pCacheKey);
+        pRefData->pCacheKey = NULL;
+    }
+
+    return numBuffs;
+}
+
+// the scheduler must be locked
+static void TGM_LocalDetectRelease(TGM_LocalDetectPool* pPool, TGM_LocalRefData* pRefData)
+{
+    for (unsigned int i = 0; i != NUM_LOCAL_PAIR_CHUNK; ++i)
+    {
+        TGM_LocalPairArray* pLocalPairArray = pRefData->pLocalPairArrays[i];
+        if (pLocalPairArray == NULL)
+            continue;
+
+        if (pLocalPairArray->capacity == 0)
+            free(pLocalPairArray);
+        else
+            TGM_ARRAY_FREE(pLocalPairArray, TRUE);
+
+        free(pRefData->pOrders[i]);
+
+        pRefData->pLocalPairArrays[i] = NULL;
+        pRefData->pOrders[i] = NULL;
+    }
+
+    if (pRefData->pCrossPairArray != NULL)
+    {
+        if (pRefData->pCrossPairArray->capacity == 0)
+            free(pRefData->pCrossPairArray);
+        else
+            TGM_ARRAY_FREE(pRefData->pCrossPairArray, TRUE);
+
+        pRefData->pCrossPairArray = NULL;
+    }
+
+    TGM_DetectSchedulerLoadDone(pPool->pEngines->pScheduler, pRefData->numBytes);
+}
+
+// hand the references whose jobs are all finished in all the engines over to the writer in reference order. the events
+// of all the engines on a reference go in one batch so that they are merged by position. an incremental run also caches
+// the detected events here, they are small next to the read pairs of the reference. the scheduler must be locked
+static void TGM_DetectOutput(TGM_DetectEngines* pEngines)
+{
+    TGM_LocalDetectPool* pLocalPool = pEngines->pLocalPool;
+    TGM_SpecialDetectPool* pSpecialPool = pEngines->pSpecialPool;
+
+    while (pEngines->nextOutput != pEngines->numRefs)
+    {
+        unsigned int refIndex = pEngines->nextOutput;
+
+        if (pLocalPool != NULL && (!pLocalPool->pRefData[refIndex].isLoaded || pLocalPool->pRefData[refIndex].numPending != 0))
+            break;
+
+        if (pSpecialPool != NULL && (!pSpecialPool->pRefData[refIndex].isLoaded || pSpecialPool->pRefData[refIndex].numPending != 0))
+            break;
+
+        unsigned int numBuffs = (pLocalPool != NULL ? pLocalPool->pRefData[refIndex].numBuffs : 0);
+        if (pSpecialPool != NULL)
+            numBuffs += pSpecialPool->pRefData[refIndex].numJobs;
+
+        TGM_EventBuff* batch[numBuffs + 1];
+        unsigned int numGathered = 0;
+
+        if (pLocalPool != NULL)
+            numGathered += TGM_LocalDetectGather(batch + numGathered, pLocalPool, refIndex);
+
+        if (pSpecialPool != NULL)
+            numGathered += TGM_SpecialDetectGather(batch + numGathered, pSpecialPool, refIndex);
+
+        if (numGathered != 0)
+            TGM_EventWriterSubmit(pEngines->pWriter, batch, numGathered);
+
+        ++(pEngines->nextOutput);
+    }
+}
+
+// look for the events of an engine on a reference in the detect cache. returns TRUE if they are loaded from the
+// cache. otherwise the reference must be detected and its events are saved with the returned key (if there is one)
+static TGM_Bool TGM_DetectCacheLookup(TGM_EventBuff*** pppEventBuffs, unsigned int* pNumBuffs, TGM_DetectCacheKey** ppCacheKey, const TGM_DetectEngines* pEngines,
+                                      const char* engineName, const unsigned char cacheDigest[16], int32_t refID, uint32_t chunkSet)
+{
+    *ppCacheKey = NULL;
+    if (!pEngines->pDetectPars->incremental)
+        return FALSE;
+
+    TGM_DetectCacheKey* pCacheKey = TGM_DetectCacheKeyAlloc(pEngines->pDetectPars->workingDir, engineName, refID, cacheDigest, pEngines->pInFile, chunkSet);
+
+    if (TGM_DetectCacheLoad(pppEventBuffs, pNumBuffs, pCacheKey) == TGM_OK)
+    {
+        TGM_DetectCacheKeyFree(pCacheKey);
+        return TRUE;
+    }
+
+    *ppCacheKey = pCacheKey;
+    return FALSE;
+}
+
+// the loader reads and cuts the references in the load order ahead of the detection threads. it stops
+// when the number of references or the memory in flight would go over the limits, but always lets one in
+static void* TGM_SpecialDetectLoader(void* pArg)
+{
+    TGM_SpecialDetectPool* pPool = pArg;
+    TGM_DetectEngines* pEngines = pPool->pEngines;
+    TGM_DetectScheduler* pScheduler = pEngines->pScheduler;
+    int32_t minGap = SPLIT_GAP_FRAG_LEN_SCALE * pEngines->pLibTable->fragLenMax;
+    unsigned int nextDeque = 0;
+
+    TGM_DetectSchedulerLock(pScheduler);
+
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+    {
+        int32_t refID = pPool->pLoadOrder[i];
+        TGM_SpecialRefData* pRefData = pPool->pRefData + (refID - pEngines->pDetectPars->workingRefID[0]);
+
+        TGM_DetectSchedulerLoadWait(pScheduler, pRefData->numBytes);
+        TGM_DetectSchedulerUnlock(pScheduler);
+
+        // an unchanged reference takes the events of the last run
+        TGM_EventBuff** ppCachedBuffs = NULL;
+        unsigned int numCachedBuffs = 0;
+        TGM_DetectCacheKey* pCacheKey = NULL;
+
+        if (TGM_DetectCacheLookup(&ppCachedBuffs, &numCachedBuffs, &pCacheKey, pEngines, "special", pPool->cacheDigest, refID, (1 << TGM_SPECIAL_PAIR_CHUNK)))
+        {
+            TGM_DetectSchedulerLock(pScheduler);
+
+            pRefData->ppEventBuffs = ppCachedBuffs;
+            pRefData->numJobs = numCachedBuffs;
+            pRefData->numPending = 0;
+            pRefData->isLoaded = TRUE;
+
+            TGM_DetectSchedulerLoadDone(pScheduler, pRefData->numBytes);
+            TGM_DetectOutput(pEngines);
+            continue;
+        }
+
+        TGM_SpecialPairArray* pSpecialPairArray = (TGM_SpecialPairArray*) calloc(1, sizeof(TGM_SpecialPairArray));
+        if (pSpecialPairArray == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special pairs.\n");
+
+        // use the records in place if we can, otherwise read a copy
+        if (!TGM_SpecialPairArrayMap(pSpecialPairArray, pEngines->pInFile, refID))
+        {
+            TGM_ARRAY_INIT(pSpecialPairArray, 10, TGM_SpecialPair);
+            TGM_SpecialPairArrayRead(pSpecialPairArray, pEngines->pInFile, refID);
+        }
+
+        uint32_t* pOrder = TGM_SpecialPairArraySortOrder(pSpecialPairArray);
+
+        TGM_DetectJob* pJobs = NULL;
+        unsigned int numJobs = TGM_SpecialDetectMakeJobs(&pJobs, pSpecialPairArray, pOrder, refID, pRefData, pPool->splitSize, minGap);
+
+        pRefData->ppEventBuffs = (TGM_EventBuff**) calloc(numJobs + 1, sizeof(TGM_EventBuff*));
+        if (pRefData->ppEventBuffs == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special insertion events.\n");
+
+        // the largest jobs sit at the front of the queues where the idle threads steal from
+        qsort(pJobs, numJobs, sizeof(TGM_DetectJob), CompareJobSize);
+
+        TGM_DetectSchedulerLock(pScheduler);
+
+        pRefData->pSpecialPairArray = pSpecialPairArray;
+        pRefData->pOrder = pOrder;
+        pRefData->pCacheKey = pCacheKey;
+        pRefData->numJobs = numJobs;
+        pRefData->numPending = numJobs;
+        pRefData->isLoaded = TRUE;
+
+        for (unsigned int j = 0; j != numJobs; ++j)
+        {
+            TGM_DetectSchedulerPush(pScheduler, nextDeque, pJobs + j);
+            nextDeque = (nextDeque + 1) % pScheduler->numThread;
+        }
+
+        free(pJobs);
+
+        if (numJobs == 0)
+        {
+            TGM_SpecialDetectRelease(pPool, pRefData);
+            TGM_DetectOutput(pEngines);
+        }
+
+        TGM_DetectSchedulerBroadcast(pScheduler);
+    }
+
+    --(pEngines->numLoaders);
+    TGM_DetectSchedulerBroadcast(pScheduler);
+    TGM_DetectSchedulerUnlock(pScheduler);
+
+    return NULL;
+}
+
+// add a special pair to a window of a streamed reference. the memory of a new or larger window is
+// counted in before it is allocated, so the open windows are held to the loading limits too
+static void TGM_SpecialWindowAppend(TGM_DetectScheduler* pScheduler, TGM_SpecialPairArray** ppWindow, const TGM_SpecialPair* pSpecialPair)
+{
+    TGM_SpecialPairArray* pWindow = *ppWindow;
+
+    if (pWindow == NULL || TGM_ARRAY_IS_FULL(pWindow))
+    {
+        unsigned int numAdded = (pWindow == NULL ? 64 : pWindow->capacity);
+
+        TGM_DetectSchedulerLock(pScheduler);
+        TGM_DetectSchedulerLoadGrow(pScheduler, numAdded * sizeof(TGM_SpecialPair));
+        TGM_DetectSchedulerUnlock(pScheduler);
+
+        if (pWindow == NULL)
+        {
+            TGM_ARRAY_ALLOC(pWindow, numAdded, TGM_SpecialPairArray, TGM_SpecialPair);
+            *ppWindow = pWindow;
+        }
+        else
+        {
+            TGM_ARRAY_RESIZE(pWindow, pWindow->capacity * 2, TGM_SpecialPair);
+        }
+    }
+
+    pWindow->data[pWindow->size] = *pSpecialPair;
+    ++(pWindow->size);
+}
+
+// hand a window of special pairs over to the detection threads as a job of its streamed reference.
+// the pairs are already counted in the loading limits. the loader waits here while the data in flight
+// is over the limits
+static void TGM_SpecialDetectPushWindow(TGM_SpecialDetectPool* pPool, TGM_SpecialRefData* pRefData, TGM_SpecialPairArray* pSpecialPairArray,
+                                        int64_t ownBegin, int64_t ownEnd, int32_t refID, unsigned int* pJobCapacity, unsigned int* pNextDeque)
+{
+    TGM_DetectScheduler* pScheduler = pPool->pEngines->pScheduler;
+
+    TGM_DetectSchedulerLock(pScheduler);
+    TGM_DetectSchedulerLoadGrow(pScheduler, pSpecialPairArray->size * sizeof(uint32_t));
+    TGM_DetectSchedulerUnlock(pScheduler);
+
+    TGM_SpecialWindow* pWindow = (TGM_SpecialWindow*) malloc(sizeof(TGM_SpecialWindow));
+    if (pWindow == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a window of special pairs.\n");
+
+    pWindow->pRefData = pRefData;
+    pWindow->pSpecialPairArray = pSpecialPairArray;
+    pWindow->pOrder = TGM_SpecialPairArraySortOrder(pSpecialPairArray);
+    pWindow->ownBegin = ownBegin;
+    pWindow->ownEnd = ownEnd;
+    pWindow->numBytes = pSpecialPairArray->capacity * sizeof(TGM_SpecialPair) + pSpecialPairArray->size * sizeof(uint32_t);
+
+    const TGM_SpecialPair* pFirstPair = pSpecialPairArray->data + pWindow->pOrder[0];
+
+    TGM_DetectJob job;
+    job.data = pWindow;
+    job.refID = refID;
+    job.specialID = pFirstPair->specialID;
+    job.tileID = 0;
+    job.begin = 0;
+    job.end = pSpecialPairArray->size;
+    job.eventType = SV_SPECIAL;
+
+    TGM_DetectSchedulerLock(pScheduler);
+
+    TGM_DetectSchedulerLoadWait(pScheduler, 0);
+
+    // the detection threads store their events with the scheduler locked
+    if (pRefData->numJobs == *pJobCapacity)
+    {
+        *pJobCapacity = (*pJobCapacity == 0 ? DEFAULT_JOB_DEQUE_CAPACITY : *pJobCapacity * 2);
+
+        pRefData->ppEventBuffs = (TGM_EventBuff**) realloc(pRefData->ppEventBuffs, (*pJobCapacity + 1) * sizeof(TGM_EventBuff*));
+        pRefData->pJobKeys = (uint64_t*) realloc(pRefData->pJobKeys, (*pJobCapacity + 1) * sizeof(uint64_t));
+        if (pRefData->ppEventBuffs == NULL || pRefData->pJobKeys == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special insertion events.\n");
+    }
+
+    job.jobID = pRefData->numJobs;
+    pRefData->ppEventBuffs[job.jobID] = NULL;
+    pRefData->pJobKeys[job.jobID] = ((uint64_t) ((uint16_t) (pFirstPair->specialID + 0x8000)) << 32) | (uint32_t) pFirstPair->pos[0];
+
+    ++(pRefData->numJobs);
+    ++(pRefData->numPending);
+
+    TGM_DetectSchedulerPush(pScheduler, *pNextDeque, &job);
+    *pNextDeque = (*pNextDeque + 1) % pScheduler->numThread;
+
+    TGM_DetectSchedulerBroadcast(pScheduler);
+    TGM_DetectSchedulerUnlock(pScheduler);
+}
+
+// push the windows of a special reference the stream has moved far enough past. a gap that no cluster
+// or merged event spans ends all of them, while a cut window only waits for the pairs of its halo
+static void TGM_SpecialDetectAdvance(TGM_SpecialDetectPool* pPool, TGM_SpecialRefData* pRefData, TGM_SpecialWindowCut* pCut, int64_t pos,
+                                     int32_t minGap, int32_t refID, unsigned int* pJobCapacity, unsigned int* pNextDeque)
+{
+    if (pCut->pOpen == NULL)
+        return;
+
+    if (pos - pCut->pOpen->data[pCut->pOpen->size - 1].pos[0] > minGap)
+    {
+        if (pCut->pClosing != NULL)
+            TGM_SpecialDetectPushWindow(pPool, pRefData, pCut->pClosing, pCut->closingBegin, pCut->cutPos, refID, pJobCapacity, pNextDeque);
+
+        TGM_SpecialDetectPushWindow(pPool, pRefData, pCut->pOpen, pCut->openBegin, INT64_MAX, refID, pJobCapacity, pNextDeque);
+
+        pCut->pOpen = NULL;
+        pCut->pClosing = NULL;
+        pCut->openBegin = INT64_MIN;
+    }
+    else if (pCut->pClosing != NULL && pos >= pCut->cutPos + minGap)
+    {
+        TGM_SpecialDetectPushWindow(pPool, pRefData, pCut->pClosing, pCut->closingBegin, pCut->cutPos, refID, pJobCapacity, pNextDeque);
+        pCut->pClosing = NULL;
+    }
+}
+
+// the streaming loader reads the special pairs of a reference in position order and cuts a window
+// of a special reference as soon as the stream is a gap past its last pair. a dense region without
+// such a gap is cut into windows of at most a few maximum fragment lengths. they overlap by the gap
+// on each side and each of them only keeps the events starting in its core, like the tiles of the
+// local engine. the events are those of the in-memory loader except where a cluster chains further
+// than the gap past a cut. only the runs around the stream position and the windows not clustered
+// yet are in memory, instead of the whole reference
+static void* TGM_SpecialDetectStreamLoader(void* pArg)
+{
+    TGM_SpecialDetectPool* pPool = pArg;
+    TGM_DetectEngines* pEngines = pPool->pEngines;
+    TGM_DetectScheduler* pScheduler = pEngines->pScheduler;
+    int32_t minGap = SPLIT_GAP_FRAG_LEN_SCALE * pEngines->pLibTable->fragLenMax;
+    int32_t windowSize = WINDOW_FRAG_LEN_SCALE * pEngines->pLibTable->fragLenMax;
+    unsigned int numSpecialIDs = pPool->pSpecialID->size;
+    unsigned int nextDeque = 0;
+
+    // windows of each special reference
+    TGM_SpecialWindowCut cuts[numSpecialIDs + 1];
+
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+    {
+        int32_t refID = pPool->pLoadOrder[i];
+        TGM_SpecialRefData* pRefData = pPool->pRefData + (refID - pEngines->pDetectPars->workingRefID[0]);
+        unsigned int jobCapacity = 0;
+
+        // an unchanged reference takes the events of the last run
+        TGM_EventBuff** ppCachedBuffs = NULL;
+        unsigned int numCachedBuffs = 0;
+        TGM_DetectCacheKey* pCacheKey = NULL;
+
+        if (TGM_DetectCacheLookup(&ppCachedBuffs, &numCachedBuffs, &pCacheKey, pEngines, "special", pPool->cacheDigest, refID, (1 << TGM_SPECIAL_PAIR_CHUNK)))
+        {
+            TGM_DetectSchedulerLock(pScheduler);
+
+            pRefData->ppEventBuffs = ppCachedBuffs;
+            pRefData->numJobs = numCachedBuffs;
+            pRefData->isLoaded = TRUE;
+            TGM_DetectOutput(pEngines);
+
+            TGM_DetectSchedulerUnlock(pScheduler);
+            continue;
+        }
+
+        // the windows are pushed before the reference is read to the end. the key must be in place before the last of them finishes
+        TGM_DetectSchedulerLock(pScheduler);
+        pRefData->pCacheKey = pCacheKey;
+        TGM_DetectSchedulerUnlock(pScheduler);
+
+        for (unsigned int s = 0; s != numSpecialIDs; ++s)
+        {
+            cuts[s].pOpen = NULL;
+            cuts[s].pClosing = NULL;
+            cuts[s].openBegin = INT64_MIN;
+        }
+
+        TGM_ReadPairStream* pStream = TGM_ReadPairStreamOpen(pEngines->pInFile, refID, TGM_SPECIAL_PAIR_CHUNK);
+
+        const TGM_SpecialPair* pSpecialPair = NULL;
+        int64_t lastSweep = INT32_MIN;
+        while ((pSpecialPair = TGM_ReadPairStreamNext(pStream)) != NULL)
+        {
+            if (pSpecialPair->specialID < 0 || pSpecialPair->specialID >= (int) numSpecialIDs)
+                TGM_ErrQuit("ERROR: Unknown special reference ID in the read pair file: %d.\n", pSpecialPair->specialID);
+
+            int64_t pos = pSpecialPair->pos[0];
+            TGM_SpecialWindowCut* pCut = cuts + pSpecialPair->specialID;
+            TGM_SpecialDetectAdvance(pPool, pRefData, pCut, pos, minGap, refID, &jobCapacity, &nextDeque);
+
+            // the pairs in the halo before the cut start the next window
+            if (pCut->pOpen != NULL && pCut->pClosing == NULL)
+            {
+                int64_t coreBegin = (pCut->openBegin == INT64_MIN ? pCut->pOpen->data[0].pos[0] : pCut->openBegin);
+                if (pos >= coreBegin + windowSize)
+                {
+                    TGM_SpecialPairArray* pClosing = pCut->pOpen;
+
+                    pCut->pClosing = pClosing;
+                    pCut->closingBegin = pCut->openBegin;
+                    pCut->cutPos = coreBegin + windowSize;
+                    pCut->pOpen = NULL;
+                    pCut->openBegin = pCut->cutPos;
+
+                    unsigned int j = pClosing->size;
+                    while (j > 0 && pClosing->data[j - 1].pos[0] >= pCut->cutPos - minGap)
+                        --j;
+
+                    for (; j != pClosing->size; ++j)
+                        TGM_SpecialWindowAppend(pScheduler, &(pCut->pOpen), pClosing->data + j);
+                }
+            }
+
+            TGM_SpecialWindowAppend(pScheduler, &(pCut->pOpen), pSpecialPair);
+            if (pCut->pClosing != NULL)
+                TGM_SpecialWindowAppend(pScheduler, &(pCut->pClosing), pSpecialPair);
+
+            // the windows of the other special references are pushed once the stream is far enough past them
+            if (pos - lastSweep > minGap)
+            {
+                for (unsigned int s = 0; s != numSpecialIDs; ++s)
+                    TGM_SpecialDetectAdvance(pPool, pRefData, cuts + s, pos, minGap, refID, &jobCapacity, &nextDeque);
+
+                lastSweep = pos;
+            }
+        }
+
+        TGM_ReadPairStreamClose(pStream);
+
+        for (unsigned int s = 0; s != numSpecialIDs; ++s)
+            TGM_SpecialDetectAdvance(pPool, pRefData, cuts + s, INT64_MAX, minGap, refID, &jobCapacity, &nextDeque);
+
+        TGM_DetectSchedulerLock(pScheduler);
+
+        pRefData->isLoaded = TRUE;
+        if (pRefData->numPending == 0)
+            TGM_DetectOutput(pEngines);
+
+        TGM_DetectSchedulerUnlock(pScheduler);
+    }
+
+    TGM_DetectSchedulerLock(pScheduler);
+
+    --(pEngines->numLoaders);
+    TGM_DetectSchedulerBroadcast(pScheduler);
+    TGM_DetectSchedulerUnlock(pScheduler);
+
+    return NULL;
+}
+
+// sort the local pairs by position without moving them (they may be mapped read only)
+static uint32_t* TGM_LocalPairArraySortOrder(const TGM_LocalPairArray* pLocalPairArray)
+{
+    uint64_t size = pLocalPairArray->size;
+
+    uint32_t* pOrder = (uint32_t*) malloc((size + 1) * sizeof(uint32_t));
+    TGM_SortKey* pKeys = (TGM_SortKey*) malloc(2 * (size + 1) * sizeof(TGM_SortKey));
+    if (pOrder == NULL || pKeys == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the order of the local pairs.\n");
+
+    for (uint64_t i = 0; i != size; ++i)
+    {
+        pKeys[i].key = (uint32_t) pLocalPairArray->data[i].upPos;
+        pKeys[i].index = i;
+    }
+
+    const TGM_SortKey* pSorted = TGM_RadixSortKeys(pKeys, pKeys + size + 1, size);
+    for (uint64_t i = 0; i != size; ++i)
+        pOrder[i] = pSorted[i].index;
+
+    free(pKeys);
+
+    return pOrder;
+}
+
+// index of the first local pair in the position order at or after a position
+static uint32_t TGM_LocalPairLowerBound(const TGM_LocalPairArray* pLocalPairArray, const uint32_t* pOrder, int64_t pos)
+{
+    uint32_t low = 0;
+    uint32_t high = pLocalPairArray->size;
+
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        if ((int64_t) pLocalPairArray->data[pOrder[mid]].upPos < pos)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+// the positions covered by a tile and its halo on both sides. a tile sees the clusters of its core as the
+// whole reference does as long as they reach no further than the halo past the core. a longer chain of
+// read pairs is cut at the halo, and the events made of it can differ from those of an untiled run
+static inline void TGM_LocalTileBounds(int64_t bounds[2], unsigned int tileID, int32_t tileSize, int32_t halo)
+{
+    bounds[0] = (int64_t) tileID * tileSize - halo;
+    bounds[1] = (int64_t) (tileID + 1) * tileSize + halo;
+}
+
+// an event belongs to the tile whose core holds its start position, so an event seen by two tiles is written once.
+// the events past the last tile belong to the last tile
+static inline TGM_Bool TGM_LocalTileOwns(uint32_t pos, unsigned int tileID, int32_t tileSize, unsigned int numTiles)
+{
+    if (numTiles == 1)
+        return TRUE;
+
+    uint64_t owner = pos / (uint32_t) tileSize;
+    if (owner >= numTiles)
+        owner = numTiles - 1;
+
+    return (owner == tileID);
+}
+
+// sort the local pairs of a reference by position and cut the reference into tiles
+static unsigned int TGM_LocalDetectMakeTiles(TGM_LocalRefData* pRefData, int32_t tileSize)
+{
+    int32_t maxPos = 0;
+
+    for (unsigned int j = 0; j != NUM_LOCAL_PAIR_CHUNK; ++j)
+    {
+        const TGM_LocalPairArray* pLocalPairArray = pRefData->pLocalPairArrays[j];
+        if (pLocalPairArray == NULL || pLocalPairArray->size == 0)
+            continue;
+
+        pRefData->pOrders[j] = TGM_LocalPairArraySortOrder(pLocalPairArray);
+
+        int32_t lastPos = pLocalPairArray->data[pRefData->pOrders[j][pLocalPairArray->size - 1]].upPos;
+        if (lastPos > maxPos)
+            maxPos = lastPos;
+    }
+
+    return maxPos / tileSize + 1;
+}
+
+// make the jobs of a reference: one for each local SV type and tile with read pairs in it. the translocations
+// are clustered on a grid hash of the whole reference and are never tiled
+static unsigned int TGM_LocalDetectMakeJobs(TGM_DetectJob* pJobs, const TGM_LocalDetectPool* pPool, TGM_LocalRefData* pRefData,
+                                            int32_t refID, const uint64_t* pNumPairs)
+{
+    int32_t tileSize = pPool->pEngines->pDetectPars->tileSize;
+    int32_t halo = pPool->pEngines->pLibTable->fragLenMax;
+    unsigned int numJobs = 0;
+
+    for (unsigned int k = 0; k != NUM_LOCAL_SV_TYPE; ++k)
+    {
+        if ((pPool->detectSet & (1 << TGM_LocalEventTypes[k])) == 0)
+            continue;
+
+        unsigned int numTiles = (TGM_LocalEventTypes[k] == SV_INTER_CHR_TRNSLCTN ? 1 : pRefData->numTiles);
+        for (unsigned int t = 0; t != numTiles; ++t)
+        {
+            uint64_t numJobPairs = 0;
+            for (unsigned int j = 0; j != TGM_NUM_RP_CHUNK_TYPES; ++j)
+            {
+                if ((TGM_LocalEventChunks[k] & (1 << j)) == 0)
+                    continue;
+
+                if (numTiles == 1)
+                    numJobPairs += pNumPairs[j];
+                else if (pNumPairs[j] != 0)
+                {
+                    int64_t bounds[2];
+                    TGM_LocalTileBounds(bounds, t, tileSize, halo);
+
+                    const TGM_LocalPairArray* pLocalPairArray = pRefData->pLocalPairArrays[j];
+                    numJobPairs += TGM_LocalPairLowerBound(pLocalPairArray, pRefData->pOrders[j], bounds[1])
+                                   - TGM_LocalPairLowerBound(pLocalPairArray, pRefData->pOrders[j], bounds[0]);
+                }
+            }
+
+            if (numJobPairs == 0)
+                continue;
+
+            TGM_DetectJob* pJob = pJobs + numJobs;
+
+            pJob->data = pRefData;
+            pJob->refID = refID;
+            pJob->specialID = -1;
+            pJob->jobID = k * pRefData->numTiles + t;
+            pJob->tileID = t;
+            pJob->begin = 0;
+            pJob->end = numJobPairs;
+            pJob->eventType = TGM_LocalEventTypes[k];
+
+            ++numJobs;
+        }
+    }
+
+    return numJobs;
+}
+
+// the loader of the local SV engine. the local pairs of a reference are loaded once and make one job for
+// each local SV type. with a tile size, a reference is cut into tiles that overlap by the maximum fragment
+// length and each tile is a job of its own
+static void* TGM_LocalDetectLoader(void* pArg)
+{
+    TGM_LocalDetectPool* pPool = pArg;
+    TGM_DetectEngines* pEngines = pPool->pEngines;
+    TGM_DetectScheduler* pScheduler = pEngines->pScheduler;
+    int32_t tileSize = pEngines->pDetectPars->tileSize;
+    unsigned int nextDeque = 0;
+
+    TGM_DetectSchedulerLock(pScheduler);
+
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+    {
+        int32_t refID = pPool->pLoadOrder[i];
+        TGM_LocalRefData* pRefData = pPool->pRefData + (refID - pEngines->pDetectPars->workingRefID[0]);
+
+        TGM_DetectSchedulerLoadWait(pScheduler, pRefData->numBytes);
+        TGM_DetectSchedulerUnlock(pScheduler);
+
+        // an unchanged reference takes the events of the last run
+        TGM_EventBuff** ppCachedBuffs = NULL;
+        unsigned int numCachedBuffs = 0;
+        TGM_DetectCacheKey* pCacheKey = NULL;
+
+        if (TGM_DetectCacheLookup(&ppCachedBuffs, &numCachedBuffs, &pCacheKey, pEngines, "local", pPool->cacheDigest, refID, pPool->chunkSet))
+        {
+            TGM_DetectSchedulerLock(pScheduler);
+
+            pRefData->ppEventBuffs = ppCachedBuffs;
+            pRefData->numBuffs = numCachedBuffs;
+            pRefData->numPending = 0;
+            pRefData->isLoaded = TRUE;
+
+            TGM_LocalDetectRelease(pPool, pRefData);
+            TGM_DetectOutput(pEngines);
+            continue;
+        }
+
+        uint64_t numPairs[TGM_NUM_RP_CHUNK_TYPES] = {0};
+        for (unsigned int j = 0; j != NUM_LOCAL_PAIR_CHUNK; ++j)
+        {
+            if ((pPool->chunkSet & (1 << j)) == 0)
+                continue;
+
+            TGM_LocalPairArray* pLocalPairArray = (TGM_LocalPairArray*) calloc(1, sizeof(TGM_LocalPairArray));
+            if (pLocalPairArray == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the local pairs.\n");
+
+            // use the records in place if we can, otherwise read a copy
+            if (!TGM_LocalPairArrayMap(pLocalPairArray, pEngines->pInFile, refID, j))
+            {
+                TGM_ARRAY_INIT(pLocalPairArray, 10, TGM_LocalPair);
+                TGM_LocalPairArrayRead(pLocalPairArray, pEngines->pInFile, refID, j);
+            }
+
+            pRefData->pLocalPairArrays[j] = pLocalPairArray;
+            numPairs[j] = pLocalPairArray->size;
+        }
+
+        if ((pPool->chunkSet & (1 << TGM_CROSS_PAIR_CHUNK)) != 0)
+        {
+            TGM_CrossPairArray* pCrossPairArray = (TGM_CrossPairArray*) calloc(1, sizeof(TGM_CrossPairArray));
+            if (pCrossPairArray == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the cross pairs.\n");
+
+            if (!TGM_CrossPairArrayMap(pCrossPairArray, pEngines->pInFile, refID))
+            {
+                TGM_ARRAY_INIT(pCrossPairArray, 10, TGM_CrossPair);
+                TGM_CrossPairArrayRead(pCrossPairArray, pEngines->pInFile, refID);
+            }
+
+            pRefData->pCrossPairArray = pCrossPairArray;
+            numPairs[TGM_CROSS_PAIR_CHUNK] = pCrossPairArray->size;
+        }
+
+        pRefData->numTiles = 1;
+        if (tileSize > 0)
+            pRefData->numTiles = TGM_LocalDetectMakeTiles(pRefData, tileSize);
+
+        unsigned int maxJobs = NUM_LOCAL_SV_TYPE * pRefData->numTiles;
+        TGM_DetectJob* pJobs = (TGM_DetectJob*) malloc(maxJobs * sizeof(TGM_DetectJob));
+        pRefData->ppEventBuffs = (TGM_EventBuff**) calloc(maxJobs, sizeof(TGM_EventBuff*));
+        if (pJobs == NULL || pRefData->ppEventBuffs == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the local SV detection jobs.\n");
+
+        unsigned int numJobs = TGM_LocalDetectMakeJobs(pJobs, pPool, pRefData, refID, numPairs);
+
+        TGM_DetectSchedulerLock(pScheduler);
+
+        pRefData->pCacheKey = pCacheKey;
+        pRefData->numBuffs = maxJobs;
+        pRefData->numPending = numJobs;
+        pRefData->isLoaded = TRUE;
+
+        for (unsigned int j = 0; j != numJobs; ++j)
+        {
+            TGM_DetectSchedulerPush(pScheduler, nextDeque, pJobs + j);
+            nextDeque = (nextDeque + 1) % pScheduler->numThread;
+        }
+
+        free(pJobs);
+
+        if (pRefData->numPending == 0)
+        {
+            TGM_LocalDetectRelease(pPool, pRefData);
+            TGM_DetectOutput(pEngines);
+        }
+
+        TGM_DetectSchedulerBroadcast(pScheduler);
+    }
+
+    --(pEngines->numLoaders);
+    TGM_DetectSchedulerBroadcast(pScheduler);
+    TGM_DetectSchedulerUnlock(pScheduler);
+
+    return NULL;
+}
+
+static void TGM_SpecialDetectRun(TGM_SpecialDetectPool* pPool, TGM_DetectWorkspace* pWorkspace, const TGM_DetectJob* pJob)
+{
+    TGM_DetectEngines* pEngines = pPool->pEngines;
+    TGM_SpecialRefData* pRefData = pJob->data;
+    TGM_SpecialWindow* pWindow = NULL;
+
+    const TGM_SpecialPairArray* pSpecialPairArray = NULL;
+    const uint32_t* pOrder = NULL;
+
+    // a job of a streamed reference owns its window of special pairs
+    if (pEngines->pDetectPars->streamSpecial)
+    {
+        pWindow = pJob->data;
+        pRefData = pWindow->pRefData;
+        pSpecialPairArray = pWindow->pSpecialPairArray;
+        pOrder = pWindow->pOrder;
+    }
+    else
+    {
+        pSpecialPairArray = pRefData->pSpecialPairArray;
+        pOrder = pRefData->pOrder;
+    }
+
+    TGM_SupportArray* pSupportArray = NULL;
+    if (pEngines->pDetectPars->sampleSupport)
+    {
+        pSupportArray = pWorkspace->pSupportArray;
+        TGM_ARRAY_RESET(pSupportArray);
+    }
+
+    TGM_SpecialEventArray* pSpecialEventArray = NULL;
+    TGM_ARRAY_ALLOC(pSpecialEventArray, DEFAULT_SV_CAPACITY, TGM_SpecialEventArray, TGM_SpecialEvent);
+
+    TGM_DetectSpecialOne(pSpecialEventArray, pWorkspace->pSideEvents, pSupportArray, pWorkspace->pClusters[0], pWorkspace->pClusters[1], pWorkspace->pAttrbtArrays,
+                         pWorkspace->pMemberPairs, pSpecialPairArray, pOrder, pJob->begin, pJob->end, pEngines->pLibTable);
+
+    // the events are formatted here so that the writer thread only merges and writes
+    TGM_EventBuff* pEventBuff = TGM_EventBuffAlloc();
+    const char* specialName = pPool->pSpecialID->names[pJob->specialID];
+    char* const* pAnchors = pEngines->pLibTable->pAnchorInfo->pAnchors;
+    TGM_EventFormat format = pEngines->pDetectPars->outputFormat;
+    for (unsigned int i = 0; i != pSpecialEventArray->size; ++i)
+    {
+        // an event in the halo of a window is kept by the window next to it
+        if (pWindow != NULL && (pSpecialEventArray->data[i].pos < pWindow->ownBegin || pSpecialEventArray->data[i].pos >= pWindow->ownEnd))
+            continue;
+
+        TGM_SpecialEventWrite(pEventBuff, pSpecialEventArray->data + i, specialName, pAnchors, format);
+        TGM_EventSampleWrite(pEventBuff, pSupportArray, pSpecialEventArray->data[i].support, NULL, pEngines->sampleFields, pEngines->pLibTable->pSampleInfo, format);
+    }
+
+    TGM_ARRAY_FREE(pSpecialEventArray, TRUE);
+
+    TGM_DetectSchedulerLock(pEngines->pScheduler);
+
+    pRefData->ppEventBuffs[pJob->jobID] = pEventBuff;
+
+    if (pWindow != NULL)
+    {
+        TGM_ARRAY_FREE(pWindow->pSpecialPairArray, TRUE);
+        free(pWindow->pOrder);
 
-            TGM_ClusterBuild(pCluster3);
-            TGM_ClusterBuild(pCluster5);
+        TGM_DetectSchedulerLoadDone(pEngines->pScheduler, pWindow->numBytes);
+        free(pWindow);
+    }
+
+    // the last job of a reference releases its special pairs. a streamed reference
+    // may run out of jobs before it is read to the end, the output waits for that
+    --(pRefData->numPending);
+    if (pRefData->numPending == 0)
+    {
+        if (pWindow == NULL)
+            TGM_SpecialDetectRelease(pPool, pRefData);
 
-            TGM_ClusterFinalize(pCluster3);
-            TGM_ClusterFinalize(pCluster5);
+        TGM_DetectOutput(pEngines);
+    }
 
-            TGM_ClusterClean(pCluster3);
-            TGM_ClusterClean(pCluster5);
+    TGM_DetectSchedulerUnlock(pEngines->pScheduler);
+}
 
-            // TGM_ClusterPrint(pCluster3, k, pSpecialID->names[i / 2]);
-            // TGM_ClusterPrint(pCluster5, k, pSpecialID->names[i / 2]);
+static void TGM_LocalDetectRun(TGM_LocalDetectPool* pPool, TGM_DetectWorkspace* pWorkspace, const TGM_DetectJob* pJob)
+{
+    TGM_DetectEngines* pEngines = pPool->pEngines;
+    TGM_LocalRefData* pRefData = pJob->data;
+    int32_t tileSize = pEngines->pDetectPars->tileSize;
+    unsigned int numTiles = (pJob->eventType == SV_INTER_CHR_TRNSLCTN ? 1 : pRefData->numTiles);
 
-            const TGM_Cluster* pCluster = pCluster3;
-            unsigned int numClsElmnts = pCluster->pElmntArray->length;
-            for (unsigned int j = 0; j != numClsElmnts; ++j)
-            {
-                if (pCluster->pElmntArray->data[j].numReadPair == 0)
-                    continue;
+    TGM_LocalPairArray* pLocalPairArrays[NUM_LOCAL_PAIR_CHUNK];
+    memcpy(pLocalPairArrays, pRefData->pLocalPairArrays, sizeof(pLocalPairArrays));
+
+    // a tile clusters its own copy of the local pairs in its core and halo
+    if (numTiles > 1)
+    {
+        int64_t bounds[2];
+        TGM_LocalTileBounds(bounds, pJob->tileID, tileSize, pEngines->pLibTable->fragLenMax);
+
+        unsigned int numCopies = 0;
+        for (unsigned int j = 0; j != NUM_LOCAL_PAIR_CHUNK; ++j)
+        {
+            if ((TGM_LocalEventChunks[pJob->jobID / pRefData->numTiles] & (1 << j)) == 0 || pLocalPairArrays[j] == NULL)
+                continue;
+
+            const uint32_t* pOrder = pRefData->pOrders[j];
+            TGM_LocalPairArray* pTilePairs = pWorkspace->pTilePairs[numCopies++];
+
+            uint32_t first = (pOrder != NULL ? TGM_LocalPairLowerBound(pLocalPairArrays[j], pOrder, bounds[0]) : 0);
+            uint32_t last = (pOrder != NULL ? TGM_LocalPairLowerBound(pLocalPairArrays[j], pOrder, bounds[1]) : 0);
+
+            TGM_ARRAY_RESIZE_NO_COPY(pTilePairs, last - first + 1, TGM_LocalPair);
+            for (uint32_t i = first; i != last; ++i)
+                pTilePairs->data[i - first] = pLocalPairArrays[j]->data[pOrder[i]];
+
+            pTilePairs->size = last - first;
+            pLocalPairArrays[j] = pTilePairs;
+        }
+    }
+
+    // a job gets its share of the threads so that the largest ones do not hold up the end of the run
+    unsigned int numThreads = (pJob->end * (uint64_t) pEngines->numThreads + pPool->totalCount - 1) / pPool->totalCount;
+    if (numThreads == 0)
+        numThreads = 1;
+
+    TGM_EventFormat format = pEngines->pDetectPars->outputFormat;
+    TGM_EventBuff* pEventBuff = TGM_EventBuffAlloc();
+    const TGM_SampleInfo* pSampleInfo = pEngines->pLibTable->pSampleInfo;
+    char* const* pAnchors = pEngines->pLibTable->pAnchorInfo->pAnchors;
+
+    TGM_SupportArray* pSupportArray = NULL;
+    if (pEngines->pDetectPars->sampleSupport)
+    {
+        pSupportArray = pWorkspace->pSupportArray;
+        TGM_ARRAY_RESET(pSupportArray);
+    }
+
+    // the owned events of a job are genotyped in one batch. the k-th owned event gets the counts of the k-th site
+    TGM_Genotyper* pGenotyper = pWorkspace->pGenotyper;
+    const uint32_t* pGenotypeCounts = NULL;
+    unsigned int numSites = 0;
+    if (pGenotyper != NULL)
+        TGM_GenotyperReset(pGenotyper);
 
-                if (TGM_ARRAY_IS_FULL(pSpecialEventArray))
-                    TGM_ARRAY_RESIZE(pSpecialEventArray, pSpecialEventArray->capacity * 2, TGM_SpecialEvent);
+    TGM_DelArray* pDelArray = NULL;
+    TGM_DupArray* pDupArray = NULL;
+    TGM_InvArray* pInvArray = NULL;
+    TGM_TransArray* pTransArray = NULL;
 
-                TGM_SpecialEvent* pSpecialEvent = pSpecialEventArray->data + pSpecialEventArray->size;
-                TGM_SpecialEventMake(pSpecialEvent, pCluster, j, pSpecialPairArray, pLibTable);
-                ++(pSpecialEventArray->size);
+    switch (pJob->eventType)
+    {
+        case SV_DELETION:
+            TGM_ARRAY_ALLOC(pDelArray, DEFAULT_SV_CAPACITY, TGM_DelArray, TGM_DelEvent);
+            TGM_DetectDelOne(pDelArray, pSupportArray, pWorkspace, pLocalPairArrays[TGM_LONG_PAIR_CHUNK], numThreads, pEngines->pLibTable, pEngines->pDetectPars);
+
+            for (unsigned int i = 0; pGenotyper != NULL && i != pDelArray->size; ++i)
+            {
+                if (TGM_LocalTileOwns(pDelArray->data[i].pos, pJob->tileID, tileSize, numTiles))
+                    TGM_GenotyperAddSite(pGenotyper, pDelArray->data[i].refID, pDelArray->data[i].pos, pDelArray->data[i].end, SV_DELETION);
             }
 
-            pCluster = pCluster5;
-            numClsElmnts = pCluster->pElmntArray->length;
-            for (unsigned int j = 0; j != numClsElmnts; ++j)
+            if (pGenotyper != NULL)
+                TGM_GenotyperRun(pGenotyper);
+
+            for (unsigned int i = 0; i != pDelArray->size; ++i)
             {
-                if (pCluster->pElmntArray->data[j].numReadPair == 0)
-                    continue;
+                if (TGM_LocalTileOwns(pDelArray->data[i].pos, pJob->tileID, tileSize, numTiles))
+                {
+                    if (pGenotyper != NULL)
+                        pGenotypeCounts = TGM_GenotyperCounts(pGenotyper, numSites++);
+
+                    TGM_DelEventWrite(pEventBuff, pDelArray->data + i, pAnchors, format);
+                    TGM_EventSampleWrite(pEventBuff, pSupportArray, pDelArray->data[i].support, pGenotypeCounts, pEngines->sampleFields, pSampleInfo, format);
+                }
+            }
 
-                if (TGM_ARRAY_IS_FULL(pSpecialEventArray))
-                    TGM_ARRAY_RESIZE(pSpecialEventArray, pSpecialEventArray->capacity * 2, TGM_SpecialEvent);
+            TGM_ARRAY_FREE(pDelArray, TRUE);
+            break;
+        case SV_TANDEM_DUP:
+            TGM_ARRAY_ALLOC(pDupArray, DEFAULT_SV_CAPACITY, TGM_DupArray, TGM_DupEvent);
+            TGM_DetectDupOne(pDupArray, pSupportArray, pWorkspace, pLocalPairArrays[TGM_SHORT_PAIR_CHUNK], pLocalPairArrays[TGM_REVERSED_PAIR_CHUNK],
+                             numThreads, pEngines->pLibTable, pEngines->pDetectPars);
 
-                TGM_SpecialEvent* pSpecialEvent = pSpecialEventArray->data + pSpecialEventArray->size;
-                TGM_SpecialEventMake(pSpecialEvent, pCluster, j, pSpecialPairArray, pLibTable);
-                ++(pSpecialEventArray->size);
+            for (unsigned int i = 0; pGenotyper != NULL && i != pDupArray->size; ++i)
+            {
+                if (TGM_LocalTileOwns(pDupArray->data[i].pos, pJob->tileID, tileSize, numTiles))
+                    TGM_GenotyperAddSite(pGenotyper, pDupArray->data[i].refID, pDupArray->data[i].pos, pDupArray->data[i].end, SV_TANDEM_DUP);
             }
 
-            qsort(pSpecialEventArray->data, pSpecialEventArray->size, sizeof(TGM_SpecialEvent), CompareSpecialEvents);
+            if (pGenotyper != NULL)
+                TGM_GenotyperRun(pGenotyper);
 
-            unsigned int headIndex = 1;
-            unsigned int tailIndex = 0;
-            unsigned int newSize = pSpecialEventArray->size;
-            while (headIndex < pSpecialEventArray->size)
+            for (unsigned int i = 0; i != pDupArray->size; ++i)
             {
-                TGM_SpecialEvent mergedEvent;
-                if (abs(pSpecialEventArray->data[headIndex].pos - pSpecialEventArray->data[tailIndex].pos) < pLibTable->fragLenMax)
+                if (TGM_LocalTileOwns(pDupArray->data[i].pos, pJob->tileID, tileSize, numTiles))
                 {
-                    TGM_SpecialEvent* pHeadEvent = pSpecialEventArray->data + headIndex;
-                    TGM_SpecialEvent* pTailEvent = pSpecialEventArray->data + tailIndex;
+                    if (pGenotyper != NULL)
+                        pGenotypeCounts = TGM_GenotyperCounts(pGenotyper, numSites++);
+
+                    TGM_DupEventWrite(pEventBuff, pDupArray->data + i, pAnchors, format);
+                    TGM_EventSampleWrite(pEventBuff, pSupportArray, pDupArray->data[i].support, pGenotypeCounts, pEngines->sampleFields, pSampleInfo, format);
+                }
+            }
+
+            TGM_ARRAY_FREE(pDupArray, TRUE);
+            break;
+        case SV_INVERSION:
+            TGM_ARRAY_ALLOC(pInvArray, DEFAULT_SV_CAPACITY, TGM_InvArray, TGM_InvEvent);
+            TGM_DetectInvOne(pInvArray, pSupportArray, pWorkspace, pLocalPairArrays[TGM_INVERTED_PAIR_CHUNK], numThreads, pEngines->pLibTable, pEngines->pDetectPars);
+
+            for (unsigned int i = 0; pGenotyper != NULL && i != pInvArray->size; ++i)
+            {
+                if (TGM_LocalTileOwns(pInvArray->data[i].pos, pJob->tileID, tileSize, numTiles))
+                    TGM_GenotyperAddSite(pGenotyper, pInvArray->data[i].refID, pInvArray->data[i].pos, pInvArray->data[i].end, SV_INVERSION);
+            }
+
+            if (pGenotyper != NULL)
+                TGM_GenotyperRun(pGenotyper);
 
-                    TGM_SpecialEventMerge(&mergedEvent, pHeadEvent, pTailEvent, pCluster3, pCluster5);
-                    memcpy(pTailEvent, &mergedEvent, sizeof(TGM_SpecialEvent));
+            for (unsigned int i = 0; i != pInvArray->size; ++i)
+            {
+                if (TGM_LocalTileOwns(pInvArray->data[i].pos, pJob->tileID, tileSize, numTiles))
+                {
+                    if (pGenotyper != NULL)
+                        pGenotypeCounts = TGM_GenotyperCounts(pGenotyper, numSites++);
 
-                    --newSize;
+                    TGM_InvEventWrite(pEventBuff, pInvArray->data + i, pAnchors, format);
+                    TGM_EventSampleWrite(pEventBuff, pSupportArray, pInvArray->data[i].support, pGenotypeCounts, pEngines->sampleFields, pSampleInfo, format);
                 }
-                else
+            }
+
+            TGM_ARRAY_FREE(pInvArray, TRUE);
+            break;
+        case SV_INTER_CHR_TRNSLCTN:
+            // the grid clustering is linear in the number of cross pairs and runs on one thread
+            TGM_ARRAY_ALLOC(pTransArray, DEFAULT_SV_CAPACITY, TGM_TransArray, TGM_TransEvent);
+            TGM_ReadPairFindTrans(pTransArray, pSupportArray, pWorkspace->pCrossGrid, pWorkspace->pAssistArray, pRefData->pCrossPairArray,
+                                  pEngines->pLibTable, pEngines->pDetectPars);
+
+            for (unsigned int i = 0; i != pTransArray->size; ++i)
+            {
+                TGM_TransEventWrite(pEventBuff, pTransArray->data + i, pAnchors, format);
+                TGM_EventSampleWrite(pEventBuff, pSupportArray, pTransArray->data[i].support, NULL, pEngines->sampleFields, pSampleInfo, format);
+            }
+
+            TGM_ARRAY_FREE(pTransArray, TRUE);
+            break;
+        default:
+            break;
+    }
+
+    TGM_DetectSchedulerLock(pEngines->pScheduler);
+
+    pRefData->ppEventBuffs[pJob->jobID] = pEventBuff;
+
+    // the last job of a reference releases its local pairs
+    --(pRefData->numPending);
+    if (pRefData->numPending == 0)
+    {
+        TGM_LocalDetectRelease(pPool, pRefData);
+        TGM_DetectOutput(pEngines);
+    }
+
+    TGM_DetectSchedulerUnlock(pEngines->pScheduler);
+}
+
+static void TGM_DetectWorkspaceInit(TGM_DetectWorkspace* pWorkspace, const TGM_DetectEngines* pEngines)
+{
+    for (unsigned int i = 0; i != 2; ++i)
+    {
+        pWorkspace->pAttrbtArrays[i] = TGM_ReadPairAttrbtArrayAlloc(pEngines->pLibTable->size);
+        pWorkspace->pClusters[i] = TGM_ClusterAlloc(pEngines->pDetectPars->minNumClustered);
+    }
+
+    pWorkspace->pMemberPairs = NULL;
+    TGM_ARRAY_ALLOC(pWorkspace->pMemberPairs, DEFAULT_SV_CAPACITY, TGM_SpecialPairArray, TGM_SpecialPair);
+
+    pWorkspace->pSideEvents = NULL;
+    TGM_ARRAY_ALLOC(pWorkspace->pSideEvents, DEFAULT_SV_CAPACITY, TGM_SpecialEventArray, TGM_SpecialEvent);
+
+    pWorkspace->pAssistArray = SV_AssistArrayAlloc();
+    pWorkspace->pCrossGrid = TGM_CrossGridAlloc();
+
+    for (unsigned int i = 0; i != 2; ++i)
+    {
+        pWorkspace->pTilePairs[i] = NULL;
+        TGM_ARRAY_ALLOC(pWorkspace->pTilePairs[i], DEFAULT_SV_CAPACITY, TGM_LocalPairArray, TGM_LocalPair);
+    }
+
+    pWorkspace->pSupportArray = NULL;
+    TGM_ARRAY_ALLOC(pWorkspace->pSupportArray, DEFAULT_SV_CAPACITY, TGM_SupportArray, TGM_SampleCount);
+
+    // each thread reads the BAM files with its own inputs and block caches
+    pWorkspace->pGenotyper = NULL;
+    if (pEngines->ppBamIndices != NULL)
+    {
+        const TGM_ReadPairDetectPars* pDetectPars = pEngines->pDetectPars;
+        pWorkspace->pGenotyper = TGM_GenotyperAlloc(pDetectPars->bamFileNames, pEngines->ppBamIndices, pDetectPars->numBamFiles, pDetectPars->genotypeCacheBlocks,
+                                                    pEngines->pLibTable);
+    }
+}
+
+static void TGM_DetectWorkspaceDestroy(TGM_DetectWorkspace* pWorkspace)
+{
+    for (unsigned int i = 0; i != 2; ++i)
+    {
+        TGM_ClusterFree(pWorkspace->pClusters[i]);
+        TGM_ReadPairAttrbtArrayFree(pWorkspace->pAttrbtArrays[i]);
+    }
+
+    TGM_ARRAY_FREE(pWorkspace->pMemberPairs, TRUE);
+    TGM_ARRAY_FREE(pWorkspace->pSideEvents, TRUE);
+    SV_AssistArrayFree(pWorkspace->pAssistArray);
+    TGM_CrossGridFree(pWorkspace->pCrossGrid);
+
+    for (unsigned int i = 0; i != 2; ++i)
+        TGM_ARRAY_FREE(pWorkspace->pTilePairs[i], TRUE);
+
+    TGM_ARRAY_FREE(pWorkspace->pSupportArray, TRUE);
+    TGM_GenotyperFree(pWorkspace->pGenotyper);
+}
+
+static void* TGM_DetectWorker(void* pArg)
+{
+    TGM_DetectThread* pThread = pArg;
+    TGM_DetectEngines* pEngines = pThread->pEngines;
+    TGM_DetectScheduler* pScheduler = pEngines->pScheduler;
+
+    TGM_DetectWorkspace workspace;
+    TGM_DetectWorkspaceInit(&workspace, pEngines);
+
+    TGM_DetectJob job;
+    while (TRUE)
+    {
+        TGM_Status status = TGM_DetectSchedulerPop(&job, pScheduler, pThread->threadID);
+        if (status != TGM_OK)
+        {
+            // look again with the scheduler locked so that we never sleep through a push
+            TGM_DetectSchedulerLock(pScheduler);
+            status = TGM_DetectSchedulerPop(&job, pScheduler, pThread->threadID);
+
+            if (status != TGM_OK)
+            {
+                // all the references are loaded and no more jobs will come
+                if (pEngines->numLoaders == 0)
                 {
-                    ++tailIndex;
-                    if (headIndex != tailIndex)
-                        memcpy(pSpecialEventArray->data + tailIndex, pSpecialEventArray->data + headIndex, sizeof(TGM_SpecialEvent));
+                    TGM_DetectSchedulerUnlock(pScheduler);
+                    break;
                 }
 
-                ++headIndex;
+                TGM_DetectSchedulerWait(pScheduler);
+
+                TGM_DetectSchedulerUnlock(pScheduler);
+                continue;
             }
 
-            pSpecialEventArray->size = newSize;
-            qsort(pSpecialEventArray->data, pSpecialEventArray->size, sizeof(TGM_SpecialEvent), CompareSpecialEvents);
+            TGM_DetectSchedulerUnlock(pScheduler);
+        }
+
+        switch (job.eventType)
+        {
+            case SV_DELETION:
+            case SV_TANDEM_DUP:
+            case SV_INVERSION:
+            case SV_INTER_CHR_TRNSLCTN:
+                TGM_LocalDetectRun(pEngines->pLocalPool, &workspace, &job);
+                break;
+            case SV_SPECIAL:
+                TGM_SpecialDetectRun(pEngines->pSpecialPool, &workspace, &job);
+                break;
+            default:
+                break;
+        }
+    }
+
+    TGM_DetectWorkspaceDestroy(&workspace);
+
+    return NULL;
+}
+
+// load the references with more read pairs first
+static int CompareRefCount(const void* pRef1, const void* pRef2)
+{
+    const TGM_DetectRefCount* pR1 = pRef1;
+    const TGM_DetectRefCount* pR2 = pRef2;
+
+    if (pR1->count != pR2->count)
+        return (pR1->count > pR2->count ? -1 : 1);
+
+    return (pR1->refID < pR2->refID ? -1 : 1);
+}
+
+// order the working references by decreasing number of read pairs in a set of chunk types. the number of read
+// pairs of each working reference goes to pNumPairs and the total number of read pairs is returned
+static uint64_t TGM_DetectLoadOrder(int32_t* pLoadOrder, uint64_t* pNumPairs, const TGM_DetectEngines* pEngines, uint32_t chunkSet)
+{
+    TGM_DetectRefCount* pRefCounts = (TGM_DetectRefCount*) malloc(pEngines->numRefs * sizeof(TGM_DetectRefCount));
+    if (pRefCounts == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the load order of the references.\n");
+
+    // the chunk index tells us the size of each reference before anything is loaded
+    uint64_t totalCount = 0;
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+    {
+        pRefCounts[i].refID = pEngines->pDetectPars->workingRefID[0] + i;
+        pRefCounts[i].count = 0;
 
-            for (unsigned int h = 0; h != pSpecialEventArray->size; ++h)
-                TGM_SpecialEventPrint(pSpecialEventArray->data + h);
+        for (unsigned int j = 0; j != TGM_NUM_RP_CHUNK_TYPES; ++j)
+        {
+            if ((chunkSet & (1 << j)) != 0)
+                pRefCounts[i].count += TGM_ReadPairInFileCount(pEngines->pInFile, pRefCounts[i].refID, j);
         }
 
-        fclose(specialInput);
+        pNumPairs[i] = pRefCounts[i].count;
+        totalCount += pRefCounts[i].count;
     }
 
-    TGM_ClusterFree(pCluster3);
-    TGM_ClusterFree(pCluster5);
+    qsort(pRefCounts, pEngines->numRefs, sizeof(TGM_DetectRefCount), CompareRefCount);
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+        pLoadOrder[i] = pRefCounts[i].refID;
 
-    TGM_ARRAY_FREE(pSpecialPairArray, TRUE);
-    TGM_ARRAY_FREE(pSpecialEventArray, TRUE);
+    free(pRefCounts);
+
+    return totalCount;
+}
+
+static void TGM_SpecialDetectPoolInit(TGM_SpecialDetectPool* pPool, TGM_DetectEngines* pEngines, const TGM_SpecialID* pSpecialID)
+{
+    memset(pPool, 0, sizeof(TGM_SpecialDetectPool));
+
+    pPool->pEngines = pEngines;
+    pPool->pSpecialID = pSpecialID;
+
+    pPool->pRefData = (TGM_SpecialRefData*) calloc(pEngines->numRefs, sizeof(TGM_SpecialRefData));
+    pPool->pLoadOrder = (int32_t*) malloc(pEngines->numRefs * sizeof(int32_t));
+    uint64_t* pNumPairs = (uint64_t*) malloc(pEngines->numRefs * sizeof(uint64_t));
+    if (pPool->pRefData == NULL || pPool->pLoadOrder == NULL || pNumPairs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the special insertion detection.\n");
+
+    uint64_t totalCount = TGM_DetectLoadOrder(pPool->pLoadOrder, pNumPairs, pEngines, (1 << TGM_SPECIAL_PAIR_CHUNK));
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+        pPool->pRefData[i].numBytes = pNumPairs[i] * sizeof(TGM_SpecialPair);
+
+    free(pNumPairs);
+
+    // a few jobs per thread keep the threads busy till the end
+    pPool->splitSize = totalCount / (pEngines->numThreads * 4);
+    if (pPool->splitSize < MIN_SPLIT_JOB_PAIRS)
+        pPool->splitSize = MIN_SPLIT_JOB_PAIRS;
+}
+
+static void TGM_SpecialDetectPoolDestroy(TGM_SpecialDetectPool* pPool)
+{
+    free(pPool->pRefData);
+    free(pPool->pLoadOrder);
+}
+
+static void TGM_LocalDetectPoolInit(TGM_LocalDetectPool* pPool, TGM_DetectEngines* pEngines, uint32_t detectSet)
+{
+    memset(pPool, 0, sizeof(TGM_LocalDetectPool));
+
+    pPool->pEngines = pEngines;
+    pPool->detectSet = detectSet;
+
+    if ((detectSet & (1 << SV_DELETION)) != 0)
+        pPool->chunkSet |= (1 << TGM_LONG_PAIR_CHUNK);
+
+    if ((detectSet & (1 << SV_TANDEM_DUP)) != 0)
+        pPool->chunkSet |= (1 << TGM_SHORT_PAIR_CHUNK) | (1 << TGM_REVERSED_PAIR_CHUNK);
+
+    if ((detectSet & (1 << SV_INVERSION)) != 0)
+        pPool->chunkSet |= (1 << TGM_INVERTED_PAIR_CHUNK);
+
+    if ((detectSet & (1 << SV_INTER_CHR_TRNSLCTN)) != 0)
+        pPool->chunkSet |= (1 << TGM_CROSS_PAIR_CHUNK);
+
+    pPool->pRefData = (TGM_LocalRefData*) calloc(pEngines->numRefs, sizeof(TGM_LocalRefData));
+    pPool->pLoadOrder = (int32_t*) malloc(pEngines->numRefs * sizeof(int32_t));
+    uint64_t* pNumPairs = (uint64_t*) malloc(pEngines->numRefs * sizeof(uint64_t));
+    if (pPool->pRefData == NULL || pPool->pLoadOrder == NULL || pNumPairs == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the local SV detection.\n");
+
+    pPool->totalCount = TGM_DetectLoadOrder(pPool->pLoadOrder, pNumPairs, pEngines, pPool->chunkSet);
+    for (unsigned int i = 0; i != pEngines->numRefs; ++i)
+    {
+        // the cross pairs are larger than the local pairs
+        int32_t refID = pEngines->pDetectPars->workingRefID[0] + i;
+        for (unsigned int j = 0; j != TGM_NUM_RP_CHUNK_TYPES; ++j)
+        {
+            if ((pPool->chunkSet & (1 << j)) == 0)
+                continue;
+
+            uint64_t count = TGM_ReadPairInFileCount(pEngines->pInFile, refID, j);
+            pPool->pRefData[i].numBytes += count * TGM_ReadPairRecordSize(j);
+
+            // a tiled reference also keeps the position order of its local pairs
+            if (pEngines->pDetectPars->tileSize > 0 && j < NUM_LOCAL_PAIR_CHUNK)
+                pPool->pRefData[i].numBytes += count * sizeof(uint32_t);
+        }
+    }
+
+    free(pNumPairs);
+}
+
+static void TGM_LocalDetectPoolDestroy(TGM_LocalDetectPool* pPool)
+{
+    free(pPool->pRefData);
+    free(pPool->pLoadOrder);
+}
+
+static void TGM_DetectEnginesInit(TGM_DetectEngines* pEngines, const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile)
+{
+    memset(pEngines, 0, sizeof(TGM_DetectEngines));
+
+    pEngines->pDetectPars = pDetectPars;
+    pEngines->pLibTable = pLibTable;
+    pEngines->pInFile = pInFile;
+    pEngines->numThreads = (pDetectPars->numThreads > 0 ? pDetectPars->numThreads : 1);
+
+    if (pDetectPars->workingRefID[1] >= pDetectPars->workingRefID[0])
+        pEngines->numRefs = pDetectPars->workingRefID[1] - pDetectPars->workingRefID[0] + 1;
+}
+
+static void TGM_DetectEnginesRun(TGM_DetectEngines* pEngines)
+{
+    pEngines->numLoaders = (pEngines->pLocalPool != NULL) + (pEngines->pSpecialPool != NULL);
+    if (pEngines->numLoaders == 0)
+        return;
+
+    unsigned int numThreads = pEngines->numThreads;
+
+    // keep one more reference in memory than the number of threads so that loading overlaps clustering
+    pEngines->pScheduler = TGM_DetectSchedulerAlloc(numThreads, numThreads + 1, pEngines->pLibTable);
+    pEngines->pScheduler->loadingMemLimit = pEngines->pDetectPars->loadingMemLimit;
+
+    const TGM_ReadPairDetectPars* pDetectPars = pEngines->pDetectPars;
+
+    // only the local events are genotyped. the indices are loaded once and shared by the threads
+    if (pEngines->pLocalPool != NULL && pDetectPars->numBamFiles > 0)
+    {
+        pEngines->ppBamIndices = (bam_index_t**) malloc(pDetectPars->numBamFiles * sizeof(bam_index_t*));
+        if (pEngines->ppBamIndices == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the BAM indices.\n");
+
+        for (unsigned int i = 0; i != pDetectPars->numBamFiles; ++i)
+        {
+            pEngines->ppBamIndices[i] = bam_index_load(pDetectPars->bamFileNames[i]);
+            if (pEngines->ppBamIndices[i] == NULL)
+                TGM_ErrQuit("ERROR: Cannot open bam index file for: %s\n", pDetectPars->bamFileNames[i]);
+        }
+
+        pEngines->sampleFields |= TGM_SAMPLE_GENOTYPE;
+    }
+
+    if (pDetectPars->sampleSupport)
+        pEngines->sampleFields |= TGM_SAMPLE_SUPPORT;
+
+    // the cached events of a reference are only reused with the parameters they were detected with
+    if (pDetectPars->incremental)
+    {
+        if (pEngines->pLocalPool != NULL)
+        {
+            TGM_LocalDetectPool* pLocalPool = pEngines->pLocalPool;
+            TGM_DetectCacheDigestPars(pLocalPool->cacheDigest, pDetectPars, pEngines->pLibTable, pEngines->sampleFields, &(pLocalPool->detectSet), sizeof(uint32_t),
+                                      (pEngines->ppBamIndices != NULL));
+        }
+
+        if (pEngines->pSpecialPool != NULL)
+        {
+            const TGM_SpecialID* pSpecialID = pEngines->pSpecialPool->pSpecialID;
+            TGM_DetectCacheDigestPars(pEngines->pSpecialPool->cacheDigest, pDetectPars, pEngines->pLibTable, pEngines->sampleFields, pSpecialID->names,
+                                      pSpecialID->size * sizeof(pSpecialID->names[0]), FALSE);
+        }
+    }
+
+    // the VCF output of a joint run has a column for each sample
+    const char* const* pSampleNames = (const char* const*) pEngines->pLibTable->pSampleInfo->pSamples;
+    unsigned int numSamples = pEngines->pLibTable->pSampleInfo->size;
+
+    pEngines->pWriter = TGM_EventWriterOpen(pDetectPars->outputFile, pDetectPars->outputFormat, pDetectPars->compressOutput, pSampleNames, numSamples,
+                                            pEngines->sampleFields, pEngines->pLibTable->pAnchorInfo);
+
+    pthread_t loaders[2];
+    unsigned int numLoaders = 0;
+
+    if (pEngines->pLocalPool != NULL)
+    {
+        if (pthread_create(loaders + numLoaders, NULL, TGM_LocalDetectLoader, pEngines->pLocalPool) != 0)
+            TGM_ErrQuit("ERROR: Cannot create the local pair loading thread.\n");
+
+        ++numLoaders;
+    }
+
+    if (pEngines->pSpecialPool != NULL)
+    {
+        void* (*loader) (void*) = (pDetectPars->streamSpecial ? TGM_SpecialDetectStreamLoader : TGM_SpecialDetectLoader);
+        if (pthread_create(loaders + numLoaders, NULL, loader, pEngines->pSpecialPool) != 0)
+            TGM_ErrQuit("ERROR: Cannot create the special pair loading thread.\n");
+
+        ++numLoaders;
+    }
+
+    pthread_t threads[numThreads];
+    TGM_DetectThread threadArgs[numThreads];
+
+    for (unsigned int t = 0; t != numThreads; ++t)
+    {
+        threadArgs[t].pEngines = pEngines;
+        threadArgs[t].threadID = t;
+    }
+
+    // the calling thread works as the first worker
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        if (pthread_create(threads + t, NULL, TGM_DetectWorker, threadArgs + t) != 0)
+            TGM_ErrQuit("ERROR: Cannot create a detection thread.\n");
+    }
+
+    TGM_DetectWorker(threadArgs);
+
+    for (unsigned int t = 1; t < numThreads; ++t)
+        pthread_join(threads[t], NULL);
+
+    for (unsigned int i = 0; i != numLoaders; ++i)
+        pthread_join(loaders[i], NULL);
+
+    TGM_DetectSchedulerFree(pEngines->pScheduler);
+    pEngines->pScheduler = NULL;
+
+    // all the references are submitted by now. this waits for the writer to finish them
+    TGM_EventWriterClose(pEngines->pWriter);
+    pEngines->pWriter = NULL;
+
+    if (pEngines->ppBamIndices != NULL)
+    {
+        for (unsigned int i = 0; i != pDetectPars->numBamFiles; ++i)
+            bam_index_destroy(pEngines->ppBamIndices[i]);
+
+        free(pEngines->ppBamIndices);
+        pEngines->ppBamIndices = NULL;
+    }
+}
+
+void TGM_DetectSpecial(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, const TGM_SpecialID* pSpecialID, TGM_ReadPairInFile* pInFile)
+{
+    TGM_DetectEngines engines;
+    TGM_DetectEnginesInit(&engines, pDetectPars, pLibTable, pInFile);
+    if (engines.numRefs == 0)
+        return;
+
+    TGM_SpecialDetectPool specialPool;
+    TGM_SpecialDetectPoolInit(&specialPool, &engines, pSpecialID);
+    engines.pSpecialPool = &specialPool;
+
+    TGM_DetectEnginesRun(&engines);
+
+    TGM_SpecialDetectPoolDestroy(&specialPool);
+}
+
+// run the local SV engine alone on a set of local SV types
+static void TGM_DetectLocal(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile, uint32_t detectSet)
+{
+    TGM_DetectEngines engines;
+    TGM_DetectEnginesInit(&engines, pDetectPars, pLibTable, pInFile);
+    if (engines.numRefs == 0)
+        return;
+
+    TGM_LocalDetectPool localPool;
+    TGM_LocalDetectPoolInit(&localPool, &engines, detectSet);
+    engines.pLocalPool = &localPool;
+
+    TGM_DetectEnginesRun(&engines);
+
+    TGM_LocalDetectPoolDestroy(&localPool);
+}
+
+void TGM_DetectDel(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile)
+{
+    TGM_DetectLocal(pDetectPars, pLibTable, pInFile, (1 << SV_DELETION));
+}
 
-    for (unsigned int i = 0; i != numArray; ++i)
-        TGM_ReadPairAttrbtArrayFree(pAttrbtArrays[i]);
+void TGM_DetectTandemDup(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile)
+{
+    TGM_DetectLocal(pDetectPars, pLibTable, pInFile, (1 << SV_TANDEM_DUP));
+}
+
+void TGM_DetectInversion(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile)
+{
+    TGM_DetectLocal(pDetectPars, pLibTable, pInFile, (1 << SV_INVERSION));
+}
 
-    free(pAttrbtArrays);
+void TGM_DetectTranslocation(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile)
+{
+    TGM_DetectLocal(pDetectPars, pLibTable, pInFile, (1 << SV_INTER_CHR_TRNSLCTN));
 }
 
-void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, const TGM_Cluster* pCluster, unsigned int index, 
-                         const TGM_SpecialPairArray* pSpecialPairArray, const TGM_LibInfoTable* pLibTable)
+void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, TGM_SupportArray* pSupportArray, const TGM_Cluster* pCluster, unsigned int index, 
+                         const TGM_SpecialPair* pMemberPairs, const TGM_LibInfoTable* pLibTable)
 {
     const TGM_ClusterElmnt* pClusterElmnt = pCluster->pElmntArray->data + index;
-    unsigned int i = pClusterElmnt->startIndex;
     unsigned int numReadPair = pClusterElmnt->numReadPair;
 
     unsigned int posMin5 = UINT_MAX;
@@ -585,10 +2718,9 @@ void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, const TGM_Cluster* pC
 
     const TGM_SpecialPair* pSpecialPair = NULL;
 
-    do
+    for (unsigned int i = TGM_ClusterMemberBegin(pCluster, index); i != TGM_ClusterMemberEnd(pCluster, index); ++i)
     {
-        unsigned int origIndex = pCluster->pAttrbtArray->data[i].origIndex;
-        pSpecialPair = pSpecialPairArray->data + origIndex;
+        pSpecialPair = pMemberPairs + i;
 
         int fragLenMedian = pLibTable->pLibInfo[pSpecialPair->readGrpID].fragLenMedian;
 
@@ -629,10 +2761,7 @@ void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, const TGM_Cluster* pC
             if (endUniq > endMax3)
                 endMax3 = endUniq;
         }
-
-        i = pCluster->pNext[i];
-
-    }while(i != pClusterElmnt->startIndex);
+    }
 
     pSpecialEvent->refID = pSpecialPair->refID[0];
     if (pSpecialPair->readPairType == PT_SPECIAL3)
@@ -659,9 +2788,12 @@ void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, const TGM_Cluster* pC
     pSpecialEvent->pos3[1] = endMax3;
 
     pSpecialEvent->posUncertainty = DoubleRoundToInt((double) ((endMax5 - posMin5) + (endMax3 - posMin3)) / (double) (2 * numReadPair));
+
+    TGM_EventCountSamples(pSpecialEvent->support, pSupportArray, pCluster, index, pLibTable);
 }
 
-void TGM_SpecialEventMerge(TGM_SpecialEvent* pMergedEvent, const TGM_SpecialEvent* pHeadEvent, const TGM_SpecialEvent* pTailEvent, TGM_Cluster* pCluster3, TGM_Cluster* pCluster5)
+void TGM_SpecialEventMerge(TGM_SpecialEvent* pMergedEvent, TGM_SupportArray* pSupportArray, const TGM_SpecialEvent* pHeadEvent, const TGM_SpecialEvent* pTailEvent,
+                           TGM_Cluster* pCluster3, TGM_Cluster* pCluster5)
 {
     if (pTailEvent->numFrag[0] == 0)
         TGM_SWAP(pHeadEvent, pTailEvent, const TGM_SpecialEvent*);
@@ -700,21 +2832,84 @@ void TGM_SpecialEventMerge(TGM_SpecialEvent* pMergedEvent, const TGM_SpecialEven
 
     pMergedEvent->pos = (posHead < posTail ? posHead : posTail);
     pMergedEvent->posUncertainty = DoubleRoundToInt((double) (pMergedEvent->pos5[1] - pMergedEvent->pos5[0]) / numFrag5);
+
+    if (pSupportArray != NULL)
+        TGM_SupportArraySum(pMergedEvent->support, pSupportArray, pHeadEvent->support, pTailEvent->support);
+}
+
+// the VCF records use 1-based positions. the events are indexed from their start to their end
+void TGM_SpecialEventWrite(TGM_EventBuff* pEventBuff, const TGM_SpecialEvent* pSpecialEvent, const char* specialName, char* const* pAnchors, TGM_EventFormat format)
+{
+    int32_t pos = pSpecialEvent->pos;
+
+    if (format == TGM_EVENT_VCF)
+    {
+        TGM_EventBuffAdd(pEventBuff, pSpecialEvent->refID, pos, pos + 1, "%s\t%d\t.\tN\t<INS:ME:%s>\t.\tPASS\tSVTYPE=INS;CIPOS=%d,%d;NFRAG=%d,%d\n",
+                         pAnchors[pSpecialEvent->refID], pos + 1, specialName, -(int) pSpecialEvent->posUncertainty, (int) pSpecialEvent->posUncertainty,
+                         pSpecialEvent->numFrag[0], pSpecialEvent->numFrag[1]);
+    }
+    else
+    {
+        TGM_EventBuffAdd(pEventBuff, pSpecialEvent->refID, pos, pos + 1, "%s\t%d\t%d\t%d\t%d\n",
+                         pAnchors[pSpecialEvent->refID], pos, pos + 1, pSpecialEvent->numFrag[0], pSpecialEvent->numFrag[1]);
+    }
 }
 
-void TGM_SpecialEventPrint(const TGM_SpecialEvent* pSpecialEvent)
+void TGM_DelEventWrite(TGM_EventBuff* pEventBuff, const TGM_DelEvent* pDelEvent, char* const* pAnchors, TGM_EventFormat format)
 {
-    printf("chr%d\t%d\t%d\t%d\t%d\n", pSpecialEvent->refID + 1, pSpecialEvent->pos, pSpecialEvent->pos + 1, pSpecialEvent->numFrag[0], pSpecialEvent->numFrag[1]);
+    if (format == TGM_EVENT_VCF)
+    {
+        TGM_EventBuffAdd(pEventBuff, pDelEvent->refID, pDelEvent->pos, pDelEvent->end,
+                         "%s\t%d\t.\tN\t<DEL>\t%d\tPASS\tSVTYPE=DEL;END=%d;SVLEN=-%d;CIPOS=%d,%d;CIEND=%d,%d;CILEN=%d,%d\n",
+                         pAnchors[pDelEvent->refID], pDelEvent->pos + 1, pDelEvent->quality, pDelEvent->end, pDelEvent->length,
+                         pDelEvent->CIpos[0], pDelEvent->CIpos[1], pDelEvent->CIend[0], pDelEvent->CIend[1], pDelEvent->CIlen[0], pDelEvent->CIlen[1]);
+    }
+    else
+    {
+        TGM_EventBuffAdd(pEventBuff, pDelEvent->refID, pDelEvent->pos, pDelEvent->end, "%s\t%d\t%d\tDEL\t%d\t%d\t%d,%d\t%d,%d\t%d,%d\n",
+                         pAnchors[pDelEvent->refID], pDelEvent->pos, pDelEvent->end, pDelEvent->length, pDelEvent->quality,
+                         pDelEvent->CIpos[0], pDelEvent->CIpos[1], pDelEvent->CIend[0], pDelEvent->CIend[1], pDelEvent->CIlen[0], pDelEvent->CIlen[1]);
+    }
 }
 
-void TGM_DetectTranslocation(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable)
+void TGM_DupEventWrite(TGM_EventBuff* pEventBuff, const TGM_DupEvent* pDupEvent, char* const* pAnchors, TGM_EventFormat format)
 {
+    if (format == TGM_EVENT_VCF)
+    {
+        TGM_EventBuffAdd(pEventBuff, pDupEvent->refID, pDupEvent->pos, pDupEvent->end,
+                         "%s\t%d\t.\tN\t<DUP:TANDEM>\t%d\tPASS\tSVTYPE=DUP;END=%d;SVLEN=%d;CIPOS=%d,%d;CIEND=%d,%d;CILEN=%d,%d\n",
+                         pAnchors[pDupEvent->refID], pDupEvent->pos + 1, pDupEvent->quality, pDupEvent->end, pDupEvent->length,
+                         pDupEvent->CIpos[0], pDupEvent->CIpos[1], pDupEvent->CIend[0], pDupEvent->CIend[1], pDupEvent->CIlen[0], pDupEvent->CIlen[1]);
+    }
+    else
+    {
+        TGM_EventBuffAdd(pEventBuff, pDupEvent->refID, pDupEvent->pos, pDupEvent->end, "%s\t%d\t%d\tDUP\t%d\t%d\t%d,%d\t%d,%d\t%d,%d\n",
+                         pAnchors[pDupEvent->refID], pDupEvent->pos, pDupEvent->end, pDupEvent->length, pDupEvent->quality,
+                         pDupEvent->CIpos[0], pDupEvent->CIpos[1], pDupEvent->CIend[0], pDupEvent->CIend[1], pDupEvent->CIlen[0], pDupEvent->CIlen[1]);
+    }
+}
 
+void TGM_InvEventWrite(TGM_EventBuff* pEventBuff, const TGM_InvEvent* pInvEvent, char* const* pAnchors, TGM_EventFormat format)
+{
+    if (format == TGM_EVENT_VCF)
+    {
+        TGM_EventBuffAdd(pEventBuff, pInvEvent->refID, pInvEvent->pos, pInvEvent->end,
+                         "%s\t%d\t.\tN\t<INV>\t%d\tPASS\tSVTYPE=INV;END=%d;SVLEN=%d;CIPOS=%d,%d;CIEND=%d,%d;NFRAG=%d,%d\n",
+                         pAnchors[pInvEvent->refID], pInvEvent->pos + 1, pInvEvent->quality, pInvEvent->end, pInvEvent->length,
+                         pInvEvent->CIpos[0], pInvEvent->CIpos[1], pInvEvent->CIend[0], pInvEvent->CIend[1], pInvEvent->numFrag[0], pInvEvent->numFrag[1]);
+    }
+    else
+    {
+        TGM_EventBuffAdd(pEventBuff, pInvEvent->refID, pInvEvent->pos, pInvEvent->end, "%s\t%d\t%d\tINV\t%d\t%d\t%d,%d\t%d,%d\t%d,%d\n",
+                         pAnchors[pInvEvent->refID], pInvEvent->pos, pInvEvent->end, pInvEvent->length, pInvEvent->quality,
+                         pInvEvent->CIpos[0], pInvEvent->CIpos[1], pInvEvent->CIend[0], pInvEvent->CIend[1], pInvEvent->numFrag[0], pInvEvent->numFrag[1]);
+    }
 }
 
-void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLongPairArray,
+void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, TGM_SupportArray* pSupportArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLongPairArray,
                         TGM_Cluster* pDelCluster, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars)
 {
+    TGM_ARRAY_RESET(pDelArray);
     TGM_ARRAY_RESIZE_NO_COPY(pDelArray, pDelCluster->pElmntArray->size, TGM_DelEvent);
 
     unsigned int i = 0;
@@ -746,13 +2941,13 @@ void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray,
         int numReadPair = pDelCluster->pElmntArray->data[i].numReadPair;
         SV_AssistArrayResize(pAssistArray, numReadPair);
 
-        unsigned int startIndex = pDelCluster->pElmntArray->data[i].startIndex;
-        unsigned int j = startIndex;
         unsigned int assistIndex = 0;
         const TGM_LocalPair* pLongPair = NULL;
 
-        do
+        // the members are in position order, so the long pairs are visited almost sequentially
+        for (unsigned int m = TGM_ClusterMemberBegin(pDelCluster, i); m != TGM_ClusterMemberEnd(pDelCluster, i); ++m)
         {
+            unsigned int j = pDelCluster->pMembers[m];
             unsigned int origIndex = pDelCluster->pAttrbtArray->data[j].origIndex;
             pLongPair = (pLongPairArray->data + origIndex);
 
@@ -791,18 +2986,21 @@ void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray,
             if (pAssistArray->pFragLenDiff[assistIndex] > fragLenDiffMax)
                 fragLenDiffMax = pAssistArray->pFragLenDiff[assistIndex];
 
-            j = pDelCluster->pNext[j];
             ++assistIndex;
-
-        }while(j != startIndex);
+        }
 
         int eventLength = FindMedianInt(pAssistArray->pFragLenDiff, pAssistArray->size);
         if (eventLength < 1)
+        {
+            ++i;
+            ++counter;
             continue;
+        }
 
         int k = pDelArray->size;
 
         pDelArray->data[k].clusterID = i;
+        TGM_EventCountSamples(pDelArray->data[k].support, pSupportArray, pDelCluster, i, pLibTable);
 
         pDelArray->data[k].refID = pLongPair->refID;
         pDelArray->data[k].pos = endMax5 + 1;
@@ -856,11 +3054,13 @@ void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray,
         }
 
         if (isOverlap)
-            TGM_DelEventMerge(pDelArray, pDelCluster);
+            TGM_DelEventMerge(pDelArray, pSupportArray, pDelCluster);
         else
         {
             if (numReadPair >= pPars->minNumClustered && pDelArray->data[k].length >= pPars->minEventLength)
                 ++(pDelArray->size);
+            else if (pSupportArray != NULL)
+                pSupportArray->size = pDelArray->data[k].support[0];
         }
 
         ++i;
@@ -871,3 +3071,615 @@ void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray,
 
     //TGM_DelEventGenotype(pDelArray, pLibTable);
 }
+
+void TGM_ReadPairFindDup(TGM_DupArray* pDupArray, TGM_SupportArray* pSupportArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLocalPairArray,
+                        const TGM_Cluster* pDupCluster, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars)
+{
+    const TGM_ReadPairAttrbtArray* pAttrbtArray = pDupCluster->pAttrbtArray;
+    TGM_Bool isReversed = (pAttrbtArray->readPairType == PT_REVERSED);
+
+    for (unsigned int i = 0; i != pDupCluster->pElmntArray->length; ++i)
+    {
+        int numReadPair = pDupCluster->pElmntArray->data[i].numReadPair;
+        if (numReadPair == 0 || numReadPair < pPars->minNumClustered)
+            continue;
+
+        int posMin = INT_MAX;
+        int posMax = 0;
+
+        int endMax = 0;
+
+        int lengthMin = INT_MAX;
+        int lengthMax = INT_MIN;
+
+        SV_AssistArrayResize(pAssistArray, numReadPair);
+
+        unsigned int assistIndex = 0;
+        const TGM_LocalPair* pLocalPair = NULL;
+
+        for (unsigned int m = TGM_ClusterMemberBegin(pDupCluster, i); m != TGM_ClusterMemberEnd(pDupCluster, i); ++m)
+        {
+            unsigned int j = pDupCluster->pMembers[m];
+            pLocalPair = pLocalPairArray->data + pAttrbtArray->data[j].origIndex;
+
+            int medianFragLen = pLibTable->pLibInfo[pLocalPair->readGrpID].fragLenMedian;
+
+            // a reversed pair spans the duplication junction: its fragment is the
+            // part of the copy outside the two reads plus the median fragment length.
+            // a short pair misses the inserted copy between its two reads
+            int length = 0;
+            if (isReversed)
+                length = pLocalPair->fragLen + medianFragLen - 2 * (pLocalPair->upEnd - pLocalPair->upPos + 1);
+            else
+                length = medianFragLen - pLocalPair->fragLen;
+
+            if (pLocalPair->upPos < posMin)
+                posMin = pLocalPair->upPos;
+
+            if (pLocalPair->upPos > posMax)
+                posMax = pLocalPair->upPos;
+
+            if (pLocalPair->upEnd > endMax)
+                endMax = pLocalPair->upEnd;
+
+            if (length < lengthMin)
+                lengthMin = length;
+
+            if (length > lengthMax)
+                lengthMax = length;
+
+            pAssistArray->pFragLenDiff[assistIndex] = length;
+            pAssistArray->pMapQ5[assistIndex] = pLocalPair->upMapQ;
+            pAssistArray->pMapQ3[assistIndex] = pLocalPair->downMapQ;
+
+            ++assistIndex;
+        }
+
+        int eventLength = FindMedianInt(pAssistArray->pFragLenDiff, pAssistArray->size);
+        if (eventLength < 1 || eventLength < pPars->minEventLength)
+            continue;
+
+        if (pDupArray->size == pDupArray->capacity)
+            TGM_ARRAY_RESIZE(pDupArray, pDupArray->capacity * 2, TGM_DupEvent);
+
+        TGM_DupEvent* pDupEvent = pDupArray->data + pDupArray->size;
+        ++(pDupArray->size);
+
+        pDupEvent->clusterID = i;
+        pDupEvent->refID = pLocalPair->refID;
+        pDupEvent->readPairType = pAttrbtArray->readPairType;
+
+        pDupEvent->pos = (isReversed ? posMin : endMax + 1);
+        pDupEvent->length = eventLength;
+        pDupEvent->end = pDupEvent->pos + eventLength;
+        pDupEvent->quality = (int) ((numReadPair * 100.0) / (numReadPair + 10.0));
+
+        pDupEvent->CIpos[0] = -(posMax - posMin) / numReadPair;
+        pDupEvent->CIpos[1] = (posMax - posMin) / numReadPair;
+
+        pDupEvent->CIend[0] = -(lengthMax - lengthMin) / numReadPair;
+        pDupEvent->CIend[1] = (lengthMax - lengthMin) / numReadPair;
+
+        pDupEvent->CIlen[0] = -(eventLength - lengthMin) / numReadPair;
+        pDupEvent->CIlen[1] = (lengthMax - eventLength) / numReadPair;
+
+        pDupEvent->mapQ5 = FindMedianInt(pAssistArray->pMapQ5, pAssistArray->size);
+        pDupEvent->mapQ3 = FindMedianInt(pAssistArray->pMapQ3, pAssistArray->size);
+
+        TGM_EventCountSamples(pDupEvent->support, pSupportArray, pDupCluster, i, pLibTable);
+    }
+}
+
+// summarize the inverted3 (side 0) or inverted5 (side 1) clusters as half inversions
+static void TGM_InvEventMakeHalf(TGM_InvArray* pInvArray, TGM_SupportArray* pSupportArray, const TGM_LocalPairArray* pInvertedPairArray,
+                                 const TGM_Cluster* pInvCluster, unsigned int side, const TGM_LibInfoTable* pLibTable)
+{
+    const TGM_ReadPairAttrbtArray* pAttrbtArray = pInvCluster->pAttrbtArray;
+
+    for (unsigned int i = 0; i != pInvCluster->pElmntArray->length; ++i)
+    {
+        int numReadPair = pInvCluster->pElmntArray->data[i].numReadPair;
+        if (numReadPair == 0)
+            continue;
+
+        int posMin = INT_MAX;
+        int posMax = 0;
+
+        int endMin = INT_MAX;
+        int endMax = 0;
+
+        const TGM_LocalPair* pInvertedPair = NULL;
+
+        for (unsigned int m = TGM_ClusterMemberBegin(pInvCluster, i); m != TGM_ClusterMemberEnd(pInvCluster, i); ++m)
+        {
+            unsigned int j = pInvCluster->pMembers[m];
+            pInvertedPair = pInvertedPairArray->data + pAttrbtArray->data[j].origIndex;
+
+            // the forward-forward pairs end just before both breakpoints and the
+            // reverse-reverse pairs start just after them
+            int pos = 0;
+            int end = 0;
+            if (side == 0)
+            {
+                pos = pInvertedPair->upEnd + 1;
+                end = pInvertedPair->upPos + pInvertedPair->fragLen - 1;
+            }
+            else
+            {
+                pos = pInvertedPair->upPos;
+                end = pInvertedPair->downPos - 1;
+            }
+
+            if (pos < posMin)
+                posMin = pos;
+
+            if (pos > posMax)
+                posMax = pos;
+
+            if (end < endMin)
+                endMin = end;
+
+            if (end > endMax)
+                endMax = end;
+        }
+
+        if (pInvArray->size == pInvArray->capacity)
+            TGM_ARRAY_RESIZE(pInvArray, pInvArray->capacity * 2, TGM_InvEvent);
+
+        TGM_InvEvent* pInvEvent = pInvArray->data + pInvArray->size;
+        ++(pInvArray->size);
+
+        pInvEvent->refID = pInvertedPair->refID;
+        pInvEvent->pos = (side == 0 ? posMax : posMin);
+        pInvEvent->end = (side == 0 ? endMax : endMin);
+        pInvEvent->length = (pInvEvent->end > pInvEvent->pos ? pInvEvent->end - pInvEvent->pos : 0);
+
+        pInvEvent->CIpos[0] = -(posMax - posMin) / numReadPair;
+        pInvEvent->CIpos[1] = (posMax - posMin) / numReadPair;
+
+        pInvEvent->CIend[0] = -(endMax - endMin) / numReadPair;
+        pInvEvent->CIend[1] = (endMax - endMin) / numReadPair;
+
+        pInvEvent->numFrag[side] = numReadPair;
+        pInvEvent->numFrag[1 - side] = 0;
+
+        TGM_EventCountSamples(pInvEvent->support, pSupportArray, pInvCluster, i, pLibTable);
+    }
+
+    if (pInvArray->size > 1)
+        qsort(pInvArray->data, pInvArray->size, sizeof(TGM_InvEvent), CompareInvEvents);
+}
+
+void TGM_ReadPairFindInv(TGM_InvArray* pInvArray, TGM_SupportArray* pSupportArray, const TGM_LocalPairArray* pInvertedPairArray, TGM_Cluster* pInvClusters[2],
+                        const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars)
+{
+    TGM_ARRAY_RESET(pInvArray);
+
+    TGM_InvArray* pHalfArray = NULL;
+    TGM_ARRAY_ALLOC(pHalfArray, DEFAULT_SV_CAPACITY, TGM_InvArray, TGM_InvEvent);
+
+    // the inverted3 half events go to pInvArray and the inverted5 half events go to pHalfArray
+    TGM_InvEventMakeHalf(pInvArray, pSupportArray, pInvertedPairArray, pInvClusters[0], 0, pLibTable);
+    TGM_InvEventMakeHalf(pHalfArray, pSupportArray, pInvertedPairArray, pInvClusters[1], 1, pLibTable);
+
+    int fragLenMax = 0;
+    for (unsigned int i = 0; i != pLibTable->size; ++i)
+    {
+        if (pLibTable->pLibInfo[i].fragLenHigh > fragLenMax)
+            fragLenMax = pLibTable->pLibInfo[i].fragLenHigh;
+    }
+
+    // both half events are sorted by position, so an inverted3 event only has to look at the
+    // inverted5 events starting within one fragment from it
+    unsigned int first = 0;
+    unsigned int numHalf = pInvArray->size;
+    for (unsigned int i = 0; i != numHalf; ++i)
+    {
+        TGM_InvEvent* pInvEvent = pInvArray->data + i;
+
+        while (first != pHalfArray->size && (int) pHalfArray->data[first].pos + fragLenMax <= (int) pInvEvent->pos)
+            ++first;
+
+        for (unsigned int j = first; j != pHalfArray->size && (int) pHalfArray->data[j].pos < (int) pInvEvent->pos + fragLenMax; ++j)
+        {
+            TGM_InvEvent* pHalfEvent = pHalfArray->data + j;
+            if (pHalfEvent->numFrag[1] == 0 || abs((int) pHalfEvent->end - (int) pInvEvent->end) >= fragLenMax)
+                continue;
+
+            pInvEvent->pos = (pInvEvent->pos + pHalfEvent->pos) / 2;
+            pInvEvent->end = (pInvEvent->end + pHalfEvent->end) / 2;
+            pInvEvent->length = (pInvEvent->end > pInvEvent->pos ? pInvEvent->end - pInvEvent->pos : 0);
+
+            pInvEvent->CIpos[0] = -abs((int) pInvEvent->pos - (int) pHalfEvent->pos);
+            pInvEvent->CIpos[1] = -pInvEvent->CIpos[0];
+
+            pInvEvent->CIend[0] = -abs((int) pInvEvent->end - (int) pHalfEvent->end);
+            pInvEvent->CIend[1] = -pInvEvent->CIend[0];
+
+            pInvEvent->numFrag[1] = pHalfEvent->numFrag[1];
+            pHalfEvent->numFrag[1] = 0;
+
+            if (pSupportArray != NULL)
+                TGM_SupportArraySum(pInvEvent->support, pSupportArray, pInvEvent->support, pHalfEvent->support);
+
+            break;
+        }
+    }
+
+    // the inverted5 events without a partner are kept as half inversions
+    for (unsigned int j = 0; j != pHalfArray->size; ++j)
+    {
+        if (pHalfArray->data[j].numFrag[1] == 0)
+            continue;
+
+        if (pInvArray->size == pInvArray->capacity)
+            TGM_ARRAY_RESIZE(pInvArray, pInvArray->capacity * 2, TGM_InvEvent);
+
+        pInvArray->data[pInvArray->size] = pHalfArray->data[j];
+        ++(pInvArray->size);
+    }
+
+    TGM_ARRAY_FREE(pHalfArray, TRUE);
+
+    unsigned int numKept = 0;
+    for (unsigned int i = 0; i != pInvArray->size; ++i)
+    {
+        TGM_InvEvent* pInvEvent = pInvArray->data + i;
+        int numReadPair = pInvEvent->numFrag[0] + pInvEvent->numFrag[1];
+
+        if (numReadPair < pPars->minNumClustered || pInvEvent->length < pPars->minEventLength)
+            continue;
+
+        pInvEvent->quality = (int) ((numReadPair * 100.0) / (numReadPair + 10.0));
+        pInvArray->data[numKept] = *pInvEvent;
+        ++numKept;
+    }
+
+    pInvArray->size = numKept;
+
+    if (pInvArray->size > 1)
+        qsort(pInvArray->data, pInvArray->size, sizeof(TGM_InvEvent), CompareInvEvents);
+}
+
+// a translocation is written on the reference of its up mates. the other breakpoint goes in CHR2 and POS2
+// instead of END so that the index and the region queries only see the breakpoint on this reference
+void TGM_TransEventWrite(TGM_EventBuff* pEventBuff, const TGM_TransEvent* pTransEvent, char* const* pAnchors, TGM_EventFormat format)
+{
+    char strand5 = ((pTransEvent->orient & 2) != 0 ? '-' : '+');
+    char strand3 = ((pTransEvent->orient & 1) != 0 ? '-' : '+');
+
+    if (format == TGM_EVENT_VCF)
+    {
+        TGM_EventBuffAdd(pEventBuff, pTransEvent->refID[0], pTransEvent->pos[0], pTransEvent->pos[0] + 1,
+                         "%s\t%d\t.\tN\t<TRA>\t%d\tPASS\tSVTYPE=TRA;CHR2=%s;POS2=%d;STRANDS=%c%c;CIPOS=%d,%d;CIEND=%d,%d;NFRAG=%d\n",
+                         pAnchors[pTransEvent->refID[0]], pTransEvent->pos[0] + 1, pTransEvent->quality, pAnchors[pTransEvent->refID[1]], pTransEvent->pos[1] + 1,
+                         strand5, strand3, pTransEvent->CIpos[0], pTransEvent->CIpos[1], pTransEvent->CIend[0], pTransEvent->CIend[1], pTransEvent->numFrag);
+    }
+    else
+    {
+        TGM_EventBuffAdd(pEventBuff, pTransEvent->refID[0], pTransEvent->pos[0], pTransEvent->pos[0] + 1,
+                         "%s\t%d\t%s\t%d\tTRA\t%c%c\t%d\t%d\t%d,%d\t%d,%d\n", pAnchors[pTransEvent->refID[0]], pTransEvent->pos[0],
+                         pAnchors[pTransEvent->refID[1]], pTransEvent->pos[1], strand5, strand3, pTransEvent->numFrag, pTransEvent->quality,
+                         pTransEvent->CIpos[0], pTransEvent->CIpos[1], pTransEvent->CIend[0], pTransEvent->CIend[1]);
+    }
+}
+
+// the text output lists the supporting samples by name and the VCF output has a count in every sample column
+void TGM_EventSampleWrite(TGM_EventBuff* pEventBuff, const TGM_SupportArray* pSupportArray, const uint32_t support[2], const uint32_t* pGenotypeCounts,
+                          uint32_t sampleFields, const TGM_SampleInfo* pSampleInfo, TGM_EventFormat format)
+{
+    if (sampleFields == 0)
+        return;
+
+    const TGM_SampleCount* pCounts = NULL;
+    unsigned int numCounts = 0;
+    if ((sampleFields & TGM_SAMPLE_SUPPORT) != 0)
+    {
+        pCounts = pSupportArray->data + support[0];
+        numCounts = support[1] - support[0];
+    }
+
+    if (format == TGM_EVENT_VCF)
+    {
+        if (sampleFields == TGM_SAMPLE_SUPPORT)
+            TGM_EventBuffAppend(pEventBuff, "\tSU");
+        else if (sampleFields == TGM_SAMPLE_GENOTYPE)
+            TGM_EventBuffAppend(pEventBuff, "\tAS:RS");
+        else
+            TGM_EventBuffAppend(pEventBuff, "\tSU:AS:RS");
+
+        unsigned int j = 0;
+        for (unsigned int i = 0; i != pSampleInfo->size; ++i)
+        {
+            char delim = '\t';
+            if ((sampleFields & TGM_SAMPLE_SUPPORT) != 0)
+            {
+                uint32_t count = 0;
+                if (j != numCounts && pCounts[j].sampleID == (int32_t) i)
+                {
+                    count = pCounts[j].count;
+                    ++j;
+                }
+
+                TGM_EventBuffAppend(pEventBuff, "\t%u", count);
+                delim = ':';
+            }
+
+            // the events that are not genotyped have missing values
+            if ((sampleFields & TGM_SAMPLE_GENOTYPE) != 0)
+            {
+                if (pGenotypeCounts != NULL)
+                    TGM_EventBuffAppend(pEventBuff, "%c%u:%u", delim, pGenotypeCounts[2 * i], pGenotypeCounts[2 * i + 1]);
+                else
+                    TGM_EventBuffAppend(pEventBuff, "%c.:.", delim);
+            }
+        }
+    }
+    else
+    {
+        if ((sampleFields & TGM_SAMPLE_SUPPORT) != 0)
+        {
+            if (numCounts == 0)
+                TGM_EventBuffAppend(pEventBuff, "\t.");
+
+            for (unsigned int j = 0; j != numCounts; ++j)
+                TGM_EventBuffAppend(pEventBuff, "%c%s:%u", (j == 0 ? '\t' : ','), pSampleInfo->pSamples[pCounts[j].sampleID], pCounts[j].count);
+        }
+
+        // only the samples with informative pairs are listed
+        if ((sampleFields & TGM_SAMPLE_GENOTYPE) != 0)
+        {
+            char delim = '\t';
+            for (unsigned int i = 0; pGenotypeCounts != NULL && i != pSampleInfo->size; ++i)
+            {
+                if (pGenotypeCounts[2 * i] != 0 || pGenotypeCounts[2 * i + 1] != 0)
+                {
+                    TGM_EventBuffAppend(pEventBuff, "%c%s:%u/%u", delim, pSampleInfo->pSamples[i], pGenotypeCounts[2 * i], pGenotypeCounts[2 * i + 1]);
+                    delim = ',';
+                }
+            }
+
+            if (delim == '\t')
+                TGM_EventBuffAppend(pEventBuff, "\t.");
+        }
+    }
+}
+
+static uint32_t TGM_CrossGridFind(uint32_t* pParent, uint32_t cellIndex)
+{
+    while (pParent[cellIndex] != cellIndex)
+    {
+        pParent[cellIndex] = pParent[pParent[cellIndex]];
+        cellIndex = pParent[cellIndex];
+    }
+
+    return cellIndex;
+}
+
+// the root of a set is always its first cell so that the clusters come out in cell order
+static void TGM_CrossGridUnion(uint32_t* pParent, uint32_t cellIndex1, uint32_t cellIndex2)
+{
+    uint32_t root1 = TGM_CrossGridFind(pParent, cellIndex1);
+    uint32_t root2 = TGM_CrossGridFind(pParent, cellIndex2);
+
+    if (root1 < root2)
+        pParent[root2] = root1;
+    else if (root2 < root1)
+        pParent[root1] = root2;
+}
+
+// make a translocation event from the cross pairs of a cluster
+static void TGM_TransEventMake(TGM_TransEvent* pTransEvent, TGM_SupportArray* pSupportArray, SV_AssistArray* pAssistArray, const TGM_CrossPairArray* pCrossPairArray,
+                               const TGM_CrossGridEntry* pEntries, const uint32_t* pMembers, unsigned int numMembers, uint32_t orient,
+                               const TGM_LibInfoTable* pLibTable)
+{
+    int posMin[2] = {INT_MAX, INT_MAX};
+    int posMax[2] = {0, 0};
+    int endMax[2] = {0, 0};
+
+    SV_AssistArrayResize(pAssistArray, numMembers);
+
+    const TGM_CrossPair* pCrossPair = NULL;
+    for (unsigned int i = 0; i != numMembers; ++i)
+    {
+        pCrossPair = pCrossPairArray->data + pEntries[pMembers[i]].index;
+
+        int pos[2] = {pCrossPair->upPos, pCrossPair->downPos};
+        int end[2] = {pCrossPair->upEnd, pCrossPair->downEnd};
+
+        for (unsigned int k = 0; k != 2; ++k)
+        {
+            if (pos[k] < posMin[k])
+                posMin[k] = pos[k];
+
+            if (pos[k] > posMax[k])
+                posMax[k] = pos[k];
+
+            if (end[k] > endMax[k])
+                endMax[k] = end[k];
+        }
+
+        pAssistArray->pMapQ5[i] = pCrossPair->upMapQ;
+        pAssistArray->pMapQ3[i] = pCrossPair->downMapQ;
+    }
+
+    // the translocation clusters are made in the cross grid, so the samples are counted from the cross pairs
+    pTransEvent->support[0] = pTransEvent->support[1] = 0;
+    if (pSupportArray != NULL)
+    {
+        pTransEvent->support[0] = pSupportArray->size;
+        for (unsigned int i = 0; i != numMembers; ++i)
+        {
+            int32_t readGrpID = pCrossPairArray->data[pEntries[pMembers[i]].index].readGrpID;
+            TGM_SupportArrayAdd(pSupportArray, pTransEvent->support[0], pLibTable->pSampleMap[readGrpID], 1);
+        }
+
+        pTransEvent->support[1] = pSupportArray->size;
+    }
+
+    pTransEvent->refID[0] = pCrossPair->upRefID;
+    pTransEvent->refID[1] = pCrossPair->downRefID;
+    pTransEvent->orient = orient;
+
+    // a forward mate lies before its breakpoint and a reverse mate lies after it
+    pTransEvent->pos[0] = ((orient & 2) != 0 ? posMin[0] : endMax[0] + 1);
+    pTransEvent->pos[1] = ((orient & 1) != 0 ? posMin[1] : endMax[1] + 1);
+
+    pTransEvent->CIpos[0] = -(posMax[0] - posMin[0]) / (int) numMembers;
+    pTransEvent->CIpos[1] = (posMax[0] - posMin[0]) / (int) numMembers;
+
+    pTransEvent->CIend[0] = -(posMax[1] - posMin[1]) / (int) numMembers;
+    pTransEvent->CIend[1] = (posMax[1] - posMin[1]) / (int) numMembers;
+
+    pTransEvent->numFrag = numMembers;
+    pTransEvent->quality = (int) ((numMembers * 100.0) / (numMembers + 10.0));
+
+    pTransEvent->mapQ5 = FindMedianInt(pAssistArray->pMapQ5, pAssistArray->size);
+    pTransEvent->mapQ3 = FindMedianInt(pAssistArray->pMapQ3, pAssistArray->size);
+}
+
+void TGM_ReadPairFindTrans(TGM_TransArray* pTransArray, TGM_SupportArray* pSupportArray, TGM_CrossGrid* pCrossGrid, SV_AssistArray* pAssistArray, const TGM_CrossPairArray* pCrossPairArray,
+                          const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars)
+{
+    // neighbors of a cell that come after it in the sort order
+    static const int neighbors[4][2] = {{0, 1}, {1, -1}, {1, 0}, {1, 1}};
+
+    TGM_ARRAY_RESET(pTransArray);
+
+    uint64_t numPairs = pCrossPairArray->size;
+    if (numPairs == 0)
+        return;
+
+    TGM_CrossGridReserve(pCrossGrid, numPairs);
+
+    // mates of the same translocation are at most one fragment away from each other
+    uint32_t cellSize = (pLibTable->fragLenMax > 0 ? pLibTable->fragLenMax : 1);
+
+    TGM_CrossGridEntry* pEntries = pCrossGrid->pEntries;
+    for (uint64_t i = 0; i != numPairs; ++i)
+    {
+        const TGM_CrossPair* pCrossPair = pCrossPairArray->data + i;
+
+        pEntries[i].group = ((uint32_t) pCrossPair->downRefID << 2) | (pCrossPair->pairMode & 3);
+        pEntries[i].cell[0] = pCrossPair->upPos / cellSize;
+        pEntries[i].cell[1] = pCrossPair->downPos / cellSize;
+        pEntries[i].index = i;
+    }
+
+    qsort(pEntries, numPairs, sizeof(TGM_CrossGridEntry), CompareCrossGridEntries);
+
+    khash_t(crossCell)* pCellHash = pCrossGrid->pCellHash;
+    uint32_t* pCellStart = pCrossGrid->pCellStart;
+    uint32_t* pParent = pCrossGrid->pParent;
+    uint32_t* pCompID = pCrossGrid->pCompID;
+    uint32_t* pCompStart = pCrossGrid->pCompStart;
+
+    uint64_t groupBegin = 0;
+    while (groupBegin != numPairs)
+    {
+        // hash the non-empty cells of the group
+        kh_clear(crossCell, pCellHash);
+
+        uint32_t numCells = 0;
+        uint64_t groupEnd = groupBegin;
+        while (groupEnd != numPairs && pEntries[groupEnd].group == pEntries[groupBegin].group)
+        {
+            if (groupEnd == groupBegin || pEntries[groupEnd].cell[0] != pEntries[groupEnd - 1].cell[0]
+                || pEntries[groupEnd].cell[1] != pEntries[groupEnd - 1].cell[1])
+            {
+                int ret = 0;
+                uint64_t key = ((uint64_t) pEntries[groupEnd].cell[0] << 32) | pEntries[groupEnd].cell[1];
+                khiter_t khIter = kh_put(crossCell, pCellHash, key, &ret);
+                kh_value(pCellHash, khIter) = numCells;
+
+                pCellStart[numCells] = groupEnd;
+                pParent[numCells] = numCells;
+                ++numCells;
+            }
+
+            ++groupEnd;
+        }
+
+        pCellStart[numCells] = groupEnd;
+
+        // join the neighboring cells
+        for (uint32_t c = 0; c != numCells; ++c)
+        {
+            const TGM_CrossGridEntry* pEntry = pEntries + pCellStart[c];
+            for (unsigned int k = 0; k != 4; ++k)
+            {
+                if (neighbors[k][1] < 0 && pEntry->cell[1] == 0)
+                    continue;
+
+                uint64_t key = ((uint64_t) (pEntry->cell[0] + neighbors[k][0]) << 32) | (uint32_t) (pEntry->cell[1] + neighbors[k][1]);
+                khiter_t khIter = kh_get(crossCell, pCellHash, key);
+                if (khIter != kh_end(pCellHash))
+                    TGM_CrossGridUnion(pParent, c, kh_value(pCellHash, khIter));
+            }
+        }
+
+        // number the clusters in the order of their first cells and count their cross pairs
+        uint32_t numComps = 0;
+        for (uint32_t c = 0; c != numCells; ++c)
+        {
+            uint32_t root = TGM_CrossGridFind(pParent, c);
+            if (root == c)
+            {
+                pCompID[c] = numComps;
+                pCompStart[numComps] = 0;
+                ++numComps;
+            }
+            else
+                pCompID[c] = pCompID[root];
+
+            pCompStart[pCompID[c]] += pCellStart[c + 1] - pCellStart[c];
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t k = 0; k != numComps; ++k)
+        {
+            uint32_t count = pCompStart[k];
+            pCompStart[k] = offset;
+            offset += count;
+        }
+
+        pCompStart[numComps] = offset;
+
+        // gather the entries of each cluster
+        for (uint32_t c = 0; c != numCells; ++c)
+        {
+            uint32_t* pNext = pCompStart + pCompID[c];
+            for (uint32_t e = pCellStart[c]; e != pCellStart[c + 1]; ++e)
+            {
+                pCrossGrid->pMembers[*pNext] = e;
+                ++(*pNext);
+            }
+        }
+
+        // after the gather each cluster starts where the previous one ends
+        uint32_t compBegin = 0;
+        for (uint32_t k = 0; k != numComps; ++k)
+        {
+            uint32_t compEnd = pCompStart[k];
+            uint32_t numMembers = compEnd - compBegin;
+
+            if (numMembers >= pPars->minNumClustered)
+            {
+                if (pTransArray->size == pTransArray->capacity)
+                    TGM_ARRAY_RESIZE(pTransArray, pTransArray->capacity * 2, TGM_TransEvent);
+
+                TGM_TransEventMake(pTransArray->data + pTransArray->size, pSupportArray, pAssistArray, pCrossPairArray, pEntries,
+                                   pCrossGrid->pMembers + compBegin, numMembers, pEntries[groupBegin].group & 3, pLibTable);
+
+                ++(pTransArray->size);
+            }
+
+            compBegin = compEnd;
+        }
+
+        groupBegin = groupEnd;
+    }
+
+    if (pTransArray->size > 1)
+        qsort(pTransArray->data, pTransArray->size, sizeof(TGM_TransEvent), CompareTransEvents);
+}
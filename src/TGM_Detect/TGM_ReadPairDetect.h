@@ -23,6 +23,7 @@
 
 #include "TGM_Cluster.h"
 #include "TGM_ReadPairBuild.h"
+#include "TGM_EventWriter.h"
 
 typedef struct TGM_ReadPairDetectPars
 {
@@ -36,15 +37,29 @@ typedef struct TGM_ReadPairDetectPars
 
     int minEventLength;
 
-}TGM_ReadPairDetectPars;
+    uint64_t loadingMemLimit;
 
-typedef struct TGM_SpecialID
-{
-    char (*names)[3];
-    
-    uint32_t size;
+    int32_t tileSize;
+
+    TGM_Bool streamSpecial;
+
+    TGM_Bool incremental;
+
+    TGM_Bool sampleSupport;
+
+    char** bamFileNames;
+
+    unsigned int numBamFiles;
+
+    unsigned int genotypeCacheBlocks;
 
-}TGM_SpecialID;
+    char* outputFile;
+
+    TGM_EventFormat outputFormat;
+
+    TGM_Bool compressOutput;
+
+}TGM_ReadPairDetectPars;
 
 typedef struct TGM_DetectJob
 {
@@ -52,31 +67,57 @@ typedef struct TGM_DetectJob
 
     int32_t refID;
 
+    int32_t specialID;
+
+    unsigned int jobID;
+
+    unsigned int tileID;
+
+    unsigned int begin;
+
+    unsigned int end;
+
     SV_EventType eventType;
 
 }TGM_DetectJob;
 
-typedef struct TGM_DetectJobStack
+// double-ended job queue owned by one detection thread. the owner takes jobs
+// from the back and the other threads steal jobs from the front
+typedef struct TGM_DetectJobDeque
 {
     TGM_DetectJob* pJobs;
 
-    const TGM_LibInfoTable* pLibTable;
+    unsigned int head;
 
-    unsigned int top;
+    unsigned int size;
 
     unsigned int capacity;
 
     pthread_mutex_t mutex;
 
+}TGM_DetectJobDeque;
+
+typedef struct TGM_DetectScheduler
+{
+    TGM_DetectJobDeque* pDeques;
+
+    const TGM_LibInfoTable* pLibTable;
+
+    pthread_mutex_t mutex;
+
+    pthread_cond_t cond;
+
     unsigned int numThread;
 
     unsigned int loadingNum;
 
     unsigned int loadingLimit;
 
-    int nextJobID;
+    uint64_t loadingMem;
+
+    uint64_t loadingMemLimit;
 
-}TGM_DetectJobStack;
+}TGM_DetectScheduler;
 
 typedef struct TGM_DelEvent
 {
@@ -98,6 +139,8 @@ typedef struct TGM_DelEvent
     unsigned char mapQ5;
     unsigned char mapQ3;
 
+    uint32_t support[2];            // range of the per-sample counts in the support array of the job
+
 }TGM_DelEvent;
 
 typedef struct TGM_DelArray
@@ -110,6 +153,129 @@ typedef struct TGM_DelArray
 
 }TGM_DelArray;
 
+typedef struct TGM_DupEvent
+{
+    int32_t clusterID;
+
+    int32_t refID;
+    uint32_t pos;
+    uint32_t end;
+    uint32_t length;
+
+    int CIpos[2];
+    int CIend[2];
+    int CIlen[2];
+
+    unsigned char quality;
+    unsigned char mapQ5;
+    unsigned char mapQ3;
+
+    unsigned char readPairType;     // short or reversed pairs
+
+    uint32_t support[2];            // range of the per-sample counts in the support array of the job
+
+}TGM_DupEvent;
+
+typedef struct TGM_DupArray
+{
+    TGM_DupEvent* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_DupArray;
+
+typedef struct TGM_InvEvent
+{
+    int32_t refID;
+    uint32_t pos;
+    uint32_t end;
+    uint32_t length;
+
+    int CIpos[2];
+    int CIend[2];
+
+    int numFrag[2];                 // number of inverted3 and inverted5 pairs
+
+    unsigned char quality;
+
+    uint32_t support[2];            // range of the per-sample counts in the support array of the job
+
+}TGM_InvEvent;
+
+typedef struct TGM_InvArray
+{
+    TGM_InvEvent* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_InvArray;
+
+typedef struct TGM_TransEvent
+{
+    int32_t refID[2];               // reference ID of the up and down breakpoint
+    int32_t pos[2];                 // position of the up and down breakpoint
+
+    int CIpos[2];                   // confidence interval of the up breakpoint
+    int CIend[2];                   // confidence interval of the down breakpoint
+
+    int numFrag;                    // number of cross pairs
+
+    unsigned char quality;
+    unsigned char mapQ5;
+    unsigned char mapQ3;
+
+    unsigned char orient;           // strand of the up mate (bit 1) and the down mate (bit 0), set bit means reverse
+
+    uint32_t support[2];            // range of the per-sample counts in the support array of the job
+
+}TGM_TransEvent;
+
+typedef struct TGM_TransArray
+{
+    TGM_TransEvent* data;
+
+    unsigned int size;
+
+    unsigned int capacity;
+
+}TGM_TransArray;
+
+// a cross pair placed in the translocation grid
+typedef struct TGM_CrossGridEntry
+{
+    uint32_t group;                 // down reference ID and orientation of the cross pair
+
+    uint32_t cell[2];               // grid cell of the up and down mate
+
+    uint32_t index;                 // index of the cross pair
+
+}TGM_CrossGridEntry;
+
+// 2-D grid hash over the (up position, down position) plane of the cross pairs
+typedef struct TGM_CrossGrid
+{
+    TGM_CrossGridEntry* pEntries;   // cross pairs sorted by group and cell
+
+    uint32_t* pCellStart;           // first entry of each non-empty cell in a group
+
+    uint32_t* pParent;              // union-find parent of each non-empty cell in a group
+
+    uint32_t* pCompID;              // cluster index of each non-empty cell in a group
+
+    uint32_t* pCompStart;           // first member of each cluster in a group
+
+    uint32_t* pMembers;             // entries grouped by cluster
+
+    void* pCellHash;                // cell key to non-empty cell index
+
+    uint64_t capacity;              // number of cross pairs the arrays can hold
+
+}TGM_CrossGrid;
+
 typedef struct TGM_SpecialEvent
 {
     int32_t refID;
@@ -124,6 +290,8 @@ typedef struct TGM_SpecialEvent
     int numFrag[2];
     double sense[2];
 
+    uint32_t support[2];            // range of the per-sample counts in the support array of the job
+
 }TGM_SpecialEvent;
 
 typedef struct TGM_SpecialEventArray
@@ -150,67 +318,113 @@ typedef struct SV_AssistArray
 
 }SV_AssistArray;
 
-TGM_DetectJobStack* TGM_DetectJobStackAlloc(unsigned int numThread, unsigned int loadingLimit, const TGM_LibInfoTable* pLibTable);
+TGM_DetectScheduler* TGM_DetectSchedulerAlloc(unsigned int numThread, unsigned int loadingLimit, const TGM_LibInfoTable* pLibTable);
 
-void TGM_DetectJobStackFree(TGM_DetectJobStack* pJobStack);
+void TGM_DetectSchedulerFree(TGM_DetectScheduler* pScheduler);
 
 SV_AssistArray* SV_AssistArrayAlloc(void);
 
 void SV_AssistArrayFree(SV_AssistArray* pAssistArray);
 
+TGM_CrossGrid* TGM_CrossGridAlloc(void);
+
+void TGM_CrossGridFree(TGM_CrossGrid* pCrossGrid);
+
 
 void TGM_ReadPairDetect(const TGM_ReadPairDetectPars* pDetectPars);
 
-int TGM_DetectJobStackLock(TGM_DetectJobStack* pJobStack);
+int TGM_DetectSchedulerLock(TGM_DetectScheduler* pScheduler);
 
-int TGM_DetectJobStackUnlock(TGM_DetectJobStack* pJobStack);
+int TGM_DetectSchedulerUnlock(TGM_DetectScheduler* pScheduler);
 
-static inline TGM_Bool TGM_DetectJobStackIsEmpty(const TGM_DetectJobStack* pJobStack)
-{
-    return (pJobStack->top == 0);
-}
+int TGM_DetectSchedulerWait(TGM_DetectScheduler* pScheduler);
+
+int TGM_DetectSchedulerBroadcast(TGM_DetectScheduler* pScheduler);
+
+void TGM_DetectSchedulerPush(TGM_DetectScheduler* pScheduler, unsigned int threadID, const TGM_DetectJob* pJob);
 
-void TGM_DetectJobStackPush(TGM_DetectJobStack* pJobStack, const TGM_DetectJob* pJob);
+TGM_Status TGM_DetectSchedulerPop(TGM_DetectJob* pJob, TGM_DetectScheduler* pScheduler, unsigned int threadID);
 
-TGM_Status TGM_DetectJobStackPop(TGM_DetectJob* pJob, TGM_DetectJobStack* pJobStack);
+void TGM_LocalPairArrayRead(TGM_LocalPairArray* pLocalPairArray, TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType);
 
-TGM_SpecialID* TGM_SpecialIDRead(FILE* libInput);
+TGM_Bool TGM_LocalPairArrayMap(TGM_LocalPairArray* pLocalPairArray, TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType);
 
-void TGM_SpecialIDFree(TGM_SpecialID* pSpecialID);
+void TGM_CrossPairArrayRead(TGM_CrossPairArray* pCrossPairArray, TGM_ReadPairInFile* pInFile, int32_t refID);
 
-void TGM_LocalPairArrayRead(TGM_LocalPairArray* pLongPairArray, FILE* input);
+TGM_Bool TGM_CrossPairArrayMap(TGM_CrossPairArray* pCrossPairArray, TGM_ReadPairInFile* pInFile, int32_t refID);
 
-void TGM_CrossPairArrayRead(TGM_CrossPairArray* pCrossPairArray, FILE* input);
+void TGM_SpecialPairArrayRead(TGM_SpecialPairArray* pSpecialPairArray, TGM_ReadPairInFile* pInFile, int32_t refID);
 
-void TGM_SpecialPairArrayRead(TGM_SpecialPairArray* pSpecialPairArray, FILE* input);
+TGM_Bool TGM_SpecialPairArrayMap(TGM_SpecialPairArray* pSpecialPairArray, TGM_ReadPairInFile* pInFile, int32_t refID);
 
 // void TGM_SpecialPairTableReadID(TGM_SpecialPairTable* pSpeicalPairTable, FILE* libInput);
 
 void SV_AssistArrayResize(SV_AssistArray* pAssistArray, unsigned int newSize);
 
-void TGM_DetectDel(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable);
+void TGM_DetectDel(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile);
 
-void TGM_DetectTandemDup(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable);
+void TGM_DetectTandemDup(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile);
 
-void TGM_DetectInversion(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable);
+void TGM_DetectInversion(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile);
 
-void TGM_DetectSpecial(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, const TGM_SpecialID* pSpecialID);
+void TGM_DetectSpecial(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, const TGM_SpecialID* pSpecialID, TGM_ReadPairInFile* pInFile);
 
-void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, const TGM_Cluster* pCluster, unsigned int index, 
-                         const TGM_SpecialPairArray* pSpecialPairArray, const TGM_LibInfoTable* pLibTable);
+// pMemberPairs holds the special pairs of the compacted cluster gathered by TGM_ClusterGather.
+// the per-sample counts are appended to pSupportArray unless it is NULL
+void TGM_SpecialEventMake(TGM_SpecialEvent* pSpecialEvent, TGM_SupportArray* pSupportArray, const TGM_Cluster* pCluster, unsigned int index, 
+                         const TGM_SpecialPair* pMemberPairs, const TGM_LibInfoTable* pLibTable);
 
-void TGM_SpecialEventMerge(TGM_SpecialEvent* mergedEvent, const TGM_SpecialEvent* pHeadEvent, const TGM_SpecialEvent* pTailEvent, TGM_Cluster* pCluster3, TGM_Cluster* pCluster5);
+void TGM_SpecialEventMerge(TGM_SpecialEvent* mergedEvent, TGM_SupportArray* pSupportArray, const TGM_SpecialEvent* pHeadEvent, const TGM_SpecialEvent* pTailEvent,
+                           TGM_Cluster* pCluster3, TGM_Cluster* pCluster5);
 
-void TGM_SpecialEventPrint(const TGM_SpecialEvent* pSpecialEvent);
+void TGM_SpecialEventWrite(TGM_EventBuff* pEventBuff, const TGM_SpecialEvent* pSpecialEvent, const char* specialName, char* const* pAnchors, TGM_EventFormat format);
 
-void TGM_DetectTranslocation(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable);
+void TGM_DetectTranslocation(const TGM_ReadPairDetectPars* pDetectPars, const TGM_LibInfoTable* pLibTable, TGM_ReadPairInFile* pInFile);
 
-void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLongPairArray,
+// the deletion cluster must be compacted with TGM_ClusterCompact. in this and the following find functions
+// the per-sample counts of the events are appended to pSupportArray unless it is NULL
+void TGM_ReadPairFindDel(TGM_DelArray* pDelArray, TGM_SupportArray* pSupportArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLongPairArray,
                         TGM_Cluster* pDelCluster, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars);
 
-/*  
-void TGM_DelEventGenotype(TGM_DelArray* pDelArray, const TGM_LibInfoTable* pLibTable);
-*/
+void TGM_DelEventWrite(TGM_EventBuff* pEventBuff, const TGM_DelEvent* pDelEvent, char* const* pAnchors, TGM_EventFormat format);
+
+// the duplication cluster must be compacted with TGM_ClusterCompact. the events are appended to pDupArray
+void TGM_ReadPairFindDup(TGM_DupArray* pDupArray, TGM_SupportArray* pSupportArray, SV_AssistArray* pAssistArray, const TGM_LocalPairArray* pLocalPairArray,
+                        const TGM_Cluster* pDupCluster, const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars);
+
+void TGM_DupEventWrite(TGM_EventBuff* pEventBuff, const TGM_DupEvent* pDupEvent, char* const* pAnchors, TGM_EventFormat format);
+
+// the inverted3 and inverted5 clusters must be compacted with TGM_ClusterCompact
+void TGM_ReadPairFindInv(TGM_InvArray* pInvArray, TGM_SupportArray* pSupportArray, const TGM_LocalPairArray* pInvertedPairArray, TGM_Cluster* pInvClusters[2],
+                        const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars);
+
+void TGM_InvEventWrite(TGM_EventBuff* pEventBuff, const TGM_InvEvent* pInvEvent, char* const* pAnchors, TGM_EventFormat format);
+
+// the cross pairs are grouped by the down reference and the orientation. each group is put in a grid of
+// cells one maximum fragment length wide and the clusters are the connected sets of neighboring cells
+void TGM_ReadPairFindTrans(TGM_TransArray* pTransArray, TGM_SupportArray* pSupportArray, TGM_CrossGrid* pCrossGrid, SV_AssistArray* pAssistArray, const TGM_CrossPairArray* pCrossPairArray,
+                          const TGM_LibInfoTable* pLibTable, const TGM_ReadPairDetectPars* pPars);
+
+void TGM_TransEventWrite(TGM_EventBuff* pEventBuff, const TGM_TransEvent* pTransEvent, char* const* pAnchors, TGM_EventFormat format);
+
+//================================================================
+// function:
+//      extend the last written event with its per-sample fields
+//
+// args:
+//      1. pEventBuff: event buffer holding the event
+//      2. pSupportArray: per-sample counts of the clustered pairs
+//      3. support: range of the event in the support array
+//      4. pGenotypeCounts: alternative and reference counts of each
+//                          sample (NULL if the event is not
+//                          genotyped)
+//      5. sampleFields: per-sample fields of the output (nothing
+//                       is written if 0)
+//      6. pSampleInfo: names of the samples
+//      7. format: format of the events
+//================================================================
+void TGM_EventSampleWrite(TGM_EventBuff* pEventBuff, const TGM_SupportArray* pSupportArray, const uint32_t support[2], const uint32_t* pGenotypeCounts,
+                          uint32_t sampleFields, const TGM_SampleInfo* pSampleInfo, TGM_EventFormat format);
 
 
 #endif  /*TGM_READPAIRDETECT_H*/
@@ -0,0 +1,986 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairFile.c
+ *
+ *    Description:  single indexed container for the read pair data
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "md5.h"
+#include "TGM_Error.h"
+#include "TGM_Utilities.h"
+#include "TGM_ReadPairFile.h"
+#include "TGM_ReadPairCodec.h"
+
+#define DEFAULT_RP_CHUNK_CAPACITY 100
+
+// the bytes of a chunk are digested in pieces of this size (md5 takes a 32-bit length)
+#define TGM_RP_DIGEST_PIECE_SIZE (1 << 20)
+
+static const char* TGM_ReadPairFileName = "read_pairs.dat";
+
+static const char TGM_READ_PAIR_FILE_MAGIC[4] = {'T', 'G', 'M', 'P'};
+
+// header at the beginning of the container
+typedef struct TGM_ReadPairFileHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    uint64_t reserved;
+
+}TGM_ReadPairFileHeader;
+
+// trailer at the end of the container
+typedef struct TGM_ReadPairFileTrailer
+{
+    uint64_t indexOffset;          // file offset of the chunk index
+
+    uint64_t numChunks;            // number of entries in the chunk index
+
+    char magic[4];
+
+    uint32_t version;
+
+}TGM_ReadPairFileTrailer;
+
+static int CompareChunks(const void* a, const void* b)
+{
+    const TGM_ReadPairChunk* first = a;
+    const TGM_ReadPairChunk* second = b;
+
+    if (first->refID != second->refID)
+        return (first->refID < second->refID ? -1 : 1);
+
+    if (first->chunkType != second->chunkType)
+        return (first->chunkType < second->chunkType ? -1 : 1);
+
+    if (first->offset != second->offset)
+        return (first->offset < second->offset ? -1 : 1);
+
+    return 0;
+}
+
+// arguments of a decompression thread
+typedef struct TGM_ReadPairDecodeJob
+{
+    const TGM_ReadPairChunk* pChunks;     // chunks to be read
+
+    const uint64_t* pStageOffsets;        // offsets of the compressed chunks in the staging buffer
+
+    const uint64_t* pDstOffsets;          // offsets of the decoded read pairs in the output buffer
+
+    uint64_t numChunks;                   // number of chunks
+
+    const uint8_t* pStage;                // staging buffer
+
+    char* pDst;                           // output buffer
+
+    unsigned int threadID;                // ID of this thread
+
+    unsigned int numThreads;              // total number of decompression threads
+
+}TGM_ReadPairDecodeJob;
+
+// pad the output stream to the chunk alignment
+static void TGM_ReadPairOutFilePad(TGM_ReadPairOutFile* pOutFile)
+{
+    static const char padding[TGM_READ_PAIR_CHUNK_ALIGN] = {0};
+
+    unsigned int padSize = (TGM_READ_PAIR_CHUNK_ALIGN - pOutFile->currOffset % TGM_READ_PAIR_CHUNK_ALIGN) % TGM_READ_PAIR_CHUNK_ALIGN;
+    if (padSize > 0)
+    {
+        if (fwrite(padding, sizeof(char), padSize, pOutFile->output) != padSize)
+            TGM_ErrQuit("ERROR: Cannot write the read pair file.\n");
+
+        pOutFile->currOffset += padSize;
+    }
+}
+
+// decompress every numThreads-th compressed chunk starting from the thread ID
+static void* TGM_ReadPairDecodeThread(void* pArg)
+{
+    const TGM_ReadPairDecodeJob* pJob = pArg;
+    TGM_ReadPairCodecBuff* pCodecBuff = TGM_ReadPairCodecBuffAlloc();
+
+    for (uint64_t i = pJob->threadID; i < pJob->numChunks; i += pJob->numThreads)
+    {
+        const TGM_ReadPairChunk* pChunk = pJob->pChunks + i;
+        if (pChunk->codec == TGM_RP_CODEC_RAW)
+            continue;
+
+        TGM_ReadPairBlockDecode(pJob->pDst + pJob->pDstOffsets[i], pCodecBuff, pJob->pStage + pJob->pStageOffsets[i], pChunk->size,
+                                pChunk->refID, pChunk->chunkType, pChunk->numPairs);
+    }
+
+    TGM_ReadPairCodecBuffFree(pCodecBuff);
+
+    return NULL;
+}
+
+// get the bytes of a chunk from the mapped container or read them into the staging buffer
+static const uint8_t* TGM_ReadPairStreamLoad(TGM_ReadPairStream* pStream, const TGM_ReadPairChunk* pChunk)
+{
+    const TGM_ReadPairInFile* pInFile = pStream->pInFile;
+
+    if (pInFile->pMap != NULL)
+    {
+        if (pChunk->offset + pChunk->size > pInFile->mapSize)
+            TGM_ErrQuit("ERROR: The read pair file is truncated.\n");
+
+        return pInFile->pMap + pChunk->offset;
+    }
+
+    if (pChunk->size > pStream->stageCap)
+    {
+        free(pStream->pStage);
+        pStream->pStage = (uint8_t*) malloc(pChunk->size);
+        if (pStream->pStage == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the staging buffer of the read pair file.\n");
+
+        pStream->stageCap = pChunk->size;
+    }
+
+    // pread does not move the shared file position of the other readers
+    if (pread(fileno(pInFile->input), pStream->pStage, pChunk->size, pChunk->offset) != (ssize_t) pChunk->size)
+        TGM_ErrQuit("ERROR: Cannot read the read pairs from the read pair file.\n");
+
+    return pStream->pStage;
+}
+
+static inline const char* TGM_ReadPairRunRecord(const TGM_ReadPairStream* pStream, const TGM_ReadPairRun* pRun, uint64_t index)
+{
+    return pRun->pRecords + pStream->recordSize * (pRun->pOrder != NULL ? pRun->pOrder[index] : index);
+}
+
+// decode a compressed block, or get a raw chunk and sort it by position if it is not sorted yet
+static void TGM_ReadPairRunOpen(TGM_ReadPairStream* pStream, TGM_ReadPairRun* pRun)
+{
+    const TGM_ReadPairChunk* pChunk = pRun->pChunk;
+    const uint8_t* pBytes = NULL;
+
+    if (pChunk->codec != TGM_RP_CODEC_RAW)
+    {
+        pRun->pBuff = malloc(pChunk->numPairs * pStream->recordSize);
+        if (pRun->pBuff == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the read pairs.\n");
+
+        pBytes = TGM_ReadPairStreamLoad(pStream, pChunk);
+        TGM_ReadPairBlockDecode(pRun->pBuff, pStream->pCodecBuff, pBytes, pChunk->size, pChunk->refID, pChunk->chunkType, pChunk->numPairs);
+
+        pRun->pRecords = pRun->pBuff;
+        return;
+    }
+
+    if (pChunk->size != pChunk->numPairs * pStream->recordSize)
+        TGM_ErrQuit("ERROR: Unexpected record size in the read pair file.\n");
+
+    pBytes = TGM_ReadPairStreamLoad(pStream, pChunk);
+    if (pStream->pInFile->pMap != NULL && pChunk->offset % TGM_READ_PAIR_CHUNK_ALIGN == 0)
+    {
+        pRun->pRecords = (const char*) pBytes;
+    }
+    else
+    {
+        pRun->pBuff = malloc(pChunk->size);
+        if (pRun->pBuff == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the read pairs.\n");
+
+        memcpy(pRun->pBuff, pBytes, pChunk->size);
+        pRun->pRecords = pRun->pBuff;
+    }
+
+    uint64_t numPairs = pChunk->numPairs;
+    uint64_t i = 1;
+    while (i < numPairs && TGM_ReadPairRecordPos(pRun->pRecords + pStream->recordSize * (i - 1), pStream->chunkType)
+                           <= TGM_ReadPairRecordPos(pRun->pRecords + pStream->recordSize * i, pStream->chunkType))
+    {
+        ++i;
+    }
+
+    if (i >= numPairs)
+        return;
+
+    // the radix sort is stable so the read pairs at the same position keep their order in the chunk
+    pRun->pOrder = (uint32_t*) malloc(numPairs * sizeof(uint32_t));
+    TGM_SortKey* pKeys = (TGM_SortKey*) malloc(2 * numPairs * sizeof(TGM_SortKey));
+    if (pRun->pOrder == NULL || pKeys == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the order of the read pairs.\n");
+
+    for (i = 0; i != numPairs; ++i)
+    {
+        pKeys[i].key = (uint32_t) TGM_ReadPairRecordPos(pRun->pRecords + pStream->recordSize * i, pStream->chunkType);
+        pKeys[i].index = i;
+    }
+
+    const TGM_SortKey* pSorted = TGM_RadixSortKeys(pKeys, pKeys + numPairs, numPairs);
+    for (i = 0; i != numPairs; ++i)
+        pRun->pOrder[i] = pSorted[i].index;
+
+    free(pKeys);
+}
+
+static void TGM_ReadPairRunClose(TGM_ReadPairRun* pRun)
+{
+    free(pRun->pBuff);
+    free(pRun->pOrder);
+
+    pRun->pBuff = NULL;
+    pRun->pOrder = NULL;
+    pRun->pRecords = NULL;
+}
+
+static int CompareRuns(const void* a, const void* b)
+{
+    const TGM_ReadPairRun* first = a;
+    const TGM_ReadPairRun* second = b;
+
+    if (first->startPos != second->startPos)
+        return (first->startPos < second->startPos ? -1 : 1);
+
+    return (first->pChunk < second->pChunk ? -1 : 1);
+}
+
+// order of two open runs in the merge heap: the position of the next read pair, then the chunk index
+static inline TGM_Bool TGM_ReadPairRunBefore(const TGM_ReadPairStream* pStream, uint64_t run1, uint64_t run2)
+{
+    const TGM_ReadPairRun* pRun1 = pStream->pRuns + run1;
+    const TGM_ReadPairRun* pRun2 = pStream->pRuns + run2;
+
+    int32_t pos1 = TGM_ReadPairRecordPos(TGM_ReadPairRunRecord(pStream, pRun1, pRun1->next), pStream->chunkType);
+    int32_t pos2 = TGM_ReadPairRecordPos(TGM_ReadPairRunRecord(pStream, pRun2, pRun2->next), pStream->chunkType);
+
+    if (pos1 != pos2)
+        return (pos1 < pos2);
+
+    return (pRun1->pChunk < pRun2->pChunk);
+}
+
+static void TGM_ReadPairStreamSiftDown(TGM_ReadPairStream* pStream, uint64_t index)
+{
+    uint64_t* pHeap = pStream->pHeap;
+    while (TRUE)
+    {
+        uint64_t smallest = index;
+        uint64_t left = 2 * index + 1;
+        uint64_t right = left + 1;
+
+        if (left < pStream->heapSize && TGM_ReadPairRunBefore(pStream, pHeap[left], pHeap[smallest]))
+            smallest = left;
+
+        if (right < pStream->heapSize && TGM_ReadPairRunBefore(pStream, pHeap[right], pHeap[smallest]))
+            smallest = right;
+
+        if (smallest == index)
+            break;
+
+        uint64_t temp = pHeap[index];
+        pHeap[index] = pHeap[smallest];
+        pHeap[smallest] = temp;
+        index = smallest;
+    }
+}
+
+static void TGM_ReadPairStreamPush(TGM_ReadPairStream* pStream, uint64_t run)
+{
+    uint64_t* pHeap = pStream->pHeap;
+    uint64_t index = pStream->heapSize;
+    pHeap[index] = run;
+    ++(pStream->heapSize);
+
+    while (index > 0)
+    {
+        uint64_t parent = (index - 1) / 2;
+        if (!TGM_ReadPairRunBefore(pStream, pHeap[index], pHeap[parent]))
+            break;
+
+        uint64_t temp = pHeap[index];
+        pHeap[index] = pHeap[parent];
+        pHeap[parent] = temp;
+        index = parent;
+    }
+}
+
+// wait for write jobs and run them until the container is closed
+static void* TGM_ReadPairWriterThread(void* pArg)
+{
+    TGM_ReadPairOutFile* pOutFile = pArg;
+
+    pthread_mutex_lock(&(pOutFile->mutex));
+
+    while (TRUE)
+    {
+        while (!pOutFile->isBusy && !pOutFile->isClosing)
+            pthread_cond_wait(&(pOutFile->cond), &(pOutFile->mutex));
+
+        if (!pOutFile->isBusy)
+            break;
+
+        pthread_mutex_unlock(&(pOutFile->mutex));
+
+        pOutFile->writeFunc(pOutFile->pWriteTable, pOutFile);
+
+        pthread_mutex_lock(&(pOutFile->mutex));
+
+        pOutFile->writeFunc = NULL;
+        pOutFile->pWriteTable = NULL;
+        pOutFile->isBusy = FALSE;
+        pthread_cond_broadcast(&(pOutFile->cond));
+    }
+
+    pthread_mutex_unlock(&(pOutFile->mutex));
+
+    return NULL;
+}
+
+// write an encoded chunk and add it into the index
+static void TGM_ReadPairOutFileAppend(TGM_ReadPairOutFile* pOutFile, int32_t refID, TGM_ReadPairChunkType chunkType, TGM_ReadPairCodec codec,
+                                     const void* pData, uint64_t size, uint64_t numPairs, int32_t startPos)
+{
+    TGM_ReadPairOutFilePad(pOutFile);
+
+    TGM_ReadPairChunk chunk;
+    memset(&chunk, 0, sizeof(TGM_ReadPairChunk));
+
+    chunk.refID = refID;
+    chunk.chunkType = chunkType;
+    chunk.codec = codec;
+    chunk.offset = pOutFile->currOffset;
+    chunk.numPairs = numPairs;
+    chunk.size = size;
+    chunk.startPos = startPos;
+
+    // the digest lets the detector tell a changed chunk without reading it
+    struct MD5Context context;
+    MD5Init(&context);
+
+    for (uint64_t done = 0; done < size; done += TGM_RP_DIGEST_PIECE_SIZE)
+    {
+        uint64_t pieceSize = (size - done < TGM_RP_DIGEST_PIECE_SIZE ? size - done : TGM_RP_DIGEST_PIECE_SIZE);
+        MD5Update(&context, (unsigned char*) pData + done, pieceSize);
+    }
+
+    MD5Final(chunk.digest, &context);
+
+    if (fwrite(pData, sizeof(char), size, pOutFile->output) != size)
+        TGM_ErrQuit("ERROR: Cannot write the read pairs into the read pair file.\n");
+
+    pOutFile->currOffset += chunk.size;
+
+    TGM_ARRAY_PUSH(pOutFile->pChunkArray, &chunk, TGM_ReadPairChunk);
+}
+
+// set up the stream buffer, the codec and the writer thread of an opened output container
+static void TGM_ReadPairOutFileInit(TGM_ReadPairOutFile* pOutFile, int compressLevel)
+{
+    // a large aligned buffer turns the many small chunk writes into few big ones
+    if (posix_memalign((void**) &(pOutFile->pStreamBuff), TGM_READ_PAIR_WRITE_BUFF_ALIGN, TGM_READ_PAIR_WRITE_BUFF_SIZE) != 0)
+        TGM_ErrQuit("ERROR: Not enough memory for the stream buffer of the read pair file.\n");
+
+    if (setvbuf(pOutFile->output, pOutFile->pStreamBuff, _IOFBF, TGM_READ_PAIR_WRITE_BUFF_SIZE) != 0)
+        TGM_ErrQuit("ERROR: Cannot set the stream buffer of the read pair file.\n");
+
+    pOutFile->compressLevel = compressLevel;
+    pOutFile->pCodecBuff = NULL;
+    if (compressLevel != 0)
+        pOutFile->pCodecBuff = TGM_ReadPairCodecBuffAlloc();
+
+    pOutFile->writeFunc = NULL;
+    pOutFile->pWriteTable = NULL;
+    pOutFile->isBusy = FALSE;
+    pOutFile->isClosing = FALSE;
+
+    pthread_mutex_init(&(pOutFile->mutex), NULL);
+    pthread_cond_init(&(pOutFile->cond), NULL);
+
+    if (pthread_create(&(pOutFile->writer), NULL, TGM_ReadPairWriterThread, pOutFile) != 0)
+        TGM_ErrQuit("ERROR: Cannot create the writer thread of the read pair file.\n");
+}
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+TGM_ReadPairOutFile* TGM_ReadPairOutFileOpen(const char* workingDir, int compressLevel)
+{
+    TGM_ReadPairOutFile* pOutFile = (TGM_ReadPairOutFile*) malloc(sizeof(TGM_ReadPairOutFile));
+    if (pOutFile == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a read pair output file object.\n");
+
+    char* fileName = TGM_CreateFileName(workingDir, TGM_ReadPairFileName);
+
+    pOutFile->output = fopen(fileName, "wb");
+    if (pOutFile->output == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the read pair file: %s\n", fileName);
+
+    free(fileName);
+
+    TGM_ReadPairOutFileInit(pOutFile, compressLevel);
+
+    TGM_ARRAY_ALLOC(pOutFile->pChunkArray, DEFAULT_RP_CHUNK_CAPACITY, TGM_ReadPairChunkArray, TGM_ReadPairChunk);
+
+    TGM_ReadPairFileHeader header;
+    memset(&header, 0, sizeof(TGM_ReadPairFileHeader));
+    memcpy(header.magic, TGM_READ_PAIR_FILE_MAGIC, sizeof(header.magic));
+    header.version = TGM_READ_PAIR_FILE_VERSION;
+
+    if (fwrite(&header, sizeof(TGM_ReadPairFileHeader), 1, pOutFile->output) != 1)
+        TGM_ErrQuit("ERROR: Cannot write the header of the read pair file.\n");
+
+    pOutFile->currOffset = sizeof(TGM_ReadPairFileHeader);
+
+    return pOutFile;
+}
+
+TGM_ReadPairOutFile* TGM_ReadPairOutFileResume(const char* workingDir, int compressLevel, uint64_t offset, const TGM_ReadPairChunk* pChunks, uint64_t numChunks)
+{
+    TGM_ReadPairOutFile* pOutFile = (TGM_ReadPairOutFile*) malloc(sizeof(TGM_ReadPairOutFile));
+    if (pOutFile == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a read pair output file object.\n");
+
+    char* fileName = TGM_CreateFileName(workingDir, TGM_ReadPairFileName);
+
+    pOutFile->output = fopen(fileName, "r+b");
+    if (pOutFile->output == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the read pair file: %s\n", fileName);
+
+    TGM_ReadPairFileHeader header;
+    if (fread(&header, sizeof(TGM_ReadPairFileHeader), 1, pOutFile->output) != 1
+        || memcmp(header.magic, TGM_READ_PAIR_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.version != TGM_READ_PAIR_FILE_VERSION)
+    {
+        TGM_ErrQuit("ERROR: \"%s\" is not a valid read pair file.\n", fileName);
+    }
+
+    // drop everything written after the last commit (including the index of a finished build)
+    if (offset < sizeof(TGM_ReadPairFileHeader) || ftruncate(fileno(pOutFile->output), offset) != 0 || fseeko(pOutFile->output, offset, SEEK_SET) != 0)
+        TGM_ErrQuit("ERROR: Cannot truncate the read pair file: %s\n", fileName);
+
+    free(fileName);
+
+    TGM_ReadPairOutFileInit(pOutFile, compressLevel);
+
+    uint64_t capacity = (numChunks > DEFAULT_RP_CHUNK_CAPACITY ? numChunks : DEFAULT_RP_CHUNK_CAPACITY);
+    TGM_ARRAY_ALLOC(pOutFile->pChunkArray, capacity, TGM_ReadPairChunkArray, TGM_ReadPairChunk);
+
+    memcpy(pOutFile->pChunkArray->data, pChunks, numChunks * sizeof(TGM_ReadPairChunk));
+    pOutFile->pChunkArray->size = numChunks;
+
+    pOutFile->currOffset = offset;
+
+    return pOutFile;
+}
+
+void TGM_ReadPairOutFileClose(TGM_ReadPairOutFile* pOutFile)
+{
+    if (pOutFile != NULL)
+    {
+        pthread_mutex_lock(&(pOutFile->mutex));
+        pOutFile->isClosing = TRUE;
+        pthread_cond_broadcast(&(pOutFile->cond));
+        pthread_mutex_unlock(&(pOutFile->mutex));
+
+        // the writer thread finishes the pending job before it quits
+        pthread_join(pOutFile->writer, NULL);
+        pthread_mutex_destroy(&(pOutFile->mutex));
+        pthread_cond_destroy(&(pOutFile->cond));
+
+        TGM_ReadPairOutFilePad(pOutFile);
+
+        TGM_ReadPairFileTrailer trailer;
+        memset(&trailer, 0, sizeof(TGM_ReadPairFileTrailer));
+
+        trailer.indexOffset = pOutFile->currOffset;
+        trailer.numChunks = pOutFile->pChunkArray->size;
+        memcpy(trailer.magic, TGM_READ_PAIR_FILE_MAGIC, sizeof(trailer.magic));
+        trailer.version = TGM_READ_PAIR_FILE_VERSION;
+
+        // the index is sorted so that the detector can find all the chunks of a reference with a binary search
+        qsort(pOutFile->pChunkArray->data, pOutFile->pChunkArray->size, sizeof(TGM_ReadPairChunk), CompareChunks);
+
+        uint64_t writeSize = fwrite(pOutFile->pChunkArray->data, sizeof(TGM_ReadPairChunk), pOutFile->pChunkArray->size, pOutFile->output);
+        if (writeSize != pOutFile->pChunkArray->size)
+            TGM_ErrQuit("ERROR: Cannot write the chunk index of the read pair file.\n");
+
+        if (fwrite(&trailer, sizeof(TGM_ReadPairFileTrailer), 1, pOutFile->output) != 1)
+            TGM_ErrQuit("ERROR: Cannot write the trailer of the read pair file.\n");
+
+        fclose(pOutFile->output);
+        free(pOutFile->pStreamBuff);
+        TGM_ARRAY_FREE(pOutFile->pChunkArray, TRUE);
+        TGM_ReadPairCodecBuffFree(pOutFile->pCodecBuff);
+
+        free(pOutFile);
+    }
+}
+
+TGM_ReadPairInFile* TGM_ReadPairInFileOpen(const char* workingDir, unsigned int numThreads)
+{
+    TGM_ReadPairInFile* pInFile = (TGM_ReadPairInFile*) malloc(sizeof(TGM_ReadPairInFile));
+    if (pInFile == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a read pair input file object.\n");
+
+    char* fileName = TGM_CreateFileName(workingDir, TGM_ReadPairFileName);
+
+    pInFile->input = fopen(fileName, "rb");
+    if (pInFile->input == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the read pair file: %s\n", fileName);
+
+    TGM_ReadPairFileHeader header;
+    if (fread(&header, sizeof(TGM_ReadPairFileHeader), 1, pInFile->input) != 1
+        || memcmp(header.magic, TGM_READ_PAIR_FILE_MAGIC, sizeof(header.magic)) != 0)
+    {
+        TGM_ErrQuit("ERROR: \"%s\" is not a valid read pair file.\n", fileName);
+    }
+
+    if (header.version != TGM_READ_PAIR_FILE_VERSION)
+        TGM_ErrQuit("ERROR: Unsupported version of the read pair file: %u.\n", header.version);
+
+    TGM_ReadPairFileTrailer trailer;
+    if (fseeko(pInFile->input, -((off_t) sizeof(TGM_ReadPairFileTrailer)), SEEK_END) != 0
+        || fread(&trailer, sizeof(TGM_ReadPairFileTrailer), 1, pInFile->input) != 1
+        || memcmp(trailer.magic, TGM_READ_PAIR_FILE_MAGIC, sizeof(trailer.magic)) != 0)
+    {
+        TGM_ErrQuit("ERROR: The read pair file \"%s\" is truncated.\n", fileName);
+    }
+
+    free(fileName);
+
+    pInFile->numThreads = (numThreads > 0 ? numThreads : 1);
+
+    uint64_t capacity = (trailer.numChunks > 0 ? trailer.numChunks : 1);
+    TGM_ARRAY_ALLOC(pInFile->pChunkArray, capacity, TGM_ReadPairChunkArray, TGM_ReadPairChunk);
+
+    if (fseeko(pInFile->input, trailer.indexOffset, SEEK_SET) != 0)
+        TGM_ErrQuit("ERROR: Cannot seek the chunk index of the read pair file.\n");
+
+    if (trailer.numChunks > 0 && fread(pInFile->pChunkArray->data, sizeof(TGM_ReadPairChunk), trailer.numChunks, pInFile->input) != trailer.numChunks)
+        TGM_ErrQuit("ERROR: Cannot read the chunk index of the read pair file.\n");
+
+    pInFile->pChunkArray->size = trailer.numChunks;
+
+    // map the whole container so that the read pairs can be used in place and
+    // the page cache is shared with other processes reading the same file
+    pInFile->pMap = NULL;
+    pInFile->mapSize = 0;
+
+    struct stat fileStat;
+    if (fstat(fileno(pInFile->input), &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* pMap = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fileno(pInFile->input), 0);
+        if (pMap != MAP_FAILED)
+        {
+            pInFile->pMap = pMap;
+            pInFile->mapSize = fileStat.st_size;
+        }
+    }
+
+    return pInFile;
+}
+
+void TGM_ReadPairInFileClose(TGM_ReadPairInFile* pInFile)
+{
+    if (pInFile != NULL)
+    {
+        if (pInFile->pMap != NULL)
+            munmap((void*) pInFile->pMap, pInFile->mapSize);
+
+        fclose(pInFile->input);
+        TGM_ARRAY_FREE(pInFile->pChunkArray, TRUE);
+
+        free(pInFile);
+    }
+}
+
+TGM_ReadPairStream* TGM_ReadPairStreamOpen(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType)
+{
+    TGM_ReadPairStream* pStream = (TGM_ReadPairStream*) calloc(1, sizeof(TGM_ReadPairStream));
+    if (pStream == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for a read pair stream object.\n");
+
+    pStream->pInFile = pInFile;
+    pStream->refID = refID;
+    pStream->chunkType = chunkType;
+    pStream->recordSize = TGM_ReadPairRecordSize(chunkType);
+
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    TGM_ReadPairInFileFind(&begin, &end, pInFile, refID, chunkType);
+
+    pStream->pRuns = (TGM_ReadPairRun*) calloc(end - begin + 1, sizeof(TGM_ReadPairRun));
+    pStream->pHeap = (uint64_t*) malloc((end - begin + 1) * sizeof(uint64_t));
+    if (pStream->pRuns == NULL || pStream->pHeap == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the runs of a read pair stream.\n");
+
+    pStream->pCodecBuff = TGM_ReadPairCodecBuffAlloc();
+
+    // the index tells where each run starts, so no run is read before the merge reaches it
+    for (uint64_t i = begin; i != end; ++i)
+    {
+        const TGM_ReadPairChunk* pChunk = pInFile->pChunkArray->data + i;
+        if (pChunk->numPairs == 0)
+            continue;
+
+        TGM_ReadPairRun* pRun = pStream->pRuns + pStream->numRuns;
+        pRun->pChunk = pChunk;
+        pRun->startPos = pChunk->startPos;
+
+        ++(pStream->numRuns);
+    }
+
+    qsort(pStream->pRuns, pStream->numRuns, sizeof(TGM_ReadPairRun), CompareRuns);
+
+    return pStream;
+}
+
+void TGM_ReadPairStreamClose(TGM_ReadPairStream* pStream)
+{
+    if (pStream != NULL)
+    {
+        for (uint64_t i = 0; i != pStream->numRuns; ++i)
+            TGM_ReadPairRunClose(pStream->pRuns + i);
+
+        TGM_ReadPairCodecBuffFree(pStream->pCodecBuff);
+        free(pStream->pRuns);
+        free(pStream->pHeap);
+        free(pStream->pStage);
+
+        free(pStream);
+    }
+}
+
+
+//======================
+// Interface functions
+//======================
+
+void TGM_ReadPairOutFileWrite(TGM_ReadPairOutFile* pOutFile, int32_t refID, TGM_ReadPairChunkType chunkType,
+                             const void* pData, size_t recordSize, uint64_t numPairs)
+{
+    if (numPairs == 0)
+        return;
+
+    if (pOutFile->compressLevel == 0)
+    {
+        // a raw chunk is not sorted. its smallest position is kept in the index so that a stream can place it without reading it
+        int32_t startPos = TGM_ReadPairRecordPos(pData, chunkType);
+        for (uint64_t i = 1; i != numPairs; ++i)
+        {
+            int32_t pos = TGM_ReadPairRecordPos((const char*) pData + recordSize * i, chunkType);
+            if (pos < startPos)
+                startPos = pos;
+        }
+
+        TGM_ReadPairOutFileAppend(pOutFile, refID, chunkType, TGM_RP_CODEC_RAW, pData, recordSize * numPairs, numPairs, startPos);
+        return;
+    }
+
+    if (recordSize != TGM_ReadPairRecordSize(chunkType))
+        TGM_ErrQuit("ERROR: Unexpected record size for the compressed read pairs.\n");
+
+    // each block is an independent index entry so that the detector can decode them in parallel
+    const char* pCurr = (const char*) pData;
+    for (uint64_t i = 0; i < numPairs; i += TGM_RP_CODEC_BLOCK_PAIRS)
+    {
+        uint64_t blockPairs = (numPairs - i < TGM_RP_CODEC_BLOCK_PAIRS ? numPairs - i : TGM_RP_CODEC_BLOCK_PAIRS);
+
+        const uint8_t* pBlock = NULL;
+        uint64_t blockSize = TGM_ReadPairBlockEncode(&pBlock, pOutFile->pCodecBuff, refID, chunkType, pCurr, blockPairs, pOutFile->compressLevel);
+
+        TGM_ReadPairOutFileAppend(pOutFile, refID, chunkType, TGM_RP_CODEC_DELTA_ZLIB, pBlock, blockSize, blockPairs, TGM_ReadPairBlockStartPos(pBlock, blockSize));
+        pCurr += recordSize * blockPairs;
+    }
+}
+
+void TGM_ReadPairOutFileSubmit(TGM_ReadPairOutFile* pOutFile, TGM_ReadPairWriteFunc writeFunc, void* pTable)
+{
+    pthread_mutex_lock(&(pOutFile->mutex));
+
+    while (pOutFile->isBusy)
+        pthread_cond_wait(&(pOutFile->cond), &(pOutFile->mutex));
+
+    pOutFile->writeFunc = writeFunc;
+    pOutFile->pWriteTable = pTable;
+    pOutFile->isBusy = TRUE;
+    pthread_cond_broadcast(&(pOutFile->cond));
+
+    pthread_mutex_unlock(&(pOutFile->mutex));
+}
+
+void TGM_ReadPairOutFileSync(TGM_ReadPairOutFile* pOutFile)
+{
+    pthread_mutex_lock(&(pOutFile->mutex));
+
+    while (pOutFile->isBusy)
+        pthread_cond_wait(&(pOutFile->cond), &(pOutFile->mutex));
+
+    pthread_mutex_unlock(&(pOutFile->mutex));
+}
+
+void TGM_ReadPairOutFileFlush(TGM_ReadPairOutFile* pOutFile)
+{
+    TGM_ReadPairOutFileSync(pOutFile);
+
+    if (fflush(pOutFile->output) != 0 || fsync(fileno(pOutFile->output)) != 0)
+        TGM_ErrQuit("ERROR: Cannot flush the read pair file.\n");
+}
+
+void TGM_ReadPairInFileFind(uint64_t* pBegin, uint64_t* pEnd, const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType)
+{
+    const TGM_ReadPairChunkArray* pChunkArray = pInFile->pChunkArray;
+    TGM_ReadPairChunk key = {.refID = refID, .chunkType = chunkType};
+
+    // lower bound of the key
+    uint64_t low = 0;
+    uint64_t high = pChunkArray->size;
+    while (low < high)
+    {
+        uint64_t mid = low + (high - low) / 2;
+        if (CompareChunks(pChunkArray->data + mid, &key) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    *pBegin = low;
+
+    while (low != pChunkArray->size && pChunkArray->data[low].refID == refID && pChunkArray->data[low].chunkType == chunkType)
+        ++low;
+
+    *pEnd = low;
+}
+
+uint64_t TGM_ReadPairInFileCount(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType)
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    TGM_ReadPairInFileFind(&begin, &end, pInFile, refID, chunkType);
+
+    uint64_t numPairs = 0;
+    for (uint64_t i = begin; i != end; ++i)
+        numPairs += pInFile->pChunkArray->data[i].numPairs;
+
+    return numPairs;
+}
+
+uint64_t TGM_ReadPairInFileRead(void* pBuff, const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType, size_t recordSize)
+{
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    TGM_ReadPairInFileFind(&begin, &end, pInFile, refID, chunkType);
+
+    const TGM_ReadPairChunk* pChunks = pInFile->pChunkArray->data + begin;
+    uint64_t numChunks = end - begin;
+    if (numChunks == 0)
+        return 0;
+
+    uint64_t* pStageOffsets = (uint64_t*) malloc(2 * numChunks * sizeof(uint64_t));
+    if (pStageOffsets == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the chunk offsets.\n");
+
+    uint64_t* pDstOffsets = pStageOffsets + numChunks;
+
+    // raw chunks are read straight into the output buffer
+    // while compressed ones are staged for the decompression threads.
+    // a mapped container is its own staging buffer
+    const TGM_Bool isMapped = (pInFile->pMap != NULL);
+    uint64_t numPairs = 0;
+    uint64_t stageSize = 0;
+    uint64_t numCompressed = 0;
+    for (uint64_t i = 0; i != numChunks; ++i)
+    {
+        if (pChunks[i].codec == TGM_RP_CODEC_RAW)
+        {
+            if (pChunks[i].size != pChunks[i].numPairs * recordSize)
+                TGM_ErrQuit("ERROR: Unexpected record size in the read pair file.\n");
+        }
+        else
+        {
+            if (recordSize != TGM_ReadPairRecordSize(chunkType))
+                TGM_ErrQuit("ERROR: Unexpected record size in the read pair file.\n");
+
+            if (isMapped)
+            {
+                pStageOffsets[i] = pChunks[i].offset;
+            }
+            else
+            {
+                pStageOffsets[i] = stageSize;
+                stageSize += pChunks[i].size;
+            }
+
+            ++numCompressed;
+        }
+
+        if (isMapped && pChunks[i].offset + pChunks[i].size > pInFile->mapSize)
+            TGM_ErrQuit("ERROR: The read pair file is truncated.\n");
+
+        pDstOffsets[i] = numPairs * recordSize;
+        numPairs += pChunks[i].numPairs;
+    }
+
+    // the loaders of the detection engines read at the same time. each call stages its own blocks
+    uint8_t* pStage = NULL;
+    if (stageSize > 0)
+    {
+        pStage = (uint8_t*) malloc(stageSize);
+        if (pStage == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the staging buffer of the read pair file.\n");
+    }
+
+    char* pDst = (char*) pBuff;
+    for (uint64_t i = 0; i != numChunks; ++i)
+    {
+        const TGM_ReadPairChunk* pChunk = pChunks + i;
+
+        if (isMapped)
+        {
+            if (pChunk->codec == TGM_RP_CODEC_RAW)
+                memcpy(pDst + pDstOffsets[i], pInFile->pMap + pChunk->offset, pChunk->size);
+
+            continue;
+        }
+
+        // pread does not move the shared file position of the other readers
+        void* pTarget = (pChunk->codec == TGM_RP_CODEC_RAW ? (void*) (pDst + pDstOffsets[i]) : (void*) (pStage + pStageOffsets[i]));
+        if (pread(fileno(pInFile->input), pTarget, pChunk->size, pChunk->offset) != (ssize_t) pChunk->size)
+            TGM_ErrQuit("ERROR: Cannot read the read pairs from the read pair file.\n");
+    }
+
+    if (numCompressed > 0)
+    {
+        unsigned int numThreads = (numCompressed < pInFile->numThreads ? numCompressed : pInFile->numThreads);
+
+        TGM_ReadPairDecodeJob jobs[numThreads];
+        pthread_t threads[numThreads];
+
+        for (unsigned int t = 0; t != numThreads; ++t)
+        {
+            jobs[t].pChunks = pChunks;
+            jobs[t].pStageOffsets = pStageOffsets;
+            jobs[t].pDstOffsets = pDstOffsets;
+            jobs[t].numChunks = numChunks;
+            jobs[t].pStage = (isMapped ? pInFile->pMap : pStage);
+            jobs[t].pDst = pDst;
+            jobs[t].threadID = t;
+            jobs[t].numThreads = numThreads;
+        }
+
+        // the calling thread takes the first share of the blocks
+        for (unsigned int t = 1; t < numThreads; ++t)
+        {
+            if (pthread_create(threads + t, NULL, TGM_ReadPairDecodeThread, jobs + t) != 0)
+                TGM_ErrQuit("ERROR: Cannot create a decompression thread.\n");
+        }
+
+        TGM_ReadPairDecodeThread(jobs);
+
+        for (unsigned int t = 1; t < numThreads; ++t)
+            pthread_join(threads[t], NULL);
+    }
+
+    free(pStage);
+    free(pStageOffsets);
+
+    return numPairs;
+}
+
+const void* TGM_ReadPairInFileMap(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType, size_t recordSize, uint64_t* pNumPairs)
+{
+    *pNumPairs = 0;
+    if (pInFile->pMap == NULL)
+        return NULL;
+
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    TGM_ReadPairInFileFind(&begin, &end, pInFile, refID, chunkType);
+
+    // the read pairs must be contiguous, uncompressed and aligned
+    if (end - begin != 1)
+        return NULL;
+
+    const TGM_ReadPairChunk* pChunk = pInFile->pChunkArray->data + begin;
+    if (pChunk->codec != TGM_RP_CODEC_RAW
+        || pChunk->size != pChunk->numPairs * recordSize
+        || pChunk->offset % TGM_READ_PAIR_CHUNK_ALIGN != 0
+        || pChunk->offset + pChunk->size > pInFile->mapSize)
+    {
+        return NULL;
+    }
+
+    uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t pageOffset = pChunk->offset - pChunk->offset % pageSize;
+
+    posix_madvise((void*) (pInFile->pMap + pageOffset), pChunk->offset + pChunk->size - pageOffset, POSIX_MADV_SEQUENTIAL);
+    posix_madvise((void*) (pInFile->pMap + pageOffset), pChunk->offset + pChunk->size - pageOffset, POSIX_MADV_WILLNEED);
+
+    *pNumPairs = pChunk->numPairs;
+    return pInFile->pMap + pChunk->offset;
+}
+
+const void* TGM_ReadPairStreamNext(TGM_ReadPairStream* pStream)
+{
+    if (pStream->pRetired != NULL)
+    {
+        TGM_ReadPairRunClose(pStream->pRetired);
+        pStream->pRetired = NULL;
+    }
+
+    // a run joins the merge once the merge reaches its first position
+    while (pStream->nextRun != pStream->numRuns)
+    {
+        TGM_ReadPairRun* pRun = pStream->pRuns + pStream->nextRun;
+        if (pStream->heapSize > 0)
+        {
+            const TGM_ReadPairRun* pTop = pStream->pRuns + pStream->pHeap[0];
+            int32_t topPos = TGM_ReadPairRecordPos(TGM_ReadPairRunRecord(pStream, pTop, pTop->next), pStream->chunkType);
+            if (pRun->startPos > topPos)
+                break;
+        }
+
+        if (pRun->pRecords == NULL)
+            TGM_ReadPairRunOpen(pStream, pRun);
+
+        TGM_ReadPairStreamPush(pStream, pStream->nextRun);
+        ++(pStream->nextRun);
+    }
+
+    if (pStream->heapSize == 0)
+        return NULL;
+
+    TGM_ReadPairRun* pRun = pStream->pRuns + pStream->pHeap[0];
+    const void* pRecord = TGM_ReadPairRunRecord(pStream, pRun, pRun->next);
+
+    ++(pRun->next);
+    if (pRun->next == pRun->pChunk->numPairs)
+    {
+        // the record stays valid till the next call
+        pStream->pRetired = pRun;
+
+        --(pStream->heapSize);
+        pStream->pHeap[0] = pStream->pHeap[pStream->heapSize];
+    }
+
+    if (pStream->heapSize > 0)
+        TGM_ReadPairStreamSiftDown(pStream, 0);
+
+    return pRecord;
+}
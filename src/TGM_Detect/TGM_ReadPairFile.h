@@ -0,0 +1,441 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadPairFile.h
+ *
+ *    Description:  single indexed container for the read pair data
+ *
+ *        Version:  1.0
+ *        Created:
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:
+ *        Company:
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_READPAIRFILE_H
+#define  TGM_READPAIRFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "TGM_Types.h"
+
+//===============================
+// Type and constant definition
+//===============================
+
+// version of the read pair container format
+#define TGM_READ_PAIR_FILE_VERSION 1
+
+// all the chunks in the container start at a multiple of this value
+#define TGM_READ_PAIR_CHUNK_ALIGN 8
+
+// size and alignment of the stream buffer of the output container
+#define TGM_READ_PAIR_WRITE_BUFF_SIZE (8 << 20)
+
+#define TGM_READ_PAIR_WRITE_BUFF_ALIGN 4096
+
+// type of the read pairs stored in a chunk
+typedef enum
+{
+    TGM_LONG_PAIR_CHUNK = 0,             // long pairs (deletion)
+
+    TGM_SHORT_PAIR_CHUNK = 1,            // short pairs (tandem duplication)
+
+    TGM_REVERSED_PAIR_CHUNK = 2,         // reversed pairs (tandem duplication)
+
+    TGM_INVERTED_PAIR_CHUNK = 3,         // inverted pairs (inversion)
+
+    TGM_SPECIAL_PAIR_CHUNK = 4,          // special pairs (retro insertion)
+
+    TGM_CROSS_PAIR_CHUNK = 5,            // cross pairs (inter-chromosome translocation)
+
+    TGM_SPLIT_LONG_CHUNK = 6,            // long split pairs
+
+    TGM_SPLIT_SHORT_CHUNK = 7,           // short split pairs
+
+    TGM_SPLIT_REVERSED_CHUNK = 8,        // reversed split pairs
+
+    TGM_SPLIT_INVERTED_CHUNK = 9,        // inverted split pairs
+
+    TGM_SPLIT_SPECIAL_CHUNK = 10         // special split pairs
+
+}TGM_ReadPairChunkType;
+
+#define TGM_NUM_RP_CHUNK_TYPES 11
+
+// encoding of the read pairs in a chunk
+typedef enum
+{
+    TGM_RP_CODEC_RAW = 0,                // fixed-size records
+
+    TGM_RP_CODEC_DELTA_ZLIB = 1          // position sorted, delta encoded, varint packed and zlib compressed block
+
+}TGM_ReadPairCodec;
+
+// index entry of a chunk in the read pair container
+typedef struct TGM_ReadPairChunk
+{
+    int32_t refID;                 // reference ID of the read pairs in this chunk
+
+    int16_t chunkType;             // read pair type of this chunk
+
+    int16_t codec;                 // encoding of the read pairs in this chunk
+
+    uint64_t offset;               // file offset of the chunk
+
+    uint64_t numPairs;             // number of read pairs in the chunk
+
+    uint64_t size;                 // number of bytes of the chunk in the file
+
+    int32_t startPos;              // smallest position of the read pairs in the chunk
+
+    unsigned char digest[16];      // md5 digest of the bytes of the chunk in the file
+
+}TGM_ReadPairChunk;
+
+typedef struct TGM_ReadPairChunkArray
+{
+    TGM_ReadPairChunk* data;       // index entries
+
+    uint64_t size;                 // number of index entries
+
+    uint64_t capacity;             // capacity of the index array
+
+}TGM_ReadPairChunkArray;
+
+struct TGM_ReadPairOutFile;
+
+// a function that writes a table of read pairs into the output container
+typedef void (*TGM_ReadPairWriteFunc) (void* pTable, struct TGM_ReadPairOutFile* pOutFile);
+
+// output container (used by the read pair build)
+typedef struct TGM_ReadPairOutFile
+{
+    FILE* output;                         // output stream of the container
+
+    char* pStreamBuff;                    // aligned stream buffer of the output
+
+    pthread_t writer;                     // writer thread
+
+    pthread_mutex_t mutex;                // mutex protecting the pending write job
+
+    pthread_cond_t cond;                  // signaled when a write job is submitted or finished
+
+    TGM_ReadPairWriteFunc writeFunc;      // function of the pending write job
+
+    void* pWriteTable;                    // table of the pending write job
+
+    TGM_Bool isBusy;                      // a write job is pending or running
+
+    TGM_Bool isClosing;                   // the writer thread should quit
+
+    TGM_ReadPairChunkArray* pChunkArray;  // index of all the chunks written so far
+
+    uint64_t currOffset;                  // current file offset
+
+    int compressLevel;                    // zlib compression level (0 means raw records)
+
+    struct TGM_ReadPairCodecBuff* pCodecBuff;  // buffers used to encode the compressed blocks
+
+}TGM_ReadPairOutFile;
+
+// input container (used by the read pair detect)
+typedef struct TGM_ReadPairInFile
+{
+    FILE* input;                          // input stream of the container
+
+    const uint8_t* pMap;                  // read-only shared mapping of the container (NULL if it cannot be mapped)
+
+    uint64_t mapSize;                     // size of the mapping
+
+    TGM_ReadPairChunkArray* pChunkArray;  // index sorted by reference ID, chunk type and file offset
+
+    unsigned int numThreads;              // number of threads used to decompress the blocks
+
+}TGM_ReadPairInFile;
+
+// a position sorted run of read pairs in the input container: a compressed block or a raw chunk
+typedef struct TGM_ReadPairRun
+{
+    const TGM_ReadPairChunk* pChunk;      // index entry of the run
+
+    int32_t startPos;                     // position of the first read pair of the run
+
+    const char* pRecords;                 // read pairs of the run (NULL till the run is opened)
+
+    void* pBuff;                          // decoded or copied read pairs (NULL if they are used in place)
+
+    uint32_t* pOrder;                     // position order of an unsorted raw chunk (NULL if the read pairs are sorted)
+
+    uint64_t next;                        // next read pair of the run
+
+}TGM_ReadPairRun;
+
+// reader of the read pairs of one reference and chunk type in position order. the runs are merged
+// and a run is only opened when the merge reaches its first position, so only the runs overlapping
+// the current position are in memory
+typedef struct TGM_ReadPairStream
+{
+    const TGM_ReadPairInFile* pInFile;    // input container
+
+    int32_t refID;                        // reference ID of the read pairs
+
+    TGM_ReadPairChunkType chunkType;      // read pair type of the chunks
+
+    size_t recordSize;                    // size of a read pair record
+
+    TGM_ReadPairRun* pRuns;               // runs of the read pairs sorted by their first position
+
+    uint64_t numRuns;                     // number of runs
+
+    uint64_t nextRun;                     // next run to be opened
+
+    uint64_t* pHeap;                      // open runs in a min heap on the position of their next read pair
+
+    uint64_t heapSize;                    // number of open runs
+
+    TGM_ReadPairRun* pRetired;            // run finished by the last call, freed by the next one
+
+    struct TGM_ReadPairCodecBuff* pCodecBuff;  // buffers used to decode the compressed blocks
+
+    uint8_t* pStage;                      // compressed block read from an unmapped container
+
+    uint64_t stageCap;                    // capacity of the staging buffer
+
+}TGM_ReadPairStream;
+
+
+//===============================
+// Constructors and Destructors
+//===============================
+
+//================================================================
+// function:
+//      create the read pair container in the working directory,
+//      write the file header and start the writer thread
+//
+// args:
+//      1. workingDir: the working directory for the detector
+//      2. compressLevel: zlib compression level of the read
+//                        pairs. 0 means storing raw records
+//
+// return:
+//      a pointer to the output container
+//================================================================
+TGM_ReadPairOutFile* TGM_ReadPairOutFileOpen(const char* workingDir, int compressLevel);
+
+//================================================================
+// function:
+//      reopen a partially written read pair container, truncate
+//      it to the last committed offset and restore its chunk
+//      index
+//
+// args:
+//      1. workingDir: the working directory for the detector
+//      2. compressLevel: zlib compression level of the read
+//                        pairs. 0 means storing raw records
+//      3. offset: file offset of the last commit
+//      4. pChunks: the chunk index at the last commit
+//      5. numChunks: number of entries in the chunk index
+//
+// return:
+//      a pointer to the output container
+//================================================================
+TGM_ReadPairOutFile* TGM_ReadPairOutFileResume(const char* workingDir, int compressLevel, uint64_t offset, const TGM_ReadPairChunk* pChunks, uint64_t numChunks);
+
+//================================================================
+// function:
+//      wait for the pending write job, write the chunk index and
+//      the trailer at the end of the read pair container and
+//      close it
+//
+// args:
+//      1. pOutFile: a pointer to the output container
+//================================================================
+void TGM_ReadPairOutFileClose(TGM_ReadPairOutFile* pOutFile);
+
+//================================================================
+// function:
+//      open the read pair container in the working directory,
+//      load its chunk index and map it into memory
+//
+// args:
+//      1. workingDir: the working directory for the detector
+//      2. numThreads: number of threads used to decompress
+//                     the compressed blocks
+//
+// return:
+//      a pointer to the input container
+//================================================================
+TGM_ReadPairInFile* TGM_ReadPairInFileOpen(const char* workingDir, unsigned int numThreads);
+
+void TGM_ReadPairInFileClose(TGM_ReadPairInFile* pInFile);
+
+//================================================================
+// function:
+//      open a position ordered reader of the read pairs of a
+//      given reference and chunk type. the runs are placed in
+//      the merge by the start positions in the index. raw chunks
+//      are used in place (or read) and sorted, and compressed
+//      blocks are decoded, when the merge reaches them
+//
+// args:
+//      1. pInFile: a pointer to the input container
+//      2. refID: reference ID of the read pairs
+//      3. chunkType: read pair type of the chunks
+//
+// return:
+//      a pointer to the read pair stream
+//================================================================
+TGM_ReadPairStream* TGM_ReadPairStreamOpen(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType);
+
+void TGM_ReadPairStreamClose(TGM_ReadPairStream* pStream);
+
+
+//======================
+// Interface functions
+//======================
+
+//================================================================
+// function:
+//      append a chunk of read pairs to the container. if
+//      compression is on, the read pairs are split into blocks
+//      and each block gets its own index entry
+//
+// args:
+//      1. pOutFile: a pointer to the output container
+//      2. refID: reference ID of the read pairs
+//      3. chunkType: read pair type of the chunk
+//      4. pData: a pointer to the read pairs
+//      5. recordSize: size of a read pair record
+//      6. numPairs: number of read pairs
+//================================================================
+void TGM_ReadPairOutFileWrite(TGM_ReadPairOutFile* pOutFile, int32_t refID, TGM_ReadPairChunkType chunkType,
+                             const void* pData, size_t recordSize, uint64_t numPairs);
+
+//================================================================
+// function:
+//      hand a table of read pairs over to the writer thread. the
+//      caller must not touch the table until the next call of
+//      TGM_ReadPairOutFileSync or TGM_ReadPairOutFileSubmit
+//      returns. only the writer thread may write into the output
+//      container while it is open
+//
+// args:
+//      1. pOutFile: a pointer to the output container
+//      2. writeFunc: function that writes the table
+//      3. pTable: the table to be written
+//================================================================
+void TGM_ReadPairOutFileSubmit(TGM_ReadPairOutFile* pOutFile, TGM_ReadPairWriteFunc writeFunc, void* pTable);
+
+//================================================================
+// function:
+//      wait until the writer thread finishes the pending job
+//
+// args:
+//      1. pOutFile: a pointer to the output container
+//================================================================
+void TGM_ReadPairOutFileSync(TGM_ReadPairOutFile* pOutFile);
+
+//================================================================
+// function:
+//      wait for the writer thread and flush everything written
+//      so far to the disk
+//
+// args:
+//      1. pOutFile: a pointer to the output container
+//================================================================
+void TGM_ReadPairOutFileFlush(TGM_ReadPairOutFile* pOutFile);
+
+//================================================================
+// function:
+//      get the total number of read pairs of a given reference
+//      and chunk type
+//
+// args:
+//      1. pInFile: a pointer to the input container
+//      2. refID: reference ID of the read pairs
+//      3. chunkType: read pair type of the chunk
+//
+// return:
+//      number of read pairs
+//================================================================
+uint64_t TGM_ReadPairInFileCount(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType);
+
+//================================================================
+// function:
+//      read all the read pairs of a given reference and chunk
+//      type into a buffer. compressed blocks are decoded in
+//      parallel. several threads may read from the container at
+//      the same time
+//
+// args:
+//      1. pBuff: buffer large enough to hold all the read pairs
+//      2. pInFile: a pointer to the input container
+//      3. refID: reference ID of the read pairs
+//      4. chunkType: read pair type of the chunk
+//      5. recordSize: size of a read pair record
+//
+// return:
+//      number of read pairs read
+//================================================================
+uint64_t TGM_ReadPairInFileRead(void* pBuff, const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType, size_t recordSize);
+
+//================================================================
+// function:
+//      get the read pairs of a given reference and chunk type in
+//      place from the mapped container. this only works if they
+//      are stored as raw records in a single chunk. the pages are
+//      advised for sequential access
+//
+// args:
+//      1. pInFile: a pointer to the input container
+//      2. refID: reference ID of the read pairs
+//      3. chunkType: read pair type of the chunk
+//      4. recordSize: size of a read pair record
+//      5. pNumPairs: output number of read pairs
+//
+// return:
+//      a read-only pointer to the read pairs. NULL if they
+//      cannot be used in place (TGM_ReadPairInFileRead must be
+//      used instead)
+//================================================================
+const void* TGM_ReadPairInFileMap(const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType, size_t recordSize, uint64_t* pNumPairs);
+
+//================================================================
+// function:
+//      find the index range of the chunks of a given reference
+//      and chunk type
+//
+// args:
+//      1. pBegin: output index of the first chunk
+//      2. pEnd: output index right after the last chunk
+//      3. pInFile: a pointer to the input container
+//      4. refID: reference ID of the read pairs
+//      5. chunkType: read pair type of the chunk
+//================================================================
+void TGM_ReadPairInFileFind(uint64_t* pBegin, uint64_t* pEnd, const TGM_ReadPairInFile* pInFile, int32_t refID, TGM_ReadPairChunkType chunkType);
+
+//================================================================
+// function:
+//      get the next read pair of a stream. the read pairs come
+//      out in position order (ties in the order of the chunk
+//      index) and the blocks behind the current position are
+//      freed
+//
+// args:
+//      1. pStream: a pointer to the read pair stream
+//
+// return:
+//      a read-only pointer to the read pair (valid till the next
+//      call). NULL at the end of the stream
+//================================================================
+const void* TGM_ReadPairStreamNext(TGM_ReadPairStream* pStream);
+
+#endif  /*TGM_READPAIRFILE_H*/